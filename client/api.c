@@ -263,12 +263,16 @@ TDNFCheckLocalPackages(
     Solvable *s = NULL;
     Id p;
 
-    if(!pTdnf || !pTdnf->pSack || !pTdnf->pSack->pPool || !pszLocalPath)
+    if(!pTdnf || !pszLocalPath)
     {
         dwError = ERROR_TDNF_INVALID_PARAMETER;
         BAIL_ON_TDNF_ERROR(dwError);
     }
 
+    /* problems are checked for providers in the installed set */
+    dwError = TDNFInitHandleStages(pTdnf, TDNF_INIT_STAGE_PROVIDES);
+    BAIL_ON_TDNF_ERROR(dwError);
+
     queue_init(&queueJobs);
 
     pr_info("Checking all packages from: %s\n", pszLocalPath);
@@ -341,6 +345,69 @@ TDNFCheckUpdates(
     )
 {
     uint32_t dwError = 0;
+    char *pszJob = NULL;
+    char *pszSpecs = NULL;
+    char *pszCacheKey = NULL;
+    int nSpecCount = 0;
+    int nCached = 0;
+    PTDNF_UPDATE_SUMMARY pSummary = NULL;
+
+    if(!pTdnf || !pTdnf->pArgs || !ppPkgInfo || !pdwCount)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    dwError = TDNFInitHandleStages(pTdnf, TDNF_INIT_STAGE_REPOS);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    if (pTdnf->pArgs->pSetOpt)
+    {
+        dwError = TDNFHasOpt(pTdnf->pArgs, TDNF_SETOPT_KEY_CACHED, &nCached);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    /* --cached answers from the summary written by makecache */
+    if (nCached && (!ppszPackageNameSpecs || !ppszPackageNameSpecs[0]))
+    {
+        dwError = TDNFGetUpdateSummary(pTdnf, &pSummary);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        *ppPkgInfo = pSummary->pPkgInfos;
+        *pdwCount = pSummary->dwPkgCount;
+        pSummary->pPkgInfos = NULL;
+        pSummary->dwPkgCount = 0;
+        goto cleanup;
+    }
+
+    if (ppszPackageNameSpecs)
+    {
+        dwError = TDNFStringArrayCount(ppszPackageNameSpecs, &nSpecCount);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        dwError = TDNFJoinArrayToString(ppszPackageNameSpecs, " ", nSpecCount,
+                                        &pszSpecs);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    dwError = TDNFAllocateStringPrintf(&pszJob, "%s %s",
+                                       TDNF_RESULT_CACHE_SLOT_CHECK_UPDATE,
+                                       pszSpecs ? pszSpecs : "");
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    if (!TDNFResultCacheGetKey(pTdnf, pszJob,
+                               TDNF_RESULT_CACHE_KEY_FRESH |
+                               TDNF_RESULT_CACHE_KEY_ARGS,
+                               &pszCacheKey) &&
+        !TDNFResultCacheReadPkgInfoArray(pTdnf,
+                                         TDNF_RESULT_CACHE_SLOT_CHECK_UPDATE,
+                                         pszCacheKey,
+                                         ppPkgInfo,
+                                         pdwCount))
+    {
+        goto cleanup;
+    }
+
     dwError = TDNFList(
                   pTdnf,
                   SCOPE_UPGRADES,
@@ -349,9 +416,30 @@ TDNFCheckUpdates(
                   pdwCount);
     if(dwError == ERROR_TDNF_NO_MATCH)
     {
+        *ppPkgInfo = NULL;
+        *pdwCount = 0;
         dwError = 0;
     }
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    if (pszCacheKey)
+    {
+        TDNFResultCacheWritePkgInfoArray(pTdnf,
+                                         TDNF_RESULT_CACHE_SLOT_CHECK_UPDATE,
+                                         pszCacheKey,
+                                         *ppPkgInfo,
+                                         *pdwCount);
+    }
+
+cleanup:
+    TDNF_SAFE_FREE_MEMORY(pszJob);
+    TDNF_SAFE_FREE_MEMORY(pszSpecs);
+    TDNF_SAFE_FREE_MEMORY(pszCacheKey);
+    TDNFFreeUpdateSummary(pSummary);
     return dwError;
+
+error:
+    goto cleanup;
 }
 
 
@@ -377,6 +465,26 @@ TDNFClean(
         BAIL_ON_TDNF_ERROR(dwError);
     }
 
+    dwError = TDNFInitHandleStages(pTdnf, TDNF_INIT_STAGE_REPOS);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    if (nCleanType & CLEANTYPE_STALE)
+    {
+        /* no need to look at packages that are all removed below */
+        if (!(nCleanType & CLEANTYPE_PACKAGES))
+        {
+            dwError = TDNFCleanStalePackages(pTdnf);
+            BAIL_ON_TDNF_ERROR(dwError);
+        }
+        dwError = TDNFCleanStaleRepoDirs(pTdnf);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        if (nCleanType == CLEANTYPE_STALE)
+        {
+            goto cleanup;
+        }
+    }
+
     for (pRepo = pTdnf->pRepos; pRepo; pRepo = pRepo->pNext)
     {
         if (strcmp(pRepo->pszId, CMDLINE_REPO_NAME) == 0)
@@ -425,7 +533,7 @@ TDNFClean(
                If we did clean just one part it's not expected to be empty
                unless the other parts were already cleaned.
             */
-            if (nCleanType == CLEANTYPE_ALL)
+            if ((nCleanType & CLEANTYPE_ALL) == CLEANTYPE_ALL)
             {
                 pr_err("Cache directory for %s not removed because it's not empty.\n", pRepo->pszId);
             }
@@ -435,6 +543,17 @@ TDNFClean(
 
         pr_info("\n");
     }
+
+    if (nCleanType & CLEANTYPE_DBCACHE)
+    {
+        dwError = TDNFResultCacheRemove(pTdnf);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+    if (nCleanType & CLEANTYPE_PACKAGES)
+    {
+        dwError = TDNFPackageStorePrune(pTdnf);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
 cleanup:
     return dwError;
 
@@ -454,7 +573,7 @@ TDNFCountCommand(
     uint32_t dwError = 0;
     uint32_t dwCount = 0;
 
-    if(!pTdnf || !pTdnf->pSack || !pdwCount)
+    if(!pTdnf || !pdwCount)
     {
         dwError = ERROR_TDNF_INVALID_PARAMETER;
         BAIL_ON_TDNF_ERROR(dwError);
@@ -477,6 +596,35 @@ error:
     goto cleanup;
 }
 
+//Mark the packages of repos that were used with expired metadata
+static
+void
+_TDNFMarkStalePackages(
+    PTDNF pTdnf,
+    PTDNF_PKG_INFO pPkgInfo,
+    uint32_t dwCount
+    )
+{
+    PTDNF_REPO_DATA pRepo = NULL;
+    uint32_t i;
+
+    for (pRepo = pTdnf->pRepos; pRepo; pRepo = pRepo->pNext)
+    {
+        if (!pRepo->nStale)
+        {
+            continue;
+        }
+        for (i = 0; pPkgInfo && i < dwCount; i++)
+        {
+            if (pPkgInfo[i].pszRepoName &&
+                !strcmp(pPkgInfo[i].pszRepoName, pRepo->pszId))
+            {
+                pPkgInfo[i].nStale = 1;
+            }
+        }
+    }
+}
+
 //Lists info on each installed package
 //Returns a sum of installed size
 uint32_t
@@ -526,7 +674,7 @@ TDNFListInternal(
     PSolvQuery pQuery = NULL;
     PSolvPackageList pPkgList = NULL;
 
-    if(!pTdnf || !pTdnf->pSack || !ppszPackageNameSpecs ||
+    if(!pTdnf || !ppszPackageNameSpecs ||
        !ppPkgInfo || !pdwCount)
     {
         dwError = ERROR_TDNF_INVALID_PARAMETER;
@@ -564,6 +712,8 @@ TDNFListInternal(
     }
     BAIL_ON_TDNF_ERROR(dwError);
 
+    _TDNFMarkStalePackages(pTdnf, pPkgInfo, dwCount);
+
     *ppPkgInfo = pPkgInfo;
     *pdwCount = dwCount;
 
@@ -603,7 +753,6 @@ TDNFOpenHandle(
 {
     uint32_t dwError = 0;
     PTDNF pTdnf = NULL;
-    PSolvSack pSack = NULL;
     char *pszCacheDir = NULL;
     char *pszRepoDir = NULL;
     int nHasOptReposdir = 0;
@@ -634,6 +783,7 @@ TDNFOpenHandle(
     BAIL_ON_TDNF_ERROR(dwError);
 
     GlobalSetDnfCheckUpdateCompat(pTdnf->pConf->nCheckUpdateCompat);
+    TDNFBandwidthSetup(pTdnf->pConf);
 
     dwError = TDNFHasOpt(pTdnf->pArgs, TDNF_SETOPT_KEY_REPOSDIR, &nHasOptReposdir);
     BAIL_ON_TDNF_ERROR(dwError);
@@ -653,6 +803,17 @@ TDNFOpenHandle(
         pTdnf->pConf->pszCacheDir = pszCacheDir;
         pszCacheDir = NULL;
 
+        /* shared_cachedir is a host path, it is not in the installroot */
+        if (!IsNullOrEmptyString(pTdnf->pConf->pszSharedCacheDir) && !gEuid)
+        {
+            dwError = TDNFUtilsMakeDirs(pTdnf->pConf->pszSharedCacheDir);
+            if (dwError == ERROR_TDNF_ALREADY_EXISTS)
+            {
+                dwError = 0;
+            }
+            BAIL_ON_TDNF_ERROR(dwError);
+        }
+
         if (!nHasOptReposdir)
         {
             dwError = TDNFJoinPath(&pszRepoDir,
@@ -676,6 +837,11 @@ TDNFOpenHandle(
             }
         }
     }
+    else
+    {
+        /* without an installroot cachedir is all there is */
+        TDNF_SAFE_FREE_MEMORY(pTdnf->pConf->pszSharedCacheDir);
+    }
 
     if (nHasOptReposdir)
     {
@@ -684,36 +850,8 @@ TDNFOpenHandle(
         BAIL_ON_TDNF_ERROR(dwError);
     }
 
-    dwError = TDNFLoadPlugins(pTdnf);
-    BAIL_ON_TDNF_ERROR(dwError);
-
-    dwError = SolvInitSack(
-                  &pSack,
-                  pTdnf->pConf->pszCacheDir,
-                  pTdnf->pArgs->pszInstallRoot);
-    BAIL_ON_TDNF_ERROR(dwError);
-
-    if(!pArgs->nAllDeps)
-    {
-        dwError = SolvReadInstalledRpms(pSack->pPool->installed, pszCacheDir);
-        BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
-    }
-
-    dwError = TDNFLoadRepoData(
-                  pTdnf,
-                  &pTdnf->pRepos);
-    BAIL_ON_TDNF_ERROR(dwError);
-
-    dwError = TDNFRepoListFinalize(pTdnf);
-    BAIL_ON_TDNF_ERROR(dwError);
-
-    dwError = TDNFInitCmdLineRepo(pTdnf, pSack);
-    BAIL_ON_TDNF_ERROR(dwError);
-
-    pool_addfileprovides(pSack->pPool);
-    pool_createwhatprovides(pSack->pPool);
-
-    pTdnf->pSack = pSack;
+    /* plugins, repos and the sack are brought up
+       on demand, see TDNFInitHandleStages() */
     *ppTdnf = pTdnf;
 
 cleanup:
@@ -730,10 +868,70 @@ error:
     {
         *ppTdnf = NULL;
     }
-    if(pSack)
+    goto cleanup;
+}
+
+//switch an open handle to another installroot. The config,
+//repos and the loaded repo metadata are kept, only the
+//installed packages are read again from the new root and
+//the gpg keys of the handle are dropped.
+uint32_t
+TDNFSetInstallRoot(
+    PTDNF pTdnf,
+    const char *pszInstallRoot
+    )
+{
+    uint32_t dwError = 0;
+    char *pszInstallRootNew = NULL;
+
+    if(!pTdnf || !pTdnf->pArgs || IsNullOrEmptyString(pszInstallRoot))
     {
-        SolvFreeSack(pSack);
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    if (pszInstallRoot[0] != '/')
+    {
+        pr_crit("Install root must be an absolute path.\n");
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    dwError = TDNFAllocateString(pszInstallRoot, &pszInstallRootNew);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    TDNF_SAFE_FREE_MEMORY(pTdnf->pArgs->pszInstallRoot);
+    pTdnf->pArgs->pszInstallRoot = pszInstallRootNew;
+    pszInstallRootNew = NULL;
+
+    /* keys were accepted for the rpmdb of the previous root */
+    TDNFFreeGPGKeys(pTdnf->pGPGKeys);
+    pTdnf->pGPGKeys = NULL;
+
+    /* if the sack is not loaded yet it is set up for the new root */
+    if (pTdnf->dwInitStages & TDNF_INIT_STAGE_SACK)
+    {
+        dwError = SolvSetRootDir(pTdnf->pSack,
+                                 pTdnf->pArgs->pszInstallRoot);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        if(!pTdnf->pArgs->nAllDeps)
+        {
+            dwError = SolvReadInstalledRpms(pTdnf->pSack->pPool->installed,
+                                            NULL);
+            BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+        }
+
+        pTdnf->dwInitStages &= ~TDNF_INIT_STAGE_PROVIDES;
+        dwError = TDNFInitHandleStages(pTdnf, TDNF_INIT_STAGE_PROVIDES);
+        BAIL_ON_TDNF_ERROR(dwError);
     }
+
+cleanup:
+    TDNF_SAFE_FREE_MEMORY(pszInstallRootNew);
+    return dwError;
+
+error:
     goto cleanup;
 }
 
@@ -834,6 +1032,7 @@ TDNFAddCmdLinePackages(
                               pszPkgName,
                               basename(pszCopyOfPkgName),
                               pRepo,
+                              NULL,
                               &pszRPMPath
                           );
                 BAIL_ON_TDNF_ERROR(dwError);
@@ -877,7 +1076,7 @@ TDNFProvides(
     PSolvQuery pQuery = NULL;
     PSolvPackageList pPkgList = NULL;
 
-    if(!pTdnf || !pTdnf->pSack || IsNullOrEmptyString(pszSpec) ||
+    if(!pTdnf || IsNullOrEmptyString(pszSpec) ||
        !ppPkgInfo)
     {
         dwError = ERROR_TDNF_INVALID_PARAMETER;
@@ -940,12 +1139,15 @@ TDNFRepoList(
 
     PTDNF_REPO_DATA pRepos = NULL;
 
-    if(!pTdnf || !pTdnf->pRepos || !ppReposAll)
+    if(!pTdnf || !ppReposAll)
     {
         dwError = ERROR_TDNF_INVALID_PARAMETER;
         BAIL_ON_TDNF_ERROR(dwError);
     }
 
+    dwError = TDNFInitHandleStages(pTdnf, TDNF_INIT_STAGE_REPOS);
+    BAIL_ON_TDNF_ERROR(dwError);
+
     pRepos = pTdnf->pRepos;
 
     while(pRepos)
@@ -1001,60 +1203,6 @@ error:
     goto cleanup;
 }
 
-static int
-_rm_rpms(
-    const char *pszFilePath,
-    const struct stat *sbuf,
-    int type,
-    struct FTW *ftwb
-    )
-{
-    uint32_t dwError = 0;
-    char *pszKeepFile = NULL;
-    struct stat statKeep = {0};
-
-    UNUSED(sbuf);
-    UNUSED(type);
-    UNUSED(ftwb);
-
-    if (strcmp(&pszFilePath[strlen(pszFilePath)-4], ".rpm") == 0)
-    {
-        dwError = TDNFAllocateStringPrintf(&pszKeepFile, "%s.reposync-keep", pszFilePath);
-        BAIL_ON_TDNF_ERROR(dwError);
-
-        if (stat(pszKeepFile, &statKeep))
-        {
-            if (errno == ENOENT)
-            {
-                pr_info("deleting %s\n", pszFilePath);
-                if(remove(pszFilePath) < 0)
-                {
-                    pr_crit("unable to remove %s: %s\n", pszFilePath, strerror(errno));
-                }
-            }
-            else
-            {
-                dwError = errno;
-                BAIL_ON_TDNF_SYSTEM_ERROR(dwError);
-            }
-        }
-        else
-        {
-            /* marker file can be removed now */
-            /* coverity[toctou] */
-            if(remove(pszKeepFile) < 0)
-            {
-                pr_crit("unable to remove %s: %s\n", pszKeepFile, strerror(errno));
-            }
-        }
-    }
-cleanup:
-    TDNF_SAFE_FREE_MEMORY(pszKeepFile);
-    return (int)dwError;
-error:
-    goto cleanup;
-}
-
 uint32_t
 TDNFRepoSync(
     PTDNF pTdnf,
@@ -1062,28 +1210,33 @@ TDNFRepoSync(
     )
 {
     uint32_t dwError = 0;
-    int ret;
     PTDNF_PKG_INFO pPkgInfos = NULL;
     PTDNF_PKG_INFO pPkgInfo = NULL;
     PTDNF_REPO_DATA pRepo = NULL;
-    char *pszRepoDir = NULL;
     PSolvQuery pQuery = NULL;
     PSolvPackageList pPkgList = NULL;
     char *pszRootPath = NULL;
     char *pszUrl = NULL;
     char *pszDir = NULL;
-    char *pszFilePath = NULL;
-    char *pszKeepFile = NULL;
+    char *pszFileDir = NULL;
+    char **ppszRepoDirs = NULL;
     uint32_t dwCount = 0;
     uint32_t dwRepoCount = 0;
-    TDNFRPMTS ts = {0};
+    PTDNF_REPOSYNC_JOB pJobs = NULL;
+    uint32_t dwJobCount = 0;
+    int nLockFd = -1;
+    int nMetaLockFd = -1;
+    uint32_t i;
 
-    if(!pTdnf || !pTdnf->pSack || !pReposyncArgs)
+    if(!pTdnf || !pReposyncArgs)
     {
         dwError = ERROR_TDNF_INVALID_PARAMETER;
         BAIL_ON_TDNF_ERROR(dwError);
     }
 
+    dwError = TDNFInitHandleStages(pTdnf, TDNF_INIT_STAGE_REPOS);
+    BAIL_ON_TDNF_ERROR(dwError);
+
     /* count enabled repos */
     for (pRepo = pTdnf->pRepos; pRepo; pRepo = pRepo->pNext)
     {
@@ -1137,16 +1290,6 @@ TDNFRepoSync(
     dwError = TDNFPopulatePkgInfoForRepoSync(pTdnf->pSack, pPkgList, &pPkgInfos);
     BAIL_ON_TDNF_ERROR(dwError);
 
-    if (pReposyncArgs->nGPGCheck)
-    {
-        ts.pTS = rpmtsCreate();
-        if(!ts.pTS)
-        {
-            dwError = ERROR_TDNF_RPMTS_CREATE_FAILED;
-            BAIL_ON_TDNF_ERROR(dwError);
-        }
-    }
-
     if (pReposyncArgs->pszDownloadPath == NULL)
     {
         pszRootPath = getcwd(NULL, 0);
@@ -1161,15 +1304,45 @@ TDNFRepoSync(
         BAIL_ON_TDNF_ERROR(dwError);
     }
 
+    /* another reposync with norepopath may write the same file names */
+    if (pReposyncArgs->nNoRepoPath && !pReposyncArgs->nPrintUrlsOnly)
+    {
+        dwError = TDNFUtilsMakeDir(pszRootPath);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        dwError = TDNFRepoSyncLockDir(pszRootPath, &nLockFd);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        if (pReposyncArgs->nDownloadMetadata &&
+            pReposyncArgs->pszMetaDataPath &&
+            strcmp(pReposyncArgs->pszMetaDataPath, pszRootPath))
+        {
+            dwError = TDNFUtilsMakeDir(pReposyncArgs->pszMetaDataPath);
+            BAIL_ON_TDNF_ERROR(dwError);
+
+            dwError = TDNFRepoSyncLockDir(pReposyncArgs->pszMetaDataPath,
+                                          &nMetaLockFd);
+            BAIL_ON_TDNF_ERROR(dwError);
+        }
+    }
+
     if (pReposyncArgs->nNewestOnly)
     {
         TDNFPkgInfoFilterNewest(pTdnf->pSack, pPkgInfos);
     }
 
-    /* iterate through all packages */
     for (pPkgInfo = pPkgInfos; pPkgInfo; pPkgInfo = pPkgInfo->pNext)
     {
         dwCount++;
+    }
+
+    dwError = TDNFAllocateMemory(dwCount, sizeof(TDNF_REPOSYNC_JOB),
+                                 (void **)&pJobs);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    /* iterate through all packages */
+    for (pPkgInfo = pPkgInfos; pPkgInfo; pPkgInfo = pPkgInfo->pNext)
+    {
         if (strcmp(pPkgInfo->pszRepoName, SYSTEM_REPO_NAME) == 0)
         {
             continue;
@@ -1193,7 +1366,7 @@ TDNFRepoSync(
 
         if (!pReposyncArgs->nPrintUrlsOnly)
         {
-            PTDNF_REPO_DATA pPkgRepo = NULL;
+            PTDNF_REPOSYNC_JOB pJob = &pJobs[dwJobCount];
 
             if (!pReposyncArgs->nNoRepoPath)
             {
@@ -1212,51 +1385,28 @@ TDNFRepoSync(
             dwError = TDNFUtilsMakeDir(pszDir);
             BAIL_ON_TDNF_ERROR(dwError);
 
-            dwError = TDNFFindRepoById(pTdnf, pPkgInfo->pszRepoName, &pPkgRepo);
+            dwError = TDNFFindRepoById(pTdnf, pPkgInfo->pszRepoName, &pJob->pRepo);
             BAIL_ON_TDNF_ERROR(dwError);
 
-            dwError = TDNFDownloadPackageToTree(pTdnf,
-                            pPkgInfo->pszLocation, pPkgInfo->pszName,
-                            pPkgRepo, pszDir,
-                            &pszFilePath);
+            dwError = TDNFGetPackageTreePath(pPkgInfo->pszLocation, pszDir,
+                                             &pJob->pszFilePath);
             BAIL_ON_TDNF_ERROR(dwError);
+            pJob->pPkgInfo = pPkgInfo;
+            dwJobCount++;
 
-            /* if gpgcheck option is given, check for a valid signature. If that fails,
-               delete the package */
-            if (pReposyncArgs->nGPGCheck)
-            {
-                dwError = TDNFGPGCheckPackage(&ts, pTdnf, pPkgRepo, pszFilePath, NULL);
-                if (dwError != RPMRC_NOTTRUSTED && dwError != RPMRC_NOKEY)
-                {
-                    BAIL_ON_TDNF_ERROR(dwError);
-                }
-                else if (dwError)
-                {
-                    pr_crit("checking package %s failed: %d, deleting\n", pszFilePath, dwError);
-                    if(remove(pszFilePath) < 0)
-                    {
-                        pr_crit("unable to remove %s: %s\n", pszFilePath, strerror(errno));
-                    }
-                }
-            }
+            /* create directories here, the workers would race on them */
+            dwError = TDNFDirName(pJob->pszFilePath, &pszFileDir);
+            BAIL_ON_TDNF_ERROR(dwError);
 
-            /* dwError==0 means TDNFGPGCheckPackage() succeeded or wasn't called */
-            if (pReposyncArgs->nDelete && dwError == 0)
+            dwError = TDNFUtilsMakeDirs(pszFileDir);
+            if (dwError == ERROR_TDNF_ALREADY_EXISTS)
             {
-                /* if "delete" option is given, create a marker file to protect
-                   what we just downloaded. Later all *.rpm files that do not
-                   have a marker file will be deleted */
-                dwError = TDNFAllocateStringPrintf(&pszKeepFile, "%s.reposync-keep", pszFilePath);
-                BAIL_ON_TDNF_ERROR(dwError);
-
-                dwError = TDNFTouchFile(pszKeepFile);
-                BAIL_ON_TDNF_ERROR(dwError);
-                TDNF_SAFE_FREE_MEMORY(pszKeepFile);
+                dwError = 0;
             }
-            dwError = 0;
+            BAIL_ON_TDNF_ERROR(dwError);
 
+            TDNF_SAFE_FREE_MEMORY(pszFileDir);
             TDNF_SAFE_FREE_MEMORY(pszDir);
-            TDNF_SAFE_FREE_MEMORY(pszFilePath);
         }
         else
         {
@@ -1273,11 +1423,18 @@ TDNFRepoSync(
         }
     }
 
+    dwError = TDNFRepoSyncPackages(pTdnf, pReposyncArgs, pJobs, dwJobCount);
+    BAIL_ON_TDNF_ERROR(dwError);
+
     if (pReposyncArgs->nDelete)
     {
-        /* go through all packages in the destination directory,
-           delete those that were not just downloaded as indicated by the
-           marker file */
+        /* go through all packages in the destination directories,
+           delete those that were not just synced */
+        dwError = TDNFAllocateMemory(dwRepoCount + 1, sizeof(char *),
+                                     (void **)&ppszRepoDirs);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        i = 0;
         for (pRepo = pTdnf->pRepos; pRepo; pRepo = pRepo->pNext)
         {
             if ((strcmp(pRepo->pszName, CMDLINE_REPO_NAME) == 0) ||
@@ -1287,24 +1444,18 @@ TDNFRepoSync(
             }
 
             /* no need to check nNoRepoPath since we wouldn't get here */
-            dwError = TDNFJoinPath(&pszRepoDir,
+            dwError = TDNFJoinPath(&ppszRepoDirs[i++],
                                    pszRootPath && strcmp(pszRootPath, "/") ? pszRootPath : "",
                                    pRepo->pszId,
                                    NULL);
             BAIL_ON_TDNF_ERROR(dwError);
-
-            ret = nftw(pszRepoDir, _rm_rpms, 10, FTW_DEPTH|FTW_PHYS);
-            if (ret < 0)
-            {
-                dwError = errno;
-                BAIL_ON_TDNF_SYSTEM_ERROR(dwError);
-            }
-            else
-            {
-                dwError = ret;
-                BAIL_ON_TDNF_ERROR(dwError);
-            }
         }
+
+        dwError = TDNFRepoSyncDeleteUnsynced(pJobs, dwJobCount, ppszRepoDirs);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        dwError = TDNFPackageStorePrune(pTdnf);
+        BAIL_ON_TDNF_ERROR(dwError);
     }
 
     if (pReposyncArgs->nDownloadMetadata)
@@ -1322,7 +1473,7 @@ TDNFRepoSync(
                 const char *pszBasePath = pReposyncArgs->pszMetaDataPath ?
                                 pReposyncArgs->pszMetaDataPath : pszRootPath;
 
-                dwError = TDNFJoinPath(&pszRepoDir,
+                dwError = TDNFJoinPath(&pszDir,
                                        pszBasePath && strcmp(pszBasePath, "/") ? pszBasePath : "",
                                        pRepo->pszId,
                                        NULL);
@@ -1333,18 +1484,18 @@ TDNFRepoSync(
                 dwError = TDNFAllocateString(
                             pReposyncArgs->pszMetaDataPath ?
                                 pReposyncArgs->pszMetaDataPath : pszRootPath,
-                            &pszRepoDir);
+                            &pszDir);
                 BAIL_ON_TDNF_ERROR(dwError);
             }
 
-            dwError = TDNFUtilsMakeDir(pszRepoDir);
+            dwError = TDNFUtilsMakeDir(pszDir);
             BAIL_ON_TDNF_ERROR(dwError);
 
-            dwError = TDNFDownloadMetadata(pTdnf, pRepo, pszRepoDir,
+            dwError = TDNFDownloadMetadata(pTdnf, pRepo, pszDir,
                                            pReposyncArgs->nPrintUrlsOnly);
             BAIL_ON_TDNF_ERROR(dwError);
 
-            TDNF_SAFE_FREE_MEMORY(pszRepoDir);
+            TDNF_SAFE_FREE_MEMORY(pszDir);
         }
     }
 
@@ -1357,16 +1508,13 @@ cleanup:
     {
         SolvFreePackageList(pPkgList);
     }
-    if(ts.pTS)
-    {
-        rpmtsCloseDB(ts.pTS);
-        rpmtsFree(ts.pTS);
-    }
     TDNF_SAFE_FREE_MEMORY(pszDir);
-    TDNF_SAFE_FREE_MEMORY(pszRepoDir);
+    TDNF_SAFE_FREE_MEMORY(pszFileDir);
     TDNF_SAFE_FREE_MEMORY(pszRootPath);
-    TDNF_SAFE_FREE_MEMORY(pszKeepFile);
-    TDNF_SAFE_FREE_MEMORY(pszFilePath);
+    TDNF_SAFE_FREE_STRINGARRAY(ppszRepoDirs);
+    TDNFFreeRepoSyncJobs(pJobs, dwJobCount);
+    TDNFRepoSyncUnlockDir(nMetaLockFd);
+    TDNFRepoSyncUnlockDir(nLockFd);
     TDNFFreePackageInfoArray(pPkgInfos, dwCount);
     return dwError;
 error:
@@ -1396,7 +1544,7 @@ TDNFRepoQuery(
     TDNF_SCOPE nScope = SCOPE_ALL;
     struct history_ctx *pHistoryCtx = NULL;
 
-    if(!pTdnf || !pTdnf->pSack || !pRepoqueryArgs ||
+    if(!pTdnf || !pRepoqueryArgs ||
        !ppPkgInfo || !pdwCount)
     {
         dwError = ERROR_TDNF_INVALID_PARAMETER;
@@ -1571,6 +1719,8 @@ TDNFRepoQuery(
         }
     }
 
+    _TDNFMarkStalePackages(pTdnf, pPkgInfo, dwCount);
+
     *ppPkgInfo = pPkgInfo;
     *pdwCount = dwCount;
 
@@ -1614,6 +1764,8 @@ TDNFResolve(
     char **ppszPkgNames = NULL;
     char **ppszPkgFiles = NULL; /* cmd line packages */
     int i, iFiles = 0, iPkgs = 0;
+    char *pszCacheSlot = NULL;
+    char *pszCacheKey = NULL;
 
     if(!pTdnf || !ppSolvedPkgInfo)
     {
@@ -1634,6 +1786,47 @@ TDNFResolve(
 
     queue_init(&queueGoal);
 
+    dwError = TDNFInitHandleStages(pTdnf, TDNF_INIT_STAGE_REPOS);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    /* a dry run changes nothing, so the result can be reused
+       as long as repos, rpmdb, config and args are the same */
+    if (pTdnf->pArgs->nAssumeNo)
+    {
+        for (i = 1; i < pTdnf->pArgs->nCmdCount; i++)
+        {
+            if (fnmatch("*.rpm", pTdnf->pArgs->ppszCmds[i], 0) == 0)
+            {
+                break;
+            }
+        }
+        if (i == pTdnf->pArgs->nCmdCount)
+        {
+            dwError = TDNFAllocateStringPrintf(&pszCacheSlot, "resolve-%d",
+                                               nAlterType);
+            BAIL_ON_TDNF_ERROR(dwError);
+
+            if (TDNFResultCacheGetKey(pTdnf, pszCacheSlot,
+                                      TDNF_RESULT_CACHE_KEY_FRESH |
+                                      TDNF_RESULT_CACHE_KEY_ARGS,
+                                      &pszCacheKey) ||
+                TDNFResultCacheReadSolved(pTdnf, pszCacheSlot, pszCacheKey,
+                                          &pSolvedPkgInfo))
+            {
+                pSolvedPkgInfo = NULL;
+            }
+        }
+    }
+
+    if (pSolvedPkgInfo)
+    {
+        pr_info("Using cached solver result\n");
+        goto check_cache_bytes;
+    }
+
+    dwError = TDNFInitHandleStages(pTdnf, TDNF_INIT_STAGE_SACK);
+    BAIL_ON_TDNF_ERROR(dwError);
+
     if(nAlterType == ALTER_INSTALL || nAlterType == ALTER_REINSTALL)
     {
         dwError = TDNFAddCmdLinePackages(pTdnf, &queueGoal);
@@ -1714,6 +1907,17 @@ TDNFResolve(
         pSolvedPkgInfo->pPkgsToDowngrade ||
         pSolvedPkgInfo->pPkgsToReinstall;
 
+    pSolvedPkgInfo->ppszPkgsNotResolved = ppszPkgsNotResolved;
+    ppszPkgsNotResolved = NULL;
+
+    if (pszCacheKey)
+    {
+        /* failing to store only costs a solve next time */
+        TDNFResultCacheWriteSolved(pTdnf, pszCacheSlot, pszCacheKey,
+                                   pSolvedPkgInfo);
+    }
+
+check_cache_bytes:
     dwError = TDNFGetAvailableCacheBytes(pTdnf->pConf, &qwAvailCacheBytes);
     BAIL_ON_TDNF_ERROR(dwError);
 
@@ -1723,13 +1927,14 @@ TDNFResolve(
         BAIL_ON_TDNF_ERROR(dwError);
     }
 
-    pSolvedPkgInfo->ppszPkgsNotResolved = ppszPkgsNotResolved;
     *ppSolvedPkgInfo = pSolvedPkgInfo;
 
 cleanup:
     /* only free the pointers */
     TDNF_SAFE_FREE_MEMORY(ppszPkgNames);
     TDNF_SAFE_FREE_MEMORY(ppszPkgFiles);
+    TDNF_SAFE_FREE_MEMORY(pszCacheSlot);
+    TDNF_SAFE_FREE_MEMORY(pszCacheKey);
 
     queue_free(&queueGoal);
     return dwError;
@@ -1763,7 +1968,7 @@ TDNFSearchCommand(
     int nIndex = 0;
     uint32_t unCount  = 0;
     Id dwPkgId = 0;
-    if(!pTdnf || !pCmdArgs || !ppPkgInfo || !punCount || !pTdnf->pSack)
+    if(!pTdnf || !pCmdArgs || !ppPkgInfo || !punCount)
     {
         dwError = ERROR_TDNF_INVALID_PARAMETER;
         BAIL_ON_TDNF_ERROR(dwError);
@@ -1883,8 +2088,7 @@ TDNFUpdateInfo(
     uint32_t dwSecurity = 0;
     int nUpdates = 0;
 
-    if(!pTdnf || !pTdnf->pSack || !pTdnf->pSack->pPool ||
-       !ppUpdateInfo)
+    if(!pTdnf || !ppUpdateInfo)
     {
         dwError = ERROR_TDNF_INVALID_PARAMETER;
         BAIL_ON_TDNF_ERROR(dwError);
@@ -2390,12 +2594,16 @@ TDNFMark(
     char *pszCmdLine = NULL;
     char *pszName = NULL;
 
-    if(!pTdnf || !pTdnf->pSack || !ppszPackageNameSpecs)
+    if(!pTdnf || !ppszPackageNameSpecs)
     {
         dwError = ERROR_TDNF_INVALID_PARAMETER;
         BAIL_ON_TDNF_ERROR(dwError);
     }
 
+    /* only the installed packages are needed, no repos */
+    dwError = TDNFInitHandleStages(pTdnf, TDNF_INIT_STAGE_PROVIDES);
+    BAIL_ON_TDNF_ERROR(dwError);
+
     dwError = SolvCreateQuery(pTdnf->pSack, &pQuery);
     BAIL_ON_TDNF_ERROR(dwError);
 
@@ -2476,6 +2684,7 @@ TDNFCloseHandle(
 {
     if(pTdnf)
     {
+        TDNFRevalidateStaleRepos(pTdnf);
         if(pTdnf->pRepos)
         {
             TDNFFreeReposInternal(pTdnf->pRepos);
@@ -2493,6 +2702,8 @@ TDNFCloseHandle(
             SolvFreeSack(pTdnf->pSack);
         }
         TDNFFreePlugins(pTdnf->pPlugins);
+        TDNFFreeGPGKeys(pTdnf->pGPGKeys);
+        TDNFFreeMirrorHealth(pTdnf->pMirrors);
         TDNFFreeMemory(pTdnf);
     }
     TdnfExitHandler();
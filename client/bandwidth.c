@@ -0,0 +1,242 @@
+/*
+ * Copyright (C) 2023 VMware, Inc. All Rights Reserved.
+ *
+ * Licensed under the GNU Lesser General Public License v2.1 (the "License");
+ * you may not use this file except in compliance with the License. The terms
+ * of the License are located in the COPYING file of this distribution.
+ */
+
+/*
+ * One limit for all downloads of the process, max_bandwidth, on top
+ * of the throttle of each repo. It is a token bucket per class of
+ * download (TDNF_XFER_CLASS). The bandwidth is split over the classes
+ * that have transfers running, by their bandwidth_shares, so metadata
+ * is not held up by packages, and a class alone gets all of it.
+ * Transfers read from the socket and then wait for what they owe,
+ * from the write callback, so this also holds for the threads of
+ * reposync, the multi handle of multiplex.c and downloads of plugins.
+ * The bytes and times of each class are kept even without a limit,
+ * see TDNFGetTransferStats().
+ */
+
+#include "includes.h"
+
+static pthread_mutex_t gBandwidthLock = PTHREAD_MUTEX_INITIALIZER;
+static double gdMaxBandwidth;   //bytes per second, 0 for no limit
+static double gdLastRefill;
+static TDNF_BANDWIDTH_CLASS gClasses[TDNF_XFER_CLASS_COUNT];
+
+static
+double
+_TDNFBandwidthNow(
+    void
+    )
+{
+    struct timespec ts = {0};
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* share of the bandwidth of nClass now. Must hold gBandwidthLock */
+static
+double
+_TDNFBandwidthRate(
+    int nClass
+    )
+{
+    int nShares = 0;
+    int i;
+
+    for (i = 0; i < TDNF_XFER_CLASS_COUNT; i++)
+    {
+        if (gClasses[i].nActive > 0 || i == nClass)
+        {
+            nShares += gClasses[i].nShare;
+        }
+    }
+    return gdMaxBandwidth * gClasses[nClass].nShare / nShares;
+}
+
+/* hand out the bandwidth since the last call. Must hold gBandwidthLock */
+static
+void
+_TDNFBandwidthRefill(
+    double dNow
+    )
+{
+    PTDNF_BANDWIDTH_CLASS pClass = NULL;
+    double dElapsed = dNow - gdLastRefill;
+    double dRate;
+    int i;
+
+    gdLastRefill = dNow;
+    if (gdMaxBandwidth <= 0 || dElapsed <= 0)
+    {
+        return;
+    }
+
+    for (i = 0; i < TDNF_XFER_CLASS_COUNT; i++)
+    {
+        pClass = &gClasses[i];
+        if (pClass->nActive == 0)
+        {
+            continue;
+        }
+        dRate = _TDNFBandwidthRate(i);
+        pClass->dTokens += dRate * dElapsed;
+        if (pClass->dTokens > dRate * TDNF_BANDWIDTH_BURST_MS / 1000)
+        {
+            pClass->dTokens = dRate * TDNF_BANDWIDTH_BURST_MS / 1000;
+        }
+    }
+}
+
+void
+TDNFBandwidthSetup(
+    PTDNF_CONF pConf
+    )
+{
+    int i;
+
+    if (!pConf)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&gBandwidthLock);
+    gdMaxBandwidth = (double)pConf->qwMaxBandwidth;
+    for (i = 0; i < TDNF_XFER_CLASS_COUNT; i++)
+    {
+        gClasses[i].nShare = pConf->nBandwidthShares[i];
+    }
+    gdLastRefill = _TDNFBandwidthNow();
+    pthread_mutex_unlock(&gBandwidthLock);
+}
+
+//the class of a download to pszFile
+int
+TDNFBandwidthClass(
+    PTDNF pTdnf,
+    const char *pszFile
+    )
+{
+    const char *pszName = strrchr(pszFile, '/');
+    size_t nLen = 0;
+
+    pszName = pszName ? pszName + 1 : pszFile;
+    nLen = strlen(pszName);
+
+    if (strcmp(pszName, TDNF_REPO_METADATA_FILE_NAME) == 0 ||
+        strcmp(pszName, TDNF_REPO_METALINK_FILE_NAME) == 0)
+    {
+        return TDNF_XFER_REPOMD;
+    }
+    if (nLen > 4 && strcmp(pszName + nLen - 4, ".rpm") == 0)
+    {
+        return pTdnf->nPrefetching ? TDNF_XFER_PREFETCH : TDNF_XFER_PACKAGE;
+    }
+    return TDNF_XFER_METADATA;
+}
+
+void
+TDNFBandwidthStart(
+    int nClass
+    )
+{
+    PTDNF_BANDWIDTH_CLASS pClass = &gClasses[nClass];
+    double dNow = _TDNFBandwidthNow();
+
+    pthread_mutex_lock(&gBandwidthLock);
+    _TDNFBandwidthRefill(dNow);
+    if (pClass->nActive++ == 0)
+    {
+        pClass->dActiveSince = dNow;
+        pClass->dTokens = 0;
+    }
+    pthread_mutex_unlock(&gBandwidthLock);
+}
+
+void
+TDNFBandwidthStop(
+    int nClass
+    )
+{
+    PTDNF_BANDWIDTH_CLASS pClass = &gClasses[nClass];
+    double dNow = _TDNFBandwidthNow();
+
+    pthread_mutex_lock(&gBandwidthLock);
+    _TDNFBandwidthRefill(dNow);
+    if (pClass->nActive > 0 && --pClass->nActive == 0)
+    {
+        pClass->stat.dSeconds += dNow - pClass->dActiveSince;
+    }
+    pthread_mutex_unlock(&gBandwidthLock);
+}
+
+//account for nBytes read, and wait until the class can afford them
+void
+TDNFBandwidthConsume(
+    int nClass,
+    size_t nBytes
+    )
+{
+    PTDNF_BANDWIDTH_CLASS pClass = &gClasses[nClass];
+    struct timespec ts = {0};
+    double dWait = 0;
+
+    pthread_mutex_lock(&gBandwidthLock);
+    _TDNFBandwidthRefill(_TDNFBandwidthNow());
+    pClass->stat.qwBytes += nBytes;
+    if (gdMaxBandwidth > 0)
+    {
+        pClass->dTokens -= nBytes;
+        if (pClass->dTokens < 0)
+        {
+            dWait = -pClass->dTokens / _TDNFBandwidthRate(nClass);
+            pClass->stat.dWaitSeconds += dWait;
+        }
+    }
+    pthread_mutex_unlock(&gBandwidthLock);
+
+    if (dWait > 0)
+    {
+        ts.tv_sec = (time_t)dWait;
+        ts.tv_nsec = (long)((dWait - ts.tv_sec) * 1e9);
+        nanosleep(&ts, NULL);
+    }
+}
+
+uint32_t
+TDNFGetTransferStats(
+    PTDNF pTdnf,
+    PTDNF_XFER_STAT pStats
+    )
+{
+    uint32_t dwError = 0;
+    double dNow = _TDNFBandwidthNow();
+    int i;
+
+    if (!pTdnf || !pStats)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    pthread_mutex_lock(&gBandwidthLock);
+    for (i = 0; i < TDNF_XFER_CLASS_COUNT; i++)
+    {
+        pStats[i] = gClasses[i].stat;
+        if (gClasses[i].nActive > 0)
+        {
+            pStats[i].dSeconds += dNow - gClasses[i].dActiveSince;
+        }
+    }
+    pthread_mutex_unlock(&gBandwidthLock);
+
+cleanup:
+    return dwError;
+
+error:
+    goto cleanup;
+}
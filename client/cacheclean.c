@@ -0,0 +1,974 @@
+/*
+ * Copyright (C) 2023 VMware, Inc. All Rights Reserved.
+ *
+ * Licensed under the GNU Lesser General Public License v2.1 (the "License");
+ * you may not use this file except in compliance with the License. The terms
+ * of the License are located in the COPYING file of this distribution.
+ */
+
+/*
+ * Package cache size limit and clean --stale.
+ *
+ * With cache_budget set, every use of a cached package appends
+ * "<time> <path>" to <cachedir>/packages.access. After a transaction
+ * the packages of all repos that are over the budget are removed,
+ * least recently used first, and the record is rewritten with one
+ * line per remaining package. A package without a record counts as
+ * used when it was written.
+ *
+ * clean --stale removes packages that the current metadata of their
+ * repo no longer has, and the cache directories of repos that are no
+ * longer configured. In the shared cache only those that no other
+ * installroot uses.
+ */
+
+#include "includes.h"
+
+static
+uint32_t
+_TDNFCacheFileListAdd(
+    PTDNF_CACHE_FILE_LIST pList,
+    const char *pszPath,
+    uint64_t qwSize,
+    time_t tAccess
+    )
+{
+    uint32_t dwError = 0;
+    uint32_t dwCapacity = 0;
+    PTDNF_CACHE_FILE pFile = NULL;
+
+    if (pList->dwCount >= pList->dwCapacity)
+    {
+        dwCapacity = pList->dwCapacity ? pList->dwCapacity * 2 : 64;
+        dwError = TDNFReAllocateMemory(dwCapacity * sizeof(TDNF_CACHE_FILE),
+                                       (void **)&pList->pFiles);
+        BAIL_ON_TDNF_ERROR(dwError);
+        pList->dwCapacity = dwCapacity;
+    }
+
+    pFile = &pList->pFiles[pList->dwCount];
+    memset(pFile, 0, sizeof(*pFile));
+
+    dwError = TDNFAllocateString(pszPath, &pFile->pszPath);
+    BAIL_ON_TDNF_ERROR(dwError);
+    pFile->qwSize = qwSize;
+    pFile->tAccess = tAccess;
+    pList->dwCount++;
+
+cleanup:
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+static
+void
+_TDNFCacheFileListFree(
+    PTDNF_CACHE_FILE_LIST pList
+    )
+{
+    uint32_t i;
+
+    for (i = 0; i < pList->dwCount; i++)
+    {
+        TDNF_SAFE_FREE_MEMORY(pList->pFiles[i].pszPath);
+    }
+    TDNF_SAFE_FREE_MEMORY(pList->pFiles);
+    memset(pList, 0, sizeof(*pList));
+}
+
+static
+int
+_TDNFCacheFileCmpPath(
+    const void *p1,
+    const void *p2
+    )
+{
+    return strcmp(((PTDNF_CACHE_FILE)p1)->pszPath,
+                  ((PTDNF_CACHE_FILE)p2)->pszPath);
+}
+
+static
+int
+_TDNFCacheFileCmpAccess(
+    const void *p1,
+    const void *p2
+    )
+{
+    time_t t1 = ((PTDNF_CACHE_FILE)p1)->tAccess;
+    time_t t2 = ((PTDNF_CACHE_FILE)p2)->tAccess;
+
+    return t1 < t2 ? -1 : (t1 > t2 ? 1 : 0);
+}
+
+static
+int
+_TDNFCacheStrCmp(
+    const void *p1,
+    const void *p2
+    )
+{
+    return strcmp(*(const char **)p1, *(const char **)p2);
+}
+
+/* the rpms directory of pRepo, as TDNFDownloadPackageToCache() uses it */
+static
+uint32_t
+_TDNFCacheGetRpmDir(
+    PTDNF pTdnf,
+    PTDNF_REPO_DATA pRepo,
+    char **ppszDir
+    )
+{
+    uint32_t dwError = 0;
+    char *pszDir = NULL;
+
+    dwError = TDNFJoinPath(&pszDir,
+                           pTdnf->pConf->pszCacheDir,
+                           pRepo->pszId,
+                           TDNF_RPM_CACHE_DIR_NAME,
+                           NULL);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFNormalizePath(pszDir, ppszDir);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+cleanup:
+    TDNF_SAFE_FREE_MEMORY(pszDir);
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+/* add the package files below pszDir to pList */
+static
+uint32_t
+_TDNFCacheWalkRpms(
+    const char *pszDir,
+    PTDNF_CACHE_FILE_LIST pList
+    )
+{
+    uint32_t dwError = 0;
+    DIR *pDir = NULL;
+    struct dirent *pEnt = NULL;
+    struct stat st = {0};
+    char *pszPath = NULL;
+    size_t nLen = 0;
+
+    pDir = opendir(pszDir);
+    if (!pDir)
+    {
+        if (errno == ENOENT)
+        {
+            goto cleanup;
+        }
+        dwError = ERROR_TDNF_SYSTEM_BASE + errno;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    while ((pEnt = readdir(pDir)) != NULL)
+    {
+        if (!strcmp(pEnt->d_name, ".") || !strcmp(pEnt->d_name, ".."))
+        {
+            continue;
+        }
+
+        dwError = TDNFAllocateStringPrintf(&pszPath, "%s/%s",
+                                           pszDir, pEnt->d_name);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        if (lstat(pszPath, &st))
+        {
+            dwError = ERROR_TDNF_SYSTEM_BASE + errno;
+            BAIL_ON_TDNF_ERROR(dwError);
+        }
+
+        nLen = strlen(pEnt->d_name);
+        if (S_ISDIR(st.st_mode))
+        {
+            dwError = _TDNFCacheWalkRpms(pszPath, pList);
+            BAIL_ON_TDNF_ERROR(dwError);
+        }
+        else if (S_ISREG(st.st_mode) && nLen > 4 &&
+                 !strcmp(&pEnt->d_name[nLen - 4], ".rpm"))
+        {
+            dwError = _TDNFCacheFileListAdd(pList, pszPath,
+                                            st.st_size, st.st_mtime);
+            BAIL_ON_TDNF_ERROR(dwError);
+        }
+        TDNF_SAFE_FREE_MEMORY(pszPath);
+    }
+
+cleanup:
+    if (pDir)
+    {
+        closedir(pDir);
+    }
+    TDNF_SAFE_FREE_MEMORY(pszPath);
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+/*
+ * Read the access record into pList, sorted by path with the last
+ * use of each path only. A missing or broken record is just empty,
+ * it only decides the order of eviction.
+ */
+static
+uint32_t
+_TDNFCacheReadAccessRecord(
+    const char *pszFile,
+    PTDNF_CACHE_FILE_LIST pList
+    )
+{
+    uint32_t dwError = 0;
+    FILE *fp = NULL;
+    char *pszLine = NULL;
+    size_t nAlloc = 0;
+    ssize_t nLen = 0;
+    long long llTime = 0;
+    int nPos = 0;
+    uint32_t i, j;
+
+    fp = fopen(pszFile, "r");
+    if (!fp)
+    {
+        goto cleanup;
+    }
+
+    while ((nLen = getline(&pszLine, &nAlloc, fp)) > 0)
+    {
+        if (pszLine[nLen - 1] == '\n')
+        {
+            pszLine[nLen - 1] = '\0';
+        }
+        if (sscanf(pszLine, "%lld %n", &llTime, &nPos) != 1 ||
+            pszLine[nPos] != '/')
+        {
+            continue;
+        }
+        dwError = _TDNFCacheFileListAdd(pList, &pszLine[nPos],
+                                        0, (time_t)llTime);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    if (pList->dwCount == 0)
+    {
+        goto cleanup;
+    }
+
+    qsort(pList->pFiles, pList->dwCount, sizeof(TDNF_CACHE_FILE),
+          _TDNFCacheFileCmpPath);
+
+    for (i = 1, j = 0; i < pList->dwCount; i++)
+    {
+        if (!strcmp(pList->pFiles[i].pszPath, pList->pFiles[j].pszPath))
+        {
+            if (pList->pFiles[i].tAccess > pList->pFiles[j].tAccess)
+            {
+                pList->pFiles[j].tAccess = pList->pFiles[i].tAccess;
+            }
+            TDNF_SAFE_FREE_MEMORY(pList->pFiles[i].pszPath);
+        }
+        else
+        {
+            pList->pFiles[++j] = pList->pFiles[i];
+        }
+    }
+    pList->dwCount = j + 1;
+
+cleanup:
+    if (fp)
+    {
+        fclose(fp);
+    }
+    TDNF_SAFE_FREE_MEMORY(pszLine);
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+static
+uint32_t
+_TDNFCacheWriteAccessRecord(
+    const char *pszFile,
+    PTDNF_CACHE_FILE_LIST pList
+    )
+{
+    uint32_t dwError = 0;
+    char *pszTmpFile = NULL;
+    FILE *fp = NULL;
+    uint32_t i;
+
+    dwError = TDNFAllocateStringPrintf(&pszTmpFile, "%s.tmp", pszFile);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    fp = fopen(pszTmpFile, "w");
+    if (!fp)
+    {
+        dwError = errno;
+        BAIL_ON_TDNF_SYSTEM_ERROR_UNCOND(dwError);
+    }
+
+    for (i = 0; i < pList->dwCount; i++)
+    {
+        if (pList->pFiles[i].pszPath)
+        {
+            fprintf(fp, "%lld %s\n", (long long)pList->pFiles[i].tAccess,
+                    pList->pFiles[i].pszPath);
+        }
+    }
+
+    if (fclose(fp))
+    {
+        fp = NULL;
+        dwError = errno;
+        BAIL_ON_TDNF_SYSTEM_ERROR_UNCOND(dwError);
+    }
+    fp = NULL;
+
+    if (rename(pszTmpFile, pszFile))
+    {
+        dwError = errno;
+        BAIL_ON_TDNF_SYSTEM_ERROR_UNCOND(dwError);
+    }
+
+cleanup:
+    TDNF_SAFE_FREE_MEMORY(pszTmpFile);
+    return dwError;
+
+error:
+    if (fp)
+    {
+        fclose(fp);
+    }
+    if (pszTmpFile)
+    {
+        unlink(pszTmpFile);
+    }
+    goto cleanup;
+}
+
+/*
+ * Note a use of the cached package pszFile, a download or a cache
+ * hit. Only done if cache_budget is set.
+ */
+uint32_t
+TDNFCacheRecordAccess(
+    PTDNF pTdnf,
+    const char *pszFile
+    )
+{
+    uint32_t dwError = 0;
+    char *pszRecord = NULL;
+    FILE *fp = NULL;
+
+    if (!pTdnf || !pTdnf->pConf || IsNullOrEmptyString(pszFile))
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    if (pTdnf->pConf->qwCacheBudget == 0)
+    {
+        goto cleanup;
+    }
+
+    dwError = TDNFJoinPath(&pszRecord,
+                           pTdnf->pConf->pszCacheDir,
+                           TDNF_CACHE_ACCESS_FILE_NAME,
+                           NULL);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    fp = fopen(pszRecord, "a");
+    if (!fp)
+    {
+        dwError = errno;
+        BAIL_ON_TDNF_SYSTEM_ERROR_UNCOND(dwError);
+    }
+    fprintf(fp, "%lld %s\n", (long long)time(NULL), pszFile);
+
+cleanup:
+    if (fp)
+    {
+        fclose(fp);
+    }
+    TDNF_SAFE_FREE_MEMORY(pszRecord);
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+/* bytes of cached packages of all repos */
+uint32_t
+TDNFCacheGetPackageBytes(
+    PTDNF pTdnf,
+    uint64_t *pqwBytes
+    )
+{
+    uint32_t dwError = 0;
+    PTDNF_REPO_DATA pRepo = NULL;
+    TDNF_CACHE_FILE_LIST stFiles = {0};
+    char *pszDir = NULL;
+    uint64_t qwBytes = 0;
+    uint32_t i;
+
+    if (!pTdnf || !pTdnf->pConf || !pqwBytes)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    for (pRepo = pTdnf->pRepos; pRepo; pRepo = pRepo->pNext)
+    {
+        if (!strcmp(pRepo->pszId, CMDLINE_REPO_NAME))
+        {
+            continue;
+        }
+        dwError = _TDNFCacheGetRpmDir(pTdnf, pRepo, &pszDir);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        dwError = _TDNFCacheWalkRpms(pszDir, &stFiles);
+        BAIL_ON_TDNF_ERROR(dwError);
+        TDNF_SAFE_FREE_MEMORY(pszDir);
+    }
+
+    for (i = 0; i < stFiles.dwCount; i++)
+    {
+        qwBytes += stFiles.pFiles[i].qwSize;
+    }
+    *pqwBytes = qwBytes;
+
+cleanup:
+    _TDNFCacheFileListFree(&stFiles);
+    TDNF_SAFE_FREE_MEMORY(pszDir);
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+/*
+ * Remove the least recently used packages of all repos until the
+ * package cache is within cache_budget.
+ */
+uint32_t
+TDNFCacheEnforceBudget(
+    PTDNF pTdnf
+    )
+{
+    uint32_t dwError = 0;
+    PTDNF_REPO_DATA pRepo = NULL;
+    TDNF_CACHE_FILE_LIST stFiles = {0};
+    TDNF_CACHE_FILE_LIST stRecord = {0};
+    PTDNF_CACHE_FILE pFound = NULL;
+    char *pszRecord = NULL;
+    char *pszDir = NULL;
+    char *pszSize = NULL;
+    uint64_t qwTotal = 0;
+    uint64_t qwRemoved = 0;
+    uint32_t i;
+
+    if (!pTdnf || !pTdnf->pConf)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    if (pTdnf->pConf->qwCacheBudget == 0)
+    {
+        goto cleanup;
+    }
+
+    dwError = TDNFJoinPath(&pszRecord,
+                           pTdnf->pConf->pszCacheDir,
+                           TDNF_CACHE_ACCESS_FILE_NAME,
+                           NULL);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = _TDNFCacheReadAccessRecord(pszRecord, &stRecord);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    for (pRepo = pTdnf->pRepos; pRepo; pRepo = pRepo->pNext)
+    {
+        if (!strcmp(pRepo->pszId, CMDLINE_REPO_NAME))
+        {
+            continue;
+        }
+        dwError = _TDNFCacheGetRpmDir(pTdnf, pRepo, &pszDir);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        dwError = _TDNFCacheWalkRpms(pszDir, &stFiles);
+        BAIL_ON_TDNF_ERROR(dwError);
+        TDNF_SAFE_FREE_MEMORY(pszDir);
+    }
+
+    for (i = 0; i < stFiles.dwCount; i++)
+    {
+        PTDNF_CACHE_FILE pFile = &stFiles.pFiles[i];
+
+        pFound = stRecord.dwCount ?
+                 bsearch(pFile, stRecord.pFiles, stRecord.dwCount,
+                         sizeof(TDNF_CACHE_FILE), _TDNFCacheFileCmpPath) :
+                 NULL;
+        if (pFound && pFound->tAccess > pFile->tAccess)
+        {
+            pFile->tAccess = pFound->tAccess;
+        }
+        qwTotal += pFile->qwSize;
+    }
+
+    if (qwTotal > pTdnf->pConf->qwCacheBudget)
+    {
+        qsort(stFiles.pFiles, stFiles.dwCount, sizeof(TDNF_CACHE_FILE),
+              _TDNFCacheFileCmpAccess);
+
+        for (i = 0;
+             i < stFiles.dwCount && qwTotal > pTdnf->pConf->qwCacheBudget;
+             i++)
+        {
+            PTDNF_CACHE_FILE pFile = &stFiles.pFiles[i];
+
+            if (unlink(pFile->pszPath) && errno != ENOENT)
+            {
+                pr_err("could not remove %s: %s\n",
+                       pFile->pszPath, strerror(errno));
+                continue;
+            }
+            qwTotal -= pFile->qwSize;
+            qwRemoved += pFile->qwSize;
+            TDNF_SAFE_FREE_MEMORY(pFile->pszPath);
+        }
+    }
+
+    /* keep the record to one line per cached package */
+    dwError = _TDNFCacheWriteAccessRecord(pszRecord, &stFiles);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    if (qwRemoved > 0)
+    {
+        dwError = TDNFUtilsFormatSize(qwRemoved, &pszSize);
+        BAIL_ON_TDNF_ERROR(dwError);
+        pr_info("removed %s of least recently used packages from the cache\n",
+                pszSize);
+
+        /* evicted packages may still hold their store copy */
+        dwError = TDNFPackageStorePrune(pTdnf);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+cleanup:
+    _TDNFCacheFileListFree(&stFiles);
+    _TDNFCacheFileListFree(&stRecord);
+    TDNF_SAFE_FREE_MEMORY(pszRecord);
+    TDNF_SAFE_FREE_MEMORY(pszDir);
+    TDNF_SAFE_FREE_MEMORY(pszSize);
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+/*
+ * Remove cached packages of enabled repos that are not in the current
+ * metadata of the repo. Repos without loaded metadata are left alone.
+ */
+uint32_t
+TDNFCleanStalePackages(
+    PTDNF pTdnf
+    )
+{
+    uint32_t dwError = 0;
+    PTDNF_REPO_DATA pRepo = NULL;
+    Pool *pool = NULL;
+    Repo *pSolvRepo = NULL;
+    Solvable *s = NULL;
+    Id p, repoid;
+    TDNF_CACHE_FILE_LIST stFiles = {0};
+    char **ppszKeep = NULL;
+    uint32_t dwKeep = 0;
+    char *pszDir = NULL;
+    char *pszPath = NULL;
+    char *pszSize = NULL;
+    const char *pszLocation = NULL;
+    uint64_t qwRemoved = 0;
+    uint32_t i;
+
+    if (!pTdnf || !pTdnf->pConf)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    dwError = TDNFRefresh(pTdnf);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    pool = pTdnf->pSack->pPool;
+
+    for (pRepo = pTdnf->pRepos; pRepo; pRepo = pRepo->pNext)
+    {
+        if (!pRepo->nEnabled || !strcmp(pRepo->pszId, CMDLINE_REPO_NAME))
+        {
+            continue;
+        }
+
+        pSolvRepo = NULL;
+        FOR_REPOS(repoid, pSolvRepo)
+        {
+            if (pSolvRepo->name && !strcmp(pSolvRepo->name, pRepo->pszId))
+            {
+                break;
+            }
+            pSolvRepo = NULL;
+        }
+        if (!pSolvRepo)
+        {
+            continue;
+        }
+
+        dwError = _TDNFCacheGetRpmDir(pTdnf, pRepo, &pszDir);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        dwError = _TDNFCacheWalkRpms(pszDir, &stFiles);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        if (stFiles.dwCount > 0)
+        {
+            dwError = TDNFAllocateMemory(pSolvRepo->nsolvables + 1,
+                                         sizeof(char *),
+                                         (void **)&ppszKeep);
+            BAIL_ON_TDNF_ERROR(dwError);
+
+            FOR_REPO_SOLVABLES(pSolvRepo, p, s)
+            {
+                pszLocation = solvable_get_location(s, NULL);
+                if (pszLocation && dwKeep < (uint32_t)pSolvRepo->nsolvables &&
+                    TDNFGetPackageTreePath(pszLocation, pszDir, &pszPath) == 0)
+                {
+                    ppszKeep[dwKeep++] = pszPath;
+                    pszPath = NULL;
+                }
+            }
+            qsort(ppszKeep, dwKeep, sizeof(char *), _TDNFCacheStrCmp);
+
+            for (i = 0; i < stFiles.dwCount; i++)
+            {
+                const char *pszFile = stFiles.pFiles[i].pszPath;
+
+                if (dwKeep && bsearch(&pszFile, ppszKeep, dwKeep,
+                                      sizeof(char *), _TDNFCacheStrCmp))
+                {
+                    continue;
+                }
+                if (unlink(pszFile) == 0)
+                {
+                    qwRemoved += stFiles.pFiles[i].qwSize;
+                }
+            }
+
+            TDNFFreeStringArray(ppszKeep);
+            ppszKeep = NULL;
+            dwKeep = 0;
+        }
+
+        _TDNFCacheFileListFree(&stFiles);
+        TDNF_SAFE_FREE_MEMORY(pszDir);
+    }
+
+    if (qwRemoved > 0)
+    {
+        dwError = TDNFUtilsFormatSize(qwRemoved, &pszSize);
+        BAIL_ON_TDNF_ERROR(dwError);
+        pr_info("removed %s of stale packages\n", pszSize);
+
+        dwError = TDNFPackageStorePrune(pTdnf);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+cleanup:
+    _TDNFCacheFileListFree(&stFiles);
+    TDNF_SAFE_FREE_STRINGARRAY(ppszKeep);
+    TDNF_SAFE_FREE_MEMORY(pszDir);
+    TDNF_SAFE_FREE_MEMORY(pszPath);
+    TDNF_SAFE_FREE_MEMORY(pszSize);
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+/* a directory that looks like the cache of a repo */
+static
+int
+_TDNFCacheIsRepoDir(
+    const char *pszDir
+    )
+{
+    const char *ppszEntries[] = {
+        TDNF_REPODATA_DIR_NAME,
+        TDNF_SOLVCACHE_DIR_NAME,
+        TDNF_RPM_CACHE_DIR_NAME,
+        TDNF_REPO_METADATA_MARKER,
+        "keys",
+    };
+    char *pszPath = NULL;
+    int nFound = 0;
+    size_t i;
+
+    for (i = 0; i < ARRAY_SIZE(ppszEntries) && !nFound; i++)
+    {
+        if (TDNFJoinPath(&pszPath, pszDir, ppszEntries[i], NULL) == 0)
+        {
+            nFound = access(pszPath, F_OK) == 0;
+            TDNF_SAFE_FREE_MEMORY(pszPath);
+        }
+    }
+    return nFound;
+}
+
+/*
+ * Remove the repo dir pszName of the shared cache, unless another
+ * installroot still uses it. Roots that loaded it are recorded in
+ * <name>.roots, see TDNFRepoAddSharedCacheRoot(). This root no longer
+ * configures the repo, so it is dropped from the record, and roots
+ * that do not exist anymore are ignored. The lock of the repo is
+ * taken first, a repo that is locked is in use and left alone. The
+ * lock file itself is kept, another process may be waiting on it.
+ */
+static
+uint32_t
+_TDNFCleanStaleSharedRepoDir(
+    PTDNF pTdnf,
+    const char *pszCacheDir,
+    const char *pszName,
+    const char *pszPath
+    )
+{
+    uint32_t dwError = 0;
+    char *pszLockFile = NULL;
+    char *pszRootsFile = NULL;
+    char **ppszRoots = NULL;
+    const char *pszRoot = "/";
+    FILE *fp = NULL;
+    int nLockFd = -1;
+    int nInUse = 0;
+    int i;
+
+    if (!IsNullOrEmptyString(pTdnf->pArgs->pszInstallRoot))
+    {
+        pszRoot = pTdnf->pArgs->pszInstallRoot;
+    }
+
+    dwError = TDNFAllocateStringPrintf(&pszLockFile, "%s/%s%s",
+                  pszCacheDir, pszName, TDNF_SHARED_CACHE_LOCK_EXT);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFAllocateStringPrintf(&pszRootsFile, "%s/%s%s",
+                  pszCacheDir, pszName, TDNF_SHARED_CACHE_ROOTS_EXT);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    nLockFd = open(pszLockFile, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (nLockFd < 0)
+    {
+        dwError = errno;
+        BAIL_ON_TDNF_SYSTEM_ERROR_UNCOND(dwError);
+    }
+    if (flock(nLockFd, LOCK_EX | LOCK_NB))
+    {
+        if (errno != EWOULDBLOCK)
+        {
+            dwError = errno;
+            BAIL_ON_TDNF_SYSTEM_ERROR_UNCOND(dwError);
+        }
+        pr_info("keeping shared cache of %s, it is in use\n", pszName);
+        goto cleanup;
+    }
+
+    dwError = TDNFReadFileToStringArray(pszRootsFile, &ppszRoots);
+    if (dwError == ERROR_TDNF_SYSTEM_BASE + ENOENT)
+    {
+        dwError = 0;
+    }
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    for (i = 0; ppszRoots && ppszRoots[i]; i++)
+    {
+        if (!IsNullOrEmptyString(ppszRoots[i]) &&
+            strcmp(ppszRoots[i], pszRoot) &&
+            access(ppszRoots[i], F_OK) == 0)
+        {
+            nInUse = 1;
+            break;
+        }
+    }
+
+    if (nInUse)
+    {
+        pr_info("keeping shared cache of %s, it is used by %s\n",
+                pszName, ppszRoots[i]);
+
+        fp = fopen(pszRootsFile, "w");
+        if (!fp)
+        {
+            dwError = errno;
+            BAIL_ON_TDNF_SYSTEM_ERROR_UNCOND(dwError);
+        }
+        for (i = 0; ppszRoots[i]; i++)
+        {
+            if (!IsNullOrEmptyString(ppszRoots[i]) &&
+                strcmp(ppszRoots[i], pszRoot))
+            {
+                fprintf(fp, "%s\n", ppszRoots[i]);
+            }
+        }
+        goto cleanup;
+    }
+
+    pr_info("removing cache of %s, it is not a configured repo\n", pszName);
+    dwError = TDNFRecursivelyRemoveDir(pszPath);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    if (unlink(pszRootsFile) && errno != ENOENT)
+    {
+        dwError = errno;
+        BAIL_ON_TDNF_SYSTEM_ERROR_UNCOND(dwError);
+    }
+
+cleanup:
+    if (fp)
+    {
+        fclose(fp);
+    }
+    TDNFRepoUnlockSharedCache(nLockFd);
+    TDNF_SAFE_FREE_STRINGARRAY(ppszRoots);
+    TDNF_SAFE_FREE_MEMORY(pszLockFile);
+    TDNF_SAFE_FREE_MEMORY(pszRootsFile);
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+static
+uint32_t
+_TDNFCleanStaleRepoDirsIn(
+    PTDNF pTdnf,
+    const char *pszCacheDir,
+    int nShared
+    )
+{
+    uint32_t dwError = 0;
+    PTDNF_REPO_DATA pRepo = NULL;
+    DIR *pDir = NULL;
+    struct dirent *pEnt = NULL;
+    struct stat st = {0};
+    char *pszPath = NULL;
+
+    pDir = opendir(pszCacheDir);
+    if (!pDir)
+    {
+        if (errno == ENOENT)
+        {
+            goto cleanup;
+        }
+        dwError = ERROR_TDNF_SYSTEM_BASE + errno;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    while ((pEnt = readdir(pDir)) != NULL)
+    {
+        if (!strcmp(pEnt->d_name, ".") || !strcmp(pEnt->d_name, ".."))
+        {
+            continue;
+        }
+
+        for (pRepo = pTdnf->pRepos; pRepo; pRepo = pRepo->pNext)
+        {
+            if (!strcmp(pEnt->d_name, pRepo->pszId) ||
+                (pRepo->pszCacheName &&
+                 !strcmp(pEnt->d_name, pRepo->pszCacheName)))
+            {
+                break;
+            }
+        }
+        if (pRepo)
+        {
+            continue;
+        }
+
+        dwError = TDNFJoinPath(&pszPath, pszCacheDir, pEnt->d_name, NULL);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        if (lstat(pszPath, &st) == 0 && S_ISDIR(st.st_mode) &&
+            _TDNFCacheIsRepoDir(pszPath))
+        {
+            if (nShared)
+            {
+                dwError = _TDNFCleanStaleSharedRepoDir(pTdnf, pszCacheDir,
+                                                       pEnt->d_name, pszPath);
+                BAIL_ON_TDNF_ERROR(dwError);
+            }
+            else
+            {
+                pr_info("removing cache of %s, it is not a configured repo\n",
+                        pEnt->d_name);
+                dwError = TDNFRecursivelyRemoveDir(pszPath);
+                BAIL_ON_TDNF_ERROR(dwError);
+            }
+        }
+        TDNF_SAFE_FREE_MEMORY(pszPath);
+    }
+
+cleanup:
+    if (pDir)
+    {
+        closedir(pDir);
+    }
+    TDNF_SAFE_FREE_MEMORY(pszPath);
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+/*
+ * Remove the cache directories of repos that are not configured,
+ * enabled or not, from the cache of this root. Those in the shared
+ * cache are only removed once no other installroot uses them.
+ */
+uint32_t
+TDNFCleanStaleRepoDirs(
+    PTDNF pTdnf
+    )
+{
+    uint32_t dwError = 0;
+
+    if (!pTdnf || !pTdnf->pConf || !pTdnf->pArgs)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    dwError = _TDNFCleanStaleRepoDirsIn(pTdnf, pTdnf->pConf->pszCacheDir, 0);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    if (pTdnf->pConf->pszSharedCacheDir)
+    {
+        dwError = _TDNFCleanStaleRepoDirsIn(pTdnf,
+                                            pTdnf->pConf->pszSharedCacheDir,
+                                            1);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+cleanup:
+    return dwError;
+
+error:
+    goto cleanup;
+}
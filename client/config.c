@@ -26,6 +26,44 @@ TDNFConfGetRpmVerbosity(
     return nLogLevel;
 }
 
+/* "repomd metadata package prefetch", all above 0 */
+static
+uint32_t
+_TDNFParseBandwidthShares(
+    char *pszShares,
+    int *pnShares
+    )
+{
+    uint32_t dwError = 0;
+    char **ppszShares = NULL;
+    int i;
+
+    dwError = TDNFSplitStringToArray(pszShares, " ", &ppszShares);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    for (i = 0; i < TDNF_XFER_CLASS_COUNT; i++)
+    {
+        if (!ppszShares[i] || strtoi(ppszShares[i]) <= 0)
+        {
+            dwError = ERROR_TDNF_INVALID_CONF;
+            BAIL_ON_TDNF_ERROR(dwError);
+        }
+        pnShares[i] = strtoi(ppszShares[i]);
+    }
+    if (ppszShares[i])
+    {
+        dwError = ERROR_TDNF_INVALID_CONF;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+cleanup:
+    TDNF_SAFE_FREE_STRINGARRAY(ppszShares);
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
 uint32_t
 TDNFReadConfig(
     PTDNF pTdnf,
@@ -68,6 +106,10 @@ TDNFReadConfig(
     pConf->nCleanRequirementsOnRemove = 0;
     pConf->nKeepCache = 0;
     pConf->nOpenMax = TDNF_DEFAULT_OPENMAX;
+    pConf->nBandwidthShares[TDNF_XFER_REPOMD] = TDNF_BANDWIDTH_SHARE_REPOMD;
+    pConf->nBandwidthShares[TDNF_XFER_METADATA] = TDNF_BANDWIDTH_SHARE_METADATA;
+    pConf->nBandwidthShares[TDNF_XFER_PACKAGE] = TDNF_BANDWIDTH_SHARE_PACKAGE;
+    pConf->nBandwidthShares[TDNF_XFER_PREFETCH] = TDNF_BANDWIDTH_SHARE_PREFETCH;
 
     register_ini(NULL);
     mod_ini = find_cnfmodule("ini");
@@ -125,6 +167,63 @@ TDNFReadConfig(
         {
             pConf->pszCacheDir = strdup(cn->value);
         }
+        else if (strcmp(cn->name, TDNF_CONF_KEY_PACKAGE_STORE) == 0)
+        {
+            pConf->pszPackageStore = strdup(cn->value);
+        }
+        else if (strcmp(cn->name, TDNF_CONF_KEY_LOCAL_HARDLINK) == 0)
+        {
+            pConf->nLocalHardlink = isTrue(cn->value);
+        }
+        else if (strcmp(cn->name, TDNF_CONF_KEY_SHARED_CACHEDIR) == 0)
+        {
+            pConf->pszSharedCacheDir = strdup(cn->value);
+        }
+        else if (strcmp(cn->name, TDNF_CONF_KEY_CACHE_BUDGET) == 0)
+        {
+            dwError = TDNFParseSize(cn->value, &pConf->qwCacheBudget);
+            BAIL_ON_TDNF_ERROR(dwError);
+        }
+        else if (strcmp(cn->name, TDNF_CONF_KEY_SOLVCACHE_ZSTD_LEVEL) == 0)
+        {
+            pConf->nSolvCacheZstdLevel = strtoi(cn->value);
+            if (pConf->nSolvCacheZstdLevel < 0 ||
+                pConf->nSolvCacheZstdLevel > TDNF_SOLVCACHE_ZSTD_MAX_LEVEL)
+            {
+                dwError = ERROR_TDNF_INVALID_CONF;
+                BAIL_ON_TDNF_ERROR(dwError);
+            }
+        }
+        else if (strcmp(cn->name, TDNF_CONF_KEY_PREFETCH_THROTTLE) == 0)
+        {
+            dwError = TDNFParseSize(cn->value, &pConf->qwPrefetchThrottle);
+            BAIL_ON_TDNF_ERROR(dwError);
+        }
+        else if (strcmp(cn->name, TDNF_CONF_KEY_STALE_WHILE_REVALIDATE) == 0)
+        {
+            pConf->nStaleWhileRevalidate = isTrue(cn->value);
+        }
+        else if (strcmp(cn->name, TDNF_CONF_KEY_MAX_CONCURRENT_STREAMS) == 0)
+        {
+            pConf->nMaxConcurrentStreams = strtoi(cn->value);
+            if (pConf->nMaxConcurrentStreams < 0 ||
+                pConf->nMaxConcurrentStreams > TDNF_MAX_CONCURRENT_STREAMS_LIMIT)
+            {
+                dwError = ERROR_TDNF_INVALID_CONF;
+                BAIL_ON_TDNF_ERROR(dwError);
+            }
+        }
+        else if (strcmp(cn->name, TDNF_CONF_KEY_MAX_BANDWIDTH) == 0)
+        {
+            dwError = TDNFParseSize(cn->value, &pConf->qwMaxBandwidth);
+            BAIL_ON_TDNF_ERROR(dwError);
+        }
+        else if (strcmp(cn->name, TDNF_CONF_KEY_BANDWIDTH_SHARES) == 0)
+        {
+            dwError = _TDNFParseBandwidthShares(cn->value,
+                                                pConf->nBandwidthShares);
+            BAIL_ON_TDNF_ERROR(dwError);
+        }
         else if (strcmp(cn->name, TDNF_CONF_KEY_PERSISTDIR) == 0)
         {
             pConf->pszPersistDir = strdup(cn->value);
@@ -321,6 +420,8 @@ TDNFFreeConfig(
         TDNF_SAFE_FREE_MEMORY(pConf->pszProxyUserPass);
         TDNF_SAFE_FREE_MEMORY(pConf->pszRepoDir);
         TDNF_SAFE_FREE_MEMORY(pConf->pszCacheDir);
+        TDNF_SAFE_FREE_MEMORY(pConf->pszPackageStore);
+        TDNF_SAFE_FREE_MEMORY(pConf->pszSharedCacheDir);
         TDNF_SAFE_FREE_MEMORY(pConf->pszPersistDir);
         TDNF_SAFE_FREE_MEMORY(pConf->pszDistroVerPkg);
         TDNF_SAFE_FREE_MEMORY(pConf->pszVarReleaseVer);
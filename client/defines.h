@@ -79,6 +79,16 @@ typedef enum
 #define TDNF_CONF_KEY_OPENMAX             "openmax"
 #define TDNF_CONF_KEY_CHECK_UPDATE_COMPAT "dnf_check_update_compat"
 #define TDNF_CONF_KEY_DISTROSYNC_REINSTALL_CHANGED "distrosync_reinstall_changed"
+#define TDNF_CONF_KEY_PACKAGE_STORE      "package_store"
+#define TDNF_CONF_KEY_LOCAL_HARDLINK     "local_hardlink"
+#define TDNF_CONF_KEY_SHARED_CACHEDIR    "shared_cachedir"
+#define TDNF_CONF_KEY_CACHE_BUDGET       "cache_budget"
+#define TDNF_CONF_KEY_SOLVCACHE_ZSTD_LEVEL "solvcache_zstd_level"
+#define TDNF_CONF_KEY_PREFETCH_THROTTLE  "prefetch_throttle"
+#define TDNF_CONF_KEY_STALE_WHILE_REVALIDATE "stale_while_revalidate"
+#define TDNF_CONF_KEY_MAX_CONCURRENT_STREAMS "max_concurrent_streams"
+#define TDNF_CONF_KEY_MAX_BANDWIDTH      "max_bandwidth"
+#define TDNF_CONF_KEY_BANDWIDTH_SHARES   "bandwidth_shares"
 
 //Repo file key names
 #define TDNF_REPO_KEY_BASEURL             "baseurl"
@@ -96,6 +106,7 @@ typedef enum
 #define TDNF_REPO_KEY_RETRIES             "retries"
 #define TDNF_REPO_KEY_MINRATE             "minrate"
 #define TDNF_REPO_KEY_THROTTLE            "throttle"
+#define TDNF_REPO_KEY_STALL_TIMEOUT       "stall_timeout"
 #define TDNF_REPO_KEY_SSL_VERIFY          "sslverify"
 #define TDNF_REPO_KEY_SSL_CA_CERT         "sslcacert"
 #define TDNF_REPO_KEY_SSL_CLI_CERT        "sslclientcert"
@@ -103,12 +114,15 @@ typedef enum
 #define TDNF_REPO_KEY_SKIP_MD_FILELISTS   "skip_md_filelists"
 #define TDNF_REPO_KEY_SKIP_MD_UPDATEINFO  "skip_md_updateinfo"
 #define TDNF_REPO_KEY_SKIP_MD_OTHER       "skip_md_other"
+#define TDNF_REPO_KEY_HTTP2_PRIOR_KNOWLEDGE "http2_prior_knowledge"
 
 //setopt keys
 #define TDNF_SETOPT_KEY_REPOSDIR          "reposdir"
 
 //file names
 #define TDNF_REPO_METADATA_MARKER         "lastrefresh"
+//cache dir a stale repo is refreshed into, see TDNFRevalidateStaleRepos()
+#define TDNF_REVALIDATE_DIR_EXT           ".revalidate"
 #define TDNF_REPO_METADATA_FILE_PATH      "repodata/repomd.xml"
 #define TDNF_REPO_METADATA_FILE_NAME      "repomd.xml"
 #define TDNF_REPO_METALINK_FILE_NAME      "metalink"
@@ -117,6 +131,73 @@ typedef enum
 #define TDNF_AUTOINSTALLED_FILE           "autoinstalled"
 #define TDNF_HISTORY_DB_FILE              "history.db"
 
+//result cache, see resultcache.c
+#define TDNF_RESULT_CACHE_DIR_NAME        "resultcache"
+#define TDNF_RESULT_CACHE_MAGIC           "tdnf-result-cache"
+#define TDNF_RESULT_CACHE_VERSION         1
+#define TDNF_RESULT_CACHE_SLOT_CHECK_UPDATE "check-update"
+#define TDNF_RESULT_CACHE_SLOT_UPDATE_SUMMARY "update-summary"
+#define TDNF_RESULT_CACHE_SLOT_FILE_DIGESTS "file-digests"
+
+//what goes into a result cache key besides repos, rpmdb and config
+#define TDNF_RESULT_CACHE_KEY_FRESH       0x01 //fail if a refresh is due
+#define TDNF_RESULT_CACHE_KEY_ARGS        0x02 //command args and setopts
+
+//reposync download workers
+#define TDNF_REPOSYNC_DEFAULT_WORKERS     4
+#define TDNF_REPOSYNC_MAX_WORKERS         64
+//held in the target of a reposync with norepopath
+#define TDNF_REPOSYNC_LOCK_FILE_NAME      ".tdnf-reposync.lock"
+
+//workers verifying package files, one per cpu up to this
+#define TDNF_VERIFY_MAX_WORKERS           16
+
+//verified package files, one per repo, see verifycache.c
+#define TDNF_VERIFY_CACHE_FILE_NAME       "verified.cache"
+#define TDNF_VERIFY_CACHE_MAGIC           "tdnf-verify-cache"
+#define TDNF_VERIFY_CACHE_VERSION         1
+//hex digits of the long key id of a signing key
+#define TDNF_VERIFY_CACHE_KEY_ID_LEN      16
+
+//content addressed package store, see packagestore.c
+#define TDNF_PACKAGE_STORE_DIR_NAME       "store"
+
+//highest level for solvcache_zstd_level, as zstd without --ultra
+#define TDNF_SOLVCACHE_ZSTD_MAX_LEVEL     19
+
+//last use of cached packages for cache_budget, see cacheclean.c
+#define TDNF_CACHE_ACCESS_FILE_NAME       "packages.access"
+
+//priority of makecache --prefetch, see prefetch.c. The io
+//priority is best effort class, lowest level, as ioprio_set(2)
+#define TDNF_PREFETCH_NICE                19
+#define TDNF_IOPRIO_WHO_PROCESS           1
+#define TDNF_IOPRIO_CLASS_SHIFT           13
+#define TDNF_IOPRIO_CLASS_BE              2
+#define TDNF_IOPRIO_BE_LOWEST             7
+
+//downloads, see remoterepo.c. A partial file smaller than this
+//is fetched again instead of resumed
+#define TDNF_DOWNLOAD_RESUME_MIN          (64 * 1024)
+#define TDNF_DOWNLOAD_BACKOFF_BASE_MS     200
+#define TDNF_DOWNLOAD_BACKOFF_MAX_MS      10000
+
+//streams of one connection for max_concurrent_streams, see
+//multiplex.c. This is the default limit of libcurl as well.
+#define TDNF_MAX_CONCURRENT_STREAMS_LIMIT 100
+
+//max_bandwidth, see bandwidth.c. The default bandwidth_shares
+//of repomd, metadata, package and prefetch downloads. A class
+//saves up no more than its share of BURST_MS of bandwidth.
+#define TDNF_BANDWIDTH_SHARE_REPOMD       8
+#define TDNF_BANDWIDTH_SHARE_METADATA     4
+#define TDNF_BANDWIDTH_SHARE_PACKAGE      2
+#define TDNF_BANDWIDTH_SHARE_PREFETCH     1
+#define TDNF_BANDWIDTH_BURST_MS           100
+
+//setopt set by --cached
+#define TDNF_SETOPT_KEY_CACHED            "cached"
+
 // repo defaults
 #define TDNF_DEFAULT_REPO_LOCATION        "/etc/yum.repos.d"
 #define TDNF_DEFAULT_CACHE_LOCATION       "/var/cache/tdnf"
@@ -130,16 +211,27 @@ typedef enum
 #define TDNF_RPM_CACHE_DIR_NAME           "rpms"
 #define TDNF_REPODATA_DIR_NAME            "repodata"
 #define TDNF_SOLVCACHE_DIR_NAME           "solvcache"
+#define TDNF_SHARED_CACHE_LOCK_EXT        ".lock"
+#define TDNF_SHARED_CACHE_ROOTS_EXT       ".roots"
 #define TDNF_REPO_METADATA_EXPIRE_NEVER   "never"
 
 #define TDNF_DEFAULT_OPENMAX              1024
 
+//Handle init stages, see TDNFInitHandleStages()
+#define TDNF_INIT_STAGE_REPOS             0x01
+#define TDNF_INIT_STAGE_SACK              0x02
+#define TDNF_INIT_STAGE_PROVIDES          0x04
+#define TDNF_INIT_STAGE_ALL               0x07
+//set by TDNFRefresh once the repos are loaded into the sack
+#define TDNF_INIT_STAGE_REPODATA          0x08
+
 // repo default settings
 #define TDNF_REPO_DEFAULT_ENABLED            0
 #define TDNF_REPO_DEFAULT_SKIP               0
 #define TDNF_REPO_DEFAULT_GPGCHECK           1
 #define TDNF_REPO_DEFAULT_MINRATE            0
 #define TDNF_REPO_DEFAULT_THROTTLE           0
+#define TDNF_REPO_DEFAULT_STALL_TIMEOUT      30
 #define TDNF_REPO_DEFAULT_TIMEOUT            0
 #define TDNF_REPO_DEFAULT_SSLVERIFY          1
 #define TDNF_REPO_DEFAULT_RETRIES            10
@@ -149,6 +241,7 @@ typedef enum
 #define TDNF_REPO_DEFAULT_SKIP_MD_FILELISTS  0
 #define TDNF_REPO_DEFAULT_SKIP_MD_UPDATEINFO 0
 #define TDNF_REPO_DEFAULT_SKIP_MD_OTHER      0
+#define TDNF_REPO_DEFAULT_HTTP2_PRIOR_KNOWLEDGE 0
 
 // var names
 #define TDNF_VAR_RELEASEVER               "$releasever"
@@ -171,6 +264,7 @@ typedef enum
     {ERROR_TDNF_PACKAGE_REQUIRED,    "ERROR_TDNF_PACKAGE_REQUIRED",    "Package name expected but was not provided"}, \
     {ERROR_TDNF_CONF_FILE_LOAD,      "ERROR_TDNF_CONF_FILE_LOAD",      "Error loading tdnf conf (/etc/tdnf/tdnf.conf)"}, \
     {ERROR_TDNF_REPO_FILE_LOAD,      "ERROR_TDNF_REPO_FILE_LOAD",      "Error loading tdnf repo (normally under /etc/yum.repos.d/)"}, \
+    {ERROR_TDNF_INVALID_CONF,        "ERROR_TDNF_INVALID_CONF",        "Encountered an invalid value in the configuration. Check /etc/tdnf/tdnf.conf"}, \
     {ERROR_TDNF_INVALID_REPO_FILE,   "ERROR_TDNF_INVALID_REPO_FILE",   "Encountered an invalid repo file"}, \
     {ERROR_TDNF_REPO_DIR_OPEN,       "ERROR_TDNF_REPO_DIR_OPEN",       "Error opening repo dir. Check if the repodir configured in tdnf.conf exists (usually /etc/yum.repos.d)"}, \
     {ERROR_TDNF_NO_MATCH,            "ERROR_TDNF_NO_MATCH",            "No matching packages"}, \
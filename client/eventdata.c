@@ -173,6 +173,51 @@ error:
     return dwError;
 }
 
+/*
+ * Set a string item, replacing the value if the item is there.
+ * The context does not copy pcszStr, it has to stay valid until
+ * the event is done, so plugins should keep it in their handle.
+ */
+uint32_t
+TDNFEventContextSetItemString(
+    PTDNF_EVENT_CONTEXT pContext,
+    const char *pcszName,
+    const char *pcszStr
+    )
+{
+    uint32_t dwError = 0;
+    PTDNF_EVENT_DATA pData = NULL;
+
+    if (!pContext || IsNullOrEmptyString(pcszName) ||
+        IsNullOrEmptyString(pcszStr))
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    if (!pContext->pData ||
+        TDNFEventContextGetItem(pContext, pcszName, &pData))
+    {
+        dwError = TDNFAddEventDataString(pContext, pcszName, pcszStr);
+        BAIL_ON_TDNF_ERROR(dwError);
+        goto cleanup;
+    }
+
+    if (pData->nType != TDNF_EVENT_ITEM_TYPE_STRING)
+    {
+        dwError = ERROR_TDNF_EVENT_CTXT_ITEM_INVALID_TYPE;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    pData->pcszStr = pcszStr;
+
+cleanup:
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
 void
 TDNFFreeEventData(
     PTDNF_EVENT_DATA pData
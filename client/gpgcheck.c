@@ -285,29 +285,20 @@ error:
     goto cleanup;
 }
 
+static
 uint32_t
-TDNFImportGPGKeyFile(
+_TDNFImportGPGKeyData(
     rpmts pTS,
-    const char* pszFile
+    const char* pszKeyData,
+    int nKeyDataSize
     )
 {
     uint32_t dwError = 0;
     uint8_t* pPkt = NULL;
     size_t nPktLen = 0;
-    char* pszKeyData = NULL;
-    int nKeyDataSize;
     int nKeys = 0;
     int nOffset = 0;
 
-    if(pTS == NULL || IsNullOrEmptyString(pszFile))
-    {
-        dwError = ERROR_TDNF_INVALID_PARAMETER;
-        BAIL_ON_TDNF_ERROR(dwError);
-    }
-
-    dwError = ReadGPGKeyFile(pszFile, &pszKeyData, &nKeyDataSize);
-    BAIL_ON_TDNF_ERROR(dwError);
-
     while (nOffset < nKeyDataSize)
     {
         pgpArmor nArmor = pgpParsePkts(pszKeyData + nOffset, &pPkt, &nPktLen);
@@ -326,8 +317,244 @@ TDNFImportGPGKeyFile(
     }
 
 cleanup:
+    return dwError;
+error:
+    goto cleanup;
+}
+
+uint32_t
+TDNFImportGPGKeyFile(
+    rpmts pTS,
+    const char* pszFile
+    )
+{
+    uint32_t dwError = 0;
+    char* pszKeyData = NULL;
+    int nKeyDataSize;
+
+    if(pTS == NULL || IsNullOrEmptyString(pszFile))
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    dwError = ReadGPGKeyFile(pszFile, &pszKeyData, &nKeyDataSize);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = _TDNFImportGPGKeyData(pTS, pszKeyData, nKeyDataSize);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+cleanup:
+    TDNF_SAFE_FREE_MEMORY(pszKeyData);
+    return dwError;
+error:
+    goto cleanup;
+}
+
+/* guards the keys of handles, reposync checks packages in threads */
+static pthread_mutex_t mutexGPGKeys = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * Find the key of pRepo at pszUrl among the keys the handle has
+ * seen, adding a new entry if needed.
+ */
+static
+uint32_t
+_TDNFGPGGetKey(
+    PTDNF pTdnf,
+    PTDNF_REPO_DATA pRepo,
+    const char *pszUrl,
+    PTDNF_GPG_KEY *ppKey
+    )
+{
+    uint32_t dwError = 0;
+    PTDNF_GPG_KEY pKey = NULL;
+
+    for (pKey = pTdnf->pGPGKeys; pKey; pKey = pKey->pNext)
+    {
+        if (!strcmp(pKey->pszRepoId, pRepo->pszId) &&
+            !strcmp(pKey->pszUrl, pszUrl))
+        {
+            break;
+        }
+    }
+
+    if (!pKey)
+    {
+        dwError = TDNFAllocateMemory(1, sizeof(TDNF_GPG_KEY),
+                                     (void **)&pKey);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        dwError = TDNFAllocateString(pRepo->pszId, &pKey->pszRepoId);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        dwError = TDNFAllocateString(pszUrl, &pKey->pszUrl);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        pKey->pNext = pTdnf->pGPGKeys;
+        pTdnf->pGPGKeys = pKey;
+    }
+
+    *ppKey = pKey;
+
+cleanup:
+    return dwError;
+
+error:
+    TDNFFreeGPGKeys(pKey);
+    goto cleanup;
+}
+
+/*
+ * Ask for and fetch the key pKey. Its data is kept to import it into
+ * each transaction set that needs it, and it gets a keyring of its
+ * own, to tell which packages it signed without reading the key file
+ * again.
+ */
+static
+uint32_t
+_TDNFGPGFetchKey(
+    PTDNF pTdnf,
+    PTDNF_REPO_DATA pRepo,
+    PTDNF_GPG_KEY pKey
+    )
+{
+    uint32_t dwError = 0;
+    char* pszLocalGPGKey = NULL;
+    char* pszKeyData = NULL;
+    int nKeyDataSize = 0;
+    rpmKeyring pKeyring = NULL;
+    int nAnswer = 0;
+    int nRemote = 0;
+
+    pr_info("importing key from %s\n", pKey->pszUrl);
+    dwError = TDNFYesOrNo(pTdnf->pArgs, "Is this ok [y/N]: ", &nAnswer);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    if(!nAnswer)
+    {
+        dwError = ERROR_TDNF_OPERATION_ABORTED;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    dwError = TDNFUriIsRemote(pKey->pszUrl, &nRemote);
+    if (dwError == ERROR_TDNF_URL_INVALID)
+    {
+        dwError = ERROR_TDNF_KEYURL_INVALID;
+    }
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    if (nRemote)
+    {
+        dwError = TDNFFetchRemoteGPGKey(pTdnf, pRepo, pKey->pszUrl, &pszLocalGPGKey);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+    else
+    {
+        dwError = TDNFPathFromUri(pKey->pszUrl, &pszLocalGPGKey);
+        if (dwError == ERROR_TDNF_URL_INVALID)
+        {
+            dwError = ERROR_TDNF_KEYURL_INVALID;
+        }
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+    dwError = ReadGPGKeyFile(pszLocalGPGKey, &pszKeyData, &nKeyDataSize);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    pKeyring = rpmKeyringNew();
+    if (!pKeyring)
+    {
+        dwError = ERROR_TDNF_OUT_OF_MEMORY;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    dwError = AddKeyFileToKeyring(pszLocalGPGKey, pKeyring);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    pKey->pKeyring = pKeyring;
+    pKeyring = NULL;
+    pKey->pszKeyData = pszKeyData;
+    pKey->nKeyDataSize = nKeyDataSize;
+    pszKeyData = NULL;
+
+cleanup:
+    if (pKeyring)
+    {
+        rpmKeyringFree(pKeyring);
+    }
     TDNF_SAFE_FREE_MEMORY(pszKeyData);
+    TDNF_SAFE_FREE_MEMORY(pszLocalGPGKey);
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+/*
+ * Check that one of the keys of pRepo signed pszFilePath, and import
+ * the keys that did into pTS. Each key is asked for and fetched at
+ * most once per handle, but every transaction set has a keyring of
+ * its own, so it is imported into each one that reports NOKEY.
+ */
+static
+uint32_t
+_TDNFGPGImportRepoKeys(
+    PTDNFRPMTS pTS,
+    PTDNF pTdnf,
+    PTDNF_REPO_DATA pRepo,
+    const char* pszFilePath
+    )
+{
+    uint32_t dwError = 0;
+    char** ppszUrlGPGKeys = NULL;
+    PTDNF_GPG_KEY pKey = NULL;
+    int nGPGSigCheck = 0;
+    int nMatched = 0;
+    int i;
+
+    pthread_mutex_lock(&mutexGPGKeys);
+
+    dwError = TDNFGetGPGSignatureCheck(pTdnf, pRepo, &nGPGSigCheck, &ppszUrlGPGKeys);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    for (i = 0; ppszUrlGPGKeys[i]; i++) {
+        dwError = _TDNFGPGGetKey(pTdnf, pRepo, ppszUrlGPGKeys[i], &pKey);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        if (!pKey->pKeyring)
+        {
+            dwError = _TDNFGPGFetchKey(pTdnf, pRepo, pKey);
+            BAIL_ON_TDNF_ERROR(dwError);
+        }
+
+        dwError = VerifyRpmSig(pKey->pKeyring, pszFilePath);
+        if (dwError == 0)
+        {
+            dwError = _TDNFImportGPGKeyData(pTS->pTS,
+                                            pKey->pszKeyData,
+                                            pKey->nKeyDataSize);
+            BAIL_ON_TDNF_ERROR(dwError);
+            pKey->nMatched++;
+            nMatched++;
+        }
+        else if (dwError == ERROR_TDNF_RPM_GPG_NO_MATCH)
+        {
+            dwError = 0;
+        }
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    if (nMatched == 0)
+    {
+        dwError = ERROR_TDNF_RPM_GPG_NO_MATCH;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+cleanup:
+    pthread_mutex_unlock(&mutexGPGKeys);
+    TDNF_SAFE_FREE_STRINGARRAY(ppszUrlGPGKeys);
     return dwError;
+
 error:
     goto cleanup;
 }
@@ -343,15 +570,8 @@ TDNFGPGCheckPackage(
 {
     uint32_t dwError = 0;
     Header rpmHeader = NULL;
-    rpmKeyring pKeyring = NULL;
     int nGPGSigCheck = 0;
     FD_t fp = NULL;
-    char** ppszUrlGPGKeys = NULL;
-    char* pszLocalGPGKey = NULL;
-    int nAnswer = 0;
-    int nRemote = 0;
-    int i;
-    int nMatched = 0;
 
     dwError = TDNFGetGPGSignatureCheck(pTdnf, pRepo, &nGPGSigCheck, NULL);
     BAIL_ON_TDNF_ERROR(dwError);
@@ -378,70 +598,13 @@ TDNFGPGCheckPackage(
     }
     else if(nGPGSigCheck)
     {
-        dwError = TDNFGetGPGSignatureCheck(pTdnf, pRepo, &nGPGSigCheck, &ppszUrlGPGKeys);
+        dwError = _TDNFGPGImportRepoKeys(pTS, pTdnf, pRepo, pszFilePath);
         BAIL_ON_TDNF_ERROR(dwError);
 
-        for (i = 0; ppszUrlGPGKeys[i]; i++) {
-            pr_info("importing key from %s\n", ppszUrlGPGKeys[i]);
-            dwError = TDNFYesOrNo(pTdnf->pArgs, "Is this ok [y/N]: ", &nAnswer);
-            BAIL_ON_TDNF_ERROR(dwError);
-
-            if(!nAnswer)
-            {
-                dwError = ERROR_TDNF_OPERATION_ABORTED;
-                BAIL_ON_TDNF_ERROR(dwError);
-            }
-
-            dwError = TDNFUriIsRemote(ppszUrlGPGKeys[i], &nRemote);
-            if (dwError == ERROR_TDNF_URL_INVALID)
-            {
-                dwError = ERROR_TDNF_KEYURL_INVALID;
-            }
-            BAIL_ON_TDNF_ERROR(dwError);
-
-            if (nRemote)
-            {
-                dwError = TDNFFetchRemoteGPGKey(pTdnf, pRepo, ppszUrlGPGKeys[i], &pszLocalGPGKey);
-                BAIL_ON_TDNF_ERROR(dwError);
-            }
-            else
-            {
-                dwError = TDNFPathFromUri(ppszUrlGPGKeys[i], &pszLocalGPGKey);
-                if (dwError == ERROR_TDNF_URL_INVALID)
-                {
-                    dwError = ERROR_TDNF_KEYURL_INVALID;
-                }
-                BAIL_ON_TDNF_ERROR(dwError);
-            }
-            dwError = TDNFImportGPGKeyFile(pTS->pTS, pszLocalGPGKey);
-            BAIL_ON_TDNF_ERROR(dwError);
-
-            pKeyring = rpmtsGetKeyring(pTS->pTS, 0);
-            dwError = TDNFGPGCheck(pKeyring, pszLocalGPGKey, pszFilePath);
-            if (dwError == 0)
-            {
-                nMatched++;
-            }
-            else if (dwError == ERROR_TDNF_RPM_GPG_NO_MATCH)
-            {
-                dwError = 0;
-            }
-            BAIL_ON_TDNF_ERROR(dwError);
-
-            if (nRemote)
-            {
-                if (unlink(pszLocalGPGKey))
-                {
-                    dwError = errno;
-                    BAIL_ON_TDNF_SYSTEM_ERROR(dwError);
-                }
-            }
-        }
-
-        if (nMatched == 0)
+        if (rpmHeader)
         {
-            dwError = ERROR_TDNF_RPM_GPG_NO_MATCH;
-            BAIL_ON_TDNF_ERROR(dwError);
+            headerFree(rpmHeader);
+            rpmHeader = NULL;
         }
         fp = Fopen (pszFilePath, "r.ufdio");
         if(!fp)
@@ -477,8 +640,6 @@ TDNFGPGCheckPackage(
     }
 
 cleanup:
-    TDNF_SAFE_FREE_STRINGARRAY(ppszUrlGPGKeys);
-    TDNF_SAFE_FREE_MEMORY(pszLocalGPGKey);
     if(fp)
     {
         Fclose(fp);
@@ -493,6 +654,27 @@ error:
     goto cleanup;
 }
 
+void
+TDNFFreeGPGKeys(
+    PTDNF_GPG_KEY pKeys
+    )
+{
+    PTDNF_GPG_KEY pNext = NULL;
+
+    for (; pKeys; pKeys = pNext)
+    {
+        pNext = pKeys->pNext;
+        TDNF_SAFE_FREE_MEMORY(pKeys->pszRepoId);
+        TDNF_SAFE_FREE_MEMORY(pKeys->pszUrl);
+        TDNF_SAFE_FREE_MEMORY(pKeys->pszKeyData);
+        if (pKeys->pKeyring)
+        {
+            rpmKeyringFree(pKeys->pKeyring);
+        }
+        TDNFFreeMemory(pKeys);
+    }
+}
+
 uint32_t
 TDNFFetchRemoteGPGKey(
     PTDNF pTdnf,
@@ -508,6 +690,7 @@ TDNFFetchRemoteGPGKey(
     char* pszRealTopKeyCacheDir = NULL;
     char* pszDownloadCacheDir = NULL;
     char* pszKeyLocation = NULL;
+    struct stat st = {0};
 
     if(!pTdnf || !pRepo || IsNullOrEmptyString(pszUrlGPGKey))
     {
@@ -564,9 +747,16 @@ TDNFFetchRemoteGPGKey(
         BAIL_ON_TDNF_ERROR(dwError);
     }
 
-    dwError = TDNFDownloadFile(pTdnf, pRepo, pszUrlGPGKey, pszFilePath,
-                               basename(pszFilePath));
-    BAIL_ON_TDNF_ERROR(dwError);
+    /* keys are kept in the cache and refreshed with the metadata */
+    if (stat(pszNormalPath, &st) ||
+        (pRepo->lMetadataExpire >= 0 &&
+         !pTdnf->pArgs->nCacheOnly &&
+         difftime(time(NULL), st.st_mtime) > pRepo->lMetadataExpire))
+    {
+        dwError = TDNFDownloadFile(pTdnf, pRepo, pszUrlGPGKey, pszFilePath,
+                                   basename(pszFilePath));
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
 
     *ppszKeyLocation = pszNormalPath;
 
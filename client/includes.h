@@ -29,6 +29,8 @@
 #include <sys/utsname.h>
 #include <sys/vfs.h>
 #include <sys/types.h>
+#include <sys/ioctl.h>
+#include <linux/fs.h>
 
 #include <dirent.h>
 #include <pthread.h>
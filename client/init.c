@@ -7,6 +7,7 @@
  */
 
 #include "includes.h"
+#include <sys/wait.h>
 
 uint32_t
 TDNFCloneCmdArgs(
@@ -98,6 +99,14 @@ TDNFCloneCmdArgs(
         BAIL_ON_TDNF_ERROR(dwError);
     }
 
+    if(pCmdArgsIn->ppszInstallRoots)
+    {
+        dwError = TDNFAllocateStringArray(
+                      pCmdArgsIn->ppszInstallRoots,
+                      &pCmdArgs->ppszInstallRoots);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
     if(!IsNullOrEmptyString(pCmdArgsIn->pszReleaseVer))
     {
         dwError = TDNFAllocateString(
@@ -211,6 +220,117 @@ int _repo_compare(const void *ppRepo1, const void *ppRepo2)
            (*(PTDNF_REPO_DATA*)(ppRepo2))->nPriority;
 }
 
+/*
+ * Commands that only read repo metadata may be answered from an
+ * expired cache with stale_while_revalidate, everything that can
+ * change the system keeps checking metadata_expire.
+ */
+static
+int
+_TDNFCanServeStale(
+    PTDNF pTdnf
+    )
+{
+    static const char *ppszReadOnlyCmds[] = {
+        "check-update", "info", "list", "provides", "repolist",
+        "repoquery", "search", "updateinfo", "whatprovides", NULL
+    };
+    int i;
+
+    if (!pTdnf->pConf->nStaleWhileRevalidate ||
+        pTdnf->pArgs->nRefresh || pTdnf->pArgs->nCmdCount < 1)
+    {
+        return 0;
+    }
+
+    for (i = 0; ppszReadOnlyCmds[i]; i++)
+    {
+        if (!strcmp(pTdnf->pArgs->ppszCmds[0], ppszReadOnlyCmds[i]))
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* an expired cache can only be used if there is one */
+static
+uint32_t
+_TDNFHasRepoMetadata(
+    const char *pszRepoCacheDir,
+    int *pnHasMetadata
+    )
+{
+    uint32_t dwError = 0;
+    char *pszMarkerFile = NULL;
+
+    dwError = TDNFJoinPath(&pszMarkerFile,
+                           pszRepoCacheDir,
+                           TDNF_REPO_METADATA_MARKER,
+                           NULL);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    *pnHasMetadata = access(pszMarkerFile, F_OK) == 0;
+
+cleanup:
+    TDNF_SAFE_FREE_MEMORY(pszMarkerFile);
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+/*
+ * Check metadata_expire of pRepo, unless requested to ignore it.
+ * lMetadataExpire < 0 means never expire. With nStaleOk expired
+ * metadata that is there is used, pRepo->nStale is set for it.
+ */
+static
+uint32_t
+_TDNFRepoMetadataExpired(
+    PTDNF pTdnf,
+    PTDNF_REPO_DATA pRepo,
+    int nStaleOk,
+    int *pnExpired
+    )
+{
+    uint32_t dwError = 0;
+    char *pszRepoCacheDir = NULL;
+    int nExpired = 0;
+
+    pRepo->nStale = 0;
+    if (pRepo->lMetadataExpire >= 0 && !pTdnf->pArgs->nCacheOnly)
+    {
+        dwError = TDNFGetCachePath(pTdnf, pRepo,
+                                   NULL, NULL,
+                                   &pszRepoCacheDir);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        dwError = TDNFShouldSyncMetadata(
+                      pszRepoCacheDir,
+                      pRepo->lMetadataExpire,
+                      &nExpired);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        if (nExpired && nStaleOk)
+        {
+            dwError = _TDNFHasRepoMetadata(pszRepoCacheDir,
+                                           &pRepo->nStale);
+            BAIL_ON_TDNF_ERROR(dwError);
+            nExpired = !pRepo->nStale;
+        }
+    }
+
+    *pnExpired = nExpired;
+
+cleanup:
+    TDNF_SAFE_FREE_MEMORY(pszRepoCacheDir);
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
 uint32_t
 TDNFRefreshSack(
     PTDNF pTdnf,
@@ -219,12 +339,13 @@ TDNFRefreshSack(
     )
 {
     uint32_t dwError = 0;
-    char* pszRepoCacheDir = NULL;
     int nMetadataExpired = 0;
     PTDNF_REPO_DATA pRepo = NULL;
     PTDNF_REPO_DATA *ppRepoArray = NULL;
     uint32_t nCount = 0;
     uint32_t i = 0;
+    int nLockFd = -1;
+    int nStaleOk = 0;
 
     if (!pTdnf)
     {
@@ -237,6 +358,8 @@ TDNFRefreshSack(
         pTdnf->pArgs->nRefresh = 1;
     }
 
+    nStaleOk = _TDNFCanServeStale(pTdnf);
+
     for (pRepo = pTdnf->pRepos; pRepo; pRepo = pRepo->pNext)
     {
         /*
@@ -273,24 +396,34 @@ TDNFRefreshSack(
     {
         pRepo = ppRepoArray[i];
 
-        nMetadataExpired = 0;
-        /* Check if expired since last sync per metadata_expire
-           unless requested to ignore. lMetadataExpire < 0 means never expire. */
-        if(pRepo->lMetadataExpire >= 0 && !pTdnf->pArgs->nCacheOnly)
+        /* from the expiry check until the repo is loaded */
+        dwError = TDNFRepoLockSharedCache(pTdnf, pRepo, nStaleOk, &nLockFd);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        dwError = _TDNFRepoMetadataExpired(pTdnf, pRepo, nStaleOk,
+                                           &nMetadataExpired);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        /* there is nothing to serve, refresh it like any command */
+        if (nMetadataExpired && nStaleOk)
         {
-            dwError = TDNFGetCachePath(pTdnf, pRepo,
-                                       NULL, NULL,
-                                       &pszRepoCacheDir);
+            TDNFRepoUnlockSharedCache(nLockFd);
+            nLockFd = -1;
+
+            dwError = TDNFRepoLockSharedCache(pTdnf, pRepo, 0, &nLockFd);
             BAIL_ON_TDNF_ERROR(dwError);
 
-            dwError = TDNFShouldSyncMetadata(
-                          pszRepoCacheDir,
-                          pRepo->lMetadataExpire,
-                          &nMetadataExpired);
+            dwError = _TDNFRepoMetadataExpired(pTdnf, pRepo, nStaleOk,
+                                               &nMetadataExpired);
             BAIL_ON_TDNF_ERROR(dwError);
+        }
 
-            TDNF_SAFE_FREE_MEMORY(pszRepoCacheDir);
-            pszRepoCacheDir = NULL;
+        /* refreshed later, see TDNFRevalidateStaleRepos() */
+        if (pRepo->nStale)
+        {
+            pr_info("metadata of repo '%s' is expired, using it until it is refreshed\n",
+                    pRepo->pszId);
+            nMetadataExpired = 0;
         }
 
         if (nMetadataExpired)
@@ -334,10 +467,19 @@ TDNFRefreshSack(
             dwError = 0;
         }
         BAIL_ON_TDNF_ERROR(dwError);
+
+        if (pRepo->nEnabled && nLockFd >= 0)
+        {
+            dwError = TDNFRepoAddSharedCacheRoot(pTdnf, pRepo);
+            BAIL_ON_TDNF_ERROR(dwError);
+        }
+
+        TDNFRepoUnlockSharedCache(nLockFd);
+        nLockFd = -1;
     }
 
 cleanup:
-    TDNF_SAFE_FREE_MEMORY(pszRepoCacheDir);
+    TDNFRepoUnlockSharedCache(nLockFd);
     TDNF_SAFE_FREE_MEMORY(ppRepoArray);
     return dwError;
 
@@ -345,14 +487,381 @@ error:
     goto cleanup;
 }
 
+/*
+ * Move pszNewDir/pszName over pszDir/pszName. A directory cannot be
+ * renamed over one that is not empty, the old one is moved aside
+ * into pszNewDir first, which is removed afterwards.
+ */
+static
+uint32_t
+_TDNFSwapCacheEntry(
+    const char *pszDir,
+    const char *pszNewDir,
+    const char *pszName
+    )
+{
+    uint32_t dwError = 0;
+    char *pszOld = NULL;
+    char *pszNew = NULL;
+    char *pszAside = NULL;
+
+    dwError = TDNFJoinPath(&pszOld, pszDir, pszName, NULL);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFJoinPath(&pszNew, pszNewDir, pszName, NULL);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFAllocateStringPrintf(&pszAside, "%s.old", pszNew);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    if (access(pszNew, F_OK))
+    {
+        goto cleanup;
+    }
+
+    if (rename(pszOld, pszAside) && errno != ENOENT)
+    {
+        dwError = errno;
+        BAIL_ON_TDNF_SYSTEM_ERROR_UNCOND(dwError);
+    }
+    if (rename(pszNew, pszOld))
+    {
+        dwError = errno;
+        BAIL_ON_TDNF_SYSTEM_ERROR_UNCOND(dwError);
+    }
+
+cleanup:
+    TDNF_SAFE_FREE_MEMORY(pszOld);
+    TDNF_SAFE_FREE_MEMORY(pszNew);
+    TDNF_SAFE_FREE_MEMORY(pszAside);
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+/*
+ * Download the metadata of pRepo into a cache dir of its own and
+ * swap it in. The lock of the repo is only held for the swap, so
+ * readers keep using the expired metadata until then, and still
+ * have it if the download fails.
+ */
+static
+uint32_t
+_TDNFRevalidateRepo(
+    PTDNF pTdnf,
+    PTDNF_REPO_DATA pRepo
+    )
+{
+    uint32_t dwError = 0;
+    char *pszCacheName = pRepo->pszCacheName;
+    char *pszTmpName = NULL;
+    char *pszRepoCacheDir = NULL;
+    char *pszTmpCacheDir = NULL;
+    PSolvSack pSack = NULL;
+    int nLockFd = -1;
+
+    dwError = TDNFGetCachePath(pTdnf, pRepo, NULL, NULL, &pszRepoCacheDir);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFAllocateStringPrintf(&pszTmpName, "%s%s.%d",
+                                       pszCacheName ? pszCacheName : pRepo->pszId,
+                                       TDNF_REVALIDATE_DIR_EXT,
+                                       (int)getpid());
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    pRepo->pszCacheName = pszTmpName;
+    dwError = TDNFGetCachePath(pTdnf, pRepo, NULL, NULL, &pszTmpCacheDir);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = SolvInitSack(&pSack,
+                           pTdnf->pConf->pszCacheDir,
+                           pTdnf->pArgs->pszInstallRoot);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFInitRepo(pTdnf, pRepo, pSack);
+    BAIL_ON_TDNF_ERROR(dwError);
+    pRepo->pszCacheName = pszCacheName;
+
+    dwError = TDNFRepoLockSharedCache(pTdnf, pRepo, 0, &nLockFd);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    /* the refresh marker last, it makes the new metadata current */
+    dwError = _TDNFSwapCacheEntry(pszRepoCacheDir, pszTmpCacheDir,
+                                  TDNF_REPODATA_DIR_NAME);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = _TDNFSwapCacheEntry(pszRepoCacheDir, pszTmpCacheDir,
+                                  TDNF_SOLVCACHE_DIR_NAME);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = _TDNFSwapCacheEntry(pszRepoCacheDir, pszTmpCacheDir,
+                                  TDNF_REPO_METADATA_MARKER);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+cleanup:
+    TDNFRepoUnlockSharedCache(nLockFd);
+    pRepo->pszCacheName = pszCacheName;
+    if (pszTmpCacheDir)
+    {
+        TDNFRecursivelyRemoveDir(pszTmpCacheDir);
+    }
+    if (pSack)
+    {
+        SolvFreeSack(pSack);
+    }
+    TDNF_SAFE_FREE_MEMORY(pszTmpCacheDir);
+    TDNF_SAFE_FREE_MEMORY(pszRepoCacheDir);
+    TDNF_SAFE_FREE_MEMORY(pszTmpName);
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+/*
+ * Refresh the repos that were used stale in a detached process,
+ * so the command that used them does not wait for it. See
+ * _TDNFRevalidateRepo(), commands are only held up for the swap.
+ */
+void
+TDNFRevalidateStaleRepos(
+    PTDNF pTdnf
+    )
+{
+    uint32_t dwError = 0;
+    PTDNF_REPO_DATA pRepo = NULL;
+    int nStale = 0;
+    int fd = -1;
+    pid_t pid;
+
+    if (!pTdnf || !pTdnf->pConf || !pTdnf->pArgs || gEuid)
+    {
+        return;
+    }
+
+    for (pRepo = pTdnf->pRepos; pRepo; pRepo = pRepo->pNext)
+    {
+        nStale = nStale || pRepo->nStale;
+    }
+    if (!nStale)
+    {
+        return;
+    }
+
+    /* double fork, the refresher must not be our child */
+    pid = fork();
+    if (pid < 0)
+    {
+        pr_err("could not start metadata refresh: %s\n", strerror(errno));
+        return;
+    }
+    if (pid > 0)
+    {
+        /* the first child exits right away */
+        waitpid(pid, NULL, 0);
+        return;
+    }
+
+    if (setsid() < 0 || fork() != 0)
+    {
+        _exit(0);
+    }
+
+    fd = open("/dev/null", O_RDWR);
+    if (fd >= 0)
+    {
+        dup2(fd, STDIN_FILENO);
+        dup2(fd, STDOUT_FILENO);
+        dup2(fd, STDERR_FILENO);
+        if (fd > STDERR_FILENO)
+        {
+            close(fd);
+        }
+    }
+
+    for (pRepo = pTdnf->pRepos; pRepo; pRepo = pRepo->pNext)
+    {
+        if (pRepo->nStale && _TDNFRevalidateRepo(pTdnf, pRepo))
+        {
+            dwError = 1;
+        }
+    }
+
+    /* not through exit(), the atexit handlers belong to the parent */
+    _exit(dwError ? 1 : 0);
+}
+
 uint32_t
 TDNFRefresh(
     PTDNF pTdnf)
 {
-    if(!pTdnf || !pTdnf->pSack || !pTdnf->pArgs)
+    uint32_t dwError = 0;
+
+    if(!pTdnf || !pTdnf->pArgs)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    /* loading the repos twice would add them to the pool twice */
+    if (pTdnf->dwInitStages & TDNF_INIT_STAGE_REPODATA)
+    {
+        goto cleanup;
+    }
+
+    dwError = TDNFInitHandleStages(
+                  pTdnf,
+                  TDNF_INIT_STAGE_REPOS | TDNF_INIT_STAGE_SACK);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFRefreshSack(pTdnf, pTdnf->pSack, pTdnf->pArgs->nRefresh);
+    BAIL_ON_TDNF_ERROR(dwError);
+    pTdnf->dwInitStages |= TDNF_INIT_STAGE_REPODATA;
+
+    /* TDNFInitRepo rebuilds the indexes for each repo it loads,
+       so they only need to be built here if no repo was loaded */
+    if (pTdnf->pSack->pPool->whatprovides)
+    {
+        pTdnf->dwInitStages |= TDNF_INIT_STAGE_PROVIDES;
+    }
+
+    dwError = TDNFInitHandleStages(pTdnf, TDNF_INIT_STAGE_PROVIDES);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+cleanup:
+    return dwError;
+
+error:
+    /* the repos loaded before the failure would be added to the
+       pool again by another try, start over with a new pool */
+    if (pTdnf && pTdnf->pSack &&
+        !(pTdnf->dwInitStages & TDNF_INIT_STAGE_REPODATA))
+    {
+        SolvFreeSack(pTdnf->pSack);
+        pTdnf->pSack = NULL;
+        pTdnf->pSolvCmdLineRepo = NULL;
+        pTdnf->dwInitStages &= ~(TDNF_INIT_STAGE_SACK |
+                                 TDNF_INIT_STAGE_PROVIDES);
+    }
+    goto cleanup;
+}
+
+/*
+ * TDNFOpenHandle only reads the config. Everything else is
+ * brought up here, the first time a command needs it:
+ * TDNF_INIT_STAGE_REPOS    - plugins and repo definitions
+ * TDNF_INIT_STAGE_SACK     - solv pool, installed rpmdb and
+ *                            the @cmdline repo
+ * TDNF_INIT_STAGE_PROVIDES - file provides and whatprovides
+ *                            index of the pool
+ * Stages that are already done are skipped, so commands can
+ * call this for whatever they need.
+*/
+uint32_t
+TDNFInitHandleStages(
+    PTDNF pTdnf,
+    uint32_t dwStages
+    )
+{
+    uint32_t dwError = 0;
+    PSolvSack pSack = NULL;
+
+    if(!pTdnf || !pTdnf->pArgs || !pTdnf->pConf)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    if (dwStages & TDNF_INIT_STAGE_PROVIDES)
+    {
+        dwStages |= TDNF_INIT_STAGE_SACK;
+    }
+    dwStages &= ~pTdnf->dwInitStages;
+
+    /* plugins are loaded with the repos, they may
+       act on the repo readconfig events */
+    if (dwStages & TDNF_INIT_STAGE_REPOS)
+    {
+        dwError = TDNFLoadPlugins(pTdnf);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        dwError = TDNFLoadRepoData(
+                      pTdnf,
+                      &pTdnf->pRepos);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        dwError = TDNFRepoListFinalize(pTdnf);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        pTdnf->dwInitStages |= TDNF_INIT_STAGE_REPOS;
+    }
+
+    if (dwStages & TDNF_INIT_STAGE_SACK)
+    {
+        dwError = SolvInitSack(
+                      &pSack,
+                      pTdnf->pConf->pszCacheDir,
+                      pTdnf->pArgs->pszInstallRoot);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        if(!pTdnf->pArgs->nAllDeps)
+        {
+            dwError = SolvReadInstalledRpms(pSack->pPool->installed, NULL);
+            BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+        }
+
+        dwError = TDNFInitCmdLineRepo(pTdnf, pSack);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        pTdnf->pSack = pSack;
+        pSack = NULL;
+        pTdnf->dwInitStages |= TDNF_INIT_STAGE_SACK;
+    }
+
+    if (dwStages & TDNF_INIT_STAGE_PROVIDES)
+    {
+        pool_addfileprovides(pTdnf->pSack->pPool);
+        pool_createwhatprovides(pTdnf->pSack->pPool);
+
+        pTdnf->dwInitStages |= TDNF_INIT_STAGE_PROVIDES;
+    }
+
+cleanup:
+    return dwError;
+
+error:
+    if(pSack)
+    {
+        SolvFreeSack(pSack);
+    }
+    goto cleanup;
+}
+
+/*
+ * Free the pool with all repodata and the whatprovides index.
+ * The transaction only needs the solved package list, so this
+ * is done before rpm builds its own data for it, to keep the
+ * peak memory down. Later calls on the handle load the sack
+ * again, see TDNFInitHandleStages(). Batch runs over several
+ * installroots keep it, the next root only swaps the installed
+ * packages, see TDNFSetInstallRoot().
+ */
+void
+TDNFReleaseSack(
+    PTDNF pTdnf
+    )
+{
+    if(!pTdnf || !pTdnf->pSack || pTdnf->pArgs->ppszInstallRoots)
     {
-        return ERROR_TDNF_INVALID_PARAMETER;
+        return;
     }
 
-    return TDNFRefreshSack(pTdnf, pTdnf->pSack, pTdnf->pArgs->nRefresh);
+    SolvFreeSack(pTdnf->pSack);
+    pTdnf->pSack = NULL;
+    /* owned by the pool */
+    pTdnf->pSolvCmdLineRepo = NULL;
+    pTdnf->dwInitStages &= ~(TDNF_INIT_STAGE_SACK |
+                             TDNF_INIT_STAGE_PROVIDES |
+                             TDNF_INIT_STAGE_REPODATA);
 }
@@ -0,0 +1,430 @@
+/*
+ * Copyright (C) 2023 VMware, Inc. All Rights Reserved.
+ *
+ * Licensed under the GNU Lesser General Public License v2.1 (the "License");
+ * you may not use this file except in compliance with the License. The terms
+ * of the License are located in the COPYING file of this distribution.
+ */
+
+/*
+ * Package downloads over one connection per mirror. With
+ * max_concurrent_streams set, the packages that are not cached yet
+ * are fetched by a curl multi handle before the transaction gets
+ * them one by one. Transfers to the same host share one connection,
+ * with up to max_concurrent_streams HTTP/2 streams on it. A mirror
+ * that only speaks HTTP/1.1 gets them one after the other on that
+ * connection, without pipelining. Only the first url of a repo is
+ * tried here, whatever fails is left to the usual download, which
+ * goes through the other urls and retries.
+ */
+
+#include "includes.h"
+
+static
+void
+_TDNFMultiFreeXfer(
+    PTDNF_MULTI_XFER pXfer
+    )
+{
+    if (pXfer->fp)
+    {
+        fclose(pXfer->fp);
+        unlink(pXfer->pszFileTmp);
+        TDNFBandwidthStop(TDNF_XFER_PACKAGE);
+    }
+    if (pXfer->pCurl)
+    {
+        curl_easy_cleanup(pXfer->pCurl);
+    }
+    TDNF_SAFE_FREE_MEMORY(pXfer->pszUrl);
+    TDNF_SAFE_FREE_MEMORY(pXfer->pszFile);
+    TDNF_SAFE_FREE_MEMORY(pXfer->pszFileTmp);
+    TDNF_SAFE_FREE_MEMORY(pXfer->pszUserPass);
+    memset(pXfer, 0, sizeof(TDNF_MULTI_XFER));
+}
+
+static
+size_t
+_TDNFMultiWrite(
+    char *pData,
+    size_t nSize,
+    size_t nMemb,
+    void *pUserData
+    )
+{
+    PTDNF_MULTI_XFER pXfer = (PTDNF_MULTI_XFER)pUserData;
+
+    /* this holds up all streams, they are all packages */
+    TDNFBandwidthConsume(TDNF_XFER_PACKAGE, nSize * nMemb);
+    return fwrite(pData, 1, nSize * nMemb, pXfer->fp);
+}
+
+/*
+ * Set up the download of pInfo in pXfer. pXfer->pCurl stays NULL
+ * if the package does not need one here: it is local, cached
+ * already or in the package store.
+ */
+static
+uint32_t
+_TDNFMultiPrepareXfer(
+    PTDNF pTdnf,
+    PTDNF_PKG_INFO pInfo,
+    PTDNF_MULTI_XFER pXfer
+    )
+{
+    uint32_t dwError = 0;
+    PTDNF_REPO_DATA pRepo = NULL;
+    char *pszDir = NULL;
+    char *pszStorePath = NULL;
+    CURL *pCurl = NULL;
+    int i;
+
+    if (IsNullOrEmptyString(pInfo->pszLocation) ||
+        pInfo->pszLocation[0] == '/')
+    {
+        goto cleanup;
+    }
+
+    dwError = TDNFFindRepoById(pTdnf, pInfo->pszRepoName, &pRepo);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    /* local repos are used in place, see _TDNFTransGetPackageFile() */
+    for (i = 0; pRepo->ppszBaseUrls && pRepo->ppszBaseUrls[i]; i++)
+    {
+        if (strncasecmp(pRepo->ppszBaseUrls[i], "file://", 7) == 0)
+        {
+            goto cleanup;
+        }
+    }
+
+    if (pRepo->ppszBaseUrls && pRepo->ppszBaseUrls[0])
+    {
+        dwError = TDNFJoinPath(&pXfer->pszUrl, pRepo->ppszBaseUrls[0],
+                               pInfo->pszLocation, NULL);
+    }
+    else
+    {
+        dwError = TDNFAllocateString(pInfo->pszLocation, &pXfer->pszUrl);
+    }
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    if (strncasecmp(pXfer->pszUrl, "http://", 7) &&
+        strncasecmp(pXfer->pszUrl, "https://", 8))
+    {
+        goto cleanup;
+    }
+
+    dwError = TDNFGetPackageCachePath(pTdnf, pInfo->pszLocation, pRepo,
+                                      &pXfer->pszFile);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    if (access(pXfer->pszFile, F_OK) == 0 ||
+        (TDNFPackageStoreGetPath(pTdnf, pInfo, &pszStorePath) == 0 &&
+         access(pszStorePath, F_OK) == 0))
+    {
+        goto cleanup;
+    }
+
+    dwError = TDNFDirName(pXfer->pszFile, &pszDir);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    if (access(pszDir, F_OK))
+    {
+        dwError = TDNFUtilsMakeDirs(pszDir);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    dwError = TDNFAllocateStringPrintf(&pXfer->pszFileTmp, "%s.tmp",
+                                       pXfer->pszFile);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    pCurl = curl_easy_init();
+    if (!pCurl)
+    {
+        dwError = ERROR_TDNF_CURL_INIT;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    dwError = TDNFRepoGetUserPass(pTdnf, pRepo, &pXfer->pszUserPass);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    if (!IsNullOrEmptyString(pXfer->pszUserPass))
+    {
+        dwError = curl_easy_setopt(pCurl, CURLOPT_USERPWD,
+                                   pXfer->pszUserPass);
+        BAIL_ON_TDNF_CURL_ERROR(dwError);
+    }
+
+    dwError = TDNFRepoApplyProxySettings(pTdnf->pConf, pCurl);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFRepoApplyDownloadSettings(pRepo, pCurl);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFRepoApplySSLSettings(pRepo, pCurl);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = curl_easy_setopt(pCurl, CURLOPT_URL, pXfer->pszUrl);
+    BAIL_ON_TDNF_CURL_ERROR(dwError);
+
+    dwError = curl_easy_setopt(pCurl, CURLOPT_FOLLOWLOCATION, 1L);
+    BAIL_ON_TDNF_CURL_ERROR(dwError);
+
+    /* wait for the connection of the other transfers
+       instead of opening another one */
+    dwError = curl_easy_setopt(pCurl, CURLOPT_PIPEWAIT, 1L);
+    BAIL_ON_TDNF_CURL_ERROR(dwError);
+
+    dwError = curl_easy_setopt(pCurl, CURLOPT_PRIVATE, pXfer);
+    BAIL_ON_TDNF_CURL_ERROR(dwError);
+
+    pXfer->pInfo = pInfo;
+    pXfer->pCurl = pCurl;
+
+cleanup:
+    TDNF_SAFE_FREE_MEMORY(pszDir);
+    TDNF_SAFE_FREE_MEMORY(pszStorePath);
+    return dwError;
+
+error:
+    if (pCurl)
+    {
+        curl_easy_cleanup(pCurl);
+    }
+    goto cleanup;
+}
+
+static
+uint32_t
+_TDNFMultiStartXfer(
+    CURLM *pMulti,
+    PTDNF_MULTI_XFER pXfer
+    )
+{
+    uint32_t dwError = 0;
+
+    pXfer->fp = fopen(pXfer->pszFileTmp, "wb");
+    if (!pXfer->fp)
+    {
+        dwError = errno;
+        BAIL_ON_TDNF_SYSTEM_ERROR_UNCOND(dwError);
+    }
+
+    TDNFBandwidthStart(TDNF_XFER_PACKAGE);
+
+    dwError = curl_easy_setopt(pXfer->pCurl, CURLOPT_WRITEFUNCTION,
+                               _TDNFMultiWrite);
+    BAIL_ON_TDNF_CURL_ERROR(dwError);
+
+    dwError = curl_easy_setopt(pXfer->pCurl, CURLOPT_WRITEDATA, pXfer);
+    BAIL_ON_TDNF_CURL_ERROR(dwError);
+
+    if (curl_multi_add_handle(pMulti, pXfer->pCurl) != CURLM_OK)
+    {
+        dwError = ERROR_TDNF_CURL_INIT;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+cleanup:
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+/*
+ * Move a finished download in place. A failed one is dropped, the
+ * package is then downloaded again later on its own.
+ */
+static
+void
+_TDNFMultiFinishXfer(
+    PTDNF_MULTI_XFER pXfer,
+    CURLcode nResult,
+    uint32_t *pdwCount
+    )
+{
+    /* lStatus reads CURLINFO_RESPONSE_CODE. Must be long */
+    long lStatus = 0;
+    struct stat st = {0};
+    int nFailed = 0;
+
+    if (fclose(pXfer->fp))
+    {
+        nFailed = 1;
+    }
+    pXfer->fp = NULL;
+    TDNFBandwidthStop(TDNF_XFER_PACKAGE);
+
+    if (nResult != CURLE_OK)
+    {
+        pr_info("%s: %s\n", pXfer->pszUrl, curl_easy_strerror(nResult));
+        nFailed = 1;
+    }
+    else if (curl_easy_getinfo(pXfer->pCurl, CURLINFO_RESPONSE_CODE,
+                               &lStatus) != CURLE_OK || lStatus >= 400)
+    {
+        pr_info("%s: status %ld\n", pXfer->pszUrl, lStatus);
+        nFailed = 1;
+    }
+    else if (stat(pXfer->pszFileTmp, &st) ||
+             (pXfer->pInfo->dwDownloadSizeBytes &&
+              (uint64_t)st.st_size != pXfer->pInfo->dwDownloadSizeBytes))
+    {
+        nFailed = 1;
+    }
+
+    if (nFailed ||
+        rename(pXfer->pszFileTmp, pXfer->pszFile) == -1 ||
+        chmod(pXfer->pszFile, S_IRUSR|S_IWUSR|S_IRGRP|S_IROTH) == -1)
+    {
+        unlink(pXfer->pszFileTmp);
+        return;
+    }
+
+    pr_info("%s 100%% %ld\n", pXfer->pInfo->pszName, (long)st.st_size);
+    (*pdwCount)++;
+}
+
+//download the packages of pInfos that are not cached yet, see above
+uint32_t
+TDNFDownloadPackagesToCache(
+    PTDNF pTdnf,
+    PTDNF_PKG_INFO pInfos
+    )
+{
+    uint32_t dwError = 0;
+    PTDNF_MULTI_XFER pXfers = NULL;
+    PTDNF_MULTI_XFER pXfer = NULL;
+    PTDNF_PKG_INFO pInfo = NULL;
+    CURLM *pMulti = NULL;
+    CURLMsg *pMsg = NULL;
+    uint32_t dwCount = 0;
+    uint32_t dwXfers = 0;
+    uint32_t dwNext = 0;
+    uint32_t i;
+    int nStreams = 0;
+    int nActive = 0;
+    int nRunning = 0;
+    int nQueued = 0;
+
+    if (!pTdnf || !pTdnf->pConf || !pTdnf->pArgs)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    /* plugins see each package download on its own */
+    nStreams = pTdnf->pConf->nMaxConcurrentStreams;
+    if (nStreams <= 1 || pTdnf->pPlugins)
+    {
+        goto cleanup;
+    }
+
+    for (pInfo = pInfos; pInfo; pInfo = pInfo->pNext)
+    {
+        dwCount++;
+    }
+    if (dwCount < 2)
+    {
+        goto cleanup;
+    }
+
+    dwError = TDNFAllocateMemory(dwCount, sizeof(TDNF_MULTI_XFER),
+                                 (void **)&pXfers);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    for (pInfo = pInfos; pInfo; pInfo = pInfo->pNext)
+    {
+        pXfer = &pXfers[dwXfers];
+        /* the usual download reports whatever went wrong */
+        if (_TDNFMultiPrepareXfer(pTdnf, pInfo, pXfer) || !pXfer->pCurl)
+        {
+            _TDNFMultiFreeXfer(pXfer);
+            continue;
+        }
+        dwXfers++;
+    }
+    if (dwXfers < 2)
+    {
+        goto cleanup;
+    }
+
+    pMulti = curl_multi_init();
+    if (!pMulti)
+    {
+        dwError = ERROR_TDNF_CURL_INIT;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    curl_multi_setopt(pMulti, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+    curl_multi_setopt(pMulti, CURLMOPT_MAX_HOST_CONNECTIONS, 1L);
+#if LIBCURL_VERSION_NUM >= 0x074300
+    curl_multi_setopt(pMulti, CURLMOPT_MAX_CONCURRENT_STREAMS,
+                      (long)nStreams);
+#endif
+
+    dwCount = 0;
+    while (dwNext < dwXfers || nActive > 0)
+    {
+        /* with several mirrors this also bounds the open files */
+        while (dwNext < dwXfers && nActive < nStreams)
+        {
+            pXfer = &pXfers[dwNext++];
+            if (_TDNFMultiStartXfer(pMulti, pXfer))
+            {
+                _TDNFMultiFreeXfer(pXfer);
+                continue;
+            }
+            nActive++;
+        }
+
+        if (curl_multi_perform(pMulti, &nRunning) != CURLM_OK)
+        {
+            break;
+        }
+
+        while ((pMsg = curl_multi_info_read(pMulti, &nQueued)) != NULL)
+        {
+            if (pMsg->msg != CURLMSG_DONE)
+            {
+                continue;
+            }
+            pXfer = NULL;
+            curl_easy_getinfo(pMsg->easy_handle, CURLINFO_PRIVATE,
+                              (char **)&pXfer);
+            curl_multi_remove_handle(pMulti, pMsg->easy_handle);
+            _TDNFMultiFinishXfer(pXfer, pMsg->data.result, &dwCount);
+            _TDNFMultiFreeXfer(pXfer);
+            nActive--;
+        }
+
+        if (nActive > 0 &&
+            curl_multi_wait(pMulti, NULL, 0, 1000, NULL) != CURLM_OK)
+        {
+            break;
+        }
+    }
+
+    pr_info("Downloaded %u of %u packages over shared connections.\n",
+            dwCount, dwXfers);
+
+cleanup:
+    for (i = 0; pXfers && i < dwXfers; i++)
+    {
+        if (pMulti && pXfers[i].fp)
+        {
+            curl_multi_remove_handle(pMulti, pXfers[i].pCurl);
+        }
+        _TDNFMultiFreeXfer(&pXfers[i]);
+    }
+    TDNF_SAFE_FREE_MEMORY(pXfers);
+    if (pMulti)
+    {
+        curl_multi_cleanup(pMulti);
+    }
+    return dwError;
+
+error:
+    goto cleanup;
+}
@@ -0,0 +1,416 @@
+/*
+ * Copyright (C) 2023 VMware, Inc. All Rights Reserved.
+ *
+ * Licensed under the GNU Lesser General Public License v2.1 (the "License");
+ * you may not use this file except in compliance with the License. The terms
+ * of the License are located in the COPYING file of this distribution.
+ */
+
+/*
+ * Content addressed package store. Verified packages are hardlinked
+ * to <store>/<hash>/<xx>/<digest>, by default <cachedir>/store. A
+ * package with a checksum that is already in the store is taken from
+ * there instead of downloading it again, as a hardlink if possible,
+ * else as a reflink or a copy. An entry that has no other links is
+ * not used by any tree and is removed by TDNFPackageStorePrune().
+ */
+
+#include "includes.h"
+
+static
+uint32_t
+_TDNFPackageStoreGetDir(
+    PTDNF pTdnf,
+    char **ppszDir
+    )
+{
+    uint32_t dwError = 0;
+    char *pszDir = NULL;
+
+    if (pTdnf->pConf->pszPackageStore)
+    {
+        /* "package_store=" disables the store */
+        if (pTdnf->pConf->pszPackageStore[0] == '\0')
+        {
+            dwError = ERROR_TDNF_NO_DATA;
+            BAIL_ON_TDNF_ERROR(dwError);
+        }
+        dwError = TDNFAllocateString(pTdnf->pConf->pszPackageStore, &pszDir);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+    else
+    {
+        dwError = TDNFJoinPath(&pszDir,
+                               pTdnf->pConf->pszCacheDir,
+                               TDNF_PACKAGE_STORE_DIR_NAME,
+                               NULL);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    *ppszDir = pszDir;
+
+cleanup:
+    return dwError;
+
+error:
+    TDNF_SAFE_FREE_MEMORY(pszDir);
+    goto cleanup;
+}
+
+/*
+ * Get the store path for the checksum of pPkgInfo. Returns
+ * ERROR_TDNF_NO_DATA if the store is disabled or the package
+ * has no checksum.
+ */
+uint32_t
+TDNFPackageStoreGetPath(
+    PTDNF pTdnf,
+    PTDNF_PKG_INFO pPkgInfo,
+    char **ppszPath
+    )
+{
+    uint32_t dwError = 0;
+    char *pszDir = NULL;
+    char *pszHex = NULL;
+    char *pszPath = NULL;
+
+    if (!pTdnf || !pTdnf->pConf || !pPkgInfo || !ppszPath)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    if (!pPkgInfo->pbChecksum)
+    {
+        dwError = ERROR_TDNF_NO_DATA;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    dwError = _TDNFPackageStoreGetDir(pTdnf, &pszDir);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFDigestToHex(pPkgInfo->pbChecksum,
+                              pPkgInfo->nChecksumType,
+                              &pszHex);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFAllocateStringPrintf(&pszPath, "%s/%s/%.2s/%s",
+                                       pszDir,
+                                       hash_ops[pPkgInfo->nChecksumType].hash_type,
+                                       pszHex,
+                                       pszHex);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    *ppszPath = pszPath;
+
+cleanup:
+    TDNF_SAFE_FREE_MEMORY(pszDir);
+    TDNF_SAFE_FREE_MEMORY(pszHex);
+    return dwError;
+
+error:
+    TDNF_SAFE_FREE_MEMORY(pszPath);
+    goto cleanup;
+}
+
+/*
+ * Put the package of pPkgInfo at pszDest if it is in the store.
+ * The entry is checked against size and checksum first, a bad
+ * entry is removed. Returns ERROR_TDNF_NO_DATA if the package is
+ * not (or no longer) in the store, and the number of bytes that
+ * did not need a download in pqwBytes.
+ */
+uint32_t
+TDNFPackageStoreFetch(
+    PTDNF pTdnf,
+    PTDNF_PKG_INFO pPkgInfo,
+    const char *pszDest,
+    uint64_t *pqwBytes
+    )
+{
+    uint32_t dwError = 0;
+    char *pszPath = NULL;
+    char *pszTmp = NULL;
+    struct stat st = {0};
+    hash_op *hash = NULL;
+    uint8_t digest[EVP_MAX_MD_SIZE] = {0};
+
+    if (!pTdnf || !pPkgInfo || IsNullOrEmptyString(pszDest) || !pqwBytes)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    dwError = TDNFPackageStoreGetPath(pTdnf, pPkgInfo, &pszPath);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    if (lstat(pszPath, &st))
+    {
+        dwError = errno == ENOENT ? ERROR_TDNF_NO_DATA :
+                                    ERROR_TDNF_SYSTEM_BASE + errno;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    hash = hash_ops + pPkgInfo->nChecksumType;
+    if (S_ISREG(st.st_mode) &&
+        (!pPkgInfo->dwDownloadSizeBytes ||
+         (uint64_t)st.st_size == pPkgInfo->dwDownloadSizeBytes))
+    {
+        dwError = TDNFGetDigestForFile(pszPath, hash, digest);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+    if (memcmp(digest, pPkgInfo->pbChecksum, hash->length))
+    {
+        pr_err("removing bad entry %s from the package store\n", pszPath);
+        remove(pszPath);
+        dwError = ERROR_TDNF_NO_DATA;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    dwError = TDNFAllocateStringPrintf(&pszTmp, "%s.tmp", pszDest);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    remove(pszTmp);
+    if (link(pszPath, pszTmp))
+    {
+        /* different filesystem or no hardlinks, reflink or copy */
+        dwError = TDNFCopyFile(pszPath, pszTmp);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    if (rename(pszTmp, pszDest))
+    {
+        dwError = ERROR_TDNF_SYSTEM_BASE + errno;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    *pqwBytes = st.st_size;
+
+cleanup:
+    TDNF_SAFE_FREE_MEMORY(pszPath);
+    TDNF_SAFE_FREE_MEMORY(pszTmp);
+    return dwError;
+
+error:
+    if (pszTmp)
+    {
+        remove(pszTmp);
+    }
+    goto cleanup;
+}
+
+/*
+ * Add the verified package file pszFile to the store. If the
+ * checksum is already there, pszFile is replaced by a link to the
+ * store entry and its size is returned in pqwBytes. Failing to
+ * link, for example across filesystems, is not an error.
+ */
+uint32_t
+TDNFPackageStoreAdd(
+    PTDNF pTdnf,
+    PTDNF_PKG_INFO pPkgInfo,
+    const char *pszFile,
+    uint64_t *pqwBytes
+    )
+{
+    uint32_t dwError = 0;
+    char *pszPath = NULL;
+    char *pszDir = NULL;
+    char *pszTmp = NULL;
+    struct stat stFile = {0};
+    struct stat stStore = {0};
+
+    if (!pTdnf || !pPkgInfo || IsNullOrEmptyString(pszFile) || !pqwBytes)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    *pqwBytes = 0;
+
+    dwError = TDNFPackageStoreGetPath(pTdnf, pPkgInfo, &pszPath);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFDirName(pszPath, &pszDir);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFUtilsMakeDirs(pszDir);
+    if (dwError == ERROR_TDNF_SYSTEM_BASE + EEXIST)
+    {
+        dwError = 0;
+    }
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    if (link(pszFile, pszPath) == 0 || errno != EEXIST)
+    {
+        goto cleanup;
+    }
+
+    /* already stored, make pszFile share the stored copy */
+    if (stat(pszFile, &stFile) || stat(pszPath, &stStore) ||
+        stFile.st_dev != stStore.st_dev ||
+        stFile.st_ino == stStore.st_ino ||
+        stFile.st_size != stStore.st_size)
+    {
+        goto cleanup;
+    }
+
+    dwError = TDNFAllocateStringPrintf(&pszTmp, "%s.tmp", pszFile);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    remove(pszTmp);
+    if (link(pszPath, pszTmp) == 0)
+    {
+        if (rename(pszTmp, pszFile) == 0)
+        {
+            *pqwBytes = stFile.st_size;
+        }
+        else
+        {
+            remove(pszTmp);
+        }
+    }
+
+cleanup:
+    TDNF_SAFE_FREE_MEMORY(pszPath);
+    TDNF_SAFE_FREE_MEMORY(pszDir);
+    TDNF_SAFE_FREE_MEMORY(pszTmp);
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+static
+uint32_t
+_TDNFPackageStorePruneWalk(
+    const char *pszDir,
+    uint64_t *pqwBytes
+    )
+{
+    uint32_t dwError = 0;
+    DIR *pDir = NULL;
+    struct dirent *pEnt = NULL;
+    struct stat st = {0};
+    char *pszPath = NULL;
+
+    pDir = opendir(pszDir);
+    if (!pDir)
+    {
+        if (errno == ENOENT)
+        {
+            goto cleanup;
+        }
+        dwError = ERROR_TDNF_SYSTEM_BASE + errno;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    while ((pEnt = readdir(pDir)) != NULL)
+    {
+        if (!strcmp(pEnt->d_name, ".") || !strcmp(pEnt->d_name, ".."))
+        {
+            continue;
+        }
+
+        dwError = TDNFAllocateStringPrintf(&pszPath, "%s/%s",
+                                           pszDir, pEnt->d_name);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        if (lstat(pszPath, &st))
+        {
+            dwError = ERROR_TDNF_SYSTEM_BASE + errno;
+            BAIL_ON_TDNF_ERROR(dwError);
+        }
+
+        if (S_ISDIR(st.st_mode))
+        {
+            dwError = _TDNFPackageStorePruneWalk(pszPath, pqwBytes);
+            BAIL_ON_TDNF_ERROR(dwError);
+
+            /* fails unless the prune left it empty */
+            rmdir(pszPath);
+        }
+        else if (!S_ISREG(st.st_mode) || st.st_nlink <= 1)
+        {
+            if (remove(pszPath) == 0 && S_ISREG(st.st_mode))
+            {
+                *pqwBytes += st.st_size;
+            }
+        }
+        TDNF_SAFE_FREE_MEMORY(pszPath);
+    }
+
+cleanup:
+    if (pDir)
+    {
+        closedir(pDir);
+    }
+    TDNF_SAFE_FREE_MEMORY(pszPath);
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+/*
+ * Remove store entries that are not linked from anywhere else,
+ * for example after clean packages or reposync --delete removed
+ * the last tree file that used them.
+ */
+uint32_t
+TDNFPackageStorePrune(
+    PTDNF pTdnf
+    )
+{
+    uint32_t dwError = 0;
+    char *pszDir = NULL;
+    uint64_t qwBytes = 0;
+    char *pszSize = NULL;
+
+    if (!pTdnf || !pTdnf->pConf)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    dwError = _TDNFPackageStoreGetDir(pTdnf, &pszDir);
+    if (dwError == ERROR_TDNF_NO_DATA)
+    {
+        dwError = 0;
+        goto cleanup;
+    }
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = _TDNFPackageStorePruneWalk(pszDir, &qwBytes);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    if (qwBytes > 0)
+    {
+        dwError = TDNFUtilsFormatSize(qwBytes, &pszSize);
+        BAIL_ON_TDNF_ERROR(dwError);
+        pr_info("removed %s of unused packages from the package store\n",
+                pszSize);
+    }
+
+cleanup:
+    TDNF_SAFE_FREE_MEMORY(pszDir);
+    TDNF_SAFE_FREE_MEMORY(pszSize);
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+void
+TDNFPackageStoreReport(
+    uint64_t qwBytes
+    )
+{
+    char *pszSize = NULL;
+
+    if (qwBytes > 0 && TDNFUtilsFormatSize(qwBytes, &pszSize) == 0)
+    {
+        pr_info("%s deduplicated through the package store\n", pszSize);
+    }
+    TDNF_SAFE_FREE_MEMORY(pszSize);
+}
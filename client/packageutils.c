@@ -391,6 +391,46 @@ error:
     goto cleanup;
 }
 
+static
+uint32_t
+TDNFPopulatePkgChecksum(
+    PSolvSack pSack,
+    Id dwPkgId,
+    PTDNF_PKG_INFO pPkgInfo
+    )
+{
+    uint32_t dwError = 0;
+    int nChecksumType = 0;
+
+    dwError = SolvGetPkgChecksumFromId(
+                  pSack,
+                  dwPkgId,
+                  &nChecksumType,
+                  &pPkgInfo->pbChecksum);
+    //Ignore no data
+    if(dwError == ERROR_TDNF_NO_DATA)
+    {
+        dwError = 0;
+    } else if (nChecksumType == REPOKEY_TYPE_SHA512)
+    {
+        pPkgInfo->nChecksumType = TDNF_HASH_SHA512;
+    } else if (nChecksumType == REPOKEY_TYPE_SHA256)
+    {
+        pPkgInfo->nChecksumType = TDNF_HASH_SHA256;
+    } else if (nChecksumType == REPOKEY_TYPE_SHA1)
+    {
+        pPkgInfo->nChecksumType = TDNF_HASH_SHA1;
+    } else if (nChecksumType == REPOKEY_TYPE_MD5)
+    {
+        pPkgInfo->nChecksumType = TDNF_HASH_MD5;
+    } else
+    {
+        TDNF_SAFE_FREE_MEMORY(pPkgInfo->pbChecksum);
+    }
+
+    return dwError;
+}
+
 uint32_t
 TDNFPopulatePkgInfoForRepoSync(
     PSolvSack pSack,
@@ -459,6 +499,16 @@ TDNFPopulatePkgInfoForRepoSync(
                       dwPkgId,
                       &pPkgInfo->pszLocation);
         BAIL_ON_TDNF_ERROR(dwError);
+
+        /* reposync checks files it already has against these */
+        dwError = SolvGetPkgDownloadSizeFromId(
+                      pSack,
+                      dwPkgId,
+                      &pPkgInfo->dwDownloadSizeBytes);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        dwError = TDNFPopulatePkgChecksum(pSack, dwPkgId, pPkgInfo);
+        BAIL_ON_TDNF_ERROR(dwError);
     }
 
     *ppPkgInfo = pPkgInfos;
@@ -1082,7 +1132,6 @@ TDNFPopulatePkgInfos(
     Id dwPkgId = 0;
     PTDNF_PKG_INFO pPkgInfos = NULL;
     PTDNF_PKG_INFO pPkgInfo = NULL;
-    int nChecksumType = 0;
 
     if(!ppPkgInfos)
     {
@@ -1137,32 +1186,7 @@ TDNFPopulatePkgInfos(
                       &pPkgInfo->pszLocation);
         BAIL_ON_TDNF_ERROR(dwError);
 
-        dwError = SolvGetPkgChecksumFromId(
-                      pSack,
-                      dwPkgId,
-                      &nChecksumType,
-                      &pPkgInfo->pbChecksum);
-        //Ignore no data
-        if(dwError == ERROR_TDNF_NO_DATA)
-        {
-            dwError = 0;
-        } else if (nChecksumType == REPOKEY_TYPE_SHA512)
-        {
-            pPkgInfo->nChecksumType = TDNF_HASH_SHA512;
-        } else if (nChecksumType == REPOKEY_TYPE_SHA256)
-        {
-            pPkgInfo->nChecksumType = TDNF_HASH_SHA256;
-        } else if (nChecksumType == REPOKEY_TYPE_SHA1)
-        {
-            pPkgInfo->nChecksumType = TDNF_HASH_SHA1;
-        } else if (nChecksumType == REPOKEY_TYPE_MD5)
-        {
-            pPkgInfo->nChecksumType = TDNF_HASH_MD5;
-        } else
-        {
-            pPkgInfo->pbChecksum = NULL;
-        }
-
+        dwError = TDNFPopulatePkgChecksum(pSack, dwPkgId, pPkgInfo);
         BAIL_ON_TDNF_ERROR(dwError);
 
         dwError = SolvGetPkgInstallSizeFromId(
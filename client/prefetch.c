@@ -0,0 +1,283 @@
+/*
+ * Copyright (C) 2023 VMware, Inc. All Rights Reserved.
+ *
+ * Licensed under the GNU Lesser General Public License v2.1 (the "License");
+ * you may not use this file except in compliance with the License. The terms
+ * of the License are located in the COPYING file of this distribution.
+ */
+
+/*
+ * makecache --prefetch: solve the pending upgrade and download its
+ * packages to the package cache, so a later upgrade does not have
+ * to. This is meant to run from a timer, so it drops to the lowest
+ * cpu and io priority, downloads at most prefetch_throttle bytes per
+ * second and stops before the cache grows over cache_budget.
+ * Packages are checked against the repo checksum as they come in,
+ * the transaction checks them again as usual.
+ */
+
+#include "includes.h"
+#include <limits.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+
+/* failing to lower the priority is not a reason not to prefetch */
+static
+void
+_TDNFPrefetchLowerPriority(
+    void
+    )
+{
+    if (setpriority(PRIO_PROCESS, 0, TDNF_PREFETCH_NICE))
+    {
+        pr_info("could not lower cpu priority: %s\n", strerror(errno));
+    }
+    if (syscall(SYS_ioprio_set, TDNF_IOPRIO_WHO_PROCESS, 0,
+                (TDNF_IOPRIO_CLASS_BE << TDNF_IOPRIO_CLASS_SHIFT) |
+                TDNF_IOPRIO_BE_LOWEST))
+    {
+        pr_info("could not lower io priority: %s\n", strerror(errno));
+    }
+}
+
+/* local repos are used in place, see _TDNFTransGetPackageFile() */
+static
+int
+_TDNFPrefetchIsLocalRepo(
+    PTDNF_REPO_DATA pRepo
+    )
+{
+    int i;
+
+    for (i = 0; pRepo->ppszBaseUrls && pRepo->ppszBaseUrls[i]; i++)
+    {
+        if (strncasecmp(pRepo->ppszBaseUrls[i], "file://", 7) == 0)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Download the packages of pInfos that are not cached yet. Sets
+ * *pnStop when the next package would go over cache_budget.
+ * Packages that failed are counted in *pdwFailed, and the error
+ * of the first one is kept in *pdwFailError.
+ */
+static
+uint32_t
+_TDNFPrefetchPackages(
+    PTDNF pTdnf,
+    PTDNF_PKG_INFO pInfos,
+    uint64_t *pqwCacheBytes,
+    uint32_t *pdwCount,
+    uint64_t *pqwBytes,
+    uint32_t *pdwFailed,
+    uint32_t *pdwFailError,
+    int *pnStop
+    )
+{
+    uint32_t dwError = 0;
+    PTDNF_PKG_INFO pInfo = NULL;
+    PTDNF_REPO_DATA pRepo = NULL;
+    char *pszFilePath = NULL;
+    uint64_t qwBudget = pTdnf->pConf->qwCacheBudget;
+
+    for (pInfo = pInfos; pInfo && !*pnStop; pInfo = pInfo->pNext)
+    {
+        if (IsNullOrEmptyString(pInfo->pszLocation) ||
+            pInfo->pszLocation[0] == '/')
+        {
+            continue;
+        }
+
+        dwError = TDNFFindRepoById(pTdnf, pInfo->pszRepoName, &pRepo);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        if (_TDNFPrefetchIsLocalRepo(pRepo))
+        {
+            continue;
+        }
+
+        dwError = TDNFGetPackageCachePath(pTdnf, pInfo->pszLocation,
+                                          pRepo, &pszFilePath);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        if (access(pszFilePath, F_OK) == 0)
+        {
+            TDNF_SAFE_FREE_MEMORY(pszFilePath);
+            continue;
+        }
+        TDNF_SAFE_FREE_MEMORY(pszFilePath);
+
+        if (qwBudget &&
+            *pqwCacheBytes + pInfo->dwDownloadSizeBytes > qwBudget)
+        {
+            pr_info("cache_budget reached, not prefetching more packages\n");
+            *pnStop = 1;
+            break;
+        }
+
+        dwError = TDNFDownloadPackageToCache(pTdnf,
+                                             pInfo->pszLocation,
+                                             pInfo->pszName,
+                                             pRepo,
+                                             pInfo,
+                                             &pszFilePath);
+        /* without plugins the download itself is not checked, and
+           a bad package must not wait in the cache for the upgrade */
+        if (!dwError && pInfo->pbChecksum)
+        {
+            dwError = TDNFCheckPackageFile(pszFilePath, pInfo);
+            if (dwError && unlink(pszFilePath) && errno != ENOENT)
+            {
+                pr_err("could not remove %s: %s\n",
+                       pszFilePath, strerror(errno));
+            }
+        }
+        TDNF_SAFE_FREE_MEMORY(pszFilePath);
+        /* one bad package should not keep the others from the cache */
+        if (dwError)
+        {
+            pr_err("could not prefetch %s: error %u\n",
+                   pInfo->pszLocation, dwError);
+            if (!*pdwFailed)
+            {
+                *pdwFailError = dwError;
+            }
+            (*pdwFailed)++;
+            dwError = 0;
+            continue;
+        }
+
+        *pqwCacheBytes += pInfo->dwDownloadSizeBytes;
+        *pqwBytes += pInfo->dwDownloadSizeBytes;
+        (*pdwCount)++;
+    }
+
+cleanup:
+    TDNF_SAFE_FREE_MEMORY(pszFilePath);
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+//download the packages of the pending upgrade to the cache
+uint32_t
+TDNFPrefetchUpgrades(
+    PTDNF pTdnf
+    )
+{
+    uint32_t dwError = 0;
+    PTDNF_SOLVED_PKG_INFO pSolvedInfo = NULL;
+    PTDNF_REPO_DATA pRepo = NULL;
+    int *pnThrottles = NULL;
+    int nRepos = 0;
+    int nThrottle = 0;
+    int nStop = 0;
+    int i;
+    uint64_t qwCacheBytes = 0;
+    uint64_t qwBytes = 0;
+    uint32_t dwCount = 0;
+    uint32_t dwFailed = 0;
+    uint32_t dwFailError = 0;
+    char *pszSize = NULL;
+
+    if (!pTdnf || !pTdnf->pConf || !pTdnf->pArgs)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    _TDNFPrefetchLowerPriority();
+
+    dwError = TDNFResolve(pTdnf, ALTER_UPGRADEALL, &pSolvedInfo);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    if (!pSolvedInfo->nNeedDownload)
+    {
+        pr_info("No packages to prefetch.\n");
+        goto cleanup;
+    }
+
+    if (pTdnf->pConf->qwCacheBudget)
+    {
+        dwError = TDNFCacheGetPackageBytes(pTdnf, &qwCacheBytes);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    /* downloads are one at a time, so the limit of each
+       transfer is the limit of the prefetch */
+    for (pRepo = pTdnf->pRepos; pRepo; pRepo = pRepo->pNext)
+    {
+        nRepos++;
+    }
+    if (pTdnf->pConf->qwPrefetchThrottle && nRepos > 0)
+    {
+        nThrottle = pTdnf->pConf->qwPrefetchThrottle > INT_MAX ?
+                    INT_MAX : (int)pTdnf->pConf->qwPrefetchThrottle;
+
+        dwError = TDNFAllocateMemory(nRepos, sizeof(int),
+                                     (void **)&pnThrottles);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        for (pRepo = pTdnf->pRepos, i = 0; pRepo; pRepo = pRepo->pNext, i++)
+        {
+            pnThrottles[i] = pRepo->nThrottle;
+            if (pRepo->nThrottle == 0 || pRepo->nThrottle > nThrottle)
+            {
+                pRepo->nThrottle = nThrottle;
+            }
+        }
+    }
+
+    /* these come last under max_bandwidth */
+    pTdnf->nPrefetching = 1;
+
+    dwError = _TDNFPrefetchPackages(pTdnf, pSolvedInfo->pPkgsToUpgrade,
+                                    &qwCacheBytes, &dwCount, &qwBytes,
+                                    &dwFailed, &dwFailError, &nStop);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = _TDNFPrefetchPackages(pTdnf, pSolvedInfo->pPkgsToInstall,
+                                    &qwCacheBytes, &dwCount, &qwBytes,
+                                    &dwFailed, &dwFailError, &nStop);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFUtilsFormatSize(qwBytes, &pszSize);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    pr_info("Prefetched %u packages (%s).\n", dwCount, pszSize);
+
+    if (dwFailed)
+    {
+        pr_err("%u packages could not be prefetched.\n", dwFailed);
+        dwError = dwFailError;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+cleanup:
+    if (pTdnf)
+    {
+        pTdnf->nPrefetching = 0;
+    }
+    if (pnThrottles)
+    {
+        for (pRepo = pTdnf->pRepos, i = 0; pRepo; pRepo = pRepo->pNext, i++)
+        {
+            pRepo->nThrottle = pnThrottles[i];
+        }
+    }
+    TDNF_SAFE_FREE_MEMORY(pnThrottles);
+    TDNF_SAFE_FREE_MEMORY(pszSize);
+    if (pSolvedInfo)
+    {
+        TDNFFreeSolvedPackageInfo(pSolvedInfo);
+    }
+    return dwError;
+
+error:
+    goto cleanup;
+}
@@ -60,6 +60,11 @@ TDNFImportGPGKeyFile(
     const char* pszFile
     );
 
+void
+TDNFFreeGPGKeys(
+    PTDNF_GPG_KEY pKeys
+    );
+
 uint32_t
 TDNFGPGCheckPackage(
     PTDNFRPMTS pTS,
@@ -97,6 +102,22 @@ TDNFRefreshSack(
     int nCleanMetadata
     );
 
+void
+TDNFRevalidateStaleRepos(
+    PTDNF pTdnf
+    );
+
+uint32_t
+TDNFInitHandleStages(
+    PTDNF pTdnf,
+    uint32_t dwStages
+    );
+
+void
+TDNFReleaseSack(
+    PTDNF pTdnf
+    );
+
 //repoutils.c
 uint32_t
 TDNFRepoGetUserPass(
@@ -199,6 +220,16 @@ TDNFDownloadFileFromRepo(
     const char *pszProgressData
 );
 
+uint32_t
+TDNFDownloadPackageFromRepo(
+    PTDNF pTdnf,
+    PTDNF_REPO_DATA pRepo,
+    PTDNF_PKG_INFO pPkgInfo,
+    const char *pszLocation,
+    const char *pszFile,
+    const char *pszProgressData
+);
+
 uint32_t
 TDNFDownloadFile(
     PTDNF pTdnf,
@@ -208,6 +239,11 @@ TDNFDownloadFile(
     const char *pszProgressData
     );
 
+void
+TDNFFreeMirrorHealth(
+    PTDNF_MIRROR_HEALTH pMirrors
+    );
+
 uint32_t
 TDNFCreatePackageUrl(
     PTDNF pTdnf,
@@ -222,6 +258,7 @@ TDNFDownloadPackage(
     const char* pszPackageLocation,
     const char* pszPkgName,
     PTDNF_REPO_DATA pRepo,
+    PTDNF_PKG_INFO pPkgInfo,
     const char* pszRpmCacheDir
     );
 
@@ -231,6 +268,28 @@ TDNFDownloadPackageToCache(
     const char* pszPackageLocation,
     const char* pszPkgName,
     PTDNF_REPO_DATA pRepo,
+    PTDNF_PKG_INFO pPkgInfo,
+    char** ppszFilePath
+    );
+
+uint32_t
+TDNFCheckPackageFile(
+    const char *pszFile,
+    PTDNF_PKG_INFO pPkgInfo
+    );
+
+uint32_t
+TDNFGetPackageCachePath(
+    PTDNF pTdnf,
+    const char* pszPackageLocation,
+    PTDNF_REPO_DATA pRepo,
+    char** ppszFilePath
+    );
+
+uint32_t
+TDNFGetPackageTreePath(
+    const char* pszPackageLocation,
+    const char* pszNormalRpmCacheDir,
     char** ppszFilePath
     );
 
@@ -240,6 +299,7 @@ TDNFDownloadPackageToTree(
     const char* pszPackageLocation,
     const char* pszPkgName,
     PTDNF_REPO_DATA pRepo,
+    PTDNF_PKG_INFO pPkgInfo,
     char* pszNormalRpmCacheDir,
     char** ppszFilePath
     );
@@ -250,6 +310,7 @@ TDNFDownloadPackageToDirectory(
     const char* pszPackageLocation,
     const char* pszPkgName,
     PTDNF_REPO_DATA pRepo,
+    PTDNF_PKG_INFO pPkgInfo,
     const char* pszDirectory,
     char** ppszFilePath
     );
@@ -634,6 +695,25 @@ TDNFGetCachePath(
     char **ppszPath
 );
 
+uint32_t
+TDNFRepoLockSharedCache(
+    PTDNF pTdnf,
+    PTDNF_REPO_DATA pRepo,
+    int nShared,
+    int *pnLockFd
+    );
+
+void
+TDNFRepoUnlockSharedCache(
+    int nLockFd
+    );
+
+uint32_t
+TDNFRepoAddSharedCacheRoot(
+    PTDNF pTdnf,
+    PTDNF_REPO_DATA pRepo
+    );
+
 uint32_t
 TDNFGetRepoById(
     PTDNF pTdnf,
@@ -808,6 +888,270 @@ TDNFResolveBuildDependencies(
     Queue* queueGoal
     );
 
+//resultcache.c
+uint32_t
+TDNFResultCacheGetKey(
+    PTDNF pTdnf,
+    const char *pszJob,
+    uint32_t dwFlags,
+    char **ppszKey
+    );
+
+uint32_t
+TDNFResultCacheWriteSolved(
+    PTDNF pTdnf,
+    const char *pszSlot,
+    const char *pszKey,
+    PTDNF_SOLVED_PKG_INFO pSolvedPkgInfo
+    );
+
+uint32_t
+TDNFResultCacheReadSolved(
+    PTDNF pTdnf,
+    const char *pszSlot,
+    const char *pszKey,
+    PTDNF_SOLVED_PKG_INFO *ppSolvedPkgInfo
+    );
+
+uint32_t
+TDNFResultCacheWritePkgInfoArray(
+    PTDNF pTdnf,
+    const char *pszSlot,
+    const char *pszKey,
+    PTDNF_PKG_INFO pPkgInfos,
+    uint32_t dwCount
+    );
+
+uint32_t
+TDNFResultCacheReadPkgInfoArray(
+    PTDNF pTdnf,
+    const char *pszSlot,
+    const char *pszKey,
+    PTDNF_PKG_INFO *ppPkgInfos,
+    uint32_t *pdwCount
+    );
+
+uint32_t
+TDNFResultCacheWriteUpdateSummary(
+    PTDNF pTdnf,
+    const char *pszKey,
+    PTDNF_UPDATE_SUMMARY pSummary
+    );
+
+uint32_t
+TDNFResultCacheReadUpdateSummary(
+    PTDNF pTdnf,
+    const char *pszKey,
+    PTDNF_UPDATE_SUMMARY *ppSummary
+    );
+
+uint32_t
+TDNFResultCacheRemove(
+    PTDNF pTdnf
+    );
+
+void
+TDNFFreeFileDigests(
+    PTDNF_FILE_DIGEST pDigests,
+    uint32_t dwCount
+    );
+
+uint32_t
+TDNFResultCacheWriteFileDigests(
+    PTDNF pTdnf,
+    PTDNF_FILE_DIGEST pDigests,
+    uint32_t dwCount
+    );
+
+uint32_t
+TDNFResultCacheReadFileDigests(
+    PTDNF pTdnf,
+    PTDNF_FILE_DIGEST *ppDigests,
+    uint32_t *pdwCount
+    );
+
+//reposync.c
+uint32_t
+TDNFRepoSyncPackages(
+    PTDNF pTdnf,
+    PTDNF_REPOSYNC_ARGS pReposyncArgs,
+    PTDNF_REPOSYNC_JOB pJobs,
+    uint32_t dwJobCount
+    );
+
+uint32_t
+TDNFRepoSyncDeleteUnsynced(
+    PTDNF_REPOSYNC_JOB pJobs,
+    uint32_t dwJobCount,
+    char **ppszRepoDirs
+    );
+
+void
+TDNFFreeRepoSyncJobs(
+    PTDNF_REPOSYNC_JOB pJobs,
+    uint32_t dwJobCount
+    );
+
+uint32_t
+TDNFRepoSyncLockDir(
+    const char *pszDir,
+    int *pnLockFd
+    );
+
+void
+TDNFRepoSyncUnlockDir(
+    int nLockFd
+    );
+
+//packagestore.c
+uint32_t
+TDNFPackageStoreGetPath(
+    PTDNF pTdnf,
+    PTDNF_PKG_INFO pPkgInfo,
+    char **ppszPath
+    );
+
+uint32_t
+TDNFPackageStoreFetch(
+    PTDNF pTdnf,
+    PTDNF_PKG_INFO pPkgInfo,
+    const char *pszDest,
+    uint64_t *pqwBytes
+    );
+
+uint32_t
+TDNFPackageStoreAdd(
+    PTDNF pTdnf,
+    PTDNF_PKG_INFO pPkgInfo,
+    const char *pszFile,
+    uint64_t *pqwBytes
+    );
+
+uint32_t
+TDNFPackageStorePrune(
+    PTDNF pTdnf
+    );
+
+void
+TDNFPackageStoreReport(
+    uint64_t qwBytes
+    );
+
+//multiplex.c
+uint32_t
+TDNFDownloadPackagesToCache(
+    PTDNF pTdnf,
+    PTDNF_PKG_INFO pInfos
+    );
+
+//bandwidth.c
+void
+TDNFBandwidthSetup(
+    PTDNF_CONF pConf
+    );
+
+int
+TDNFBandwidthClass(
+    PTDNF pTdnf,
+    const char *pszFile
+    );
+
+void
+TDNFBandwidthStart(
+    int nClass
+    );
+
+void
+TDNFBandwidthStop(
+    int nClass
+    );
+
+void
+TDNFBandwidthConsume(
+    int nClass,
+    size_t nBytes
+    );
+
+//cacheclean.c
+uint32_t
+TDNFCacheRecordAccess(
+    PTDNF pTdnf,
+    const char *pszFile
+    );
+
+uint32_t
+TDNFCacheGetPackageBytes(
+    PTDNF pTdnf,
+    uint64_t *pqwBytes
+    );
+
+uint32_t
+TDNFCacheEnforceBudget(
+    PTDNF pTdnf
+    );
+
+uint32_t
+TDNFCleanStalePackages(
+    PTDNF pTdnf
+    );
+
+uint32_t
+TDNFCleanStaleRepoDirs(
+    PTDNF pTdnf
+    );
+
+//verifycache.c
+uint32_t
+TDNFVerifyCacheLoad(
+    PTDNF pTdnf,
+    PTDNF_REPO_DATA pRepo,
+    PTDNF_VERIFY_CACHE *ppCache
+    );
+
+PTDNF_VERIFY_CACHE_ENTRY
+TDNFVerifyCacheLookup(
+    PTDNF_VERIFY_CACHE pCache,
+    const struct stat *pStat
+    );
+
+uint32_t
+TDNFVerifyCacheSet(
+    PTDNF_VERIFY_CACHE pCache,
+    const char *pszPath,
+    const struct stat *pStat,
+    int nHashType,
+    const char *pszDigest,
+    const char *pszKeyId
+    );
+
+uint32_t
+TDNFVerifyCacheSave(
+    PTDNF_VERIFY_CACHE pCache
+    );
+
+uint32_t
+TDNFVerifyCacheGetKeyId(
+    Header rpmHeader,
+    char **ppszKeyId
+    );
+
+uint32_t
+TDNFVerifyCacheGetTrustedKeys(
+    rpmts ts,
+    char ***pppszKeys
+    );
+
+int
+TDNFVerifyCacheIsKeyTrusted(
+    char **ppszKeys,
+    const char *pszKeyId
+    );
+
+void
+TDNFFreeVerifyCache(
+    PTDNF_VERIFY_CACHE pCache
+    );
+
 //rpmtrans.c
 uint32_t
 TDNFRpmExecTransaction(
@@ -920,22 +1264,49 @@ TDNFGetSecuritySeverityOption(
     );
 
 uint32_t
-TDNFNumUpdatePkgs(
-    PTDNF_UPDATEINFO pInfo,
-    uint32_t *pdwCount
+TDNFGetAdvisoryUpgrades(
+    PTDNF pTdnf,
+    uint32_t dwSecurity,
+    const char *pszSeverity,
+    uint32_t dwRebootRequired,
+    Queue *pQueueGoal
     );
 
 uint32_t
-TDNFGetUpdatePkgs(
+TDNFGetRebootRequiredOption(
     PTDNF pTdnf,
-    char*** pppszPkgs,
-    uint32_t *pdwCount
+    uint32_t *pdwRebootRequired
     );
 
 uint32_t
-TDNFGetRebootRequiredOption(
+TDNFCollectUpdateAdvisories(
     PTDNF pTdnf,
-    uint32_t *pdwRebootRequired
+    char** ppszPackageNameSpecs,
+    PTDNF_UPDATE_SUMMARY_ADV* ppAdvs
+    );
+
+uint32_t
+TDNFCountUpdateAdvisories(
+    PTDNF_UPDATE_SUMMARY_ADV pAdvs,
+    uint32_t dwSecurity,
+    const char* pszSeverity,
+    PTDNF_UPDATEINFO_SUMMARY* ppSummary
+    );
+
+uint32_t
+TDNFGetUpdateSummary(
+    PTDNF pTdnf,
+    PTDNF_UPDATE_SUMMARY* ppSummary
+    );
+
+void
+TDNFFreeUpdateSummaryAdvisories(
+    PTDNF_UPDATE_SUMMARY_ADV pAdvs
+    );
+
+void
+TDNFFreeUpdateSummary(
+    PTDNF_UPDATE_SUMMARY pSummary
     );
 
 //utils.c
@@ -976,6 +1347,19 @@ TDNFGetFileSize(
     int *pnSize
     );
 
+uint32_t
+TDNFCopyFile(
+    const char *pszSrc,
+    const char *pszDest
+    );
+
+uint32_t
+TDNFDigestToHex(
+    const unsigned char *pbDigest,
+    int nHashType,
+    char **ppszHex
+    );
+
 int
 TDNFIsGlob(
     const char* pszString
@@ -1009,6 +1393,12 @@ TDNFParseMetadataExpire(
     long* plMetadataExpire
     );
 
+uint32_t
+TDNFParseSize(
+    const char* pszSize,
+    uint64_t* pqwSize
+    );
+
 uint32_t
 TDNFShouldSyncMetadata(
     const char* pszRepoDataFolder,
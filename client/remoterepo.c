@@ -94,17 +94,712 @@ error:
 }
 
 
+/*
+ * Get a file from a file:// url without going through libcurl, so
+ * the data does not pass through user space: a hardlink if
+ * local_hardlink is set and possible, else a reflink or an in kernel
+ * copy. Returns ERROR_TDNF_URL_INVALID for urls it does not handle.
+ */
+static
+uint32_t
+_TDNFDownloadLocalFile(
+    PTDNF pTdnf,
+    const char *pszFileUrl,
+    const char *pszFile
+    )
+{
+    uint32_t dwError = 0;
+    char *pszPath = NULL;
+    char *pszFileTmp = NULL;
+    int nLinked = 0;
+
+    /* percent encoded paths are left to libcurl */
+    if (strncasecmp(pszFileUrl, "file://", 7) || strchr(pszFileUrl, '%'))
+    {
+        dwError = ERROR_TDNF_URL_INVALID;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    dwError = TDNFPathFromUri(pszFileUrl, &pszPath);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFAllocateStringPrintf(&pszFileTmp, "%s.tmp", pszFile);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    unlink(pszFileTmp);
+    if (pTdnf->pConf->nLocalHardlink)
+    {
+        nLinked = link(pszPath, pszFileTmp) == 0;
+    }
+    if (!nLinked)
+    {
+        dwError = TDNFCopyFile(pszPath, pszFileTmp);
+        if (dwError == ERROR_TDNF_SYSTEM_BASE + ENOENT)
+        {
+            /* same error as libcurl gives */
+            dwError = ERROR_TDNF_CURL_BASE + CURLE_FILE_COULDNT_READ_FILE;
+        }
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    if (rename(pszFileTmp, pszFile) == -1)
+    {
+        dwError = errno;
+        BAIL_ON_TDNF_SYSTEM_ERROR(dwError);
+    }
+    /* a link shares the mode with its source, leave it alone */
+    if (!nLinked &&
+        chmod(pszFile, S_IRUSR|S_IWUSR|S_IRGRP|S_IROTH) == -1)
+    {
+        dwError = errno;
+        BAIL_ON_TDNF_SYSTEM_ERROR(dwError);
+    }
+
+cleanup:
+    TDNF_SAFE_FREE_MEMORY(pszPath);
+    TDNF_SAFE_FREE_MEMORY(pszFileTmp);
+    return dwError;
+
+error:
+    if(!IsNullOrEmptyString(pszFileTmp))
+    {
+        unlink(pszFileTmp);
+    }
+    goto cleanup;
+}
+
+/*
+ * Downloads go through the urls of a file in turn. A transfer that
+ * fails, or stays below minrate for stall_timeout seconds, is given
+ * up and the next url continues where it stopped. Every round over
+ * the urls after the first one waits for a backoff that doubles
+ * each round. Base urls that failed are tried last for the rest of
+ * the life of the handle, see pTdnf->pMirrors.
+ */
+
+/* reposync downloads from several threads */
+static pthread_mutex_t gMirrorsLock = PTHREAD_MUTEX_INITIALIZER;
+
+static
+int
+_TDNFMirrorFailures(
+    PTDNF pTdnf,
+    const char *pszUrl
+    )
+{
+    PTDNF_MIRROR_HEALTH pMirror = NULL;
+    int nFailures = 0;
+
+    pthread_mutex_lock(&gMirrorsLock);
+    for (pMirror = pTdnf->pMirrors; pMirror; pMirror = pMirror->pNext)
+    {
+        if (strcmp(pMirror->pszUrl, pszUrl) == 0)
+        {
+            nFailures = pMirror->nFailures;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&gMirrorsLock);
+
+    return nFailures;
+}
+
+/* the health is a hint only, running out of memory here is ignored */
+static
+void
+_TDNFMirrorFailed(
+    PTDNF pTdnf,
+    const char *pszUrl
+    )
+{
+    PTDNF_MIRROR_HEALTH pMirror = NULL;
+
+    pthread_mutex_lock(&gMirrorsLock);
+    for (pMirror = pTdnf->pMirrors; pMirror; pMirror = pMirror->pNext)
+    {
+        if (strcmp(pMirror->pszUrl, pszUrl) == 0)
+        {
+            break;
+        }
+    }
+    if (!pMirror &&
+        TDNFAllocateMemory(1, sizeof(TDNF_MIRROR_HEALTH),
+                           (void **)&pMirror) == 0)
+    {
+        if (TDNFAllocateString(pszUrl, &pMirror->pszUrl))
+        {
+            TDNF_SAFE_FREE_MEMORY(pMirror);
+        }
+        else
+        {
+            pMirror->pNext = pTdnf->pMirrors;
+            pTdnf->pMirrors = pMirror;
+        }
+    }
+    if (pMirror)
+    {
+        pMirror->nFailures++;
+    }
+    pthread_mutex_unlock(&gMirrorsLock);
+}
+
+void
+TDNFFreeMirrorHealth(
+    PTDNF_MIRROR_HEALTH pMirrors
+    )
+{
+    PTDNF_MIRROR_HEALTH pNext = NULL;
+
+    while (pMirrors)
+    {
+        pNext = pMirrors->pNext;
+        TDNF_SAFE_FREE_MEMORY(pMirrors->pszUrl);
+        TDNFFreeMemory(pMirrors);
+        pMirrors = pNext;
+    }
+}
+
+/*
+ * Wait before round nRound over the urls. Half of the wait is
+ * random, so that clients that failed together do not all come
+ * back at the same time.
+ */
+static
+void
+_TDNFDownloadBackoff(
+    int nRound,
+    unsigned int *pnSeed
+    )
+{
+    long lDelay = TDNF_DOWNLOAD_BACKOFF_BASE_MS;
+    struct timespec ts = {0};
+    int i;
+
+    for (i = 1; i < nRound && lDelay < TDNF_DOWNLOAD_BACKOFF_MAX_MS; i++)
+    {
+        lDelay *= 2;
+    }
+    if (lDelay > TDNF_DOWNLOAD_BACKOFF_MAX_MS)
+    {
+        lDelay = TDNF_DOWNLOAD_BACKOFF_MAX_MS;
+    }
+    lDelay = lDelay / 2 + rand_r(pnSeed) % (lDelay / 2 + 1);
+
+    ts.tv_sec = lDelay / 1000;
+    ts.tv_nsec = (lDelay % 1000) * 1000000L;
+    nanosleep(&ts, NULL);
+}
+
+static
+size_t
+_TDNFDownloadWrite(
+    char *pData,
+    size_t nSize,
+    size_t nMemb,
+    void *pUserData
+    )
+{
+    PTDNF_DOWNLOAD_XFER pXfer = (PTDNF_DOWNLOAD_XFER)pUserData;
+    /* lStatus reads CURLINFO_RESPONSE_CODE. Must be long */
+    long lStatus = 0;
+
+    if (!pXfer->nChecked)
+    {
+        pXfer->nChecked = 1;
+        curl_easy_getinfo(pXfer->pCurl, CURLINFO_RESPONSE_CODE, &lStatus);
+        if (lStatus >= 400)
+        {
+            /* keep what an earlier url has sent */
+            pXfer->nDiscard = 1;
+        }
+        else if (pXfer->nOffset > 0 && lStatus >= 200 && lStatus != 206)
+        {
+            /* the range was ignored, this is all of the file. libcurl
+               usually fails with CURLE_RANGE_ERROR before this */
+            if (ftruncate(fileno(pXfer->fp), 0))
+            {
+                return 0;
+            }
+            pXfer->nOffset = 0;
+        }
+    }
+
+    TDNFBandwidthConsume(pXfer->nClass, nSize * nMemb);
+
+    if (pXfer->nDiscard)
+    {
+        return nSize * nMemb;
+    }
+    return fwrite(pData, 1, nSize * nMemb, pXfer->fp);
+}
+
+/*
+ * Keep the validator of the response for If-Range. A strong ETag
+ * is preferred over Last-Modified, weak ETags cannot be used.
+ */
+static
+size_t
+_TDNFDownloadHeader(
+    char *pData,
+    size_t nSize,
+    size_t nItems,
+    void *pUserData
+    )
+{
+    PTDNF_DOWNLOAD_XFER pXfer = (PTDNF_DOWNLOAD_XFER)pUserData;
+    size_t nLen = nSize * nItems;
+    size_t nName = 0;
+    int nETag = 0;
+    char *pszValue = NULL;
+
+    if (nLen >= 5 && strncmp(pData, "HTTP/", 5) == 0)
+    {
+        /* the status line of a new response, after a redirect */
+        TDNF_SAFE_FREE_MEMORY(pXfer->pszValidator);
+        pXfer->nETag = 0;
+        return nLen;
+    }
+
+    if (nLen > 5 && strncasecmp(pData, "ETag:", 5) == 0)
+    {
+        nName = 5;
+        nETag = 1;
+    }
+    else if (nLen > 14 && strncasecmp(pData, "Last-Modified:", 14) == 0)
+    {
+        nName = 14;
+    }
+    if (nName == 0 || (pXfer->nETag && !nETag))
+    {
+        return nLen;
+    }
+
+    pData += nName;
+    nLen -= nName;
+    while (nLen > 0 && isspace((unsigned char)pData[0]))
+    {
+        pData++;
+        nLen--;
+    }
+    while (nLen > 0 && isspace((unsigned char)pData[nLen - 1]))
+    {
+        nLen--;
+    }
+    if (nLen == 0 || (nETag && pData[0] == 'W'))
+    {
+        return nSize * nItems;
+    }
+
+    if (TDNFAllocateMemory(nLen + 1, 1, (void **)&pszValue) == 0)
+    {
+        memcpy(pszValue, pData, nLen);
+        TDNF_SAFE_FREE_MEMORY(pXfer->pszValidator);
+        pXfer->pszValidator = pszValue;
+        pXfer->nETag = nETag;
+    }
+    return nSize * nItems;
+}
+
+/*
+ * One try at pszFileUrl, writing to pszFileTmp. *ppszValidator is
+ * the ETag or Last-Modified of the response that wrote the partial
+ * file of an earlier try, and gets the one of this response.
+ * A partial file that is big enough is continued with If-Range, so
+ * a different file comes back whole. Without a validator it is only
+ * continued if nChecked says the file is checked against the repo
+ * checksum after the download, else it is fetched again.
+ * *plStatus gets the response code. nClass is the TDNF_XFER_CLASS
+ * for max_bandwidth.
+ */
+static
+uint32_t
+_TDNFDownloadAttempt(
+    PTDNF pTdnf,
+    PTDNF_REPO_DATA pRepo,
+    const char *pszFileUrl,
+    const char *pszFileTmp,
+    const char *pszProgressData,
+    int nClass,
+    int nChecked,
+    char **ppszValidator,
+    long *plStatus
+    )
+{
+    uint32_t dwError = 0;
+    CURL *pCurl = NULL;
+    char *pszUserPass = NULL;
+    char *pszIfRange = NULL;
+    struct curl_slist *pHeaders = NULL;
+    TDNF_DOWNLOAD_XFER xfer = {0};
+    struct stat st = {0};
+    int nNoOutput = 1;
+
+    pCurl = curl_easy_init();
+    if(!pCurl)
+    {
+        dwError = ERROR_TDNF_CURL_INIT;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    dwError = TDNFRepoGetUserPass(pTdnf, pRepo, &pszUserPass);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    if(!IsNullOrEmptyString(pszUserPass))
+    {
+        dwError = curl_easy_setopt(
+                      pCurl,
+                      CURLOPT_USERPWD,
+                      pszUserPass);
+        BAIL_ON_TDNF_CURL_ERROR(dwError);
+    }
+
+    dwError = TDNFRepoApplyProxySettings(pTdnf->pConf, pCurl);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFRepoApplyDownloadSettings(pRepo, pCurl);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFRepoApplySSLSettings(pRepo, pCurl);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = curl_easy_setopt(pCurl, CURLOPT_URL, pszFileUrl);
+    BAIL_ON_TDNF_CURL_ERROR(dwError);
+
+    dwError = curl_easy_setopt(pCurl, CURLOPT_FOLLOWLOCATION, 1L);
+    BAIL_ON_TDNF_CURL_ERROR(dwError);
+
+    if (!pTdnf->pArgs->nQuiet && pszProgressData != NULL)
+    {
+        //print progress only if tty or verbose is specified.
+        if (isatty(STDOUT_FILENO) || pTdnf->pArgs->nVerbose)
+        {
+            dwError = set_progress_cb(pCurl, pszProgressData);
+            BAIL_ON_TDNF_ERROR(dwError);
+            nNoOutput = 0;
+        }
+    }
+
+    xfer.fp = fopen(pszFileTmp, "ab");
+    if(!xfer.fp)
+    {
+        dwError = errno;
+        BAIL_ON_TDNF_SYSTEM_ERROR_UNCOND(dwError);
+    }
+
+    if (fstat(fileno(xfer.fp), &st) == 0 &&
+        st.st_size >= TDNF_DOWNLOAD_RESUME_MIN &&
+        (*ppszValidator || nChecked))
+    {
+        xfer.nOffset = st.st_size;
+        dwError = curl_easy_setopt(pCurl, CURLOPT_RESUME_FROM_LARGE,
+                                   xfer.nOffset);
+        BAIL_ON_TDNF_CURL_ERROR(dwError);
+
+        if (*ppszValidator)
+        {
+            /* a 200 instead of a 206 fails with CURLE_RANGE_ERROR
+               and the file is fetched again, see below */
+            dwError = TDNFAllocateStringPrintf(&pszIfRange, "If-Range: %s",
+                                               *ppszValidator);
+            BAIL_ON_TDNF_ERROR(dwError);
+
+            pHeaders = curl_slist_append(NULL, pszIfRange);
+            if (!pHeaders)
+            {
+                dwError = ERROR_TDNF_OUT_OF_MEMORY;
+                BAIL_ON_TDNF_ERROR(dwError);
+            }
+            dwError = curl_easy_setopt(pCurl, CURLOPT_HTTPHEADER, pHeaders);
+            BAIL_ON_TDNF_CURL_ERROR(dwError);
+        }
+
+        pr_info("resuming %s at %ld bytes\n", pszFileUrl, (long)xfer.nOffset);
+    }
+    else if (st.st_size > 0 && ftruncate(fileno(xfer.fp), 0))
+    {
+        dwError = errno;
+        BAIL_ON_TDNF_SYSTEM_ERROR_UNCOND(dwError);
+    }
+
+    xfer.pCurl = pCurl;
+    xfer.nClass = nClass;
+    dwError = curl_easy_setopt(pCurl, CURLOPT_WRITEFUNCTION,
+                               _TDNFDownloadWrite);
+    BAIL_ON_TDNF_CURL_ERROR(dwError);
+
+    dwError = curl_easy_setopt(pCurl, CURLOPT_WRITEDATA, &xfer);
+    BAIL_ON_TDNF_CURL_ERROR(dwError);
+
+    dwError = curl_easy_setopt(pCurl, CURLOPT_HEADERFUNCTION,
+                               _TDNFDownloadHeader);
+    BAIL_ON_TDNF_CURL_ERROR(dwError);
+
+    dwError = curl_easy_setopt(pCurl, CURLOPT_HEADERDATA, &xfer);
+    BAIL_ON_TDNF_CURL_ERROR(dwError);
+
+    TDNFBandwidthStart(nClass);
+    dwError = curl_easy_perform(pCurl);
+    TDNFBandwidthStop(nClass);
+    BAIL_ON_TDNF_CURL_ERROR(dwError);
+
+    /* finish progress line output,
+       but only if progrees was enabled */
+    if (!nNoOutput) {
+        pr_info("\n");
+    }
+
+    dwError = curl_easy_getinfo(pCurl,
+                                CURLINFO_RESPONSE_CODE,
+                                plStatus);
+    BAIL_ON_TDNF_CURL_ERROR(dwError);
+
+    if (fclose(xfer.fp))
+    {
+        xfer.fp = NULL;
+        dwError = errno;
+        BAIL_ON_TDNF_SYSTEM_ERROR_UNCOND(dwError);
+    }
+    xfer.fp = NULL;
+
+cleanup:
+    /* the partial file is from this response now */
+    if (xfer.nChecked && !xfer.nDiscard)
+    {
+        TDNF_SAFE_FREE_MEMORY(*ppszValidator);
+        *ppszValidator = xfer.pszValidator;
+        xfer.pszValidator = NULL;
+    }
+    TDNF_SAFE_FREE_MEMORY(xfer.pszValidator);
+    TDNF_SAFE_FREE_MEMORY(pszUserPass);
+    TDNF_SAFE_FREE_MEMORY(pszIfRange);
+    if(xfer.fp)
+    {
+        fclose(xfer.fp);
+    }
+    if(pCurl)
+    {
+        curl_easy_cleanup(pCurl);
+    }
+    if (pHeaders)
+    {
+        curl_slist_free_all(pHeaders);
+    }
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+/*
+ * Download pszFile from the first of ppszUrls that has it, see
+ * above. ppszMirrors are the base urls of ppszUrls, to keep track
+ * of their health. NULL if the urls are not from base urls.
+ * nChecked is set if the caller checks the file against the repo
+ * checksum, see _TDNFDownloadAttempt().
+ */
+static
+uint32_t
+_TDNFDownloadFromUrls(
+    PTDNF pTdnf,
+    PTDNF_REPO_DATA pRepo,
+    const char **ppszUrls,
+    char **ppszMirrors,
+    int nUrls,
+    const char *pszFile,
+    const char *pszProgressData,
+    int nChecked
+    )
+{
+    uint32_t dwError = 0;
+    char *pszFileTmp = NULL;
+    char *pszValidator = NULL;  //of the partial file
+    int *pnGone = NULL;     //urls that will not have the file
+    unsigned int nSeed = (unsigned int)time(NULL) ^ (unsigned int)getpid();
+    /* lStatus reads CURLINFO_RESPONSE_CODE. Must be long */
+    long lStatus = 0;
+    int nRounds = (pRepo->nRetries > 0 ? pRepo->nRetries : 0) + 1;
+    int nClass = TDNFBandwidthClass(pTdnf, pszFile);
+    int nRound;
+    int nTried;
+    int i;
+
+    dwError = TDNFAllocateMemory(nUrls, sizeof(int), (void **)&pnGone);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFAllocateStringPrintf(&pszFileTmp,
+                                       "%s.tmp",
+                                       pszFile);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    /* whatever is left there is not from this download */
+    unlink(pszFileTmp);
+
+    for (nRound = 0; nRound < nRounds; nRound++)
+    {
+        nTried = 0;
+        for (i = 0; i < nUrls; i++)
+        {
+            if (pnGone[i])
+            {
+                continue;
+            }
+            if (nTried++ == 0 && nRound > 0)
+            {
+                _TDNFDownloadBackoff(nRound, &nSeed);
+                pr_info("retrying %d/%d\n", nRound, nRounds - 1);
+            }
+
+            dwError = _TDNFDownloadLocalFile(pTdnf, ppszUrls[i], pszFile);
+            if (dwError == 0)
+            {
+                goto cleanup;
+            }
+            if (dwError != ERROR_TDNF_URL_INVALID)
+            {
+                pnGone[i] = 1;
+                continue;
+            }
+
+            lStatus = 0;
+            dwError = _TDNFDownloadAttempt(pTdnf, pRepo, ppszUrls[i],
+                                           pszFileTmp, pszProgressData,
+                                           nClass, nChecked, &pszValidator,
+                                           &lStatus);
+            if (dwError == 0 && lStatus < 400)
+            {
+                if (rename(pszFileTmp, pszFile) == -1)
+                {
+                    dwError = errno;
+                    BAIL_ON_TDNF_SYSTEM_ERROR(dwError);
+                }
+                if (chmod(pszFile, S_IRUSR|S_IWUSR|S_IRGRP|S_IROTH) == -1)
+                {
+                    dwError = errno;
+                    BAIL_ON_TDNF_SYSTEM_ERROR(dwError);
+                }
+                goto cleanup;
+            }
+
+            if (dwError == 0)
+            {
+                pr_err(
+                        "Error: %ld when downloading %s\n. Please check repo url "
+                        "or refresh metadata with 'tdnf makecache'.\n",
+                        lStatus,
+                        ppszUrls[i]);
+                dwError = ERROR_TDNF_INVALID_PARAMETER;
+                pnGone[i] = 1;
+                if (lStatus == 416)
+                {
+                    /* the partial file does not fit this url */
+                    unlink(pszFileTmp);
+                    TDNF_SAFE_FREE_MEMORY(pszValidator);
+                }
+                continue;
+            }
+            if (dwError == ERROR_TDNF_CURL_BASE + CURLE_RANGE_ERROR)
+            {
+                /* no ranges there, or If-Range did not match. Not a
+                   failure of the url. Once more from the start, which
+                   does not send a range */
+                unlink(pszFileTmp);
+                TDNF_SAFE_FREE_MEMORY(pszValidator);
+                i--;
+                continue;
+            }
+            if (dwError <= ERROR_TDNF_CURL_BASE ||
+                dwError > ERROR_TDNF_CURL_END)
+            {
+                BAIL_ON_TDNF_ERROR(dwError);
+            }
+
+            if (TDNFCurlErrorIsFatal(dwError - ERROR_TDNF_CURL_BASE))
+            {
+                pnGone[i] = 1;
+            }
+            else if (pTdnf->pArgs->nVerbose)
+            {
+                pr_info("%s: %s\n", ppszUrls[i],
+                        curl_easy_strerror(dwError - ERROR_TDNF_CURL_BASE));
+            }
+            if (ppszMirrors)
+            {
+                _TDNFMirrorFailed(pTdnf, ppszMirrors[i]);
+            }
+        }
+        if (nTried == 0)
+        {
+            break;
+        }
+    }
+    BAIL_ON_TDNF_ERROR(dwError);
+
+cleanup:
+    TDNF_SAFE_FREE_MEMORY(pszFileTmp);
+    TDNF_SAFE_FREE_MEMORY(pszValidator);
+    TDNF_SAFE_FREE_MEMORY(pnGone);
+    return dwError;
+
+error:
+    if(!IsNullOrEmptyString(pszFileTmp))
+    {
+        unlink(pszFileTmp);
+    }
+    goto cleanup;
+}
+
 uint32_t
-TDNFDownloadFileFromRepo(
+TDNFDownloadFile(
     PTDNF pTdnf,
     PTDNF_REPO_DATA pRepo,
-    const char *pszLocation,
+    const char *pszFileUrl,
     const char *pszFile,
     const char *pszProgressData
-)
+    )
 {
     uint32_t dwError = 0;
-    char *pszUrl = NULL;
+    const char *ppszUrls[] = {pszFileUrl};
+
+    /* TDNFFetchRemoteGPGKey sends pszProgressData as NULL */
+    if(!pTdnf ||
+       !pRepo ||
+       IsNullOrEmptyString(pszFileUrl) ||
+       IsNullOrEmptyString(pszFile))
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    dwError = _TDNFDownloadFromUrls(pTdnf, pRepo, ppszUrls, NULL, 1,
+                                    pszFile, pszProgressData, 0);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+cleanup:
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+static
+uint32_t
+_TDNFDownloadFromRepo(
+    PTDNF pTdnf,
+    PTDNF_REPO_DATA pRepo,
+    const char *pszLocation,
+    const char *pszFile,
+    const char *pszProgressData,
+    int nChecked
+    )
+{
+    uint32_t dwError = 0;
+    const char *ppszLocation[] = {pszLocation};
+    char **ppszUrls = NULL;
+    char **ppszMirrors = NULL;
+    int *pnFailures = NULL;
+    int nFailures;
+    int nUrls = 0;
+    int i, j;
 
     if(!pTdnf ||
        !pTdnf->pArgs || !pRepo ||
@@ -115,249 +810,422 @@ TDNFDownloadFileFromRepo(
         BAIL_ON_TDNF_ERROR(dwError);
     }
 
-    if (pRepo->ppszBaseUrls && pRepo->ppszBaseUrls[0]) {
-        /* Try one base URL after the other until we succeed */
-        /* Note: this can be improved:
-         * 1) we could start with the last good URL next time instead of
-         *    starting with 0 each time
-         * 2) we could store a list of known bad/good URLs
-         */
-        for (int i = 0; pRepo->ppszBaseUrls[i]; i++) {
-            dwError = TDNFJoinPath(&pszUrl, pRepo->ppszBaseUrls[i], pszLocation, NULL);
-            BAIL_ON_TDNF_ERROR(dwError);
-
-            dwError = TDNFDownloadFile(pTdnf, pRepo, pszUrl, pszFile, pszProgressData);
-            if (dwError == 0) {
-                break;
-            }
-            TDNF_SAFE_FREE_MEMORY(pszUrl);
-        }
-    } else {
+    if (!pRepo->ppszBaseUrls || !pRepo->ppszBaseUrls[0])
+    {
         /* If there is no base url, pszLocation should contain the whole URL.
            This is the case for packages from the command line. */
-        dwError = TDNFDownloadFile(pTdnf, pRepo, pszLocation, pszFile, pszProgressData);
+        dwError = _TDNFDownloadFromUrls(pTdnf, pRepo, ppszLocation, NULL, 1,
+                                        pszFile, pszProgressData, nChecked);
+        BAIL_ON_TDNF_ERROR(dwError);
+        goto cleanup;
+    }
+
+    while (pRepo->ppszBaseUrls[nUrls])
+    {
+        nUrls++;
+    }
+
+    dwError = TDNFAllocateMemory(nUrls + 1, sizeof(char *),
+                                 (void **)&ppszUrls);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFAllocateMemory(nUrls, sizeof(char *),
+                                 (void **)&ppszMirrors);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFAllocateMemory(nUrls, sizeof(int), (void **)&pnFailures);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    /* healthy mirrors first, else in the order of the repo */
+    for (i = 0; i < nUrls; i++)
+    {
+        nFailures = _TDNFMirrorFailures(pTdnf, pRepo->ppszBaseUrls[i]);
+        for (j = i; j > 0 && pnFailures[j - 1] > nFailures; j--)
+        {
+            pnFailures[j] = pnFailures[j - 1];
+            ppszMirrors[j] = ppszMirrors[j - 1];
+        }
+        pnFailures[j] = nFailures;
+        ppszMirrors[j] = pRepo->ppszBaseUrls[i];
+    }
+
+    for (i = 0; i < nUrls; i++)
+    {
+        dwError = TDNFJoinPath(&ppszUrls[i], ppszMirrors[i], pszLocation, NULL);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    dwError = _TDNFDownloadFromUrls(pTdnf, pRepo, (const char **)ppszUrls,
+                                    ppszMirrors, nUrls,
+                                    pszFile, pszProgressData, nChecked);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+cleanup:
+    TDNF_SAFE_FREE_STRINGARRAY(ppszUrls);
+    TDNF_SAFE_FREE_MEMORY(ppszMirrors);
+    TDNF_SAFE_FREE_MEMORY(pnFailures);
+    return dwError;
+error:
+    goto cleanup;
+}
+
+uint32_t
+TDNFDownloadFileFromRepo(
+    PTDNF pTdnf,
+    PTDNF_REPO_DATA pRepo,
+    const char *pszLocation,
+    const char *pszFile,
+    const char *pszProgressData
+)
+{
+    return _TDNFDownloadFromRepo(pTdnf, pRepo, pszLocation, pszFile,
+                                 pszProgressData, 0);
+}
+
+/*
+ * Like TDNFDownloadFileFromRepo(), for a package that the caller
+ * checks against the checksum of pPkgInfo after the download. That
+ * lets a partial download continue from another mirror even if the
+ * mirrors do not agree on ETag or Last-Modified.
+ */
+uint32_t
+TDNFDownloadPackageFromRepo(
+    PTDNF pTdnf,
+    PTDNF_REPO_DATA pRepo,
+    PTDNF_PKG_INFO pPkgInfo,
+    const char *pszLocation,
+    const char *pszFile,
+    const char *pszProgressData
+)
+{
+    return _TDNFDownloadFromRepo(pTdnf, pRepo, pszLocation, pszFile,
+                                 pszProgressData,
+                                 pPkgInfo && pPkgInfo->pbChecksum);
+}
+
+uint32_t
+TDNFCreatePackageUrl(
+    PTDNF pTdnf,
+    const char* pszRepoId,
+    const char* pszPackageLocation,
+    char **ppszPackageUrl
+    )
+{
+    uint32_t dwError = 0;
+    char *pszPackageUrl = NULL;
+    PTDNF_REPO_DATA pRepo = NULL;
+
+    if(!pTdnf ||
+       !pTdnf->pArgs ||
+       IsNullOrEmptyString(pszPackageLocation) ||
+       IsNullOrEmptyString(pszRepoId) ||
+       !ppszPackageUrl)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    dwError = TDNFFindRepoById(pTdnf, pszRepoId, &pRepo);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    if (pRepo->ppszBaseUrls && pRepo->ppszBaseUrls[0]) {
+        dwError = TDNFJoinPath(&pszPackageUrl, pRepo->ppszBaseUrls[0], pszPackageLocation, NULL);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+    else
+    {
+        dwError = TDNFAllocateString(pszPackageLocation, &pszPackageUrl);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+    *ppszPackageUrl = pszPackageUrl;
+
+cleanup:
+    return dwError;
+error:
+    TDNF_SAFE_FREE_MEMORY(pszPackageUrl);
+    goto cleanup;
+}
+
+/*
+ * Check a package file against the size and checksum from the repo
+ * metadata. Without a checksum there is nothing to check it against,
+ * and ERROR_TDNF_CHECKSUM_MISMATCH is returned.
+ */
+uint32_t
+TDNFCheckPackageFile(
+    const char *pszFile,
+    PTDNF_PKG_INFO pPkgInfo
+    )
+{
+    uint32_t dwError = 0;
+    struct stat st = {0};
+    hash_op *hash = NULL;
+    uint8_t digest[EVP_MAX_MD_SIZE] = {0};
+
+    if (!pPkgInfo || !pPkgInfo->pbChecksum)
+    {
+        dwError = ERROR_TDNF_CHECKSUM_MISMATCH;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    if (stat(pszFile, &st))
+    {
+        dwError = errno;
+        BAIL_ON_TDNF_SYSTEM_ERROR_UNCOND(dwError);
+    }
+
+    if (pPkgInfo->dwDownloadSizeBytes &&
+        (uint64_t)st.st_size != pPkgInfo->dwDownloadSizeBytes)
+    {
+        dwError = ERROR_TDNF_SIZE_MISMATCH;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    hash = hash_ops + pPkgInfo->nChecksumType;
+    dwError = TDNFGetDigestForFile(pszFile, hash, digest);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    if (memcmp(digest, pPkgInfo->pbChecksum, hash->length))
+    {
+        dwError = ERROR_TDNF_CHECKSUM_MISMATCH;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+cleanup:
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+/*
+ * Let plugins have a go at a package download before the mirrors.
+ * A plugin can put the package at TDNF_EVENT_ITEM_PKG_FILE itself,
+ * or set TDNF_EVENT_ITEM_PKG_URL to have it downloaded from there.
+ * The url is returned in ppszUrl, NULL if no plugin set one.
+ */
+static
+uint32_t
+_TDNFEventPackageDownloadStart(
+    PTDNF pTdnf,
+    PTDNF_REPO_DATA pRepo,
+    const char *pcszLocation,
+    const char *pcszChecksum,
+    const char *pcszFile,
+    char **ppszUrl
+    )
+{
+    uint32_t dwError = 0;
+    TDNF_EVENT_CONTEXT stContext = {0};
+    const char *pcszUrl = NULL;
+
+    stContext.nEvent = MAKE_PLUGIN_EVENT(
+                           TDNF_PLUGIN_EVENT_TYPE_PACKAGE,
+                           TDNF_PLUGIN_EVENT_STATE_DOWNLOAD,
+                           TDNF_PLUGIN_EVENT_PHASE_START);
+
+    dwError = TDNFAddEventDataString(&stContext,
+                  TDNF_EVENT_ITEM_REPO_ID,
+                  pRepo->pszId);
+    BAIL_ON_TDNF_ERROR(dwError);
+    dwError = TDNFAddEventDataString(&stContext,
+                  TDNF_EVENT_ITEM_PKG_LOCATION,
+                  pcszLocation);
+    BAIL_ON_TDNF_ERROR(dwError);
+    if (pcszChecksum)
+    {
+        dwError = TDNFAddEventDataString(&stContext,
+                      TDNF_EVENT_ITEM_PKG_CHECKSUM,
+                      pcszChecksum);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+    dwError = TDNFAddEventDataString(&stContext,
+                  TDNF_EVENT_ITEM_PKG_FILE,
+                  pcszFile);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFPluginRaiseEvent(pTdnf, &stContext);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    if (TDNFEventContextGetItemString(&stContext,
+                                      TDNF_EVENT_ITEM_PKG_URL,
+                                      &pcszUrl) == 0 &&
+        !IsNullOrEmptyString(pcszUrl))
+    {
+        dwError = TDNFAllocateString(pcszUrl, ppszUrl);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+cleanup:
+    TDNFFreeEventData(stContext.pData);
+    return dwError;
+error:
+    goto cleanup;
+}
+
+static
+uint32_t
+_TDNFEventPackageDownloadEnd(
+    PTDNF pTdnf,
+    PTDNF_REPO_DATA pRepo,
+    const char *pcszLocation,
+    const char *pcszChecksum,
+    const char *pcszFile
+    )
+{
+    uint32_t dwError = 0;
+    TDNF_EVENT_CONTEXT stContext = {0};
+
+    stContext.nEvent = MAKE_PLUGIN_EVENT(
+                           TDNF_PLUGIN_EVENT_TYPE_PACKAGE,
+                           TDNF_PLUGIN_EVENT_STATE_DOWNLOAD,
+                           TDNF_PLUGIN_EVENT_PHASE_END);
+
+    dwError = TDNFAddEventDataString(&stContext,
+                  TDNF_EVENT_ITEM_REPO_ID,
+                  pRepo->pszId);
+    BAIL_ON_TDNF_ERROR(dwError);
+    dwError = TDNFAddEventDataString(&stContext,
+                  TDNF_EVENT_ITEM_PKG_LOCATION,
+                  pcszLocation);
+    BAIL_ON_TDNF_ERROR(dwError);
+    if (pcszChecksum)
+    {
+        dwError = TDNFAddEventDataString(&stContext,
+                      TDNF_EVENT_ITEM_PKG_CHECKSUM,
+                      pcszChecksum);
+        BAIL_ON_TDNF_ERROR(dwError);
     }
+    dwError = TDNFAddEventDataString(&stContext,
+                  TDNF_EVENT_ITEM_PKG_FILE,
+                  pcszFile);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFPluginRaiseEvent(pTdnf, &stContext);
     BAIL_ON_TDNF_ERROR(dwError);
 
 cleanup:
-    TDNF_SAFE_FREE_MEMORY(pszUrl);
+    TDNFFreeEventData(stContext.pData);
     return dwError;
 error:
     goto cleanup;
 }
 
+/*
+ * Download one package to pszPackageFile. Plugins get the
+ * PACKAGE_DOWNLOAD events around it. What a plugin provides
+ * is only used if it matches the checksum from the repo
+ * metadata, otherwise the package comes from the repo.
+ */
+static
 uint32_t
-TDNFDownloadFile(
+_TDNFDownloadPackageFile(
     PTDNF pTdnf,
+    const char *pszPackageLocation,
+    const char *pszPkgName,
     PTDNF_REPO_DATA pRepo,
-    const char *pszFileUrl,
-    const char *pszFile,
-    const char *pszProgressData
+    PTDNF_PKG_INFO pPkgInfo,
+    const char *pszPackageFile
     )
 {
     uint32_t dwError = 0;
-    CURL *pCurl = NULL;
-    FILE *fp = NULL;
-    char *pszUserPass = NULL;
-    char *pszFileTmp = NULL;
-    /* lStatus reads CURLINFO_RESPONSE_CODE. Must be long */
-    long lStatus = 0;
-    int i;
-    int nNoOutput = 1;
+    char *pszHex = NULL;
+    char *pszChecksum = NULL;
+    char *pszUrl = NULL;
+    int nDone = 0;
 
-    /* TDNFFetchRemoteGPGKey sends pszProgressData as NULL */
-    if(!pTdnf ||
-       !pRepo ||
-       IsNullOrEmptyString(pszFileUrl) ||
-       IsNullOrEmptyString(pszFile))
+    if (!pTdnf->pPlugins)
     {
-        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        dwError = TDNFDownloadPackageFromRepo(pTdnf,
+                                              pRepo,
+                                              pPkgInfo,
+                                              pszPackageLocation,
+                                              pszPackageFile,
+                                              pszPkgName);
         BAIL_ON_TDNF_ERROR(dwError);
+        goto cleanup;
     }
 
-    pCurl = curl_easy_init();
-    if(!pCurl)
+    if (pPkgInfo && pPkgInfo->pbChecksum)
     {
-        dwError = ERROR_TDNF_CURL_INIT;
+        dwError = TDNFDigestToHex(pPkgInfo->pbChecksum,
+                                  pPkgInfo->nChecksumType,
+                                  &pszHex);
         BAIL_ON_TDNF_ERROR(dwError);
-    }
 
-    dwError = TDNFRepoGetUserPass(pTdnf, pRepo, &pszUserPass);
-    BAIL_ON_TDNF_ERROR(dwError);
-
-    if(!IsNullOrEmptyString(pszUserPass))
-    {
-        dwError = curl_easy_setopt(
-                      pCurl,
-                      CURLOPT_USERPWD,
-                      pszUserPass);
+        dwError = TDNFAllocateStringPrintf(&pszChecksum, "%s:%s",
+                      hash_ops[pPkgInfo->nChecksumType].hash_type,
+                      pszHex);
         BAIL_ON_TDNF_ERROR(dwError);
     }
 
-    dwError = TDNFRepoApplyProxySettings(pTdnf->pConf, pCurl);
-    BAIL_ON_TDNF_ERROR(dwError);
-
-    dwError = TDNFRepoApplyDownloadSettings(pRepo, pCurl);
-    BAIL_ON_TDNF_ERROR(dwError);
-
-    dwError = TDNFRepoApplySSLSettings(pRepo, pCurl);
-    BAIL_ON_TDNF_ERROR(dwError);
-
-    dwError = curl_easy_setopt(pCurl, CURLOPT_URL, pszFileUrl);
-    BAIL_ON_TDNF_CURL_ERROR(dwError);
-
-    dwError = curl_easy_setopt(pCurl, CURLOPT_FOLLOWLOCATION, 1L);
-    BAIL_ON_TDNF_CURL_ERROR(dwError);
-
-    if (!pTdnf->pArgs->nQuiet && pszProgressData != NULL)
+    /* anything at pszPackageFile after the event is from a plugin */
+    if (unlink(pszPackageFile) && errno != ENOENT)
     {
-        //print progress only if tty or verbose is specified.
-        if (isatty(STDOUT_FILENO) || pTdnf->pArgs->nVerbose)
-        {
-            dwError = set_progress_cb(pCurl, pszProgressData);
-            BAIL_ON_TDNF_ERROR(dwError);
-            nNoOutput = 0;
-        }
+        dwError = errno;
+        BAIL_ON_TDNF_SYSTEM_ERROR_UNCOND(dwError);
     }
 
-    dwError = TDNFAllocateStringPrintf(&pszFileTmp,
-                                       "%s.tmp",
-                                       pszFile);
+    dwError = _TDNFEventPackageDownloadStart(pTdnf, pRepo,
+                                             pszPackageLocation,
+                                             pszChecksum,
+                                             pszPackageFile,
+                                             &pszUrl);
     BAIL_ON_TDNF_ERROR(dwError);
 
-    for(i = 0; i <= pRepo->nRetries; i++)
-    {
-        fp = fopen(pszFileTmp, "wb");
-        if(!fp)
-        {
-            dwError = errno;
-            BAIL_ON_TDNF_SYSTEM_ERROR_UNCOND(dwError);
-        }
-
-        dwError = curl_easy_setopt(pCurl, CURLOPT_WRITEDATA, fp);
-        BAIL_ON_TDNF_CURL_ERROR(dwError);
-
-        if (i > 0)
-        {
-            pr_info("retrying %d/%d\n", i, pRepo->nRetries);
-        }
-        dwError = curl_easy_perform(pCurl);
-        if (dwError == CURLE_OK)
-        {
-            fclose(fp);
-            fp = NULL;
-            break;
-        }
-        if (i == pRepo->nRetries || TDNFCurlErrorIsFatal(dwError))
-        {
-            BAIL_ON_TDNF_CURL_ERROR(dwError);
-        }
-        fclose(fp);
-        fp = NULL;
-    }
-    /* finish progress line output,
-       but only if progrees was enabled */
-    if (!nNoOutput) {
-        pr_info("\n");
-    }
-
-    dwError = curl_easy_getinfo(pCurl,
-                                CURLINFO_RESPONSE_CODE,
-                                &lStatus);
-    BAIL_ON_TDNF_CURL_ERROR(dwError);
-
-    if(lStatus >= 400)
+    if (access(pszPackageFile, F_OK) == 0)
     {
-        pr_err(
-                "Error: %ld when downloading %s\n. Please check repo url "
-                "or refresh metadata with 'tdnf makecache'.\n",
-                lStatus,
-                pszFileUrl);
-        dwError = ERROR_TDNF_INVALID_PARAMETER;
-        BAIL_ON_TDNF_ERROR(dwError);
+        /* a plugin put it there */
+        nDone = 1;
     }
-    else
+    else if (pszUrl && pszChecksum)
     {
-        if (rename(pszFileTmp, pszFile) == -1)
+        nDone = TDNFDownloadFile(pTdnf, pRepo, pszUrl,
+                                 pszPackageFile, pszPkgName) == 0;
+        if (!nDone)
         {
-            dwError = errno;
-            BAIL_ON_TDNF_SYSTEM_ERROR(dwError);
-        }
-        if (chmod(pszFile, S_IRUSR|S_IWUSR|S_IRGRP|S_IROTH) == -1)
-        {
-            dwError = errno;
-            BAIL_ON_TDNF_SYSTEM_ERROR(dwError);
+            pr_info("could not get %s from %s, trying the repo\n",
+                    pszPkgName, pszUrl);
         }
     }
 
-cleanup:
-    TDNF_SAFE_FREE_MEMORY(pszUserPass);
-    TDNF_SAFE_FREE_MEMORY(pszFileTmp);
-    if(fp)
-    {
-        /* coverity[dead_error_line] */
-        fclose(fp);
-    }
-    if(pCurl)
+    if (nDone && TDNFCheckPackageFile(pszPackageFile, pPkgInfo))
     {
-        curl_easy_cleanup(pCurl);
+        pr_err("%s from plugin does not match repo metadata, "
+               "trying the repo\n", pszPkgName);
+        nDone = 0;
     }
-    return dwError;
 
-error:
-    if(fp)
-    {
-        fclose(fp);
-        fp = NULL;
-    }
-    if(!IsNullOrEmptyString(pszFileTmp))
+    if (!nDone && unlink(pszPackageFile) && errno != ENOENT)
     {
-        unlink(pszFileTmp);
+        dwError = errno;
+        BAIL_ON_TDNF_SYSTEM_ERROR_UNCOND(dwError);
     }
 
-    goto cleanup;
-}
-
-uint32_t
-TDNFCreatePackageUrl(
-    PTDNF pTdnf,
-    const char* pszRepoId,
-    const char* pszPackageLocation,
-    char **ppszPackageUrl
-    )
-{
-    uint32_t dwError = 0;
-    char *pszPackageUrl = NULL;
-    PTDNF_REPO_DATA pRepo = NULL;
-
-    if(!pTdnf ||
-       !pTdnf->pArgs ||
-       IsNullOrEmptyString(pszPackageLocation) ||
-       IsNullOrEmptyString(pszRepoId) ||
-       !ppszPackageUrl)
+    if (!nDone)
     {
-        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        dwError = TDNFDownloadPackageFromRepo(pTdnf,
+                                              pRepo,
+                                              pPkgInfo,
+                                              pszPackageLocation,
+                                              pszPackageFile,
+                                              pszPkgName);
         BAIL_ON_TDNF_ERROR(dwError);
     }
 
-    dwError = TDNFFindRepoById(pTdnf, pszRepoId, &pRepo);
+    dwError = _TDNFEventPackageDownloadEnd(pTdnf, pRepo,
+                                           pszPackageLocation,
+                                           pszChecksum,
+                                           pszPackageFile);
     BAIL_ON_TDNF_ERROR(dwError);
 
-    if (pRepo->ppszBaseUrls && pRepo->ppszBaseUrls[0]) {
-        dwError = TDNFJoinPath(&pszPackageUrl, pRepo->ppszBaseUrls[0], pszPackageLocation, NULL);
-        BAIL_ON_TDNF_ERROR(dwError);
-    }
-    else
-    {
-        dwError = TDNFAllocateString(pszPackageLocation, &pszPackageUrl);
-        BAIL_ON_TDNF_ERROR(dwError);
-    }
-    *ppszPackageUrl = pszPackageUrl;
-
 cleanup:
+    TDNF_SAFE_FREE_MEMORY(pszHex);
+    TDNF_SAFE_FREE_MEMORY(pszChecksum);
+    TDNF_SAFE_FREE_MEMORY(pszUrl);
     return dwError;
+
 error:
-    TDNF_SAFE_FREE_MEMORY(pszPackageUrl);
     goto cleanup;
 }
 
@@ -367,6 +1235,7 @@ TDNFDownloadPackage(
     const char* pszPackageLocation,
     const char* pszPkgName,
     PTDNF_REPO_DATA pRepo,
+    PTDNF_PKG_INFO pPkgInfo,
     const char* pszRpmCacheDir
     )
 {
@@ -400,11 +1269,12 @@ TDNFDownloadPackage(
     dwError = TDNFGetFileSize(pszPackageFile, &nSize);
     if ((dwError == ERROR_TDNF_FILE_NOT_FOUND) || (nSize == 0))
     {
-        dwError = TDNFDownloadFileFromRepo(pTdnf,
-                                   pRepo,
-                                   pszPackageLocation,
-                                   pszPackageFile,
-                                   pszPkgName);
+        dwError = _TDNFDownloadPackageFile(pTdnf,
+                                           pszPackageLocation,
+                                           pszPkgName,
+                                           pRepo,
+                                           pPkgInfo,
+                                           pszPackageFile);
     }
     else if(dwError == 0)
     {
@@ -427,6 +1297,7 @@ TDNFDownloadPackageToCache(
     const char* pszPackageLocation,
     const char* pszPkgName,
     PTDNF_REPO_DATA pRepo,
+    PTDNF_PKG_INFO pPkgInfo,
     char** ppszFilePath
     )
 {
@@ -459,9 +1330,13 @@ TDNFDownloadPackageToCache(
                                         pszPackageLocation,
                                         pszPkgName,
                                         pRepo,
+                                        pPkgInfo,
                                         pszNormalRpmCacheDir,
                                         ppszFilePath);
     BAIL_ON_TDNF_ERROR(dwError);
+
+    /* the record only orders eviction for cache_budget */
+    TDNFCacheRecordAccess(pTdnf, *ppszFilePath);
 cleanup:
     TDNF_SAFE_FREE_MEMORY(pszNormalRpmCacheDir);
     TDNF_SAFE_FREE_MEMORY(pszRpmCacheDir);
@@ -471,34 +1346,75 @@ error:
 }
 
 /*
- * TDNFDownloadPackageToTree()
+ * TDNFGetPackageCachePath()
  *
- * Download a package while preserving the directory path. For example,
- * if pszPackageLocation is "RPMS/x86_64/foo-1.2-3.rpm", the destination will
- * be downloaded under the destination directory in RPMS/x86_64/foo-1.2-3.rpm
- * (so 'RPMS/x86_64/' will be preserved).
+ * Get the path TDNFDownloadPackageToCache() downloads a package to.
 */
 
 uint32_t
-TDNFDownloadPackageToTree(
+TDNFGetPackageCachePath(
     PTDNF pTdnf,
     const char* pszPackageLocation,
-    const char* pszPkgName,
     PTDNF_REPO_DATA pRepo,
-    char* pszNormalRpmCacheDir,
     char** ppszFilePath
     )
 {
     uint32_t dwError = 0;
-    char* pszFilePath = NULL;
-    char* pszNormalPath = NULL;
-    char* pszDownloadCacheDir = NULL;
-    char* pszRemotePath = NULL;
+    char* pszRpmCacheDir = NULL;
+    char* pszNormalRpmCacheDir = NULL;
 
     if(!pTdnf ||
        IsNullOrEmptyString(pszPackageLocation) ||
-       IsNullOrEmptyString(pszPkgName) ||
        !pRepo ||
+       !ppszFilePath)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    dwError = TDNFJoinPath(&pszRpmCacheDir,
+                           pTdnf->pConf->pszCacheDir,
+                           pRepo->pszId,
+                           "rpms",
+                           NULL);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFNormalizePath(pszRpmCacheDir,
+                                &pszNormalRpmCacheDir);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFGetPackageTreePath(pszPackageLocation,
+                                     pszNormalRpmCacheDir,
+                                     ppszFilePath);
+    BAIL_ON_TDNF_ERROR(dwError);
+cleanup:
+    TDNF_SAFE_FREE_MEMORY(pszNormalRpmCacheDir);
+    TDNF_SAFE_FREE_MEMORY(pszRpmCacheDir);
+    return dwError;
+error:
+    goto cleanup;
+}
+
+/*
+ * TDNFGetPackageTreePath()
+ *
+ * Get the path a package is downloaded to by TDNFDownloadPackageToTree().
+ * Fails if the location would leave pszNormalRpmCacheDir.
+*/
+
+uint32_t
+TDNFGetPackageTreePath(
+    const char* pszPackageLocation,
+    const char* pszNormalRpmCacheDir,
+    char** ppszFilePath
+    )
+{
+    uint32_t dwError = 0;
+    char* pszFilePath = NULL;
+    char* pszNormalPath = NULL;
+    char* pszRemotePath = NULL;
+
+    if(IsNullOrEmptyString(pszPackageLocation) ||
        IsNullOrEmptyString(pszNormalRpmCacheDir) ||
        !ppszFilePath)
     {
@@ -528,6 +1444,57 @@ TDNFDownloadPackageToTree(
         BAIL_ON_TDNF_ERROR(dwError);
     }
 
+    *ppszFilePath = pszNormalPath;
+cleanup:
+    TDNF_SAFE_FREE_MEMORY(pszFilePath);
+    TDNF_SAFE_FREE_MEMORY(pszRemotePath);
+    return dwError;
+
+error:
+    TDNF_SAFE_FREE_MEMORY(pszNormalPath);
+    goto cleanup;
+}
+
+/*
+ * TDNFDownloadPackageToTree()
+ *
+ * Download a package while preserving the directory path. For example,
+ * if pszPackageLocation is "RPMS/x86_64/foo-1.2-3.rpm", the destination will
+ * be downloaded under the destination directory in RPMS/x86_64/foo-1.2-3.rpm
+ * (so 'RPMS/x86_64/' will be preserved).
+*/
+
+uint32_t
+TDNFDownloadPackageToTree(
+    PTDNF pTdnf,
+    const char* pszPackageLocation,
+    const char* pszPkgName,
+    PTDNF_REPO_DATA pRepo,
+    PTDNF_PKG_INFO pPkgInfo,
+    char* pszNormalRpmCacheDir,
+    char** ppszFilePath
+    )
+{
+    uint32_t dwError = 0;
+    char* pszNormalPath = NULL;
+    char* pszDownloadCacheDir = NULL;
+
+    if(!pTdnf ||
+       IsNullOrEmptyString(pszPackageLocation) ||
+       IsNullOrEmptyString(pszPkgName) ||
+       !pRepo ||
+       IsNullOrEmptyString(pszNormalRpmCacheDir) ||
+       !ppszFilePath)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    dwError = TDNFGetPackageTreePath(pszPackageLocation,
+                                     pszNormalRpmCacheDir,
+                                     &pszNormalPath);
+    BAIL_ON_TDNF_ERROR(dwError);
+
     dwError = TDNFDirName(pszNormalPath, &pszDownloadCacheDir);
     BAIL_ON_TDNF_ERROR(dwError);
 
@@ -551,15 +1518,13 @@ TDNFDownloadPackageToTree(
             BAIL_ON_TDNF_SYSTEM_ERROR(dwError);
         }
         dwError = TDNFDownloadPackage(pTdnf, pszPackageLocation, pszPkgName,
-            pRepo, pszDownloadCacheDir);
+            pRepo, pPkgInfo, pszDownloadCacheDir);
         BAIL_ON_TDNF_ERROR(dwError);
     }
 
     *ppszFilePath = pszNormalPath;
 cleanup:
-    TDNF_SAFE_FREE_MEMORY(pszFilePath);
     TDNF_SAFE_FREE_MEMORY(pszDownloadCacheDir);
-    TDNF_SAFE_FREE_MEMORY(pszRemotePath);
     return dwError;
 
 error:
@@ -583,6 +1548,7 @@ TDNFDownloadPackageToDirectory(
     const char* pszPackageLocation,
     const char* pszPkgName,
     PTDNF_REPO_DATA pRepo,
+    PTDNF_PKG_INFO pPkgInfo,
     const char* pszDirectory,
     char** ppszFilePath
     )
@@ -616,7 +1582,7 @@ TDNFDownloadPackageToDirectory(
     BAIL_ON_TDNF_ERROR(dwError);
 
     dwError = TDNFDownloadPackage(pTdnf, pszPackageLocation, pszPkgName,
-                                  pRepo, pszDirectory);
+                                  pRepo, pPkgInfo, pszDirectory);
     BAIL_ON_TDNF_ERROR(dwError);
 
     *ppszFilePath = pszFilePath;
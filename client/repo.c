@@ -67,6 +67,7 @@ TDNFInitRepo(
     }
     pSolvRepoInfo->pRepo = pRepo;
     pSolvRepoInfo->pszRepoCacheDir = pszRepoCacheDir;
+    pSolvRepoInfo->nZstdLevel = pTdnf->pConf->nSolvCacheZstdLevel;
     pRepo->appdata = pSolvRepoInfo;
 
     if (pRepoData->nHasMetaData) {
@@ -345,10 +345,12 @@ TDNFCreateRepo(
     pRepo->nTimeout = TDNF_REPO_DEFAULT_TIMEOUT;
     pRepo->nMinrate = TDNF_REPO_DEFAULT_MINRATE;
     pRepo->nThrottle = TDNF_REPO_DEFAULT_THROTTLE;
+    pRepo->nStallTimeout = TDNF_REPO_DEFAULT_STALL_TIMEOUT;
     pRepo->nRetries = TDNF_REPO_DEFAULT_RETRIES;
     pRepo->nSkipMDFileLists = TDNF_REPO_DEFAULT_SKIP_MD_FILELISTS;
     pRepo->nSkipMDUpdateInfo = TDNF_REPO_DEFAULT_SKIP_MD_UPDATEINFO;
     pRepo->nSkipMDOther = TDNF_REPO_DEFAULT_SKIP_MD_OTHER;
+    pRepo->nHttp2PriorKnowledge = TDNF_REPO_DEFAULT_HTTP2_PRIOR_KNOWLEDGE;
 
     *ppRepo = pRepo;
 cleanup:
@@ -549,6 +551,10 @@ TDNFLoadReposFromFile(
             {
                 pRepo->nThrottle = strtoi(cn->value);
             }
+            else if (strcmp(cn->name, TDNF_REPO_KEY_STALL_TIMEOUT) == 0)
+            {
+                pRepo->nStallTimeout = strtoi(cn->value);
+            }
             else if (strcmp(cn->name, TDNF_REPO_KEY_SSL_VERIFY) == 0)
             {
                 pRepo->nSSLVerify = isTrue(cn->value);
@@ -584,6 +590,10 @@ TDNFLoadReposFromFile(
             {
                 pRepo->nSkipMDOther = isTrue(cn->value);
             }
+            else if (strcmp(cn->name, TDNF_REPO_KEY_HTTP2_PRIOR_KNOWLEDGE) == 0)
+            {
+                pRepo->nHttp2PriorKnowledge = isTrue(cn->value);
+            }
         }
         /* plugin event repo readconfig end */
         dwError = TDNFEventRepoReadConfigEnd(pTdnf, cn_section);
@@ -0,0 +1,929 @@
+/*
+ * Copyright (C) 2023 VMware, Inc. All Rights Reserved.
+ *
+ * Licensed under the GNU Lesser General Public License v2.1 (the "License");
+ * you may not use this file except in compliance with the License. The terms
+ * of the License are located in the COPYING file of this distribution.
+ */
+
+/*
+ * Package downloads for reposync. Packages are fetched and verified
+ * by a pool of worker threads. A file that is already in the tree
+ * is only kept if its size and checksum match the metadata. So that
+ * a mirror is not hashed completely on each run, digests are kept in
+ * the result cache with the size and mtime of the file they were
+ * computed from.
+ */
+
+#include "includes.h"
+
+static
+int
+_TDNFFileDigestCmp(
+    const void *p1,
+    const void *p2
+    )
+{
+    return strcmp(((PTDNF_FILE_DIGEST)p1)->pszPath,
+                  ((PTDNF_FILE_DIGEST)p2)->pszPath);
+}
+
+static
+int
+_TDNFFileDigestMatchesStat(
+    PTDNF_FILE_DIGEST pDigest,
+    struct stat *pStat
+    )
+{
+    return pDigest->qwSize == (uint64_t)pStat->st_size &&
+           pDigest->llMTimeSec == (int64_t)pStat->st_mtim.tv_sec &&
+           pDigest->lMTimeNSec == pStat->st_mtim.tv_nsec;
+}
+
+/*
+ * Get the digest of pJob's file, from the cache if size and
+ * mtime are unchanged. A computed digest is kept in the job
+ * so it can be saved for the next run.
+ */
+static
+uint32_t
+_TDNFRepoSyncHashFile(
+    PTDNF_REPOSYNC_CONTEXT pCtx,
+    PTDNF_REPOSYNC_JOB pJob,
+    struct stat *pStat,
+    const char **ppszDigest
+    )
+{
+    uint32_t dwError = 0;
+    TDNF_FILE_DIGEST key = {0};
+    PTDNF_FILE_DIGEST pCached = NULL;
+    PTDNF_FILE_DIGEST pDigest = &pJob->digest;
+    int nHashType = pJob->pPkgInfo->nChecksumType;
+    uint8_t digest[EVP_MAX_MD_SIZE] = {0};
+
+    key.pszPath = pJob->pszFilePath;
+    if (pCtx->dwDigestCount > 0)
+    {
+        pCached = bsearch(&key, pCtx->pDigests, pCtx->dwDigestCount,
+                          sizeof(TDNF_FILE_DIGEST), _TDNFFileDigestCmp);
+    }
+    if (pCached &&
+        pCached->nHashType == nHashType &&
+        _TDNFFileDigestMatchesStat(pCached, pStat))
+    {
+        *ppszDigest = pCached->pszDigest;
+        goto cleanup;
+    }
+
+    dwError = TDNFGetDigestForFile(pJob->pszFilePath,
+                                   hash_ops + nHashType,
+                                   digest);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    TDNF_SAFE_FREE_MEMORY(pDigest->pszDigest);
+    TDNF_SAFE_FREE_MEMORY(pDigest->pszPath);
+
+    dwError = TDNFDigestToHex(digest, nHashType, &pDigest->pszDigest);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFAllocateString(pJob->pszFilePath, &pDigest->pszPath);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    pDigest->qwSize = pStat->st_size;
+    pDigest->llMTimeSec = pStat->st_mtim.tv_sec;
+    pDigest->lMTimeNSec = pStat->st_mtim.tv_nsec;
+    pDigest->nHashType = nHashType;
+
+    *ppszDigest = pDigest->pszDigest;
+
+cleanup:
+    return dwError;
+
+error:
+    TDNF_SAFE_FREE_MEMORY(pDigest->pszPath);
+    TDNF_SAFE_FREE_MEMORY(pDigest->pszDigest);
+    goto cleanup;
+}
+
+/*
+ * Record pszDigest as the digest of pJob's file without hashing it,
+ * so the next run finds it in the cache.
+ */
+static
+uint32_t
+_TDNFRepoSyncTrustFile(
+    PTDNF_REPOSYNC_JOB pJob,
+    struct stat *pStat,
+    const char *pszDigest
+    )
+{
+    uint32_t dwError = 0;
+    PTDNF_FILE_DIGEST pDigest = &pJob->digest;
+
+    TDNF_SAFE_FREE_MEMORY(pDigest->pszDigest);
+    TDNF_SAFE_FREE_MEMORY(pDigest->pszPath);
+
+    dwError = TDNFAllocateString(pszDigest, &pDigest->pszDigest);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFAllocateString(pJob->pszFilePath, &pDigest->pszPath);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    pDigest->qwSize = pStat->st_size;
+    pDigest->llMTimeSec = pStat->st_mtim.tv_sec;
+    pDigest->lMTimeNSec = pStat->st_mtim.tv_nsec;
+    pDigest->nHashType = pJob->pPkgInfo->nChecksumType;
+
+cleanup:
+    return dwError;
+
+error:
+    TDNF_SAFE_FREE_MEMORY(pDigest->pszPath);
+    TDNF_SAFE_FREE_MEMORY(pDigest->pszDigest);
+    goto cleanup;
+}
+
+/*
+ * A repo whose base urls are all file:// urls. Its packages are
+ * copied from the files the metadata was made from.
+ */
+static
+int
+_TDNFRepoSyncIsLocalRepo(
+    PTDNF_REPO_DATA pRepo
+    )
+{
+    int i;
+
+    if (!pRepo->ppszBaseUrls || !pRepo->ppszBaseUrls[0])
+    {
+        return 0;
+    }
+    for (i = 0; pRepo->ppszBaseUrls[i]; i++)
+    {
+        if (strncasecmp(pRepo->ppszBaseUrls[i], "file://", 7))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+ * Check the file of pJob against size and checksum from the
+ * metadata. Returns ERROR_TDNF_FILE_NOT_FOUND if there is no
+ * file, ERROR_TDNF_SIZE_MISMATCH or ERROR_TDNF_CHECKSUM_MISMATCH
+ * if it differs. With nTrusted, the file was just copied from a
+ * source that is trusted to match the metadata, so only the size
+ * is checked and the checksum is recorded without hashing.
+ */
+static
+uint32_t
+_TDNFRepoSyncVerify(
+    PTDNF_REPOSYNC_CONTEXT pCtx,
+    PTDNF_REPOSYNC_JOB pJob,
+    int nTrusted
+    )
+{
+    uint32_t dwError = 0;
+    PTDNF_PKG_INFO pPkgInfo = pJob->pPkgInfo;
+    struct stat st = {0};
+    char *pszExpected = NULL;
+    const char *pszDigest = NULL;
+
+    if (stat(pJob->pszFilePath, &st))
+    {
+        dwError = errno == ENOENT ? ERROR_TDNF_FILE_NOT_FOUND :
+                                    ERROR_TDNF_SYSTEM_BASE + errno;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    if (pPkgInfo->dwDownloadSizeBytes &&
+        (uint64_t)st.st_size != pPkgInfo->dwDownloadSizeBytes)
+    {
+        dwError = ERROR_TDNF_SIZE_MISMATCH;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    if (pPkgInfo->pbChecksum)
+    {
+        dwError = TDNFDigestToHex(pPkgInfo->pbChecksum,
+                                  pPkgInfo->nChecksumType,
+                                  &pszExpected);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        if (nTrusted)
+        {
+            dwError = _TDNFRepoSyncTrustFile(pJob, &st, pszExpected);
+            BAIL_ON_TDNF_ERROR(dwError);
+            goto cleanup;
+        }
+
+        dwError = _TDNFRepoSyncHashFile(pCtx, pJob, &st, &pszDigest);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        if (strcmp(pszDigest, pszExpected))
+        {
+            dwError = ERROR_TDNF_CHECKSUM_MISMATCH;
+            BAIL_ON_TDNF_ERROR(dwError);
+        }
+    }
+
+cleanup:
+    TDNF_SAFE_FREE_MEMORY(pszExpected);
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+static
+int
+_TDNFRepoSyncIsRepoTrusted(
+    PTDNF_REPOSYNC_CONTEXT pCtx,
+    PTDNF_REPO_DATA pRepo
+    )
+{
+    uint32_t i;
+    int nTrusted = 0;
+
+    pthread_mutex_lock(&pCtx->mutex);
+    for (i = 0; i < pCtx->dwTrustedCount && !nTrusted; i++)
+    {
+        nTrusted = pCtx->ppTrustedRepos[i] == pRepo;
+    }
+    pthread_mutex_unlock(&pCtx->mutex);
+
+    return nTrusted;
+}
+
+static
+void
+_TDNFRepoSyncSetRepoTrusted(
+    PTDNF_REPOSYNC_CONTEXT pCtx,
+    PTDNF_REPO_DATA pRepo
+    )
+{
+    pthread_mutex_lock(&pCtx->mutex);
+    pCtx->ppTrustedRepos[pCtx->dwTrustedCount++] = pRepo;
+    pthread_mutex_unlock(&pCtx->mutex);
+}
+
+/*
+ * Importing a key may prompt the user. So packages of a repo are
+ * checked one at a time until one passed, after that its keys are
+ * in the keyring shared by all workers.
+ */
+static
+uint32_t
+_TDNFRepoSyncGPGCheck(
+    PTDNF_REPOSYNC_CONTEXT pCtx,
+    PTDNFRPMTS pTS,
+    PTDNF_REPOSYNC_JOB pJob
+    )
+{
+    uint32_t dwError = 0;
+    int nLocked = 0;
+
+    if (!_TDNFRepoSyncIsRepoTrusted(pCtx, pJob->pRepo))
+    {
+        pthread_mutex_lock(&pCtx->mutexGPG);
+        nLocked = 1;
+    }
+
+    dwError = TDNFGPGCheckPackage(pTS, pCtx->pTdnf, pJob->pRepo,
+                                  pJob->pszFilePath, NULL);
+
+    if (nLocked)
+    {
+        /* another worker may have marked it while we waited */
+        if (dwError == 0 &&
+            !_TDNFRepoSyncIsRepoTrusted(pCtx, pJob->pRepo))
+        {
+            _TDNFRepoSyncSetRepoTrusted(pCtx, pJob->pRepo);
+        }
+        pthread_mutex_unlock(&pCtx->mutexGPG);
+    }
+
+    return dwError;
+}
+
+static
+void
+_TDNFRepoSyncAddStoreBytes(
+    PTDNF_REPOSYNC_CONTEXT pCtx,
+    uint64_t qwBytes
+    )
+{
+    pthread_mutex_lock(&pCtx->mutex);
+    pCtx->qwStoreBytes += qwBytes;
+    pthread_mutex_unlock(&pCtx->mutex);
+}
+
+static
+uint32_t
+_TDNFRepoSyncPackage(
+    PTDNF_REPOSYNC_CONTEXT pCtx,
+    PTDNFRPMTS pTS,
+    PTDNF_REPOSYNC_JOB pJob
+    )
+{
+    uint32_t dwError = 0;
+    uint64_t qwBytes = 0;
+
+    dwError = _TDNFRepoSyncVerify(pCtx, pJob, 0);
+    if (dwError == ERROR_TDNF_SIZE_MISMATCH ||
+        dwError == ERROR_TDNF_CHECKSUM_MISMATCH)
+    {
+        pr_info("%s does not match the metadata, downloading again\n",
+                pJob->pszFilePath);
+    }
+    if (dwError == ERROR_TDNF_FILE_NOT_FOUND ||
+        dwError == ERROR_TDNF_SIZE_MISMATCH ||
+        dwError == ERROR_TDNF_CHECKSUM_MISMATCH)
+    {
+        /* the store checks the entry, so no need to verify again */
+        dwError = TDNFPackageStoreFetch(pCtx->pTdnf, pJob->pPkgInfo,
+                                        pJob->pszFilePath, &qwBytes);
+        if (dwError == 0)
+        {
+            _TDNFRepoSyncAddStoreBytes(pCtx, qwBytes);
+            pr_info("%s taken from the package store\n",
+                    pJob->pPkgInfo->pszLocation);
+        }
+        else
+        {
+            /* no progress output, it would be garbled by the other workers */
+            dwError = TDNFDownloadPackageFromRepo(pCtx->pTdnf,
+                                                  pJob->pRepo,
+                                                  pJob->pPkgInfo,
+                                                  pJob->pPkgInfo->pszLocation,
+                                                  pJob->pszFilePath,
+                                                  NULL);
+            BAIL_ON_TDNF_ERROR(dwError);
+
+            dwError = _TDNFRepoSyncVerify(pCtx, pJob,
+                                          _TDNFRepoSyncIsLocalRepo(pJob->pRepo));
+            if (dwError == ERROR_TDNF_SIZE_MISMATCH ||
+                dwError == ERROR_TDNF_CHECKSUM_MISMATCH)
+            {
+                pr_err("rpm file (%s) does not match the metadata (%s mismatch)\n",
+                       pJob->pszFilePath,
+                       dwError == ERROR_TDNF_SIZE_MISMATCH ? "size" : "digest");
+                if (remove(pJob->pszFilePath) < 0)
+                {
+                    pr_err("unable to remove %s: %s\n",
+                           pJob->pszFilePath, strerror(errno));
+                }
+            }
+            BAIL_ON_TDNF_ERROR(dwError);
+
+            pr_info("%s downloaded\n", pJob->pPkgInfo->pszLocation);
+        }
+    }
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    /* if gpgcheck option is given, check for a valid signature. If that fails,
+       delete the package */
+    if (pCtx->pReposyncArgs->nGPGCheck)
+    {
+        dwError = _TDNFRepoSyncGPGCheck(pCtx, pTS, pJob);
+        if (dwError == RPMRC_NOTTRUSTED || dwError == RPMRC_NOKEY)
+        {
+            pr_crit("checking package %s failed: %d, deleting\n",
+                    pJob->pszFilePath, dwError);
+            if (remove(pJob->pszFilePath) < 0)
+            {
+                pr_crit("unable to remove %s: %s\n",
+                        pJob->pszFilePath, strerror(errno));
+            }
+            dwError = 0;
+            goto cleanup;
+        }
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    pJob->nKeep = 1;
+
+    /* a file that cannot be stored is still synced */
+    if (TDNFPackageStoreAdd(pCtx->pTdnf, pJob->pPkgInfo,
+                            pJob->pszFilePath, &qwBytes) == 0)
+    {
+        _TDNFRepoSyncAddStoreBytes(pCtx, qwBytes);
+    }
+
+cleanup:
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+static
+PTDNF_REPOSYNC_JOB
+_TDNFRepoSyncNextJob(
+    PTDNF_REPOSYNC_CONTEXT pCtx
+    )
+{
+    PTDNF_REPOSYNC_JOB pJob = NULL;
+
+    pthread_mutex_lock(&pCtx->mutex);
+    if (!pCtx->dwError && pCtx->dwNextJob < pCtx->dwJobCount)
+    {
+        pJob = &pCtx->pJobs[pCtx->dwNextJob++];
+    }
+    pthread_mutex_unlock(&pCtx->mutex);
+
+    return pJob;
+}
+
+static
+void *
+_TDNFRepoSyncWorker(
+    void *pArg
+    )
+{
+    uint32_t dwError = 0;
+    PTDNF_REPOSYNC_CONTEXT pCtx = (PTDNF_REPOSYNC_CONTEXT)pArg;
+    PTDNF_REPOSYNC_JOB pJob = NULL;
+    TDNFRPMTS ts = {0};
+
+    if (pCtx->pKeyring)
+    {
+        ts.pTS = rpmtsCreate();
+        if(!ts.pTS)
+        {
+            dwError = ERROR_TDNF_RPMTS_CREATE_FAILED;
+            BAIL_ON_TDNF_ERROR(dwError);
+        }
+        rpmtsSetKeyring(ts.pTS, pCtx->pKeyring);
+    }
+
+    while ((pJob = _TDNFRepoSyncNextJob(pCtx)) != NULL)
+    {
+        dwError = _TDNFRepoSyncPackage(pCtx, &ts, pJob);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+cleanup:
+    if (ts.pTS)
+    {
+        rpmtsFree(ts.pTS);
+    }
+    return NULL;
+
+error:
+    pthread_mutex_lock(&pCtx->mutex);
+    if (!pCtx->dwError)
+    {
+        pCtx->dwError = dwError;
+    }
+    pthread_mutex_unlock(&pCtx->mutex);
+    goto cleanup;
+}
+
+/*
+ * Save the digests computed in this run together with those from
+ * earlier runs that still match their file. Errors are not fatal,
+ * the files will be hashed again next time.
+ */
+static
+uint32_t
+_TDNFRepoSyncSaveDigests(
+    PTDNF_REPOSYNC_CONTEXT pCtx
+    )
+{
+    uint32_t dwError = 0;
+    PTDNF_FILE_DIGEST pDigests = NULL;
+    PTDNF_FILE_DIGEST pNew = NULL;
+    uint32_t dwCount = 0;
+    uint32_t dwNewCount = 0;
+    uint32_t i;
+    struct stat st = {0};
+
+    dwError = TDNFAllocateMemory(pCtx->dwDigestCount + pCtx->dwJobCount + 1,
+                                 sizeof(TDNF_FILE_DIGEST),
+                                 (void **)&pDigests);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    /* shallow copies, the strings stay with the jobs */
+    for (i = 0; i < pCtx->dwJobCount; i++)
+    {
+        if (pCtx->pJobs[i].digest.pszDigest)
+        {
+            pDigests[dwNewCount++] = pCtx->pJobs[i].digest;
+        }
+    }
+    qsort(pDigests, dwNewCount, sizeof(TDNF_FILE_DIGEST), _TDNFFileDigestCmp);
+    pNew = pDigests;
+    dwCount = dwNewCount;
+
+    for (i = 0; i < pCtx->dwDigestCount; i++)
+    {
+        PTDNF_FILE_DIGEST pOld = &pCtx->pDigests[i];
+
+        if (dwNewCount &&
+            bsearch(pOld, pNew, dwNewCount, sizeof(TDNF_FILE_DIGEST),
+                    _TDNFFileDigestCmp))
+        {
+            continue;
+        }
+        /* drop files that were removed or changed */
+        if (stat(pOld->pszPath, &st) || !_TDNFFileDigestMatchesStat(pOld, &st))
+        {
+            continue;
+        }
+        pDigests[dwCount++] = *pOld;
+    }
+
+    dwError = TDNFResultCacheWriteFileDigests(pCtx->pTdnf, pDigests, dwCount);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+cleanup:
+    TDNF_SAFE_FREE_MEMORY(pDigests);
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+/*
+ * Download the packages of pJobs to their pszFilePath using
+ * pReposyncArgs->nWorkers threads. Files already present are
+ * verified and downloaded again if they do not match. Jobs that
+ * passed all checks get nKeep set.
+ */
+uint32_t
+TDNFRepoSyncPackages(
+    PTDNF pTdnf,
+    PTDNF_REPOSYNC_ARGS pReposyncArgs,
+    PTDNF_REPOSYNC_JOB pJobs,
+    uint32_t dwJobCount
+    )
+{
+    uint32_t dwError = 0;
+    TDNF_REPOSYNC_CONTEXT ctx = {0};
+    rpmts pTS = NULL;
+    pthread_t *pThreads = NULL;
+    PTDNF_REPO_DATA pRepo = NULL;
+    uint32_t dwRepoCount = 0;
+    int nWorkers = 0;
+    int nStarted = 0;
+    int nHasChecksums = 0;
+    int i;
+
+    if (!pTdnf || !pReposyncArgs || (dwJobCount && !pJobs))
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    if (dwJobCount == 0)
+    {
+        goto cleanup;
+    }
+
+    ctx.pTdnf = pTdnf;
+    ctx.pReposyncArgs = pReposyncArgs;
+    ctx.pJobs = pJobs;
+    ctx.dwJobCount = dwJobCount;
+    pthread_mutex_init(&ctx.mutex, NULL);
+    pthread_mutex_init(&ctx.mutexGPG, NULL);
+
+    for (i = 0; (uint32_t)i < dwJobCount && !nHasChecksums; i++)
+    {
+        nHasChecksums = pJobs[i].pPkgInfo->pbChecksum != NULL;
+    }
+
+    /* a missing or broken cache just means hashing everything */
+    if (nHasChecksums &&
+        TDNFResultCacheReadFileDigests(pTdnf,
+                                       &ctx.pDigests,
+                                       &ctx.dwDigestCount) == 0)
+    {
+        qsort(ctx.pDigests, ctx.dwDigestCount, sizeof(TDNF_FILE_DIGEST),
+              _TDNFFileDigestCmp);
+    }
+
+    if (pReposyncArgs->nGPGCheck)
+    {
+        pTS = rpmtsCreate();
+        if(!pTS)
+        {
+            dwError = ERROR_TDNF_RPMTS_CREATE_FAILED;
+            BAIL_ON_TDNF_ERROR(dwError);
+        }
+        ctx.pKeyring = rpmtsGetKeyring(pTS, 1);
+
+        for (pRepo = pTdnf->pRepos; pRepo; pRepo = pRepo->pNext)
+        {
+            dwRepoCount++;
+        }
+        dwError = TDNFAllocateMemory(dwRepoCount + 1,
+                                     sizeof(PTDNF_REPO_DATA),
+                                     (void **)&ctx.ppTrustedRepos);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    nWorkers = pReposyncArgs->nWorkers > 0 ? pReposyncArgs->nWorkers :
+                                             TDNF_REPOSYNC_DEFAULT_WORKERS;
+    if (nWorkers > TDNF_REPOSYNC_MAX_WORKERS)
+    {
+        nWorkers = TDNF_REPOSYNC_MAX_WORKERS;
+    }
+    if ((uint32_t)nWorkers > dwJobCount)
+    {
+        nWorkers = dwJobCount;
+    }
+
+    dwError = TDNFAllocateMemory(nWorkers, sizeof(pthread_t),
+                                 (void **)&pThreads);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    for (nStarted = 0; nStarted < nWorkers; nStarted++)
+    {
+        if (pthread_create(&pThreads[nStarted], NULL,
+                           _TDNFRepoSyncWorker, &ctx))
+        {
+            break;
+        }
+    }
+
+    /* go on with fewer workers, as long as there is one */
+    if (nStarted == 0)
+    {
+        dwError = ERROR_TDNF_SYSTEM_BASE + EAGAIN;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    for (i = 0; i < nStarted; i++)
+    {
+        pthread_join(pThreads[i], NULL);
+    }
+
+    if (nHasChecksums)
+    {
+        _TDNFRepoSyncSaveDigests(&ctx);
+    }
+
+    TDNFPackageStoreReport(ctx.qwStoreBytes);
+
+    dwError = ctx.dwError;
+    BAIL_ON_TDNF_ERROR(dwError);
+
+cleanup:
+    if (ctx.pJobs)
+    {
+        pthread_mutex_destroy(&ctx.mutex);
+        pthread_mutex_destroy(&ctx.mutexGPG);
+    }
+    if (ctx.pKeyring)
+    {
+        rpmKeyringFree(ctx.pKeyring);
+    }
+    if (pTS)
+    {
+        rpmtsFree(pTS);
+    }
+    TDNFFreeFileDigests(ctx.pDigests, ctx.dwDigestCount);
+    TDNF_SAFE_FREE_MEMORY(ctx.ppTrustedRepos);
+    TDNF_SAFE_FREE_MEMORY(pThreads);
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+void
+TDNFFreeRepoSyncJobs(
+    PTDNF_REPOSYNC_JOB pJobs,
+    uint32_t dwJobCount
+    )
+{
+    uint32_t i;
+
+    if (pJobs)
+    {
+        for (i = 0; i < dwJobCount; i++)
+        {
+            TDNF_SAFE_FREE_MEMORY(pJobs[i].pszFilePath);
+            TDNF_SAFE_FREE_MEMORY(pJobs[i].digest.pszPath);
+            TDNF_SAFE_FREE_MEMORY(pJobs[i].digest.pszDigest);
+        }
+        TDNFFreeMemory(pJobs);
+    }
+}
+
+/*
+ * Lock pszDir for a reposync with norepopath, waiting for another
+ * one that uses it. Without the repo name in the path the files of
+ * different repos would overwrite each other.
+ */
+uint32_t
+TDNFRepoSyncLockDir(
+    const char *pszDir,
+    int *pnLockFd
+    )
+{
+    uint32_t dwError = 0;
+    char *pszLockFile = NULL;
+    int fd = -1;
+
+    if (IsNullOrEmptyString(pszDir) || !pnLockFd)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    dwError = TDNFJoinPath(&pszLockFile, pszDir,
+                           TDNF_REPOSYNC_LOCK_FILE_NAME, NULL);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    fd = open(pszLockFile, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        dwError = errno;
+        BAIL_ON_TDNF_SYSTEM_ERROR(dwError);
+    }
+
+    if (flock(fd, LOCK_EX | LOCK_NB))
+    {
+        if (errno != EWOULDBLOCK)
+        {
+            dwError = errno;
+            BAIL_ON_TDNF_SYSTEM_ERROR(dwError);
+        }
+        pr_info("waiting for another reposync into %s\n", pszDir);
+        if (flock(fd, LOCK_EX))
+        {
+            dwError = errno;
+            BAIL_ON_TDNF_SYSTEM_ERROR(dwError);
+        }
+    }
+
+    *pnLockFd = fd;
+    fd = -1;
+
+cleanup:
+    TDNF_SAFE_FREE_MEMORY(pszLockFile);
+    return dwError;
+
+error:
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+    goto cleanup;
+}
+
+void
+TDNFRepoSyncUnlockDir(
+    int nLockFd
+    )
+{
+    if (nLockFd >= 0)
+    {
+        flock(nLockFd, LOCK_UN);
+        close(nLockFd);
+    }
+}
+
+static
+uint32_t
+_TDNFRepoSyncDeleteWalk(
+    Stringpool *pKeep,
+    const char *pszDir
+    )
+{
+    uint32_t dwError = 0;
+    DIR *pDir = NULL;
+    struct dirent *pEnt = NULL;
+    struct stat st = {0};
+    char *pszPath = NULL;
+    size_t nLen = 0;
+    int nIsDir = 0;
+
+    pDir = opendir(pszDir);
+    if (!pDir)
+    {
+        /* nothing synced for this repo */
+        if (errno == ENOENT)
+        {
+            goto cleanup;
+        }
+        dwError = ERROR_TDNF_SYSTEM_BASE + errno;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    while ((pEnt = readdir(pDir)) != NULL)
+    {
+        if (!strcmp(pEnt->d_name, ".") || !strcmp(pEnt->d_name, ".."))
+        {
+            continue;
+        }
+
+        dwError = TDNFAllocateStringPrintf(&pszPath, "%s/%s",
+                                           pszDir, pEnt->d_name);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        if (pEnt->d_type == DT_UNKNOWN)
+        {
+            if (lstat(pszPath, &st))
+            {
+                dwError = ERROR_TDNF_SYSTEM_BASE + errno;
+                BAIL_ON_TDNF_ERROR(dwError);
+            }
+            nIsDir = S_ISDIR(st.st_mode);
+        }
+        else
+        {
+            nIsDir = pEnt->d_type == DT_DIR;
+        }
+
+        nLen = strlen(pEnt->d_name);
+        if (nIsDir)
+        {
+            dwError = _TDNFRepoSyncDeleteWalk(pKeep, pszPath);
+            BAIL_ON_TDNF_ERROR(dwError);
+        }
+        else if (nLen > 4 && !strcmp(pEnt->d_name + nLen - 4, ".rpm") &&
+                 !stringpool_str2id(pKeep, pszPath, 0))
+        {
+            pr_info("deleting %s\n", pszPath);
+            if (remove(pszPath) < 0)
+            {
+                pr_crit("unable to remove %s: %s\n", pszPath, strerror(errno));
+            }
+        }
+        else if (nLen > 14 && !strcmp(pEnt->d_name + nLen - 14, ".reposync-keep"))
+        {
+            /* marker files from older versions */
+            remove(pszPath);
+        }
+        TDNF_SAFE_FREE_MEMORY(pszPath);
+    }
+
+cleanup:
+    if (pDir)
+    {
+        closedir(pDir);
+    }
+    TDNF_SAFE_FREE_MEMORY(pszPath);
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+/*
+ * For --delete: remove all rpms below the directories in
+ * ppszRepoDirs that were not just synced by pJobs.
+ */
+uint32_t
+TDNFRepoSyncDeleteUnsynced(
+    PTDNF_REPOSYNC_JOB pJobs,
+    uint32_t dwJobCount,
+    char **ppszRepoDirs
+    )
+{
+    uint32_t dwError = 0;
+    Stringpool keep;
+    char *pszNormalDir = NULL;
+    uint32_t i;
+
+    stringpool_init_empty(&keep);
+
+    if ((dwJobCount && !pJobs) || !ppszRepoDirs)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    for (i = 0; i < dwJobCount; i++)
+    {
+        if (pJobs[i].nKeep)
+        {
+            stringpool_str2id(&keep, pJobs[i].pszFilePath, 1);
+        }
+    }
+
+    for (i = 0; ppszRepoDirs[i]; i++)
+    {
+        /* the paths of the jobs are normalized, so are the walked ones */
+        dwError = TDNFNormalizePath(ppszRepoDirs[i], &pszNormalDir);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        dwError = _TDNFRepoSyncDeleteWalk(&keep, pszNormalDir);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        TDNF_SAFE_FREE_MEMORY(pszNormalDir);
+    }
+
+cleanup:
+    stringpool_free(&keep);
+    TDNF_SAFE_FREE_MEMORY(pszNormalDir);
+    return dwError;
+
+error:
+    goto cleanup;
+}
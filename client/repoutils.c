@@ -393,10 +393,13 @@ TDNFRepoApplyDownloadSettings(
         BAIL_ON_TDNF_ERROR(dwError);
     }
 
+    /* a transfer below minrate, or without any data, for
+       stall_timeout seconds is given up for the next url */
     if((curlError = curl_easy_setopt(
             pCurl,
             CURLOPT_LOW_SPEED_TIME,
-            pRepo->nTimeout)) != CURLE_OK)
+            pRepo->nStallTimeout > 0 ?
+                pRepo->nStallTimeout : pRepo->nTimeout)) != CURLE_OK)
     {
         dwError = ERROR_TDNF_CURL_BASE + curlError;
         BAIL_ON_TDNF_ERROR(dwError);
@@ -405,7 +408,7 @@ TDNFRepoApplyDownloadSettings(
     if((curlError = curl_easy_setopt(
             pCurl,
             CURLOPT_LOW_SPEED_LIMIT,
-            pRepo->nMinrate)) != CURLE_OK)
+            pRepo->nMinrate > 0 ? pRepo->nMinrate : 1)) != CURLE_OK)
     {
         dwError = ERROR_TDNF_CURL_BASE + curlError;
         BAIL_ON_TDNF_ERROR(dwError);
@@ -420,6 +423,21 @@ TDNFRepoApplyDownloadSettings(
         BAIL_ON_TDNF_ERROR(dwError);
     }
 
+    /* without HTTP/2 in libcurl everything stays on HTTP/1.1 */
+    if (curl_version_info(CURLVERSION_NOW)->features & CURL_VERSION_HTTP2)
+    {
+        if((curlError = curl_easy_setopt(
+                pCurl,
+                CURLOPT_HTTP_VERSION,
+                pRepo->nHttp2PriorKnowledge ?
+                    CURL_HTTP_VERSION_2_PRIOR_KNOWLEDGE :
+                    CURL_HTTP_VERSION_2TLS)) != CURLE_OK)
+        {
+            dwError = ERROR_TDNF_CURL_BASE + curlError;
+            BAIL_ON_TDNF_ERROR(dwError);
+        }
+    }
+
 cleanup:
     return dwError;
 error:
@@ -511,16 +529,27 @@ TDNFGetCachePath(
 )
 {
     uint32_t dwError = 0;
+    const char *pszCacheDir = NULL;
 
-    if(!pTdnf || !pRepo || !ppszPath)
+    if(!pTdnf || !pTdnf->pConf || !pRepo || !ppszPath)
     {
         dwError = ERROR_TDNF_INVALID_PARAMETER;
         BAIL_ON_TDNF_ERROR(dwError);
     }
 
+    pszCacheDir = pTdnf->pConf->pszCacheDir;
+
+    /* metadata can be shared by installroots, packages are deleted
+       after the install so they stay with the installroot */
+    if (pTdnf->pConf->pszSharedCacheDir &&
+        (!pszSubDir || strcmp(pszSubDir, TDNF_RPM_CACHE_DIR_NAME)))
+    {
+        pszCacheDir = pTdnf->pConf->pszSharedCacheDir;
+    }
+
     dwError = TDNFJoinPath(
                   ppszPath,
-                  pTdnf->pConf->pszCacheDir,
+                  pszCacheDir,
                   pRepo->pszCacheName ? pRepo->pszCacheName : pRepo->pszId,
                   pszSubDir,
                   pszFileName,
@@ -533,6 +562,196 @@ error:
     goto cleanup;
 }
 
+/*
+ * With shared_cachedir, take the lock of the repo's metadata in the
+ * shared cache so only one installroot refreshes it at a time. With
+ * stale_while_revalidate the metadata in cachedir is locked the same
+ * way, since it is refreshed in the background. Waits for the lock,
+ * unless nShared is set: readers that may use stale metadata take a
+ * shared lock if they can get it right away and otherwise go on with
+ * what is on disk, the refresher only holds it to swap in new files.
+ * *pnLockFd is -1 if there is nothing to lock, or nothing was locked.
+ */
+uint32_t
+TDNFRepoLockSharedCache(
+    PTDNF pTdnf,
+    PTDNF_REPO_DATA pRepo,
+    int nShared,
+    int *pnLockFd
+    )
+{
+    uint32_t dwError = 0;
+    char *pszLockFile = NULL;
+    const char *pszLockDir = NULL;
+    int fd = -1;
+
+    if(!pTdnf || !pTdnf->pConf || !pRepo || !pnLockFd)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    if (pTdnf->pConf->pszSharedCacheDir)
+    {
+        pszLockDir = pTdnf->pConf->pszSharedCacheDir;
+    }
+    else if (pTdnf->pConf->nStaleWhileRevalidate)
+    {
+        pszLockDir = pTdnf->pConf->pszCacheDir;
+    }
+    else
+    {
+        goto cleanup;
+    }
+
+    dwError = TDNFAllocateStringPrintf(&pszLockFile, "%s/%s%s",
+                  pszLockDir,
+                  pRepo->pszCacheName ? pRepo->pszCacheName : pRepo->pszId,
+                  TDNF_SHARED_CACHE_LOCK_EXT);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    fd = open(pszLockFile, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0 && errno == EACCES)
+    {
+        /* not root, we can only read the cache anyway */
+        fd = open(pszLockFile, O_RDONLY | O_CLOEXEC);
+    }
+    if (fd < 0 && (errno == ENOENT || (errno == EACCES && gEuid)))
+    {
+        /* no cache yet, or one we cannot lock that no
+           root process has used this way yet */
+        goto cleanup;
+    }
+    if (fd < 0)
+    {
+        dwError = errno;
+        BAIL_ON_TDNF_SYSTEM_ERROR(dwError);
+    }
+
+    if (flock(fd, (nShared ? LOCK_SH : LOCK_EX) | LOCK_NB))
+    {
+        if (errno != EWOULDBLOCK)
+        {
+            dwError = errno;
+            BAIL_ON_TDNF_SYSTEM_ERROR(dwError);
+        }
+        if (nShared)
+        {
+            close(fd);
+            fd = -1;
+            goto cleanup;
+        }
+        pr_info("waiting for shared cache of repo '%s'\n", pRepo->pszId);
+        if (flock(fd, LOCK_EX))
+        {
+            dwError = errno;
+            BAIL_ON_TDNF_SYSTEM_ERROR(dwError);
+        }
+    }
+
+    *pnLockFd = fd;
+    fd = -1;
+
+cleanup:
+    TDNF_SAFE_FREE_MEMORY(pszLockFile);
+    return dwError;
+
+error:
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+    goto cleanup;
+}
+
+void
+TDNFRepoUnlockSharedCache(
+    int nLockFd
+    )
+{
+    if (nLockFd >= 0)
+    {
+        flock(nLockFd, LOCK_UN);
+        close(nLockFd);
+    }
+}
+
+/*
+ * With shared_cachedir, record the installroot in <name>.roots next
+ * to the lock of the repo, so clean --stale of other installroots
+ * knows the metadata is in use. Must hold a lock of the repo.
+ */
+uint32_t
+TDNFRepoAddSharedCacheRoot(
+    PTDNF pTdnf,
+    PTDNF_REPO_DATA pRepo
+    )
+{
+    uint32_t dwError = 0;
+    char *pszRootsFile = NULL;
+    char **ppszRoots = NULL;
+    const char *pszRoot = "/";
+    FILE *fp = NULL;
+    int i;
+
+    if(!pTdnf || !pTdnf->pConf || !pTdnf->pArgs || !pRepo)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    if (!pTdnf->pConf->pszSharedCacheDir || gEuid)
+    {
+        goto cleanup;
+    }
+
+    if (!IsNullOrEmptyString(pTdnf->pArgs->pszInstallRoot))
+    {
+        pszRoot = pTdnf->pArgs->pszInstallRoot;
+    }
+
+    dwError = TDNFAllocateStringPrintf(&pszRootsFile, "%s/%s%s",
+                  pTdnf->pConf->pszSharedCacheDir,
+                  pRepo->pszCacheName ? pRepo->pszCacheName : pRepo->pszId,
+                  TDNF_SHARED_CACHE_ROOTS_EXT);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFReadFileToStringArray(pszRootsFile, &ppszRoots);
+    if (dwError == ERROR_TDNF_SYSTEM_BASE + ENOENT)
+    {
+        dwError = 0;
+    }
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    for (i = 0; ppszRoots && ppszRoots[i]; i++)
+    {
+        if (!strcmp(ppszRoots[i], pszRoot))
+        {
+            goto cleanup;
+        }
+    }
+
+    fp = fopen(pszRootsFile, "a");
+    if (!fp)
+    {
+        dwError = errno;
+        BAIL_ON_TDNF_SYSTEM_ERROR_UNCOND(dwError);
+    }
+    fprintf(fp, "%s\n", pszRoot);
+
+cleanup:
+    if (fp)
+    {
+        fclose(fp);
+    }
+    TDNF_SAFE_FREE_STRINGARRAY(ppszRoots);
+    TDNF_SAFE_FREE_MEMORY(pszRootsFile);
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
 uint32_t
 TDNFFindRepoById(
     PTDNF pTdnf,
@@ -54,8 +54,6 @@ TDNFPrepareAllPackages(
     Queue queueLocal = {0};
     char*  pszSeverity = NULL;
     uint32_t dwSecurity = 0;
-    char** ppszPkgArray = NULL;
-    uint32_t dwCount = 0;
     uint32_t dwRebootRequired = 0;
     TDNF_ALTERTYPE nAlterType = 0;
 
@@ -102,18 +100,13 @@ TDNFPrepareAllPackages(
         //pAlterType is changed to ALTER_UPGRADE and later used in TDNFGoal() to add exclude the
         // list of packages that are added in --exclude option.
         *pAlterType = ALTER_UPGRADE;
-        dwError = TDNFGetUpdatePkgs(pTdnf, &ppszPkgArray, &dwCount);
+        dwError = TDNFGetAdvisoryUpgrades(
+                      pTdnf,
+                      dwSecurity,
+                      pszSeverity,
+                      dwRebootRequired,
+                      queueGoal);
         BAIL_ON_TDNF_ERROR(dwError);
-        for(nPkgIndex = 0; (uint32_t)nPkgIndex < dwCount; ++nPkgIndex)
-        {
-            dwError = TDNFPrepareSinglePkg(
-                          pTdnf,
-                          ppszPkgArray[nPkgIndex],
-                          *pAlterType,
-                          ppszPkgsNotResolved,
-                          queueGoal);
-            BAIL_ON_TDNF_ERROR(dwError);
-        }
     }
     else
     {
@@ -0,0 +1,1758 @@
+/*
+ * Copyright (C) 2023 VMware, Inc. All Rights Reserved.
+ *
+ * Licensed under the GNU Lesser General Public License v2.1 (the "License");
+ * you may not use this file except in compliance with the License. The terms
+ * of the License are located in the COPYING file of this distribution.
+ */
+
+/*
+ * Cache for the results of read only solves (check-update and
+ * alter commands with --assumeno). A result is stored in one file
+ * per job slot under <cachedir>/resultcache, together with a key.
+ * The key is a sha256 over everything the result depends on: the
+ * cookies of the enabled repos, the rpmdb cookie, the solver
+ * related config and the job itself. Any change of these gives
+ * a new key, so a stale entry is never used.
+ */
+
+#include "includes.h"
+
+#define RESULT_CACHE_FIELD_SEP '\t'
+
+static
+void
+_TDNFResultCacheAddString(
+    Chksum *pChkSum,
+    const char *pszValue
+    )
+{
+    if (pszValue)
+    {
+        solv_chksum_add(pChkSum, pszValue, strlen(pszValue));
+    }
+    /* terminate, so "ab" "c" differs from "a" "bc" */
+    solv_chksum_add(pChkSum, "", 1);
+}
+
+static
+void
+_TDNFResultCacheAddStringArray(
+    Chksum *pChkSum,
+    char **ppszValues
+    )
+{
+    int i;
+
+    for (i = 0; ppszValues && ppszValues[i]; i++)
+    {
+        _TDNFResultCacheAddString(pChkSum, ppszValues[i]);
+    }
+    _TDNFResultCacheAddString(pChkSum, NULL);
+}
+
+static
+void
+_TDNFResultCacheAddInt(
+    Chksum *pChkSum,
+    int nValue
+    )
+{
+    char szValue[32] = {0};
+
+    snprintf(szValue, sizeof(szValue), "%d", nValue);
+    _TDNFResultCacheAddString(pChkSum, szValue);
+}
+
+static
+uint32_t
+_TDNFResultCacheAddRpmDBCookie(
+    PTDNF pTdnf,
+    Chksum *pChkSum
+    )
+{
+    uint32_t dwError = 0;
+    rpmts pTS = NULL;
+    char *pszCookie = NULL;
+    const char *pszRootDir = "/";
+
+    if (!IsNullOrEmptyString(pTdnf->pArgs->pszInstallRoot))
+    {
+        pszRootDir = pTdnf->pArgs->pszInstallRoot;
+    }
+
+    pTS = rpmtsCreate();
+    if (!pTS)
+    {
+        dwError = ERROR_TDNF_RPMTS_CREATE_FAILED;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    if (rpmtsSetRootDir(pTS, pszRootDir))
+    {
+        dwError = ERROR_TDNF_RPMTS_BAD_ROOT_DIR;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    if (rpmtsOpenDB(pTS, O_RDONLY))
+    {
+        dwError = ERROR_TDNF_RPMTS_OPENDB_FAILED;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    pszCookie = rpmdbCookie(rpmtsGetRdb(pTS));
+    if (!pszCookie)
+    {
+        dwError = ERROR_TDNF_NO_DATA;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+    _TDNFResultCacheAddString(pChkSum, pszCookie);
+
+cleanup:
+    if (pszCookie)
+    {
+        free(pszCookie);
+    }
+    if (pTS)
+    {
+        rpmtsCloseDB(pTS);
+        rpmtsFree(pTS);
+    }
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+static
+uint32_t
+_TDNFResultCacheAddRepoCookies(
+    PTDNF pTdnf,
+    Chksum *pChkSum,
+    int nNeedFresh
+    )
+{
+    uint32_t dwError = 0;
+    PTDNF_REPO_DATA pRepo = NULL;
+    char *pszRepoCacheDir = NULL;
+    char *pszRepoMD = NULL;
+    unsigned char pszCookie[SOLV_COOKIE_LEN] = {0};
+    int nShouldSync = 0;
+
+    for (pRepo = pTdnf->pRepos; pRepo; pRepo = pRepo->pNext)
+    {
+        if (!strcmp(pRepo->pszName, CMDLINE_REPO_NAME) || !pRepo->nEnabled)
+        {
+            continue;
+        }
+
+        /* repos read from a directory have no cookie */
+        if (!pRepo->nHasMetaData)
+        {
+            dwError = ERROR_TDNF_NO_DATA;
+            BAIL_ON_TDNF_ERROR(dwError);
+        }
+
+        dwError = TDNFGetCachePath(pTdnf, pRepo,
+                                   NULL, NULL,
+                                   &pszRepoCacheDir);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        /* a refresh may replace the metadata we would be keyed on */
+        if (nNeedFresh &&
+            pRepo->lMetadataExpire >= 0 &&
+            !pTdnf->pArgs->nCacheOnly)
+        {
+            dwError = TDNFShouldSyncMetadata(
+                          pszRepoCacheDir,
+                          pRepo->lMetadataExpire,
+                          &nShouldSync);
+            BAIL_ON_TDNF_ERROR(dwError);
+
+            if (nShouldSync)
+            {
+                dwError = ERROR_TDNF_NO_DATA;
+                BAIL_ON_TDNF_ERROR(dwError);
+            }
+        }
+
+        dwError = TDNFJoinPath(&pszRepoMD,
+                               pszRepoCacheDir,
+                               TDNF_REPO_METADATA_FILE_PATH,
+                               NULL);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        if (access(pszRepoMD, F_OK))
+        {
+            dwError = ERROR_TDNF_NO_DATA;
+            BAIL_ON_TDNF_ERROR(dwError);
+        }
+
+        dwError = SolvCalculateCookieForFile(pszRepoMD, pszCookie);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        _TDNFResultCacheAddString(pChkSum, pRepo->pszId);
+        _TDNFResultCacheAddInt(pChkSum, pRepo->nPriority);
+        solv_chksum_add(pChkSum, pszCookie, SOLV_COOKIE_LEN);
+
+        TDNF_SAFE_FREE_MEMORY(pszRepoCacheDir);
+        TDNF_SAFE_FREE_MEMORY(pszRepoMD);
+    }
+
+cleanup:
+    TDNF_SAFE_FREE_MEMORY(pszRepoCacheDir);
+    TDNF_SAFE_FREE_MEMORY(pszRepoMD);
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+/*
+ * Compute the cache key for pszJob. Returns ERROR_TDNF_NO_DATA
+ * if the result cannot be cached, for example for repos without
+ * metadata. With TDNF_RESULT_CACHE_KEY_FRESH it also fails if
+ * --refresh was given or the metadata of a repo has expired,
+ * since the refresh would invalidate the key right away. With
+ * TDNF_RESULT_CACHE_KEY_ARGS the command args and setopts are
+ * part of the key, without it only pszJob identifies the job.
+ */
+uint32_t
+TDNFResultCacheGetKey(
+    PTDNF pTdnf,
+    const char *pszJob,
+    uint32_t dwFlags,
+    char **ppszKey
+    )
+{
+    uint32_t dwError = 0;
+    Chksum *pChkSum = NULL;
+    PTDNF_CMD_ARGS pArgs = NULL;
+    PTDNF_CONF pConf = NULL;
+    PTDNF_CMD_OPT pSetOpt = NULL;
+    const unsigned char *pDigest = NULL;
+    int nDigestLen = 0;
+    char *pszKey = NULL;
+    int i;
+
+    if (!pTdnf || !pTdnf->pArgs || !pTdnf->pConf ||
+        IsNullOrEmptyString(pszJob) || !ppszKey)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    pArgs = pTdnf->pArgs;
+    pConf = pTdnf->pConf;
+
+    if ((dwFlags & TDNF_RESULT_CACHE_KEY_FRESH) && pArgs->nRefresh)
+    {
+        dwError = ERROR_TDNF_NO_DATA;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    pChkSum = solv_chksum_create(REPOKEY_TYPE_SHA256);
+    if (!pChkSum)
+    {
+        dwError = ERROR_TDNF_SOLV_CHKSUM;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    _TDNFResultCacheAddInt(pChkSum, TDNF_RESULT_CACHE_VERSION);
+    _TDNFResultCacheAddString(pChkSum, pszJob);
+
+    dwError = _TDNFResultCacheAddRepoCookies(
+                  pTdnf,
+                  pChkSum,
+                  dwFlags & TDNF_RESULT_CACHE_KEY_FRESH);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = _TDNFResultCacheAddRpmDBCookie(pTdnf, pChkSum);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    /* config */
+    _TDNFResultCacheAddStringArray(pChkSum, pConf->ppszExcludes);
+    _TDNFResultCacheAddStringArray(pChkSum, pConf->ppszMinVersions);
+    _TDNFResultCacheAddStringArray(pChkSum, pConf->ppszPkgLocks);
+    _TDNFResultCacheAddStringArray(pChkSum, pConf->ppszProtectedPkgs);
+    _TDNFResultCacheAddInt(pChkSum, pConf->nInstallOnlyLimit);
+    _TDNFResultCacheAddInt(pChkSum, pConf->nCleanRequirementsOnRemove);
+    _TDNFResultCacheAddInt(pChkSum, pConf->nDistroSyncReinstallChanged);
+    _TDNFResultCacheAddInt(pChkSum, pConf->nCheckUpdateCompat);
+    _TDNFResultCacheAddString(pChkSum, pConf->pszVarBaseArch);
+    _TDNFResultCacheAddString(pChkSum, pConf->pszVarReleaseVer);
+
+    /* the job: options that change it, command and package args */
+    if (dwFlags & TDNF_RESULT_CACHE_KEY_ARGS)
+    {
+        for (i = 0; i < pArgs->nCmdCount; i++)
+        {
+            _TDNFResultCacheAddString(pChkSum, pArgs->ppszCmds[i]);
+        }
+        _TDNFResultCacheAddString(pChkSum, NULL);
+        for (pSetOpt = pArgs->pSetOpt; pSetOpt; pSetOpt = pSetOpt->pNext)
+        {
+            _TDNFResultCacheAddString(pChkSum, pSetOpt->pszOptName);
+            _TDNFResultCacheAddString(pChkSum, pSetOpt->pszOptValue);
+        }
+    }
+    _TDNFResultCacheAddInt(pChkSum, pArgs->nAllDeps);
+    _TDNFResultCacheAddInt(pChkSum, pArgs->nAllowErasing);
+    _TDNFResultCacheAddInt(pChkSum, pArgs->nBest);
+    _TDNFResultCacheAddInt(pChkSum, pArgs->nNoDeps);
+    _TDNFResultCacheAddInt(pChkSum, pArgs->nDisableExcludes);
+    _TDNFResultCacheAddInt(pChkSum, pArgs->nNoAutoRemove);
+    _TDNFResultCacheAddInt(pChkSum, pArgs->nSkipBroken);
+    _TDNFResultCacheAddInt(pChkSum, pArgs->nSource);
+    _TDNFResultCacheAddInt(pChkSum, pArgs->nBuildDeps);
+    _TDNFResultCacheAddString(pChkSum, pArgs->pszInstallRoot);
+    _TDNFResultCacheAddString(pChkSum, pArgs->pszReleaseVer);
+
+    pDigest = solv_chksum_get(pChkSum, &nDigestLen);
+    if (!pDigest)
+    {
+        dwError = ERROR_TDNF_SOLV_CHKSUM;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    dwError = TDNFAllocateMemory(1, nDigestLen * 2 + 1, (void **)&pszKey);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    solv_bin2hex(pDigest, nDigestLen, pszKey);
+
+    *ppszKey = pszKey;
+
+cleanup:
+    if (pChkSum)
+    {
+        solv_chksum_free(pChkSum, NULL);
+    }
+    return dwError;
+
+error:
+    TDNF_SAFE_FREE_MEMORY(pszKey);
+    if (ppszKey)
+    {
+        *ppszKey = NULL;
+    }
+    goto cleanup;
+}
+
+static
+uint32_t
+_TDNFResultCacheGetPath(
+    PTDNF pTdnf,
+    const char *pszSlot,
+    char **ppszPath
+    )
+{
+    uint32_t dwError = 0;
+    char *pszFile = NULL;
+
+    dwError = TDNFAllocateStringPrintf(&pszFile, "%s.cache", pszSlot);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFJoinPath(ppszPath,
+                           pTdnf->pConf->pszCacheDir,
+                           TDNF_RESULT_CACHE_DIR_NAME,
+                           pszFile,
+                           NULL);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+cleanup:
+    TDNF_SAFE_FREE_MEMORY(pszFile);
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+static
+int
+_TDNFResultCacheIsSafeString(
+    const char *pszValue
+    )
+{
+    return !pszValue ||
+           (!strchr(pszValue, RESULT_CACHE_FIELD_SEP) && !strchr(pszValue, '\n'));
+}
+
+static
+uint32_t
+_TDNFResultCacheWritePkg(
+    FILE *fp,
+    PTDNF_PKG_INFO pPkgInfo
+    )
+{
+    uint32_t dwError = 0;
+
+    if (!_TDNFResultCacheIsSafeString(pPkgInfo->pszName) ||
+        !_TDNFResultCacheIsSafeString(pPkgInfo->pszArch) ||
+        !_TDNFResultCacheIsSafeString(pPkgInfo->pszVersion) ||
+        !_TDNFResultCacheIsSafeString(pPkgInfo->pszRelease) ||
+        !_TDNFResultCacheIsSafeString(pPkgInfo->pszEVR) ||
+        !_TDNFResultCacheIsSafeString(pPkgInfo->pszRepoName) ||
+        !_TDNFResultCacheIsSafeString(pPkgInfo->pszLocation) ||
+        !_TDNFResultCacheIsSafeString(pPkgInfo->pszSummary))
+    {
+        dwError = ERROR_TDNF_NO_DATA;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    if (fprintf(fp, "pkg\t%u\t%u\t%u\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\n",
+                pPkgInfo->dwEpoch,
+                pPkgInfo->dwInstallSizeBytes,
+                pPkgInfo->dwDownloadSizeBytes,
+                pPkgInfo->pszName ? pPkgInfo->pszName : "",
+                pPkgInfo->pszArch ? pPkgInfo->pszArch : "",
+                pPkgInfo->pszVersion ? pPkgInfo->pszVersion : "",
+                pPkgInfo->pszRelease ? pPkgInfo->pszRelease : "",
+                pPkgInfo->pszEVR ? pPkgInfo->pszEVR : "",
+                pPkgInfo->pszRepoName ? pPkgInfo->pszRepoName : "",
+                pPkgInfo->pszLocation ? pPkgInfo->pszLocation : "",
+                pPkgInfo->pszSummary ? pPkgInfo->pszSummary : "") < 0)
+    {
+        dwError = ERROR_TDNF_SYSTEM_BASE + errno;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+cleanup:
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+static
+uint32_t
+_TDNFResultCacheReadField(
+    char **ppszLine,
+    char **ppszValue
+    )
+{
+    uint32_t dwError = 0;
+    char *pszField = NULL;
+
+    pszField = strsep(ppszLine, "\t");
+    if (!pszField)
+    {
+        dwError = ERROR_TDNF_NO_DATA;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    if (ppszValue && *pszField)
+    {
+        dwError = TDNFAllocateString(pszField, ppszValue);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+cleanup:
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+static
+uint32_t
+_TDNFResultCacheReadUInt(
+    char **ppszLine,
+    uint32_t *pdwValue
+    )
+{
+    uint32_t dwError = 0;
+    char *pszField = NULL;
+    char *pszEnd = NULL;
+
+    pszField = strsep(ppszLine, "\t");
+    if (IsNullOrEmptyString(pszField))
+    {
+        dwError = ERROR_TDNF_NO_DATA;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    *pdwValue = strtoul(pszField, &pszEnd, 10);
+    if (*pszEnd)
+    {
+        dwError = ERROR_TDNF_NO_DATA;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+cleanup:
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+static
+uint32_t
+_TDNFResultCacheReadPkg(
+    char *pszLine,
+    PTDNF_PKG_INFO pPkgInfo
+    )
+{
+    uint32_t dwError = 0;
+    char *pszTag = NULL;
+
+    pszTag = strsep(&pszLine, "\t");
+    if (!pszTag || strcmp(pszTag, "pkg"))
+    {
+        dwError = ERROR_TDNF_NO_DATA;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    dwError = _TDNFResultCacheReadUInt(&pszLine, &pPkgInfo->dwEpoch);
+    BAIL_ON_TDNF_ERROR(dwError);
+    dwError = _TDNFResultCacheReadUInt(&pszLine, &pPkgInfo->dwInstallSizeBytes);
+    BAIL_ON_TDNF_ERROR(dwError);
+    dwError = _TDNFResultCacheReadUInt(&pszLine, &pPkgInfo->dwDownloadSizeBytes);
+    BAIL_ON_TDNF_ERROR(dwError);
+    dwError = _TDNFResultCacheReadField(&pszLine, &pPkgInfo->pszName);
+    BAIL_ON_TDNF_ERROR(dwError);
+    dwError = _TDNFResultCacheReadField(&pszLine, &pPkgInfo->pszArch);
+    BAIL_ON_TDNF_ERROR(dwError);
+    dwError = _TDNFResultCacheReadField(&pszLine, &pPkgInfo->pszVersion);
+    BAIL_ON_TDNF_ERROR(dwError);
+    dwError = _TDNFResultCacheReadField(&pszLine, &pPkgInfo->pszRelease);
+    BAIL_ON_TDNF_ERROR(dwError);
+    dwError = _TDNFResultCacheReadField(&pszLine, &pPkgInfo->pszEVR);
+    BAIL_ON_TDNF_ERROR(dwError);
+    dwError = _TDNFResultCacheReadField(&pszLine, &pPkgInfo->pszRepoName);
+    BAIL_ON_TDNF_ERROR(dwError);
+    dwError = _TDNFResultCacheReadField(&pszLine, &pPkgInfo->pszLocation);
+    BAIL_ON_TDNF_ERROR(dwError);
+    dwError = _TDNFResultCacheReadField(&pszLine, &pPkgInfo->pszSummary);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFUtilsFormatSize(
+                  pPkgInfo->dwInstallSizeBytes,
+                  &pPkgInfo->pszFormattedSize);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFUtilsFormatSize(
+                  pPkgInfo->dwDownloadSizeBytes,
+                  &pPkgInfo->pszFormattedDownloadSize);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+cleanup:
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+/*
+ * Open the cache file of pszSlot and check its header. Succeeds
+ * only if the entry was written for pszKey.
+ */
+static
+uint32_t
+_TDNFResultCacheOpen(
+    PTDNF pTdnf,
+    const char *pszSlot,
+    const char *pszKey,
+    FILE **pfp
+    )
+{
+    uint32_t dwError = 0;
+    char *pszPath = NULL;
+    FILE *fp = NULL;
+    char *pszLine = NULL;
+    size_t nLineSize = 0;
+    char *pszExpected = NULL;
+
+    dwError = _TDNFResultCacheGetPath(pTdnf, pszSlot, &pszPath);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    fp = fopen(pszPath, "r");
+    if (!fp)
+    {
+        dwError = ERROR_TDNF_NO_DATA;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    dwError = TDNFAllocateStringPrintf(&pszExpected, "%s %d %s\n",
+                                       TDNF_RESULT_CACHE_MAGIC,
+                                       TDNF_RESULT_CACHE_VERSION,
+                                       pszKey);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    if (getline(&pszLine, &nLineSize, fp) < 0 ||
+        strcmp(pszLine, pszExpected))
+    {
+        dwError = ERROR_TDNF_NO_DATA;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    *pfp = fp;
+
+cleanup:
+    TDNF_SAFE_FREE_MEMORY(pszPath);
+    TDNF_SAFE_FREE_MEMORY(pszExpected);
+    if (pszLine)
+    {
+        free(pszLine);
+    }
+    return dwError;
+
+error:
+    if (fp)
+    {
+        fclose(fp);
+    }
+    goto cleanup;
+}
+
+/*
+ * Results are written to a temp file which is renamed, so
+ * concurrent readers never see a partial entry. Write errors
+ * only mean the next run will solve again, so callers may
+ * ignore them.
+ */
+static
+uint32_t
+_TDNFResultCacheCreate(
+    PTDNF pTdnf,
+    const char *pszSlot,
+    const char *pszKey,
+    FILE **pfp,
+    char **ppszTmpPath
+    )
+{
+    uint32_t dwError = 0;
+    char *pszDir = NULL;
+    char *pszTmpPath = NULL;
+    FILE *fp = NULL;
+    int fd = -1;
+
+    dwError = TDNFJoinPath(&pszDir,
+                           pTdnf->pConf->pszCacheDir,
+                           TDNF_RESULT_CACHE_DIR_NAME,
+                           NULL);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFUtilsMakeDirs(pszDir);
+    if (dwError == ERROR_TDNF_ALREADY_EXISTS)
+    {
+        dwError = 0;
+    }
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFAllocateStringPrintf(&pszTmpPath, "%s/%s.XXXXXX",
+                                       pszDir, pszSlot);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    fd = mkstemp(pszTmpPath);
+    if (fd < 0)
+    {
+        dwError = ERROR_TDNF_SYSTEM_BASE + errno;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    fp = fdopen(fd, "w");
+    if (!fp)
+    {
+        dwError = ERROR_TDNF_SYSTEM_BASE + errno;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+    fd = -1;
+
+    if (fprintf(fp, "%s %d %s\n",
+                TDNF_RESULT_CACHE_MAGIC,
+                TDNF_RESULT_CACHE_VERSION,
+                pszKey) < 0)
+    {
+        dwError = ERROR_TDNF_SYSTEM_BASE + errno;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    *pfp = fp;
+    *ppszTmpPath = pszTmpPath;
+
+cleanup:
+    TDNF_SAFE_FREE_MEMORY(pszDir);
+    return dwError;
+
+error:
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+    if (fp)
+    {
+        fclose(fp);
+    }
+    if (pszTmpPath)
+    {
+        unlink(pszTmpPath);
+        TDNF_SAFE_FREE_MEMORY(pszTmpPath);
+    }
+    goto cleanup;
+}
+
+static
+uint32_t
+_TDNFResultCacheCommit(
+    PTDNF pTdnf,
+    const char *pszSlot,
+    FILE *fp,
+    const char *pszTmpPath
+    )
+{
+    uint32_t dwError = 0;
+    char *pszPath = NULL;
+    int nFailed = 0;
+
+    nFailed = ferror(fp);
+    if (fclose(fp) || nFailed)
+    {
+        dwError = ERROR_TDNF_SYSTEM_BASE + (errno ? errno : EIO);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    dwError = _TDNFResultCacheGetPath(pTdnf, pszSlot, &pszPath);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    if (chmod(pszTmpPath, 0644) || rename(pszTmpPath, pszPath))
+    {
+        dwError = ERROR_TDNF_SYSTEM_BASE + errno;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+cleanup:
+    TDNF_SAFE_FREE_MEMORY(pszPath);
+    return dwError;
+
+error:
+    unlink(pszTmpPath);
+    goto cleanup;
+}
+
+static
+uint32_t
+_TDNFResultCacheWriteStringArray(
+    FILE *fp,
+    const char *pszTag,
+    char **ppszValues
+    )
+{
+    uint32_t dwError = 0;
+    int i;
+
+    for (i = 0; ppszValues && ppszValues[i]; i++)
+    {
+        if (!_TDNFResultCacheIsSafeString(ppszValues[i]))
+        {
+            dwError = ERROR_TDNF_NO_DATA;
+            BAIL_ON_TDNF_ERROR(dwError);
+        }
+        if (fprintf(fp, "%s\t%s\n", pszTag, ppszValues[i]) < 0)
+        {
+            dwError = ERROR_TDNF_SYSTEM_BASE + errno;
+            BAIL_ON_TDNF_ERROR(dwError);
+        }
+    }
+
+cleanup:
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+#define SOLVED_PKG_LIST_COUNT 10
+
+static
+void
+_TDNFResultCacheGetSolvedLists(
+    PTDNF_SOLVED_PKG_INFO pSolvedPkgInfo,
+    PTDNF_PKG_INFO **pppLists
+    )
+{
+    pppLists[0] = &pSolvedPkgInfo->pPkgsNotAvailable;
+    pppLists[1] = &pSolvedPkgInfo->pPkgsExisting;
+    pppLists[2] = &pSolvedPkgInfo->pPkgsToInstall;
+    pppLists[3] = &pSolvedPkgInfo->pPkgsToDowngrade;
+    pppLists[4] = &pSolvedPkgInfo->pPkgsToUpgrade;
+    pppLists[5] = &pSolvedPkgInfo->pPkgsToRemove;
+    pppLists[6] = &pSolvedPkgInfo->pPkgsUnNeeded;
+    pppLists[7] = &pSolvedPkgInfo->pPkgsToReinstall;
+    pppLists[8] = &pSolvedPkgInfo->pPkgsObsoleted;
+    pppLists[9] = &pSolvedPkgInfo->pPkgsRemovedByDowngrade;
+}
+
+uint32_t
+TDNFResultCacheWriteSolved(
+    PTDNF pTdnf,
+    const char *pszSlot,
+    const char *pszKey,
+    PTDNF_SOLVED_PKG_INFO pSolvedPkgInfo
+    )
+{
+    uint32_t dwError = 0;
+    FILE *fp = NULL;
+    char *pszTmpPath = NULL;
+    PTDNF_PKG_INFO *ppLists[SOLVED_PKG_LIST_COUNT] = {0};
+    PTDNF_PKG_INFO pPkgInfo = NULL;
+    int i;
+
+    if (!pTdnf || !pTdnf->pConf || IsNullOrEmptyString(pszSlot) ||
+        IsNullOrEmptyString(pszKey) || !pSolvedPkgInfo)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    dwError = _TDNFResultCacheCreate(pTdnf, pszSlot, pszKey,
+                                     &fp, &pszTmpPath);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    if (fprintf(fp, "solved\t%d\t%d\t%d\n",
+                pSolvedPkgInfo->nNeedAction,
+                pSolvedPkgInfo->nNeedDownload,
+                pSolvedPkgInfo->nAlterType) < 0)
+    {
+        dwError = ERROR_TDNF_SYSTEM_BASE + errno;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    _TDNFResultCacheGetSolvedLists(pSolvedPkgInfo, ppLists);
+    for (i = 0; i < SOLVED_PKG_LIST_COUNT; i++)
+    {
+        if (fprintf(fp, "list\t%d\n", i) < 0)
+        {
+            dwError = ERROR_TDNF_SYSTEM_BASE + errno;
+            BAIL_ON_TDNF_ERROR(dwError);
+        }
+        for (pPkgInfo = *ppLists[i]; pPkgInfo; pPkgInfo = pPkgInfo->pNext)
+        {
+            dwError = _TDNFResultCacheWritePkg(fp, pPkgInfo);
+            BAIL_ON_TDNF_ERROR(dwError);
+        }
+    }
+
+    dwError = _TDNFResultCacheWriteStringArray(
+                  fp, "notresolved", pSolvedPkgInfo->ppszPkgsNotResolved);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = _TDNFResultCacheWriteStringArray(
+                  fp, "userinstall", pSolvedPkgInfo->ppszPkgsUserInstall);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = _TDNFResultCacheCommit(pTdnf, pszSlot, fp, pszTmpPath);
+    fp = NULL;
+    BAIL_ON_TDNF_ERROR(dwError);
+
+cleanup:
+    TDNF_SAFE_FREE_MEMORY(pszTmpPath);
+    return dwError;
+
+error:
+    if (fp)
+    {
+        fclose(fp);
+        unlink(pszTmpPath);
+    }
+    goto cleanup;
+}
+
+static
+uint32_t
+_TDNFResultCacheAppendString(
+    char ***pppszValues,
+    int *pnCount,
+    const char *pszValue
+    )
+{
+    uint32_t dwError = 0;
+    char **ppszValues = NULL;
+
+    dwError = TDNFReAllocateMemory(
+                  (*pnCount + 2) * sizeof(char *),
+                  (void **)pppszValues);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    ppszValues = *pppszValues;
+    ppszValues[*pnCount + 1] = NULL;
+
+    dwError = TDNFAllocateString(pszValue, &ppszValues[*pnCount]);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    (*pnCount)++;
+
+cleanup:
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+uint32_t
+TDNFResultCacheReadSolved(
+    PTDNF pTdnf,
+    const char *pszSlot,
+    const char *pszKey,
+    PTDNF_SOLVED_PKG_INFO *ppSolvedPkgInfo
+    )
+{
+    uint32_t dwError = 0;
+    FILE *fp = NULL;
+    char *pszLine = NULL;
+    size_t nLineSize = 0;
+    ssize_t nRead = 0;
+    PTDNF_SOLVED_PKG_INFO pSolvedPkgInfo = NULL;
+    PTDNF_PKG_INFO *ppLists[SOLVED_PKG_LIST_COUNT] = {0};
+    PTDNF_PKG_INFO pPkgInfo = NULL;
+    PTDNF_PKG_INFO pLast = NULL;
+    int nList = -1;
+    int nNotResolved = 0;
+    int nUserInstall = 0;
+    int nHaveHeader = 0;
+
+    if (!pTdnf || !pTdnf->pConf || IsNullOrEmptyString(pszSlot) ||
+        IsNullOrEmptyString(pszKey) || !ppSolvedPkgInfo)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    dwError = _TDNFResultCacheOpen(pTdnf, pszSlot, pszKey, &fp);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFAllocateMemory(1, sizeof(TDNF_SOLVED_PKG_INFO),
+                                 (void **)&pSolvedPkgInfo);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    _TDNFResultCacheGetSolvedLists(pSolvedPkgInfo, ppLists);
+
+    while ((nRead = getline(&pszLine, &nLineSize, fp)) > 0)
+    {
+        if (pszLine[nRead - 1] == '\n')
+        {
+            pszLine[nRead - 1] = '\0';
+        }
+
+        if (!strncmp(pszLine, "solved\t", 7))
+        {
+            int nAlterType = 0;
+
+            if (sscanf(pszLine + 7, "%d\t%d\t%d",
+                       &pSolvedPkgInfo->nNeedAction,
+                       &pSolvedPkgInfo->nNeedDownload,
+                       &nAlterType) != 3)
+            {
+                dwError = ERROR_TDNF_NO_DATA;
+                BAIL_ON_TDNF_ERROR(dwError);
+            }
+            pSolvedPkgInfo->nAlterType = nAlterType;
+            nHaveHeader = 1;
+        }
+        else if (!strncmp(pszLine, "list\t", 5))
+        {
+            nList = atoi(pszLine + 5);
+            if (nList < 0 || nList >= SOLVED_PKG_LIST_COUNT)
+            {
+                dwError = ERROR_TDNF_NO_DATA;
+                BAIL_ON_TDNF_ERROR(dwError);
+            }
+            pLast = NULL;
+        }
+        else if (!strncmp(pszLine, "pkg\t", 4))
+        {
+            if (nList < 0)
+            {
+                dwError = ERROR_TDNF_NO_DATA;
+                BAIL_ON_TDNF_ERROR(dwError);
+            }
+
+            dwError = TDNFAllocateMemory(1, sizeof(TDNF_PKG_INFO),
+                                         (void **)&pPkgInfo);
+            BAIL_ON_TDNF_ERROR(dwError);
+
+            dwError = _TDNFResultCacheReadPkg(pszLine, pPkgInfo);
+            BAIL_ON_TDNF_ERROR(dwError);
+
+            /* keep the order the lists were written in */
+            if (pLast)
+            {
+                pLast->pNext = pPkgInfo;
+            }
+            else
+            {
+                *ppLists[nList] = pPkgInfo;
+            }
+            pLast = pPkgInfo;
+            pPkgInfo = NULL;
+        }
+        else if (!strncmp(pszLine, "notresolved\t", 12))
+        {
+            dwError = _TDNFResultCacheAppendString(
+                          &pSolvedPkgInfo->ppszPkgsNotResolved,
+                          &nNotResolved,
+                          pszLine + 12);
+            BAIL_ON_TDNF_ERROR(dwError);
+        }
+        else if (!strncmp(pszLine, "userinstall\t", 12))
+        {
+            dwError = _TDNFResultCacheAppendString(
+                          &pSolvedPkgInfo->ppszPkgsUserInstall,
+                          &nUserInstall,
+                          pszLine + 12);
+            BAIL_ON_TDNF_ERROR(dwError);
+        }
+        else
+        {
+            dwError = ERROR_TDNF_NO_DATA;
+            BAIL_ON_TDNF_ERROR(dwError);
+        }
+    }
+
+    if (!nHaveHeader)
+    {
+        dwError = ERROR_TDNF_NO_DATA;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    /* TDNFResolve always hands out an allocated array */
+    if (!pSolvedPkgInfo->ppszPkgsNotResolved)
+    {
+        dwError = TDNFAllocateMemory(1, sizeof(char *),
+                      (void **)&pSolvedPkgInfo->ppszPkgsNotResolved);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    *ppSolvedPkgInfo = pSolvedPkgInfo;
+
+cleanup:
+    if (pszLine)
+    {
+        free(pszLine);
+    }
+    if (fp)
+    {
+        fclose(fp);
+    }
+    return dwError;
+
+error:
+    if (ppSolvedPkgInfo)
+    {
+        *ppSolvedPkgInfo = NULL;
+    }
+    if (pPkgInfo)
+    {
+        TDNFFreePackageInfo(pPkgInfo);
+    }
+    if (pSolvedPkgInfo)
+    {
+        TDNFFreeSolvedPackageInfo(pSolvedPkgInfo);
+    }
+    goto cleanup;
+}
+
+uint32_t
+TDNFResultCacheWritePkgInfoArray(
+    PTDNF pTdnf,
+    const char *pszSlot,
+    const char *pszKey,
+    PTDNF_PKG_INFO pPkgInfos,
+    uint32_t dwCount
+    )
+{
+    uint32_t dwError = 0;
+    FILE *fp = NULL;
+    char *pszTmpPath = NULL;
+    uint32_t dwIndex = 0;
+
+    if (!pTdnf || !pTdnf->pConf || IsNullOrEmptyString(pszSlot) ||
+        IsNullOrEmptyString(pszKey) || (dwCount && !pPkgInfos))
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    dwError = _TDNFResultCacheCreate(pTdnf, pszSlot, pszKey,
+                                     &fp, &pszTmpPath);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    if (fprintf(fp, "count\t%u\n", dwCount) < 0)
+    {
+        dwError = ERROR_TDNF_SYSTEM_BASE + errno;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    for (dwIndex = 0; dwIndex < dwCount; dwIndex++)
+    {
+        dwError = _TDNFResultCacheWritePkg(fp, &pPkgInfos[dwIndex]);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    dwError = _TDNFResultCacheCommit(pTdnf, pszSlot, fp, pszTmpPath);
+    fp = NULL;
+    BAIL_ON_TDNF_ERROR(dwError);
+
+cleanup:
+    TDNF_SAFE_FREE_MEMORY(pszTmpPath);
+    return dwError;
+
+error:
+    if (fp)
+    {
+        fclose(fp);
+        unlink(pszTmpPath);
+    }
+    goto cleanup;
+}
+
+uint32_t
+TDNFResultCacheReadPkgInfoArray(
+    PTDNF pTdnf,
+    const char *pszSlot,
+    const char *pszKey,
+    PTDNF_PKG_INFO *ppPkgInfos,
+    uint32_t *pdwCount
+    )
+{
+    uint32_t dwError = 0;
+    FILE *fp = NULL;
+    char *pszLine = NULL;
+    size_t nLineSize = 0;
+    ssize_t nRead = 0;
+    PTDNF_PKG_INFO pPkgInfos = NULL;
+    uint32_t dwCount = 0;
+    uint32_t dwIndex = 0;
+
+    if (!pTdnf || !pTdnf->pConf || IsNullOrEmptyString(pszSlot) ||
+        IsNullOrEmptyString(pszKey) || !ppPkgInfos || !pdwCount)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    dwError = _TDNFResultCacheOpen(pTdnf, pszSlot, pszKey, &fp);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    if (getline(&pszLine, &nLineSize, fp) < 0 ||
+        sscanf(pszLine, "count\t%u", &dwCount) != 1)
+    {
+        dwError = ERROR_TDNF_NO_DATA;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    if (dwCount > 0)
+    {
+        dwError = TDNFAllocateMemory(dwCount, sizeof(TDNF_PKG_INFO),
+                                     (void **)&pPkgInfos);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    for (dwIndex = 0; dwIndex < dwCount; dwIndex++)
+    {
+        nRead = getline(&pszLine, &nLineSize, fp);
+        if (nRead <= 0)
+        {
+            dwError = ERROR_TDNF_NO_DATA;
+            BAIL_ON_TDNF_ERROR(dwError);
+        }
+        if (pszLine[nRead - 1] == '\n')
+        {
+            pszLine[nRead - 1] = '\0';
+        }
+
+        dwError = _TDNFResultCacheReadPkg(pszLine, &pPkgInfos[dwIndex]);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    *ppPkgInfos = pPkgInfos;
+    *pdwCount = dwCount;
+
+cleanup:
+    if (pszLine)
+    {
+        free(pszLine);
+    }
+    if (fp)
+    {
+        fclose(fp);
+    }
+    return dwError;
+
+error:
+    if (ppPkgInfos)
+    {
+        *ppPkgInfos = NULL;
+    }
+    if (pdwCount)
+    {
+        *pdwCount = 0;
+    }
+    if (pPkgInfos)
+    {
+        TDNFFreePackageInfoArray(pPkgInfos, dwCount);
+    }
+    goto cleanup;
+}
+
+static
+uint32_t
+_TDNFResultCacheWriteAdvisory(
+    FILE *fp,
+    PTDNF_UPDATE_SUMMARY_ADV pAdv
+    )
+{
+    uint32_t dwError = 0;
+
+    if (!_TDNFResultCacheIsSafeString(pAdv->pszPkgName) ||
+        !_TDNFResultCacheIsSafeString(pAdv->pszID) ||
+        !_TDNFResultCacheIsSafeString(pAdv->pszSeverity))
+    {
+        dwError = ERROR_TDNF_NO_DATA;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    if (fprintf(fp, "adv\t%d\t%d\t%s\t%s\t%s\n",
+                pAdv->nType,
+                pAdv->nRebootRequired,
+                pAdv->pszPkgName ? pAdv->pszPkgName : "",
+                pAdv->pszID ? pAdv->pszID : "",
+                pAdv->pszSeverity ? pAdv->pszSeverity : "") < 0)
+    {
+        dwError = ERROR_TDNF_SYSTEM_BASE + errno;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+cleanup:
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+static
+uint32_t
+_TDNFResultCacheReadAdvisory(
+    char *pszLine,
+    PTDNF_UPDATE_SUMMARY_ADV pAdv
+    )
+{
+    uint32_t dwError = 0;
+    uint32_t dwValue = 0;
+
+    /* skip the tag */
+    dwError = _TDNFResultCacheReadField(&pszLine, NULL);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = _TDNFResultCacheReadUInt(&pszLine, &dwValue);
+    BAIL_ON_TDNF_ERROR(dwError);
+    if (dwValue > UPDATE_ENHANCEMENT)
+    {
+        dwError = ERROR_TDNF_NO_DATA;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+    pAdv->nType = dwValue;
+
+    dwError = _TDNFResultCacheReadUInt(&pszLine, &dwValue);
+    BAIL_ON_TDNF_ERROR(dwError);
+    pAdv->nRebootRequired = dwValue;
+
+    dwError = _TDNFResultCacheReadField(&pszLine, &pAdv->pszPkgName);
+    BAIL_ON_TDNF_ERROR(dwError);
+    dwError = _TDNFResultCacheReadField(&pszLine, &pAdv->pszID);
+    BAIL_ON_TDNF_ERROR(dwError);
+    dwError = _TDNFResultCacheReadField(&pszLine, &pAdv->pszSeverity);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+cleanup:
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+/*
+ * The update summary is meant to be read by monitoring as well,
+ * so it is plain text:
+ *   tdnf-result-cache <version> <key>
+ *   generated <time>
+ *   count <number of upgrades>
+ *   pkg <epoch> <installsize> <downloadsize> <name> <arch> <version>
+ *       <release> <evr> <repo> <location> <summary>
+ *   adv <type> <rebootrequired> <installed pkg> <id> <severity>
+ * with fields separated by tabs. There is one adv line for each
+ * installed package an advisory applies to.
+ */
+uint32_t
+TDNFResultCacheWriteUpdateSummary(
+    PTDNF pTdnf,
+    const char *pszKey,
+    PTDNF_UPDATE_SUMMARY pSummary
+    )
+{
+    uint32_t dwError = 0;
+    FILE *fp = NULL;
+    char *pszTmpPath = NULL;
+    PTDNF_UPDATE_SUMMARY_ADV pAdv = NULL;
+    uint32_t dwIndex = 0;
+
+    if (!pTdnf || !pTdnf->pConf || IsNullOrEmptyString(pszKey) ||
+        !pSummary || (pSummary->dwPkgCount && !pSummary->pPkgInfos))
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    dwError = _TDNFResultCacheCreate(pTdnf,
+                                     TDNF_RESULT_CACHE_SLOT_UPDATE_SUMMARY,
+                                     pszKey,
+                                     &fp,
+                                     &pszTmpPath);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    if (fprintf(fp, "generated\t%lld\ncount\t%u\n",
+                (long long)pSummary->tGenerated,
+                pSummary->dwPkgCount) < 0)
+    {
+        dwError = ERROR_TDNF_SYSTEM_BASE + errno;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    for (dwIndex = 0; dwIndex < pSummary->dwPkgCount; dwIndex++)
+    {
+        dwError = _TDNFResultCacheWritePkg(fp, &pSummary->pPkgInfos[dwIndex]);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    for (pAdv = pSummary->pAdvisories; pAdv; pAdv = pAdv->pNext)
+    {
+        dwError = _TDNFResultCacheWriteAdvisory(fp, pAdv);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    dwError = _TDNFResultCacheCommit(pTdnf,
+                                     TDNF_RESULT_CACHE_SLOT_UPDATE_SUMMARY,
+                                     fp,
+                                     pszTmpPath);
+    fp = NULL;
+    BAIL_ON_TDNF_ERROR(dwError);
+
+cleanup:
+    TDNF_SAFE_FREE_MEMORY(pszTmpPath);
+    return dwError;
+
+error:
+    if (fp)
+    {
+        fclose(fp);
+        unlink(pszTmpPath);
+    }
+    goto cleanup;
+}
+
+uint32_t
+TDNFResultCacheReadUpdateSummary(
+    PTDNF pTdnf,
+    const char *pszKey,
+    PTDNF_UPDATE_SUMMARY *ppSummary
+    )
+{
+    uint32_t dwError = 0;
+    FILE *fp = NULL;
+    char *pszLine = NULL;
+    size_t nLineSize = 0;
+    ssize_t nRead = 0;
+    PTDNF_UPDATE_SUMMARY pSummary = NULL;
+    PTDNF_UPDATE_SUMMARY_ADV pAdv = NULL;
+    PTDNF_UPDATE_SUMMARY_ADV pLast = NULL;
+    long long llGenerated = 0;
+    uint32_t dwCount = 0;
+    uint32_t dwIndex = 0;
+
+    if (!pTdnf || !pTdnf->pConf || IsNullOrEmptyString(pszKey) ||
+        !ppSummary)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    dwError = _TDNFResultCacheOpen(pTdnf,
+                                   TDNF_RESULT_CACHE_SLOT_UPDATE_SUMMARY,
+                                   pszKey,
+                                   &fp);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFAllocateMemory(1, sizeof(TDNF_UPDATE_SUMMARY),
+                                 (void **)&pSummary);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    if (getline(&pszLine, &nLineSize, fp) < 0 ||
+        sscanf(pszLine, "generated\t%lld", &llGenerated) != 1 ||
+        getline(&pszLine, &nLineSize, fp) < 0 ||
+        sscanf(pszLine, "count\t%u", &dwCount) != 1)
+    {
+        dwError = ERROR_TDNF_NO_DATA;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+    pSummary->tGenerated = llGenerated;
+
+    if (dwCount > 0)
+    {
+        dwError = TDNFAllocateMemory(dwCount, sizeof(TDNF_PKG_INFO),
+                                     (void **)&pSummary->pPkgInfos);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+    /* set now, so the error path frees what was read so far */
+    pSummary->dwPkgCount = dwCount;
+
+    for (dwIndex = 0; dwIndex < dwCount; dwIndex++)
+    {
+        nRead = getline(&pszLine, &nLineSize, fp);
+        if (nRead <= 0)
+        {
+            dwError = ERROR_TDNF_NO_DATA;
+            BAIL_ON_TDNF_ERROR(dwError);
+        }
+        if (pszLine[nRead - 1] == '\n')
+        {
+            pszLine[nRead - 1] = '\0';
+        }
+
+        dwError = _TDNFResultCacheReadPkg(pszLine,
+                                          &pSummary->pPkgInfos[dwIndex]);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    while ((nRead = getline(&pszLine, &nLineSize, fp)) > 0)
+    {
+        if (pszLine[nRead - 1] == '\n')
+        {
+            pszLine[nRead - 1] = '\0';
+        }
+        if (strncmp(pszLine, "adv\t", 4))
+        {
+            dwError = ERROR_TDNF_NO_DATA;
+            BAIL_ON_TDNF_ERROR(dwError);
+        }
+
+        dwError = TDNFAllocateMemory(1, sizeof(TDNF_UPDATE_SUMMARY_ADV),
+                                     (void **)&pAdv);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        if (pLast)
+        {
+            pLast->pNext = pAdv;
+        }
+        else
+        {
+            pSummary->pAdvisories = pAdv;
+        }
+        pLast = pAdv;
+
+        dwError = _TDNFResultCacheReadAdvisory(pszLine, pAdv);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    *ppSummary = pSummary;
+
+cleanup:
+    if (pszLine)
+    {
+        free(pszLine);
+    }
+    if (fp)
+    {
+        fclose(fp);
+    }
+    return dwError;
+
+error:
+    if (ppSummary)
+    {
+        *ppSummary = NULL;
+    }
+    TDNFFreeUpdateSummary(pSummary);
+    goto cleanup;
+}
+
+uint32_t
+TDNFResultCacheRemove(
+    PTDNF pTdnf
+    )
+{
+    uint32_t dwError = 0;
+    char *pszDir = NULL;
+
+    if (!pTdnf || !pTdnf->pConf)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    dwError = TDNFJoinPath(&pszDir,
+                           pTdnf->pConf->pszCacheDir,
+                           TDNF_RESULT_CACHE_DIR_NAME,
+                           NULL);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFRecursivelyRemoveDir(pszDir);
+    if (dwError == ERROR_TDNF_SYSTEM_BASE + ENOENT)
+    {
+        dwError = 0;
+    }
+    BAIL_ON_TDNF_ERROR(dwError);
+
+cleanup:
+    TDNF_SAFE_FREE_MEMORY(pszDir);
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+void
+TDNFFreeFileDigests(
+    PTDNF_FILE_DIGEST pDigests,
+    uint32_t dwCount
+    )
+{
+    uint32_t dwIndex = 0;
+
+    if (pDigests)
+    {
+        for (dwIndex = 0; dwIndex < dwCount; dwIndex++)
+        {
+            TDNF_SAFE_FREE_MEMORY(pDigests[dwIndex].pszPath);
+            TDNF_SAFE_FREE_MEMORY(pDigests[dwIndex].pszDigest);
+        }
+        TDNFFreeMemory(pDigests);
+    }
+}
+
+static
+uint32_t
+_TDNFResultCacheReadInt64(
+    char **ppszLine,
+    int64_t *pllValue
+    )
+{
+    uint32_t dwError = 0;
+    char *pszField = NULL;
+    char *pszEnd = NULL;
+
+    pszField = strsep(ppszLine, "\t");
+    if (IsNullOrEmptyString(pszField))
+    {
+        dwError = ERROR_TDNF_NO_DATA;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    *pllValue = strtoll(pszField, &pszEnd, 10);
+    if (*pszEnd)
+    {
+        dwError = ERROR_TDNF_NO_DATA;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+cleanup:
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+/*
+ * The file digest slot does not depend on repos or the rpmdb,
+ * entries are checked against the file when used. The format is
+ *   count <n>
+ *   file <size> <mtime sec> <mtime nsec> <hash type> <digest> <path>
+ */
+uint32_t
+TDNFResultCacheWriteFileDigests(
+    PTDNF pTdnf,
+    PTDNF_FILE_DIGEST pDigests,
+    uint32_t dwCount
+    )
+{
+    uint32_t dwError = 0;
+    FILE *fp = NULL;
+    char *pszTmpPath = NULL;
+    uint32_t dwIndex = 0;
+    uint32_t dwWritten = 0;
+
+    if (!pTdnf || !pTdnf->pConf || (dwCount && !pDigests))
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    for (dwIndex = 0; dwIndex < dwCount; dwIndex++)
+    {
+        if (_TDNFResultCacheIsSafeString(pDigests[dwIndex].pszPath))
+        {
+            dwWritten++;
+        }
+    }
+
+    dwError = _TDNFResultCacheCreate(pTdnf,
+                                     TDNF_RESULT_CACHE_SLOT_FILE_DIGESTS,
+                                     TDNF_RESULT_CACHE_SLOT_FILE_DIGESTS,
+                                     &fp,
+                                     &pszTmpPath);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    if (fprintf(fp, "count\t%u\n", dwWritten) < 0)
+    {
+        dwError = ERROR_TDNF_SYSTEM_BASE + errno;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    for (dwIndex = 0; dwIndex < dwCount; dwIndex++)
+    {
+        PTDNF_FILE_DIGEST pDigest = &pDigests[dwIndex];
+
+        /* paths we cannot store are hashed again next time */
+        if (!_TDNFResultCacheIsSafeString(pDigest->pszPath))
+        {
+            continue;
+        }
+        if (fprintf(fp, "file\t%llu\t%lld\t%ld\t%d\t%s\t%s\n",
+                    (unsigned long long)pDigest->qwSize,
+                    (long long)pDigest->llMTimeSec,
+                    pDigest->lMTimeNSec,
+                    pDigest->nHashType,
+                    pDigest->pszDigest,
+                    pDigest->pszPath) < 0)
+        {
+            dwError = ERROR_TDNF_SYSTEM_BASE + errno;
+            BAIL_ON_TDNF_ERROR(dwError);
+        }
+    }
+
+    dwError = _TDNFResultCacheCommit(pTdnf,
+                                     TDNF_RESULT_CACHE_SLOT_FILE_DIGESTS,
+                                     fp,
+                                     pszTmpPath);
+    fp = NULL;
+    BAIL_ON_TDNF_ERROR(dwError);
+
+cleanup:
+    TDNF_SAFE_FREE_MEMORY(pszTmpPath);
+    return dwError;
+
+error:
+    if (fp)
+    {
+        fclose(fp);
+        unlink(pszTmpPath);
+    }
+    goto cleanup;
+}
+
+uint32_t
+TDNFResultCacheReadFileDigests(
+    PTDNF pTdnf,
+    PTDNF_FILE_DIGEST *ppDigests,
+    uint32_t *pdwCount
+    )
+{
+    uint32_t dwError = 0;
+    FILE *fp = NULL;
+    char *pszLine = NULL;
+    char *pszCursor = NULL;
+    size_t nLineSize = 0;
+    ssize_t nRead = 0;
+    PTDNF_FILE_DIGEST pDigests = NULL;
+    PTDNF_FILE_DIGEST pDigest = NULL;
+    uint32_t dwCount = 0;
+    uint32_t dwIndex = 0;
+    int64_t llValue = 0;
+
+    if (!pTdnf || !pTdnf->pConf || !ppDigests || !pdwCount)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    dwError = _TDNFResultCacheOpen(pTdnf,
+                                   TDNF_RESULT_CACHE_SLOT_FILE_DIGESTS,
+                                   TDNF_RESULT_CACHE_SLOT_FILE_DIGESTS,
+                                   &fp);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    if (getline(&pszLine, &nLineSize, fp) < 0 ||
+        sscanf(pszLine, "count\t%u", &dwCount) != 1 ||
+        dwCount == 0)
+    {
+        dwError = ERROR_TDNF_NO_DATA;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    dwError = TDNFAllocateMemory(dwCount, sizeof(TDNF_FILE_DIGEST),
+                                 (void **)&pDigests);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    for (dwIndex = 0; dwIndex < dwCount; dwIndex++)
+    {
+        pDigest = &pDigests[dwIndex];
+
+        nRead = getline(&pszLine, &nLineSize, fp);
+        if (nRead <= 0 || strncmp(pszLine, "file\t", 5))
+        {
+            dwError = ERROR_TDNF_NO_DATA;
+            BAIL_ON_TDNF_ERROR(dwError);
+        }
+        if (pszLine[nRead - 1] == '\n')
+        {
+            pszLine[nRead - 1] = '\0';
+        }
+        pszCursor = pszLine + 5;
+
+        dwError = _TDNFResultCacheReadInt64(&pszCursor, &llValue);
+        BAIL_ON_TDNF_ERROR(dwError);
+        pDigest->qwSize = llValue;
+        dwError = _TDNFResultCacheReadInt64(&pszCursor, &pDigest->llMTimeSec);
+        BAIL_ON_TDNF_ERROR(dwError);
+        dwError = _TDNFResultCacheReadInt64(&pszCursor, &llValue);
+        BAIL_ON_TDNF_ERROR(dwError);
+        pDigest->lMTimeNSec = llValue;
+        dwError = _TDNFResultCacheReadInt64(&pszCursor, &llValue);
+        BAIL_ON_TDNF_ERROR(dwError);
+        pDigest->nHashType = llValue;
+        dwError = _TDNFResultCacheReadField(&pszCursor, &pDigest->pszDigest);
+        BAIL_ON_TDNF_ERROR(dwError);
+        dwError = _TDNFResultCacheReadField(&pszCursor, &pDigest->pszPath);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        if (!pDigest->pszDigest || !pDigest->pszPath)
+        {
+            dwError = ERROR_TDNF_NO_DATA;
+            BAIL_ON_TDNF_ERROR(dwError);
+        }
+    }
+
+    *ppDigests = pDigests;
+    *pdwCount = dwCount;
+
+cleanup:
+    if (pszLine)
+    {
+        free(pszLine);
+    }
+    if (fp)
+    {
+        fclose(fp);
+    }
+    return dwError;
+
+error:
+    if (ppDigests)
+    {
+        *ppDigests = NULL;
+    }
+    if (pdwCount)
+    {
+        *pdwCount = 0;
+    }
+    TDNFFreeFileDigests(pDigests, dwCount);
+    goto cleanup;
+}
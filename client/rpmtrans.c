@@ -39,6 +39,17 @@ TDNFRpmCleanupTS(PTDNF pTdnf,
         {
             TDNFRemoveCachedRpms(pTS->pCachedRpmsArray);
         }
+        else
+        {
+            /* the transaction is done, a failure here only
+               leaves the cache over the budget */
+            dwError = TDNFCacheEnforceBudget(pTdnf);
+            if (dwError)
+            {
+                pr_err("could not apply cache_budget: error %u\n", dwError);
+                dwError = 0;
+            }
+        }
         TDNFFreeCachedRpmsArray(pTS->pCachedRpmsArray);
     }
     TDNF_SAFE_FREE_MEMORY(pTS);
@@ -200,6 +211,10 @@ TDNFRpmExecTransaction(
     dwError = TDNFRpmCreateTS(pTdnf, pSolvedInfo, &pTS);
     BAIL_ON_TDNF_ERROR(dwError);
 
+    /* packages are downloaded and added to the transaction,
+       make room for rpm before it runs */
+    TDNFReleaseSack(pTdnf);
+
     nDownloadOnly = pTdnf->pArgs->nDownloadOnly;
     if (!nDownloadOnly) {
         if (!pTdnf->pArgs->nTestOnly)
@@ -267,6 +282,10 @@ TDNFRpmExecHistoryTransaction(
     dwError = TDNFRpmCreateTS(pTdnf, pSolvedInfo, &pTS);
     BAIL_ON_TDNF_ERROR(dwError);
 
+    /* packages are downloaded and added to the transaction,
+       make room for rpm before it runs */
+    TDNFReleaseSack(pTdnf);
+
     nDownloadOnly = pTdnf->pArgs->nDownloadOnly;
     if (!nDownloadOnly && !pTdnf->pArgs->nTestOnly) {
         int rc = 0;
@@ -418,6 +437,8 @@ TDNFPopulateTransaction(
         }
     }
 
+    TDNFPackageStoreReport(pTS->qwStoreBytes);
+
 cleanup:
     return dwError;
 
@@ -760,78 +781,64 @@ error:
     goto cleanup;
 }
 
-uint32_t
-TDNFTransAddInstallPkgs(
+/*
+ * If the package is not in the cache yet, but its checksum is in
+ * the package store, link it from there. Errors of the store just
+ * mean the package gets downloaded.
+ */
+static
+void
+_TDNFTransFetchFromStore(
     PTDNFRPMTS pTS,
     PTDNF pTdnf,
-    PTDNF_PKG_INFO pInfos,
-    int nUpgrade
+    PTDNF_PKG_INFO pInfo,
+    PTDNF_REPO_DATA pRepo
     )
 {
-    uint32_t dwError = 0;
-    PTDNF_PKG_INFO pInfo;
-
-    if(!pInfos)
+    char* pszFilePath = NULL;
+    char* pszDir = NULL;
+    uint64_t qwBytes = 0;
+
+    if (!pInfo->pbChecksum ||
+        TDNFGetPackageCachePath(pTdnf, pInfo->pszLocation, pRepo,
+                                &pszFilePath) ||
+        access(pszFilePath, F_OK) == 0 ||
+        TDNFDirName(pszFilePath, &pszDir))
     {
-        dwError = ERROR_TDNF_NO_DATA;
-        BAIL_ON_TDNF_ERROR(dwError);
+        goto cleanup;
     }
 
-    for (pInfo = pInfos; pInfo; pInfo = pInfo->pNext)
+    if (access(pszDir, F_OK) && TDNFUtilsMakeDirs(pszDir))
     {
-        PTDNF_REPO_DATA pRepo = NULL;
-
-        dwError = TDNFFindRepoById(pTdnf, pInfo->pszRepoName, &pRepo);
-        BAIL_ON_TDNF_ERROR(dwError);
-
-        dwError = TDNFTransAddInstallPkg(
-                      pTS,
-                      pTdnf,
-                      pInfo,
-                      pRepo,
-                      nUpgrade);
-        BAIL_ON_TDNF_ERROR(dwError);
+        goto cleanup;
     }
 
-cleanup:
-    return dwError;
-
-error:
-    if(dwError == ERROR_TDNF_NO_DATA)
+    if (TDNFPackageStoreFetch(pTdnf, pInfo, pszFilePath, &qwBytes) == 0)
     {
-        dwError = 0;
+        pr_info("%s package taken from the package store\n", pInfo->pszName);
+        pTS->qwStoreBytes += qwBytes;
     }
-    goto cleanup;
+
+cleanup:
+    TDNF_SAFE_FREE_MEMORY(pszFilePath);
+    TDNF_SAFE_FREE_MEMORY(pszDir);
 }
 
+/* get the file of the package, downloading it if needed */
+static
 uint32_t
-TDNFTransAddInstallPkg(
+_TDNFTransGetPackageFile(
     PTDNFRPMTS pTS,
     PTDNF pTdnf,
     PTDNF_PKG_INFO pInfo,
     PTDNF_REPO_DATA pRepo,
-    int nUpgrade
+    char **ppszFilePath
     )
 {
     uint32_t dwError = 0;
-    int nGPGCheck = 0;
     char* pszFilePath = NULL;
-    Header rpmHeader = NULL;
-    PTDNF_CACHED_RPM_ENTRY pRpmCache = NULL;
-    const char* pszPackageLocation = NULL;
-    const char* pszPkgName = NULL;
-    uint8_t digest_from_file[EVP_MAX_MD_SIZE] = {0};
-    hash_op *hash = NULL;
-    int nSize;
-
-    if(!pTS || !pTdnf || !pInfo || !pRepo)
-    {
-        dwError = ERROR_TDNF_INVALID_PARAMETER;
-        BAIL_ON_TDNF_ERROR(dwError);
-    }
-
-    pszPackageLocation = pInfo->pszLocation;
-    pszPkgName = pInfo->pszName;
+    const char* pszPackageLocation = pInfo->pszLocation;
+    const char* pszPkgName = pInfo->pszName;
 
     if (pszPackageLocation[0] == '/')
     {
@@ -867,11 +874,14 @@ TDNFTransAddInstallPkg(
 
             if (!nInPlace)
             {
+                _TDNFTransFetchFromStore(pTS, pTdnf, pInfo, pRepo);
+
                 dwError = TDNFDownloadPackageToCache(
                               pTdnf,
                               pszPackageLocation,
                               pszPkgName,
                               pRepo,
+                              pInfo,
                               &pszFilePath
                 );
             }
@@ -883,6 +893,7 @@ TDNFTransAddInstallPkg(
                           pszPackageLocation,
                           pszPkgName,
                           pRepo,
+                          pInfo,
                           pTdnf->pArgs->pszDownloadDir,
                           &pszFilePath
             );
@@ -900,7 +911,118 @@ TDNFTransAddInstallPkg(
         BAIL_ON_TDNF_SYSTEM_ERROR(dwError);
     }
 
-    if(pInfo->pbChecksum != NULL) {
+    *ppszFilePath = pszFilePath;
+
+cleanup:
+    return dwError;
+
+error:
+    TDNF_SAFE_FREE_MEMORY(pszFilePath);
+    goto cleanup;
+}
+
+/*
+ * Look up the file of pJob in the verify cache of its repo, which
+ * is loaded on first use. Anything missing just means the file is
+ * verified in full.
+ */
+static
+void
+_TDNFTransLookupVerifyCache(
+    PTDNFRPMTS pTS,
+    PTDNF pTdnf,
+    PTDNF_VERIFY_CACHE *ppCaches,
+    char ***pppszTrustedKeys,
+    PTDNF_TRANS_VERIFY_JOB pJob
+    )
+{
+    PTDNF_VERIFY_CACHE pCache = NULL;
+    PTDNF_VERIFY_CACHE_ENTRY pEntry = NULL;
+    PTDNF_PKG_INFO pInfo = pJob->pInfo;
+    char *pszDigest = NULL;
+
+    if (!pInfo->pbChecksum ||
+        pInfo->pszLocation[0] == '/' ||
+        stat(pJob->pszFilePath, &pJob->st))
+    {
+        goto cleanup;
+    }
+
+    for (pCache = *ppCaches; pCache; pCache = pCache->pNext)
+    {
+        if (pCache->pRepo == pJob->pRepo)
+        {
+            break;
+        }
+    }
+    if (!pCache)
+    {
+        if (TDNFVerifyCacheLoad(pTdnf, pJob->pRepo, &pCache))
+        {
+            goto cleanup;
+        }
+        pCache->pNext = *ppCaches;
+        *ppCaches = pCache;
+    }
+    pJob->pCache = pCache;
+
+    pEntry = TDNFVerifyCacheLookup(pCache, &pJob->st);
+    if (!pEntry ||
+        pEntry->nHashType != pInfo->nChecksumType ||
+        TDNFDigestToHex(pInfo->pbChecksum, pInfo->nChecksumType, &pszDigest) ||
+        strcmp(pszDigest, pEntry->pszDigest))
+    {
+        goto cleanup;
+    }
+    pJob->nDigestCached = 1;
+    pJob->pszDigest = pszDigest;
+    pszDigest = NULL;
+
+    /* the key may have been removed since */
+    if (pEntry->pszKeyId)
+    {
+        if (!*pppszTrustedKeys)
+        {
+            TDNFVerifyCacheGetTrustedKeys(pTS->pTS, pppszTrustedKeys);
+        }
+        if (TDNFVerifyCacheIsKeyTrusted(*pppszTrustedKeys, pEntry->pszKeyId) &&
+            TDNFAllocateString(pEntry->pszKeyId, &pJob->pszKeyId) == 0)
+        {
+            pJob->nKeyTrusted = 1;
+        }
+    }
+
+cleanup:
+    TDNF_SAFE_FREE_MEMORY(pszDigest);
+}
+
+/*
+ * Check the file of pJob against checksum and size from the
+ * metadata and read its header with ts. Files the verify cache
+ * knows are not hashed again, and if their key is still trusted
+ * their header is read with tsTrusted, which skips signatures.
+ * Signature problems are left in dwRpmRc for
+ * _TDNFTransAddVerifiedPkg(), which can ask about importing keys.
+ * Does not touch any shared state, so it runs in the verify workers.
+ */
+static
+uint32_t
+_TDNFTransVerifyPkg(
+    PTDNF_TRANS_VERIFY_CONTEXT pCtx,
+    rpmts ts,
+    rpmts tsTrusted,
+    PTDNF_TRANS_VERIFY_JOB pJob
+    )
+{
+    uint32_t dwError = 0;
+    PTDNF_PKG_INFO pInfo = pJob->pInfo;
+    const char *pszFilePath = pJob->pszFilePath;
+    uint8_t digest_from_file[EVP_MAX_MD_SIZE] = {0};
+    hash_op *hash = NULL;
+    int nSize;
+    FD_t fp = NULL;
+
+    if(pInfo->pbChecksum != NULL && !pJob->nDigestCached) {
         hash = hash_ops + pInfo->nChecksumType;
 
         dwError = TDNFGetDigestForFile(pszFilePath, hash, digest_from_file);
@@ -912,6 +1034,12 @@ TDNFTransAddInstallPkg(
             dwError = ERROR_TDNF_CHECKSUM_MISMATCH;
             BAIL_ON_TDNF_ERROR(dwError);
         }
+
+        if (pJob->pCache)
+        {
+            TDNFDigestToHex(digest_from_file, pInfo->nChecksumType,
+                            &pJob->pszDigest);
+        }
     }
 
     dwError = TDNFGetFileSize(pszFilePath, &nSize);
@@ -923,9 +1051,97 @@ TDNFTransAddInstallPkg(
         BAIL_ON_TDNF_ERROR(dwError);
     }
 
-    dwError = TDNFGPGCheckPackage(pTS, pTdnf, pRepo, pszFilePath, &rpmHeader);
+    fp = Fopen(pszFilePath, "r.ufdio");
+    if(!fp)
+    {
+        dwError = errno;
+        BAIL_ON_TDNF_SYSTEM_ERROR(dwError);
+    }
+
+    pJob->dwRpmRc = rpmReadPackageFile(pJob->nKeyTrusted ? tsTrusted : ts,
+                                       fp, pszFilePath, &pJob->rpmHeader);
+
+    /* remember which key vouched for it */
+    if (pJob->dwRpmRc == RPMRC_OK &&
+        pJob->pCache &&
+        !pJob->nKeyTrusted &&
+        !(pCtx->nVSFlags & RPMVSF_MASK_NOSIGNATURES))
+    {
+        TDNFVerifyCacheGetKeyId(pJob->rpmHeader, &pJob->pszKeyId);
+    }
+
+cleanup:
+    if (fp)
+    {
+        Fclose(fp);
+    }
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+/*
+ * Add a package that went through _TDNFTransVerifyPkg() to the
+ * transaction. Takes ownership of its file path and header.
+ */
+static
+uint32_t
+_TDNFTransAddVerifiedPkg(
+    PTDNFRPMTS pTS,
+    PTDNF pTdnf,
+    PTDNF_TRANS_VERIFY_JOB pJob,
+    int nUpgrade
+    )
+{
+    uint32_t dwError = 0;
+    int nGPGCheck = 0;
+    int nGPGSigCheck = 0;
+    PTDNF_PKG_INFO pInfo = pJob->pInfo;
+    PTDNF_REPO_DATA pRepo = pJob->pRepo;
+    char* pszFilePath = pJob->pszFilePath;
+    Header rpmHeader = pJob->rpmHeader;
+    PTDNF_CACHED_RPM_ENTRY pRpmCache = NULL;
+    uint64_t qwStoreBytes = 0;
+
+    pJob->pszFilePath = NULL;
+    pJob->rpmHeader = NULL;
+
+    dwError = pJob->dwError;
     BAIL_ON_TDNF_ERROR(dwError);
 
+    /* only kept packages go to the store, else it would keep them */
+    if ((pTdnf->pConf->nKeepCache || pTdnf->pArgs->nDownloadOnly) &&
+        !strncmp(pszFilePath, pTdnf->pConf->pszCacheDir,
+            strlen(pTdnf->pConf->pszCacheDir)) &&
+        TDNFPackageStoreAdd(pTdnf, pInfo, pszFilePath, &qwStoreBytes) == 0)
+    {
+        pTS->qwStoreBytes += qwStoreBytes;
+    }
+
+    if (pJob->dwRpmRc == RPMRC_NOTTRUSTED || pJob->dwRpmRc == RPMRC_NOKEY)
+    {
+        dwError = TDNFGetGPGSignatureCheck(pTdnf, pRepo, &nGPGSigCheck, NULL);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+    else
+    {
+        dwError = pJob->dwRpmRc;
+        BAIL_ON_TDNF_RPM_ERROR(dwError);
+    }
+
+    /* keys may have to be imported, which is interactive */
+    if (nGPGSigCheck)
+    {
+        if (rpmHeader)
+        {
+            headerFree(rpmHeader);
+            rpmHeader = NULL;
+        }
+        dwError = TDNFGPGCheckPackage(pTS, pTdnf, pRepo, pszFilePath, &rpmHeader);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
     dwError = TDNFGetGPGCheck(pTdnf, pRepo->pszId, &nGPGCheck);
     BAIL_ON_TDNF_ERROR(dwError);
     if (!nGPGCheck)
@@ -949,6 +1165,18 @@ TDNFTransAddInstallPkg(
         BAIL_ON_TDNF_RPM_ERROR(dwError);
     }
 
+    if (pJob->pCache && pJob->pszDigest)
+    {
+        /* verified just now after importing its key */
+        if (nGPGSigCheck && !pJob->pszKeyId)
+        {
+            TDNFVerifyCacheGetKeyId(rpmHeader, &pJob->pszKeyId);
+        }
+        TDNFVerifyCacheSet(pJob->pCache, pszFilePath, &pJob->st,
+                           pInfo->nChecksumType, pJob->pszDigest,
+                           pJob->pszKeyId);
+    }
+
     /* add to cached array only when file is actually in cache dir */
     if(pTS->pCachedRpmsArray &&
         !strncmp(pszFilePath, pTdnf->pConf->pszCacheDir,
@@ -976,12 +1204,309 @@ cleanup:
     return dwError;
 
 error:
-    pr_err("Error processing package: %s\n", pszPackageLocation);
+    pr_err("Error processing package: %s\n", pInfo->pszLocation);
     TDNF_SAFE_FREE_MEMORY(pszFilePath);
     TDNF_SAFE_FREE_MEMORY(pRpmCache);
     goto cleanup;
 }
 
+static
+void *
+_TDNFTransVerifyWorker(
+    void *pArg
+    )
+{
+    PTDNF_TRANS_VERIFY_CONTEXT pCtx = (PTDNF_TRANS_VERIFY_CONTEXT)pArg;
+    PTDNF_TRANS_VERIFY_JOB pJob = NULL;
+    rpmts ts = NULL;
+    rpmts tsTrusted = NULL;
+
+    ts = rpmtsCreate();
+    tsTrusted = rpmtsCreate();
+    if (ts && tsTrusted)
+    {
+        rpmtsSetKeyring(ts, pCtx->pKeyring);
+        rpmtsSetVSFlags(ts, pCtx->nVSFlags);
+        rpmtsSetVSFlags(tsTrusted, pCtx->nVSFlags |
+                                   RPMVSF_MASK_NODIGESTS |
+                                   RPMVSF_MASK_NOSIGNATURES);
+    }
+
+    for (;;)
+    {
+        pJob = NULL;
+        pthread_mutex_lock(&pCtx->mutex);
+        if (pCtx->dwNextJob < pCtx->dwJobCount)
+        {
+            pJob = &pCtx->pJobs[pCtx->dwNextJob++];
+        }
+        pthread_mutex_unlock(&pCtx->mutex);
+
+        if (!pJob)
+        {
+            break;
+        }
+        pJob->dwError = (ts && tsTrusted) ?
+                        _TDNFTransVerifyPkg(pCtx, ts, tsTrusted, pJob) :
+                        ERROR_TDNF_RPMTS_CREATE_FAILED;
+    }
+
+    if (ts)
+    {
+        rpmtsFree(ts);
+    }
+    if (tsTrusted)
+    {
+        rpmtsFree(tsTrusted);
+    }
+    return NULL;
+}
+
+/*
+ * Verify the files of pJobs on a pool of workers sized to the
+ * number of CPUs. Results are kept in the jobs.
+ */
+static
+uint32_t
+_TDNFTransVerifyPkgs(
+    PTDNFRPMTS pTS,
+    PTDNF_TRANS_VERIFY_JOB pJobs,
+    uint32_t dwJobCount
+    )
+{
+    uint32_t dwError = 0;
+    TDNF_TRANS_VERIFY_CONTEXT ctx = {0};
+    pthread_t *pThreads = NULL;
+    long lWorkers = 0;
+    int nStarted = 0;
+    int i;
+
+    lWorkers = sysconf(_SC_NPROCESSORS_ONLN);
+    if (lWorkers > TDNF_VERIFY_MAX_WORKERS)
+    {
+        lWorkers = TDNF_VERIFY_MAX_WORKERS;
+    }
+    if (lWorkers > (long)dwJobCount)
+    {
+        lWorkers = dwJobCount;
+    }
+
+    ctx.pJobs = pJobs;
+    ctx.dwJobCount = dwJobCount;
+    ctx.pKeyring = rpmtsGetKeyring(pTS->pTS, 1);
+    ctx.nVSFlags = rpmtsVSFlags(pTS->pTS);
+    pthread_mutex_init(&ctx.mutex, NULL);
+
+    if (lWorkers > 1)
+    {
+        dwError = TDNFAllocateMemory(lWorkers, sizeof(pthread_t),
+                                     (void **)&pThreads);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        for (nStarted = 0; nStarted < lWorkers; nStarted++)
+        {
+            if (pthread_create(&pThreads[nStarted], NULL,
+                               _TDNFTransVerifyWorker, &ctx))
+            {
+                break;
+            }
+        }
+        for (i = 0; i < nStarted; i++)
+        {
+            pthread_join(pThreads[i], NULL);
+        }
+    }
+
+    /* one CPU, or no threads */
+    if (nStarted == 0)
+    {
+        _TDNFTransVerifyWorker(&ctx);
+    }
+
+cleanup:
+    if (ctx.pKeyring)
+    {
+        rpmKeyringFree(ctx.pKeyring);
+    }
+    pthread_mutex_destroy(&ctx.mutex);
+    TDNF_SAFE_FREE_MEMORY(pThreads);
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+static
+void
+_TDNFTransFreeVerifyJob(
+    PTDNF_TRANS_VERIFY_JOB pJob
+    )
+{
+    TDNF_SAFE_FREE_MEMORY(pJob->pszFilePath);
+    TDNF_SAFE_FREE_MEMORY(pJob->pszDigest);
+    TDNF_SAFE_FREE_MEMORY(pJob->pszKeyId);
+    if (pJob->rpmHeader)
+    {
+        headerFree(pJob->rpmHeader);
+        pJob->rpmHeader = NULL;
+    }
+}
+
+static
+void
+_TDNFTransFreeVerifyJobs(
+    PTDNF_TRANS_VERIFY_JOB pJobs,
+    uint32_t dwJobCount
+    )
+{
+    uint32_t i;
+
+    if (pJobs)
+    {
+        for (i = 0; i < dwJobCount; i++)
+        {
+            _TDNFTransFreeVerifyJob(&pJobs[i]);
+        }
+        TDNFFreeMemory(pJobs);
+    }
+}
+
+/*
+ * Packages are downloaded one after the other, or over shared
+ * connections with max_concurrent_streams, then their files are
+ * verified in parallel. They are added to the transaction in the
+ * original order, so prompts and errors come as before.
+ */
+uint32_t
+TDNFTransAddInstallPkgs(
+    PTDNFRPMTS pTS,
+    PTDNF pTdnf,
+    PTDNF_PKG_INFO pInfos,
+    int nUpgrade
+    )
+{
+    uint32_t dwError = 0;
+    PTDNF_PKG_INFO pInfo;
+    PTDNF_TRANS_VERIFY_JOB pJobs = NULL;
+    uint32_t dwJobCount = 0;
+    PTDNF_VERIFY_CACHE pCaches = NULL;
+    PTDNF_VERIFY_CACHE pCache = NULL;
+    char **ppszTrustedKeys = NULL;
+    uint32_t i;
+
+    if(!pInfos)
+    {
+        dwError = ERROR_TDNF_NO_DATA;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    for (pInfo = pInfos; pInfo; pInfo = pInfo->pNext)
+    {
+        dwJobCount++;
+    }
+
+    dwError = TDNFAllocateMemory(dwJobCount, sizeof(TDNF_TRANS_VERIFY_JOB),
+                                 (void **)&pJobs);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    /* with max_concurrent_streams the packages for the cache come in
+       all at once, the loop below then finds them there */
+    if (!pTdnf->pArgs->nDownloadOnly || pTdnf->pArgs->pszDownloadDir == NULL)
+    {
+        dwError = TDNFDownloadPackagesToCache(pTdnf, pInfos);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    for (pInfo = pInfos, i = 0; pInfo; pInfo = pInfo->pNext, i++)
+    {
+        pJobs[i].pInfo = pInfo;
+
+        dwError = TDNFFindRepoById(pTdnf, pInfo->pszRepoName, &pJobs[i].pRepo);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        dwError = _TDNFTransGetPackageFile(pTS, pTdnf, pInfo, pJobs[i].pRepo,
+                                           &pJobs[i].pszFilePath);
+        if (dwError)
+        {
+            pr_err("Error processing package: %s\n", pInfo->pszLocation);
+        }
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        _TDNFTransLookupVerifyCache(pTS, pTdnf, &pCaches, &ppszTrustedKeys,
+                                    &pJobs[i]);
+    }
+
+    dwError = _TDNFTransVerifyPkgs(pTS, pJobs, dwJobCount);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    for (i = 0; i < dwJobCount; i++)
+    {
+        dwError = _TDNFTransAddVerifiedPkg(pTS, pTdnf, &pJobs[i], nUpgrade);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+cleanup:
+    /* what was verified stays valid even if a later package failed */
+    for (pCache = pCaches; pCache; pCache = pCache->pNext)
+    {
+        TDNFVerifyCacheSave(pCache);
+    }
+    TDNFFreeVerifyCache(pCaches);
+    TDNF_SAFE_FREE_STRINGARRAY(ppszTrustedKeys);
+    _TDNFTransFreeVerifyJobs(pJobs, dwJobCount);
+    return dwError;
+
+error:
+    if(dwError == ERROR_TDNF_NO_DATA)
+    {
+        dwError = 0;
+    }
+    goto cleanup;
+}
+
+uint32_t
+TDNFTransAddInstallPkg(
+    PTDNFRPMTS pTS,
+    PTDNF pTdnf,
+    PTDNF_PKG_INFO pInfo,
+    PTDNF_REPO_DATA pRepo,
+    int nUpgrade
+    )
+{
+    uint32_t dwError = 0;
+    TDNF_TRANS_VERIFY_JOB job = {0};
+
+    if(!pTS || !pTdnf || !pInfo || !pRepo)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    job.pInfo = pInfo;
+    job.pRepo = pRepo;
+
+    dwError = _TDNFTransGetPackageFile(pTS, pTdnf, pInfo, pRepo,
+                                       &job.pszFilePath);
+    if (dwError)
+    {
+        pr_err("Error processing package: %s\n", pInfo->pszLocation);
+    }
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = _TDNFTransVerifyPkgs(pTS, &job, 1);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = _TDNFTransAddVerifiedPkg(pTS, pTdnf, &job, nUpgrade);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+cleanup:
+    _TDNFTransFreeVerifyJob(&job);
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
 uint32_t
 TDNFTransAddErasePkgs(
     PTDNFRPMTS pTS,
@@ -19,6 +19,26 @@ typedef struct _TDNF_PLUGIN_
     struct _TDNF_PLUGIN_ *pNext;
 } TDNF_PLUGIN;
 
+//a repo key imported during the life of a handle, see gpgcheck.c
+typedef struct _TDNF_GPG_KEY
+{
+    char *pszRepoId;
+    char *pszUrl;
+    rpmKeyring pKeyring;    //just this key, set once it was fetched
+    char *pszKeyData;       //armored key, imported into each ts that lacks it
+    int nKeyDataSize;
+    int nMatched;           //packages it signed
+    struct _TDNF_GPG_KEY *pNext;
+} TDNF_GPG_KEY, *PTDNF_GPG_KEY;
+
+//health of a base url for the life of a handle, see remoterepo.c
+typedef struct _TDNF_MIRROR_HEALTH
+{
+    char *pszUrl;
+    int nFailures;          //failed or stalled transfers
+    struct _TDNF_MIRROR_HEALTH *pNext;
+} TDNF_MIRROR_HEALTH, *PTDNF_MIRROR_HEALTH;
+
 typedef struct _TDNF_
 {
     PSolvSack pSack;
@@ -27,6 +47,10 @@ typedef struct _TDNF_
     PTDNF_REPO_DATA pRepos;
     Repo *pSolvCmdLineRepo;
     PTDNF_PLUGIN pPlugins;
+    uint32_t dwInitStages;
+    PTDNF_GPG_KEY pGPGKeys;
+    PTDNF_MIRROR_HEALTH pMirrors;
+    int nPrefetching;       //packages are downloaded for makecache --prefetch
 } TDNF;
 
 typedef struct _TDNF_CACHED_RPM_ENTRY
@@ -49,8 +73,92 @@ typedef struct _TDNF_RPM_TS_
     rpmprobFilterFlags      nProbFilterFlags;
     FD_t                    pFD;
     PTDNF_CACHED_RPM_LIST   pCachedRpmsArray;
+    uint64_t                qwStoreBytes;
 } TDNFRPMTS, *PTDNFRPMTS;
 
+//a package file that was verified before, see verifycache.c
+typedef struct _TDNF_VERIFY_CACHE_ENTRY
+{
+    char *pszPath;
+    uint64_t qwDev;
+    uint64_t qwIno;
+    uint64_t qwSize;
+    int64_t llMTimeSec;
+    long lMTimeNSec;
+    int64_t llCTimeSec;
+    long lCTimeNSec;
+    int nHashType;
+    char *pszDigest;        //hex
+    char *pszKeyId;         //signature verified with this key, or NULL
+} TDNF_VERIFY_CACHE_ENTRY, *PTDNF_VERIFY_CACHE_ENTRY;
+
+typedef struct _TDNF_VERIFY_CACHE
+{
+    PTDNF_REPO_DATA pRepo;
+    char *pszPath;
+    char *pszCookie;        //of the repo metadata the entries are for
+    PTDNF_VERIFY_CACHE_ENTRY pEntries;
+    uint32_t dwCount;
+    uint32_t dwCapacity;
+    int nChanged;
+    struct _TDNF_VERIFY_CACHE *pNext;
+} TDNF_VERIFY_CACHE, *PTDNF_VERIFY_CACHE;
+
+//a cached package file or its last use, see cacheclean.c
+typedef struct _TDNF_CACHE_FILE
+{
+    char *pszPath;
+    uint64_t qwSize;
+    time_t tAccess;
+} TDNF_CACHE_FILE, *PTDNF_CACHE_FILE;
+
+typedef struct _TDNF_CACHE_FILE_LIST
+{
+    PTDNF_CACHE_FILE pFiles;
+    uint32_t dwCount;
+    uint32_t dwCapacity;
+} TDNF_CACHE_FILE_LIST, *PTDNF_CACHE_FILE_LIST;
+
+//a package download of TDNFDownloadPackagesToCache()
+typedef struct _TDNF_MULTI_XFER_
+{
+    PTDNF_PKG_INFO pInfo;
+    CURL *pCurl;
+    FILE *fp;               //open while the transfer runs
+    char *pszUrl;
+    char *pszFile;
+    char *pszFileTmp;
+    char *pszUserPass;      //must outlive the transfer
+} TDNF_MULTI_XFER, *PTDNF_MULTI_XFER;
+
+//a package file to verify before adding it to the transaction
+typedef struct _TDNF_TRANS_VERIFY_JOB_
+{
+    PTDNF_PKG_INFO pInfo;
+    PTDNF_REPO_DATA pRepo;
+    char *pszFilePath;
+    Header rpmHeader;
+    uint32_t dwRpmRc;
+    uint32_t dwError;
+    //verify cache of pRepo, and what it knows about the file
+    PTDNF_VERIFY_CACHE pCache;
+    struct stat st;
+    int nDigestCached;      //skip hashing
+    int nKeyTrusted;        //skip the signature check
+    char *pszDigest;        //hex, known good
+    char *pszKeyId;         //signature verified with this key
+} TDNF_TRANS_VERIFY_JOB, *PTDNF_TRANS_VERIFY_JOB;
+
+typedef struct _TDNF_TRANS_VERIFY_CONTEXT_
+{
+    PTDNF_TRANS_VERIFY_JOB pJobs;
+    uint32_t dwJobCount;
+    uint32_t dwNextJob;
+    rpmKeyring pKeyring;
+    rpmVSFlags nVSFlags;
+    pthread_mutex_t mutex;
+} TDNF_TRANS_VERIFY_CONTEXT, *PTDNF_TRANS_VERIFY_CONTEXT;
+
 typedef struct _TDNF_ENV_
 {
     pthread_mutex_t mutexInitialize;
@@ -81,6 +189,91 @@ typedef struct _TDNF_EVENT_DATA_
     struct _TDNF_EVENT_DATA_ *pNext;
 } TDNF_EVENT_DATA;
 
+//one advisory for one installed package, as counted by
+//TDNFUpdateInfoSummary
+typedef struct _TDNF_UPDATE_SUMMARY_ADV
+{
+    int nType;
+    int nRebootRequired;
+    char *pszPkgName;
+    char *pszID;
+    char *pszSeverity;
+    struct _TDNF_UPDATE_SUMMARY_ADV *pNext;
+} TDNF_UPDATE_SUMMARY_ADV, *PTDNF_UPDATE_SUMMARY_ADV;
+
+//precomputed at makecache, see TDNFCacheUpdateSummary
+typedef struct _TDNF_UPDATE_SUMMARY
+{
+    time_t tGenerated;
+    uint32_t dwPkgCount;
+    PTDNF_PKG_INFO pPkgInfos;
+    PTDNF_UPDATE_SUMMARY_ADV pAdvisories;
+} TDNF_UPDATE_SUMMARY, *PTDNF_UPDATE_SUMMARY;
+
+//digest of a file as it was when hashed, see TDNFResultCacheReadFileDigests
+typedef struct _TDNF_FILE_DIGEST
+{
+    char *pszPath;
+    uint64_t qwSize;
+    int64_t llMTimeSec;
+    long lMTimeNSec;
+    int nHashType;
+    char *pszDigest;        //hex
+} TDNF_FILE_DIGEST, *PTDNF_FILE_DIGEST;
+
+//one package to download or verify in TDNFRepoSyncPackages
+typedef struct _TDNF_REPOSYNC_JOB
+{
+    PTDNF_PKG_INFO pPkgInfo;
+    PTDNF_REPO_DATA pRepo;
+    char *pszFilePath;
+    int nKeep;              //verified, protect from --delete
+    TDNF_FILE_DIGEST digest; //of pszFilePath if it was hashed
+} TDNF_REPOSYNC_JOB, *PTDNF_REPOSYNC_JOB;
+
+typedef struct _TDNF_REPOSYNC_CONTEXT
+{
+    PTDNF pTdnf;
+    PTDNF_REPOSYNC_ARGS pReposyncArgs;
+    PTDNF_REPOSYNC_JOB pJobs;
+    uint32_t dwJobCount;
+    uint32_t dwNextJob;
+    uint32_t dwError;
+    //from the previous runs, sorted by path, read only
+    PTDNF_FILE_DIGEST pDigests;
+    uint32_t dwDigestCount;
+    //shared by the workers, so keys are imported once
+    rpmKeyring pKeyring;
+    PTDNF_REPO_DATA *ppTrustedRepos;
+    uint32_t dwTrustedCount;
+    uint64_t qwStoreBytes;  //not downloaded or written thanks to the store
+    pthread_mutex_t mutex;
+    pthread_mutex_t mutexGPG;
+} TDNF_REPOSYNC_CONTEXT, *PTDNF_REPOSYNC_CONTEXT;
+
+//one transfer of TDNFDownloadFile(), see _TDNFDownloadWrite()
+typedef struct _TDNF_DOWNLOAD_XFER_
+{
+    CURL *pCurl;
+    FILE *fp;
+    curl_off_t nOffset;     //resumed from here
+    int nChecked;           //response code looked at
+    int nDiscard;           //an error page, not written
+    int nClass;             //TDNF_XFER_CLASS, for max_bandwidth
+    char *pszValidator;     //ETag or Last-Modified, for If-Range
+    int nETag;              //pszValidator is an ETag
+} TDNF_DOWNLOAD_XFER, *PTDNF_DOWNLOAD_XFER;
+
+//downloads of one TDNF_XFER_CLASS, see bandwidth.c
+typedef struct _TDNF_BANDWIDTH_CLASS_
+{
+    int nShare;
+    int nActive;            //transfers running
+    double dTokens;         //bytes it may read now, below 0 when owed
+    double dActiveSince;
+    TDNF_XFER_STAT stat;
+} TDNF_BANDWIDTH_CLASS, *PTDNF_BANDWIDTH_CLASS;
+
 typedef struct progress_cb_data {
     time_t cur_time;
     time_t prev_time;
@@ -14,6 +14,102 @@ TDNFUpdateInfoSummary(
     char** ppszPackageNameSpecs,
     PTDNF_UPDATEINFO_SUMMARY* ppSummary
     )
+{
+    uint32_t dwError = 0;
+    PTDNF_UPDATEINFO_SUMMARY pSummary = NULL;
+    PTDNF_UPDATE_SUMMARY pUpdateSummary = NULL;
+    PTDNF_UPDATE_SUMMARY_ADV pAdvs = NULL;
+    char *pszSeverity = NULL;
+    uint32_t dwSecurity = 0;
+    int nCached = 0;
+
+    if(!pTdnf || !pTdnf->pArgs || !ppSummary)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    dwError = TDNFGetSecuritySeverityOption(
+                  pTdnf,
+                  &dwSecurity,
+                  &pszSeverity);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    if(pTdnf->pArgs->pSetOpt)
+    {
+        dwError = TDNFHasOpt(pTdnf->pArgs, TDNF_SETOPT_KEY_CACHED, &nCached);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    if(nCached && (!ppszPackageNameSpecs || !ppszPackageNameSpecs[0]))
+    {
+        dwError = TDNFGetUpdateSummary(pTdnf, &pUpdateSummary);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+    else
+    {
+        dwError = TDNFRefresh(pTdnf);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        dwError = TDNFCollectUpdateAdvisories(
+                      pTdnf,
+                      ppszPackageNameSpecs,
+                      &pAdvs);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    dwError = TDNFCountUpdateAdvisories(
+                  pUpdateSummary ? pUpdateSummary->pAdvisories : pAdvs,
+                  dwSecurity,
+                  pszSeverity,
+                  &pSummary);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    *ppSummary = pSummary;
+
+cleanup:
+    TDNF_SAFE_FREE_MEMORY(pszSeverity);
+    TDNFFreeUpdateSummaryAdvisories(pAdvs);
+    TDNFFreeUpdateSummary(pUpdateSummary);
+    return dwError;
+
+error:
+    if(ppSummary)
+    {
+        *ppSummary = NULL;
+    }
+    TDNFFreeUpdateInfoSummary(pSummary);
+    goto cleanup;
+}
+
+static
+int
+TDNFGetUpdateType(
+    const char *pszType
+    )
+{
+    int nType = UPDATE_UNKNOWN;
+
+    if (pszType == NULL)
+        nType = UPDATE_UNKNOWN;
+    else if (!strcmp (pszType, "bugfix"))
+        nType = UPDATE_BUGFIX;
+    else if (!strcmp (pszType, "enhancement"))
+        nType = UPDATE_ENHANCEMENT;
+    else if (!strcmp (pszType, "security"))
+        nType = UPDATE_SECURITY;
+
+    return nType;
+}
+
+//advisories for the installed packages matching ppszPackageNameSpecs,
+//or all installed packages if NULL. Needs a refreshed sack.
+uint32_t
+TDNFCollectUpdateAdvisories(
+    PTDNF pTdnf,
+    char** ppszPackageNameSpecs,
+    PTDNF_UPDATE_SUMMARY_ADV* ppAdvs
+    )
 {
     uint32_t dwError = 0;
     uint32_t nCount = 0;
@@ -24,23 +120,18 @@ TDNFUpdateInfoSummary(
     PSolvPackageList pUpdateAdvPkgList = NULL;
     Id dwAdvId = 0;
     Id dwPkgId = 0;
-    uint32_t nType = 0;
-    PTDNF_UPDATEINFO_SUMMARY pSummary = NULL;
-    const char *pszType = 0;
-    char *pszSeverity = NULL;
-    uint32_t dwSecurity = 0;
+    char *pszPkgName = NULL;
     const char* pszTemp = NULL;
+    PTDNF_UPDATE_SUMMARY_ADV pAdvs = NULL;
+    PTDNF_UPDATE_SUMMARY_ADV pAdv = NULL;
+    PTDNF_UPDATE_SUMMARY_ADV pLast = NULL;
 
-    if(!pTdnf || !pTdnf->pSack || !pTdnf->pSack->pPool ||
-       !ppSummary)
+    if(!pTdnf || !pTdnf->pSack || !ppAdvs)
     {
         dwError = ERROR_TDNF_INVALID_PARAMETER;
         BAIL_ON_TDNF_ERROR(dwError);
     }
 
-    dwError = TDNFRefresh(pTdnf);
-    BAIL_ON_TDNF_ERROR(dwError);
-
     if(!ppszPackageNameSpecs)
     {
         dwError = SolvFindAllInstalled(pTdnf->pSack, &pInstalledPkgList);
@@ -57,23 +148,6 @@ TDNFUpdateInfoSummary(
     dwError = SolvGetPackageListSize(pInstalledPkgList, &dwSize);
     BAIL_ON_TDNF_ERROR(dwError);
 
-    dwError = TDNFAllocateMemory(
-                  UPDATE_ENHANCEMENT + 1,
-                  sizeof(TDNF_UPDATEINFO_SUMMARY),
-                  (void**)&pSummary);
-    BAIL_ON_TDNF_ERROR(dwError);
-
-    pSummary[UPDATE_UNKNOWN].nType = UPDATE_UNKNOWN;
-    pSummary[UPDATE_SECURITY].nType = UPDATE_SECURITY;
-    pSummary[UPDATE_BUGFIX].nType = UPDATE_BUGFIX;
-    pSummary[UPDATE_ENHANCEMENT].nType = UPDATE_ENHANCEMENT;
-
-    dwError = TDNFGetSecuritySeverityOption(
-                  pTdnf,
-                  &dwSecurity,
-                  &pszSeverity);
-    BAIL_ON_TDNF_ERROR(dwError);
-
     for(dwPkgIndex = 0; dwPkgIndex < dwSize; dwPkgIndex++)
     {
         dwError = SolvGetPackageId(pInstalledPkgList, dwPkgIndex, &dwPkgId);
@@ -91,6 +165,9 @@ TDNFUpdateInfoSummary(
         }
         BAIL_ON_TDNF_ERROR(dwError);
 
+        dwError = SolvGetPkgNameFromId(pTdnf->pSack, dwPkgId, &pszPkgName);
+        BAIL_ON_TDNF_ERROR(dwError);
+
         dwError = SolvGetPackageListSize(pUpdateAdvPkgList, &nCount);
         BAIL_ON_TDNF_ERROR(dwError);
 
@@ -99,42 +176,64 @@ TDNFUpdateInfoSummary(
             dwError = SolvGetPackageId(pUpdateAdvPkgList, iAdv, &dwAdvId);
             BAIL_ON_TDNF_ERROR(dwError);
 
-            pszType = pool_lookup_str(
+            dwError = TDNFAllocateMemory(
+                          1,
+                          sizeof(TDNF_UPDATE_SUMMARY_ADV),
+                          (void**)&pAdv);
+            BAIL_ON_TDNF_ERROR(dwError);
+
+            /* link first, so the error path frees it */
+            if(pLast)
+            {
+                pLast->pNext = pAdv;
+            }
+            else
+            {
+                pAdvs = pAdv;
+            }
+            pLast = pAdv;
+
+            pAdv->nType = TDNFGetUpdateType(
+                              pool_lookup_str(
+                                  pTdnf->pSack->pPool,
+                                  dwAdvId,
+                                  SOLVABLE_PATCHCATEGORY));
+            pAdv->nRebootRequired = pool_lookup_void(
+                                        pTdnf->pSack->pPool,
+                                        dwAdvId,
+                                        UPDATE_REBOOT);
+
+            dwError = TDNFAllocateString(pszPkgName, &pAdv->pszPkgName);
+            BAIL_ON_TDNF_ERROR(dwError);
+
+            pszTemp = pool_lookup_str(
                           pTdnf->pSack->pPool,
                           dwAdvId,
-                          SOLVABLE_PATCHCATEGORY);
-            nType = UPDATE_UNKNOWN;
-            if (pszType == NULL)
-                nType = UPDATE_UNKNOWN;
-            else if (!strcmp (pszType, "bugfix"))
-                nType = UPDATE_BUGFIX;
-            else if (!strcmp (pszType, "enhancement"))
-                nType = UPDATE_ENHANCEMENT;
-            else if (!strcmp (pszType, "security"))
-                nType = UPDATE_SECURITY;
-            if (dwSecurity)
+                          SOLVABLE_NAME);
+            if(pszTemp)
             {
-                if (nType != UPDATE_SECURITY)
-                    continue;
+                dwError = TDNFAllocateString(pszTemp, &pAdv->pszID);
+                BAIL_ON_TDNF_ERROR(dwError);
             }
-            else if (pszSeverity)
+
+            pszTemp = pool_lookup_str(
+                          pTdnf->pSack->pPool,
+                          dwAdvId,
+                          UPDATE_SEVERITY);
+            if(pszTemp)
             {
-                pszTemp = pool_lookup_str(
-                              pTdnf->pSack->pPool,
-                              dwAdvId,
-                              UPDATE_SEVERITY);
-                if (!pszTemp || atof(pszSeverity) > atof(pszTemp))
-                    continue;
+                dwError = TDNFAllocateString(pszTemp, &pAdv->pszSeverity);
+                BAIL_ON_TDNF_ERROR(dwError);
             }
-            pSummary[nType].nCount++;
         }
+        TDNF_SAFE_FREE_MEMORY(pszPkgName);
         SolvFreePackageList(pUpdateAdvPkgList);
         pUpdateAdvPkgList = NULL;
     }
-    *ppSummary = pSummary;
+    *ppAdvs = pAdvs;
 
 cleanup:
-    TDNF_SAFE_FREE_MEMORY(pszSeverity);
+    TDNF_SAFE_FREE_MEMORY(pszPkgName);
     if(pInstalledPkgList)
     {
         SolvFreePackageList(pInstalledPkgList);
@@ -145,6 +244,65 @@ cleanup:
     }
     return dwError;
 
+error:
+    if(ppAdvs)
+    {
+        *ppAdvs = NULL;
+    }
+    TDNFFreeUpdateSummaryAdvisories(pAdvs);
+    goto cleanup;
+}
+
+//count advisories by type, honoring --security and --sec-severity
+uint32_t
+TDNFCountUpdateAdvisories(
+    PTDNF_UPDATE_SUMMARY_ADV pAdvs,
+    uint32_t dwSecurity,
+    const char* pszSeverity,
+    PTDNF_UPDATEINFO_SUMMARY* ppSummary
+    )
+{
+    uint32_t dwError = 0;
+    PTDNF_UPDATEINFO_SUMMARY pSummary = NULL;
+    PTDNF_UPDATE_SUMMARY_ADV pAdv = NULL;
+
+    if(!ppSummary)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    dwError = TDNFAllocateMemory(
+                  UPDATE_ENHANCEMENT + 1,
+                  sizeof(TDNF_UPDATEINFO_SUMMARY),
+                  (void**)&pSummary);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    pSummary[UPDATE_UNKNOWN].nType = UPDATE_UNKNOWN;
+    pSummary[UPDATE_SECURITY].nType = UPDATE_SECURITY;
+    pSummary[UPDATE_BUGFIX].nType = UPDATE_BUGFIX;
+    pSummary[UPDATE_ENHANCEMENT].nType = UPDATE_ENHANCEMENT;
+
+    for(pAdv = pAdvs; pAdv; pAdv = pAdv->pNext)
+    {
+        if (dwSecurity)
+        {
+            if (pAdv->nType != UPDATE_SECURITY)
+                continue;
+        }
+        else if (pszSeverity)
+        {
+            if (!pAdv->pszSeverity ||
+                atof(pszSeverity) > atof(pAdv->pszSeverity))
+                continue;
+        }
+        pSummary[pAdv->nType].nCount++;
+    }
+    *ppSummary = pSummary;
+
+cleanup:
+    return dwError;
+
 error:
     if(ppSummary)
     {
@@ -154,6 +312,42 @@ error:
     goto cleanup;
 }
 
+void
+TDNFFreeUpdateSummaryAdvisories(
+    PTDNF_UPDATE_SUMMARY_ADV pAdvs
+    )
+{
+    PTDNF_UPDATE_SUMMARY_ADV pAdv = NULL;
+
+    while(pAdvs)
+    {
+        pAdv = pAdvs;
+        pAdvs = pAdvs->pNext;
+
+        TDNF_SAFE_FREE_MEMORY(pAdv->pszPkgName);
+        TDNF_SAFE_FREE_MEMORY(pAdv->pszID);
+        TDNF_SAFE_FREE_MEMORY(pAdv->pszSeverity);
+        TDNF_SAFE_FREE_MEMORY(pAdv);
+    }
+}
+
+void
+TDNFFreeUpdateSummary(
+    PTDNF_UPDATE_SUMMARY pSummary
+    )
+{
+    if(pSummary)
+    {
+        if(pSummary->pPkgInfos)
+        {
+            TDNFFreePackageInfoArray(pSummary->pPkgInfos,
+                                     pSummary->dwPkgCount);
+        }
+        TDNFFreeUpdateSummaryAdvisories(pSummary->pAdvisories);
+        TDNF_SAFE_FREE_MEMORY(pSummary);
+    }
+}
+
 uint32_t
 TDNFGetUpdateInfoPackages(
     PSolvSack pSack,
@@ -254,6 +448,45 @@ error:
     goto cleanup;
 }
 
+/* whether advisory dwAdvId passes --security, --sec-severity and
+   --reboot-required */
+static
+int
+_TDNFKeepAdvisory(
+    Pool *pPool,
+    Id dwAdvId,
+    uint32_t dwSecurity,
+    const char *pszSeverity,
+    uint32_t dwRebootRequired
+    )
+{
+    const char *pszType = NULL;
+    const char *pszAdvSeverity = NULL;
+
+    if (dwSecurity)
+    {
+        pszType = pool_lookup_str(pPool, dwAdvId, SOLVABLE_PATCHCATEGORY);
+        if (!pszType || strcmp(pszType, "security"))
+        {
+            return 0;
+        }
+    }
+    else if (pszSeverity)
+    {
+        pszAdvSeverity = pool_lookup_str(pPool, dwAdvId, UPDATE_SEVERITY);
+        if (!pszAdvSeverity || atof(pszSeverity) > atof(pszAdvSeverity))
+        {
+            return 0;
+        }
+    }
+    if (dwRebootRequired &&
+        !pool_lookup_void(pPool, dwAdvId, UPDATE_REBOOT))
+    {
+        return 0;
+    }
+    return 1;
+}
+
 uint32_t
 TDNFPopulateUpdateInfoOfOneAdvisory(
     PSolvSack pSack,
@@ -268,7 +501,7 @@ TDNFPopulateUpdateInfoOfOneAdvisory(
     const char *pszType = 0;
     PTDNF_UPDATEINFO pInfo = NULL;
     const char* pszTemp = NULL;
-    uint32_t dwKeepEntry = 1;
+    uint32_t dwKeepEntry = 0;
     const int DATELEN = 200;
     char szDate[DATELEN];
     int dwReboot = 0;
@@ -285,35 +518,15 @@ TDNFPopulateUpdateInfoOfOneAdvisory(
     pszType = pool_lookup_str(pSack->pPool,
                               dwAdvId,
                               SOLVABLE_PATCHCATEGORY);
-    pszTemp = pool_lookup_str(
-                  pSack->pPool,
-                  dwAdvId,
-                  UPDATE_SEVERITY);
     dwReboot = pool_lookup_void(
                        pSack->pPool,
                        dwAdvId,
                        UPDATE_REBOOT);
-    if (dwSecurity)
-    {
-        if (strcmp (pszType, "security"))
-        {
-            dwKeepEntry = 0;
-        }
-    }
-    else if (pszSeverity)
-    {
-         if(!pszTemp || atof(pszSeverity) > atof(pszTemp))
-         {
-             dwKeepEntry = 0;
-         }
-    }
-    if (dwRebootRequired)
-    {
-         if(dwReboot == 0)
-         {
-            dwKeepEntry = 0;
-         }
-    }
+    dwKeepEntry = _TDNFKeepAdvisory(pSack->pPool,
+                                    dwAdvId,
+                                    dwSecurity,
+                                    pszSeverity,
+                                    dwRebootRequired);
 
     if (dwKeepEntry)
     {
@@ -455,152 +668,367 @@ error:
     goto cleanup;
 }
 
+/*
+ * The upgrades of upgrade --security, --sec-severity and
+ * --reboot-required, pushed to pQueueGoal. An advisory that passes
+ * the options applies if it has a package of the name and arch of an
+ * installed one, in a newer version. Every installed package named
+ * in an advisory that applies is upgraded to its best version. This
+ * is one pass over the advisories of the pool, on ids, instead of
+ * TDNFUpdateInfo() for each installed package and a lookup of each
+ * name it returns.
+ */
 uint32_t
-TDNFNumUpdatePkgs(
-    PTDNF_UPDATEINFO pInfo,
-    uint32_t *pdwCount
+TDNFGetAdvisoryUpgrades(
+    PTDNF pTdnf,
+    uint32_t dwSecurity,
+    const char *pszSeverity,
+    uint32_t dwRebootRequired,
+    Queue *pQueueGoal
     )
 {
     uint32_t dwError = 0;
-    uint32_t dwCount = 0;
-    PTDNF_UPDATEINFO_PKG pPkg = NULL;
-    if(!pInfo || !pdwCount)
+    Pool *pool = NULL; /* FOR_PROVIDES needs this name */
+    Solvable *pSolv = NULL;
+    Dataiterator di = {0};
+    Queue queueAdvs = {0};
+    Map mapNames = {0};
+    Id dwAdvId = 0;
+    Id dwName = 0;
+    Id dwEvr = 0;
+    Id dwArch = 0;
+    Id dwInstalled = 0;
+    Id dwAvailable = 0;
+    Id p, pp;
+    int nKeep = 0;
+    int nEvrCompare = 0;
+    int nDiInit = 0;
+    int i;
+
+    if(!pTdnf || !pTdnf->pSack || !pTdnf->pSack->pPool || !pQueueGoal)
     {
         dwError = ERROR_TDNF_INVALID_PARAMETER;
         BAIL_ON_TDNF_ERROR(dwError);
     }
-    while(pInfo)
+
+    pool = pTdnf->pSack->pPool;
+    queue_init(&queueAdvs);
+    map_init(&mapNames, pool->ss.nstrings);
+
+    /* the advisories that apply */
+    dataiterator_init(&di, pool, 0, 0, UPDATE_COLLECTION, 0, 0);
+    nDiInit = 1;
+    while (pool->installed && dataiterator_step(&di))
     {
-        pPkg = pInfo->pPackages;
-        while(pPkg)
+        if (di.solvid != dwAdvId)
         {
-            dwCount++;
-            pPkg = pPkg->pNext;
+            dwAdvId = di.solvid;
+            nKeep = _TDNFKeepAdvisory(pool, dwAdvId, dwSecurity,
+                                      pszSeverity, dwRebootRequired);
+        }
+        if (!nKeep)
+        {
+            dataiterator_skip_solvable(&di);
+            continue;
+        }
+
+        dataiterator_setpos(&di);
+        dwName = pool_lookup_id(pool, SOLVID_POS, UPDATE_COLLECTION_NAME);
+        dwEvr = pool_lookup_id(pool, SOLVID_POS, UPDATE_COLLECTION_EVR);
+        dwArch = pool_lookup_id(pool, SOLVID_POS, UPDATE_COLLECTION_ARCH);
+        if (!dwName || !dwEvr)
+        {
+            continue;
+        }
+
+        FOR_PROVIDES(p, pp, dwName)
+        {
+            pSolv = pool_id2solvable(pool, p);
+            if (pSolv->repo == pool->installed &&
+                pSolv->name == dwName &&
+                pSolv->arch == dwArch &&
+                pool_evrcmp(pool, dwEvr, pSolv->evr, EVRCMP_COMPARE) > 0)
+            {
+                break;
+            }
+        }
+        if (p)
+        {
+            queue_push(&queueAdvs, dwAdvId);
+            dataiterator_skip_solvable(&di);
+        }
+    }
+    dataiterator_free(&di);
+    nDiInit = 0;
+
+    if (queueAdvs.count == 0)
+    {
+        pr_info("\n%d updates.\n", 0);
+        dwError = ERROR_TDNF_NO_DATA;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    /* their installed packages, each name once */
+    for (i = 0; i < queueAdvs.count; i++)
+    {
+        dataiterator_init(&di, pool, 0, queueAdvs.elements[i],
+                          UPDATE_COLLECTION, 0, 0);
+        nDiInit = 1;
+        while (dataiterator_step(&di))
+        {
+            dataiterator_setpos(&di);
+            dwName = pool_lookup_id(pool, SOLVID_POS, UPDATE_COLLECTION_NAME);
+            if (!dwName || MAPTST(&mapNames, dwName))
+            {
+                continue;
+            }
+            MAPSET(&mapNames, dwName);
+
+            if (SolvFindHighestInstalledId(pTdnf->pSack, dwName,
+                                           &dwInstalled) ||
+                SolvFindBestAvailableId(pTdnf->pSack, dwName,
+                                        &dwAvailable))
+            {
+                continue;
+            }
+
+            dwError = SolvCmpEvr(pTdnf->pSack, dwAvailable, dwInstalled,
+                                 &nEvrCompare);
+            BAIL_ON_TDNF_ERROR(dwError);
+
+            if (nEvrCompare > 0)
+            {
+                queue_push(pQueueGoal, dwAvailable);
+            }
         }
-        pInfo = pInfo->pNext;
+        dataiterator_free(&di);
+        nDiInit = 0;
     }
-    *pdwCount = dwCount;
+
 cleanup:
+    if (nDiInit)
+    {
+        dataiterator_free(&di);
+    }
+    map_free(&mapNames);
+    queue_free(&queueAdvs);
     return dwError;
 
 error:
-    if(pdwCount)
-    {
-        *pdwCount = 0;
-    }
     goto cleanup;
 }
 
 uint32_t
-TDNFGetUpdatePkgs(
+TDNFGetRebootRequiredOption(
     PTDNF pTdnf,
-    char*** pppszPkgs,
-    uint32_t *pdwCount
+    uint32_t *pdwRebootRequired
     )
 {
     uint32_t dwError = 0;
-    uint32_t dwCount = 0;
-    char**   ppszPkgs = NULL;
-    PTDNF_UPDATEINFO_PKG pPkg = NULL;
-    int nIndex = 0;
-    char* pszPkgName = NULL;
-
-    PTDNF_UPDATEINFO pUpdateInfo = NULL;
-    PTDNF_UPDATEINFO pInfo = NULL;
+    PTDNF_CMD_OPT pSetOpt = NULL;
+    uint32_t dwRebootRequired = 0;
 
-    if(!pTdnf || !pdwCount || !pppszPkgs)
+    if(!pTdnf || !pTdnf->pArgs)
     {
         dwError = ERROR_TDNF_INVALID_PARAMETER;
         BAIL_ON_TDNF_ERROR(dwError);
     }
 
-    dwError = TDNFUpdateInfo(pTdnf, &pszPkgName, &pUpdateInfo);
-    BAIL_ON_TDNF_ERROR(dwError);
+    pSetOpt = pTdnf->pArgs->pSetOpt;
 
-    pInfo = pUpdateInfo;
-    dwError = TDNFNumUpdatePkgs(pInfo, &dwCount);
-    BAIL_ON_TDNF_ERROR(dwError);
+    while(pSetOpt)
+    {
+        if(!strcasecmp(pSetOpt->pszOptName, "reboot-required"))
+        {
+            dwRebootRequired = 1;
+            break;
+        }
+        pSetOpt = pSetOpt->pNext;
+    }
+    *pdwRebootRequired = dwRebootRequired;
+cleanup:
+    return dwError;
 
-    if(dwCount == 0)
+error:
+    if(pdwRebootRequired)
     {
-        goto cleanup;
+       *pdwRebootRequired = 0;
     }
+    goto cleanup;
+}
+
+static
+uint32_t
+TDNFBuildUpdateSummary(
+    PTDNF pTdnf,
+    PTDNF_UPDATE_SUMMARY* ppSummary
+    )
+{
+    uint32_t dwError = 0;
+    PTDNF_UPDATE_SUMMARY pSummary = NULL;
+
+    dwError = TDNFRefresh(pTdnf);
+    BAIL_ON_TDNF_ERROR(dwError);
 
     dwError = TDNFAllocateMemory(
-                  dwCount + 1,
-                  sizeof(char*),
-                  (void**)&ppszPkgs);
+                  1,
+                  sizeof(TDNF_UPDATE_SUMMARY),
+                  (void**)&pSummary);
     BAIL_ON_TDNF_ERROR(dwError);
 
-    for(pInfo = pUpdateInfo; pInfo; pInfo = pInfo->pNext)
-    {
-        pPkg = pInfo->pPackages;
-        while(pPkg)
-        {
-            dwError = TDNFAllocateString(
-                          pPkg->pszName,
-                          &ppszPkgs[nIndex++]);
-            BAIL_ON_TDNF_ERROR(dwError);
-            pPkg = pPkg->pNext;
-        }
+    pSummary->tGenerated = time(NULL);
 
-    }
-    *pppszPkgs = ppszPkgs;
-    *pdwCount  = dwCount;
-cleanup:
-    if(pUpdateInfo)
+    dwError = TDNFList(
+                  pTdnf,
+                  SCOPE_UPGRADES,
+                  NULL,
+                  &pSummary->pPkgInfos,
+                  &pSummary->dwPkgCount);
+    if(dwError == ERROR_TDNF_NO_MATCH)
     {
-        TDNFFreeUpdateInfo(pUpdateInfo);
+        pSummary->pPkgInfos = NULL;
+        pSummary->dwPkgCount = 0;
+        dwError = 0;
     }
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFCollectUpdateAdvisories(
+                  pTdnf,
+                  NULL,
+                  &pSummary->pAdvisories);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    *ppSummary = pSummary;
+
+cleanup:
     return dwError;
 
 error:
-    if(pppszPkgs)
+    if(ppSummary)
     {
-        *pppszPkgs = NULL;
+        *ppSummary = NULL;
     }
-    if(ppszPkgs)
+    TDNFFreeUpdateSummary(pSummary);
+    goto cleanup;
+}
+
+static
+uint32_t
+TDNFStoreUpdateSummary(
+    PTDNF pTdnf,
+    PTDNF_UPDATE_SUMMARY pSummary
+    )
+{
+    uint32_t dwError = 0;
+    char *pszKey = NULL;
+
+    /* repos without metadata have no cookie to key on */
+    dwError = TDNFResultCacheGetKey(
+                  pTdnf,
+                  TDNF_RESULT_CACHE_SLOT_UPDATE_SUMMARY,
+                  0,
+                  &pszKey);
+    if(dwError == ERROR_TDNF_NO_DATA)
     {
-        TDNFFreeStringArray(ppszPkgs);
+        dwError = 0;
+        goto cleanup;
     }
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFResultCacheWriteUpdateSummary(pTdnf, pszKey, pSummary);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+cleanup:
+    TDNF_SAFE_FREE_MEMORY(pszKey);
+    return dwError;
+
+error:
     goto cleanup;
 }
 
+//compute the update summary and store it for --cached,
+//makecache calls this after refreshing the metadata
 uint32_t
-TDNFGetRebootRequiredOption(
+TDNFCacheUpdateSummary(
+    PTDNF pTdnf
+    )
+{
+    uint32_t dwError = 0;
+    PTDNF_UPDATE_SUMMARY pSummary = NULL;
+
+    if(!pTdnf || !pTdnf->pArgs || !pTdnf->pConf)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    dwError = TDNFBuildUpdateSummary(pTdnf, &pSummary);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFStoreUpdateSummary(pTdnf, pSummary);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+cleanup:
+    TDNFFreeUpdateSummary(pSummary);
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+/*
+ * Get the update summary without loading the pool, if the one
+ * stored by makecache is still valid for the repo and rpmdb
+ * cookies. Otherwise it is computed, and stored for next time.
+ */
+uint32_t
+TDNFGetUpdateSummary(
     PTDNF pTdnf,
-    uint32_t *pdwRebootRequired
+    PTDNF_UPDATE_SUMMARY* ppSummary
     )
 {
     uint32_t dwError = 0;
-    PTDNF_CMD_OPT pSetOpt = NULL;
-    uint32_t dwRebootRequired = 0;
+    PTDNF_UPDATE_SUMMARY pSummary = NULL;
+    char *pszKey = NULL;
 
-    if(!pTdnf || !pTdnf->pArgs)
+    if(!pTdnf || !ppSummary)
     {
         dwError = ERROR_TDNF_INVALID_PARAMETER;
         BAIL_ON_TDNF_ERROR(dwError);
     }
 
-    pSetOpt = pTdnf->pArgs->pSetOpt;
+    dwError = TDNFInitHandleStages(pTdnf, TDNF_INIT_STAGE_REPOS);
+    BAIL_ON_TDNF_ERROR(dwError);
 
-    while(pSetOpt)
+    if(!TDNFResultCacheGetKey(
+            pTdnf,
+            TDNF_RESULT_CACHE_SLOT_UPDATE_SUMMARY,
+            0,
+            &pszKey) &&
+       !TDNFResultCacheReadUpdateSummary(pTdnf, pszKey, &pSummary))
     {
-        if(!strcasecmp(pSetOpt->pszOptName, "reboot-required"))
-        {
-            dwRebootRequired = 1;
-            break;
-        }
-        pSetOpt = pSetOpt->pNext;
+        *ppSummary = pSummary;
+        goto cleanup;
     }
-    *pdwRebootRequired = dwRebootRequired;
+
+    dwError = TDNFBuildUpdateSummary(pTdnf, &pSummary);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    /* not being able to store it is not an error here, the
+       next run just computes it again */
+    TDNFStoreUpdateSummary(pTdnf, pSummary);
+
+    *ppSummary = pSummary;
+
 cleanup:
+    TDNF_SAFE_FREE_MEMORY(pszKey);
     return dwError;
 
 error:
-    if(pdwRebootRequired)
+    if(ppSummary)
     {
-       *pdwRebootRequired = 0;
+        *ppSummary = NULL;
     }
+    TDNFFreeUpdateSummary(pSummary);
     goto cleanup;
 }
@@ -6,8 +6,12 @@
  * of the License are located in the COPYING file of this distribution.
  */
 
+#define _GNU_SOURCE 1
 #include "includes.h"
 
+#define TDNF_COPY_BUFSIZE      (64 * 1024)
+#define TDNF_COPY_RANGE_CHUNK  (1024 * 1024 * 1024)
+
 uint32_t
 TDNFGetErrorString(
     uint32_t dwErrorCode,
@@ -317,6 +321,147 @@ error:
     goto cleanup;
 }
 
+/*
+ * Copy pszSrc to pszDest without moving the data through user space
+ * where the kernel can: a reflink if the filesystem supports it, else
+ * copy_file_range(). A plain read/write loop is the last resort.
+ */
+uint32_t
+TDNFCopyFile(
+    const char *pszSrc,
+    const char *pszDest
+    )
+{
+    uint32_t dwError = 0;
+    int fdSrc = -1;
+    int fdDest = -1;
+    char *pBuf = NULL;
+    ssize_t nRead = 0;
+    ssize_t nWritten = 0;
+    ssize_t nOffset = 0;
+
+    if (IsNullOrEmptyString(pszSrc) || IsNullOrEmptyString(pszDest))
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    fdSrc = open(pszSrc, O_RDONLY);
+    if (fdSrc < 0)
+    {
+        dwError = ERROR_TDNF_SYSTEM_BASE + errno;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    fdDest = open(pszDest, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fdDest < 0)
+    {
+        dwError = ERROR_TDNF_SYSTEM_BASE + errno;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+#ifdef FICLONE
+    if (ioctl(fdDest, FICLONE, fdSrc) == 0)
+    {
+        goto cleanup;
+    }
+#endif
+
+    /* on failure nothing was copied yet, or the fallback can go on
+       from the current offsets */
+    do
+    {
+        nWritten = copy_file_range(fdSrc, NULL, fdDest, NULL,
+                                   TDNF_COPY_RANGE_CHUNK, 0);
+    } while (nWritten > 0);
+    if (nWritten == 0)
+    {
+        goto cleanup;
+    }
+    if (errno != EXDEV && errno != ENOSYS && errno != EINVAL &&
+        errno != EOPNOTSUPP)
+    {
+        dwError = ERROR_TDNF_SYSTEM_BASE + errno;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    dwError = TDNFAllocateMemory(TDNF_COPY_BUFSIZE, 1, (void **)&pBuf);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    while ((nRead = read(fdSrc, pBuf, TDNF_COPY_BUFSIZE)) != 0)
+    {
+        if (nRead < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            dwError = ERROR_TDNF_SYSTEM_BASE + errno;
+            BAIL_ON_TDNF_ERROR(dwError);
+        }
+        for (nOffset = 0; nOffset < nRead; nOffset += nWritten)
+        {
+            nWritten = write(fdDest, pBuf + nOffset, nRead - nOffset);
+            if (nWritten < 0)
+            {
+                if (errno == EINTR)
+                {
+                    nWritten = 0;
+                    continue;
+                }
+                dwError = ERROR_TDNF_SYSTEM_BASE + errno;
+                BAIL_ON_TDNF_ERROR(dwError);
+            }
+        }
+    }
+
+cleanup:
+    if (fdDest >= 0 && close(fdDest) && !dwError)
+    {
+        dwError = ERROR_TDNF_SYSTEM_BASE + errno;
+    }
+    if (fdSrc >= 0)
+    {
+        close(fdSrc);
+    }
+    TDNF_SAFE_FREE_MEMORY(pBuf);
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+uint32_t
+TDNFDigestToHex(
+    const unsigned char *pbDigest,
+    int nHashType,
+    char **ppszHex
+    )
+{
+    uint32_t dwError = 0;
+    char *pszHex = NULL;
+    unsigned int i;
+
+    dwError = TDNFAllocateMemory(hash_ops[nHashType].length * 2 + 1,
+                                 sizeof(char),
+                                 (void **)&pszHex);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    for (i = 0; i < hash_ops[nHashType].length; i++)
+    {
+        sprintf(pszHex + i * 2, "%02x", pbDigest[i]);
+    }
+
+    *ppszHex = pszHex;
+
+cleanup:
+    return dwError;
+
+error:
+    TDNF_SAFE_FREE_MEMORY(pszHex);
+    goto cleanup;
+}
+
 /* update time if file exists, create if not */
 uint32_t
 TDNFTouchFile(
@@ -566,6 +711,62 @@ error:
     goto cleanup;
 }
 
+/* a byte count with an optional k, M, G or T suffix (powers of 1024) */
+uint32_t
+TDNFParseSize(
+    const char* pszSize,
+    uint64_t* pqwSize
+    )
+{
+    uint32_t dwError = 0;
+    unsigned long long qwSize = 0;
+    char* pszEnd = NULL;
+    int nShift = 0;
+
+    if(!pqwSize || IsNullOrEmptyString(pszSize))
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    errno = 0;
+    qwSize = strtoull(pszSize, &pszEnd, 10);
+    if(errno || pszEnd == pszSize || pszSize[0] == '-')
+    {
+        dwError = ERROR_TDNF_INVALID_CONF;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    switch(*pszEnd)
+    {
+        case '\0': nShift = 0; break;
+        case 'k': case 'K': nShift = 10; break;
+        case 'm': case 'M': nShift = 20; break;
+        case 'g': case 'G': nShift = 30; break;
+        case 't': case 'T': nShift = 40; break;
+        default:
+            dwError = ERROR_TDNF_INVALID_CONF;
+            BAIL_ON_TDNF_ERROR(dwError);
+    }
+    if((*pszEnd && pszEnd[1]) || qwSize > (UINT64_MAX >> nShift))
+    {
+        dwError = ERROR_TDNF_INVALID_CONF;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    *pqwSize = (uint64_t)qwSize << nShift;
+
+cleanup:
+    return dwError;
+
+error:
+    if(pqwSize)
+    {
+        *pqwSize = 0;
+    }
+    goto cleanup;
+}
+
 uint32_t
 TDNFShouldSyncMetadata(
     const char* pszRepoDataFolder,
@@ -0,0 +1,822 @@
+/*
+ * Copyright (C) 2023 VMware, Inc. All Rights Reserved.
+ *
+ * Licensed under the GNU Lesser General Public License v2.1 (the "License");
+ * you may not use this file except in compliance with the License. The terms
+ * of the License are located in the COPYING file of this distribution.
+ */
+
+/*
+ * Cache of package files that were already verified, one file per
+ * repo in its cache dir. An entry maps the identity of a file
+ * (device, inode, size, mtime and ctime) to its digest and the id
+ * of the key its signature was verified with. The cookie of the
+ * repo metadata is in the header, so the whole cache is dropped
+ * when the metadata changes. The cache is written only by root
+ * and only used if it is owned by root and not writable by others.
+ *
+ * The format is
+ *   tdnf-verify-cache <version> <cookie>
+ *   <dev> <ino> <size> <mtime sec> <mtime nsec> <ctime sec>
+ *       <ctime nsec> <hash type> <digest> <key id or -> <path>
+ * with fields separated by tabs.
+ */
+
+#include "includes.h"
+
+static
+uint32_t
+_TDNFVerifyCacheGetCookie(
+    const char *pszRepoCacheDir,
+    char **ppszCookie
+    )
+{
+    uint32_t dwError = 0;
+    char *pszRepoMD = NULL;
+    unsigned char pszCookie[SOLV_COOKIE_LEN] = {0};
+
+    dwError = TDNFJoinPath(&pszRepoMD,
+                           pszRepoCacheDir,
+                           TDNF_REPO_METADATA_FILE_PATH,
+                           NULL);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    if (access(pszRepoMD, F_OK))
+    {
+        dwError = ERROR_TDNF_NO_DATA;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    dwError = SolvCalculateCookieForFile(pszRepoMD, pszCookie);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    /* the cookie is a sha256 */
+    dwError = TDNFDigestToHex(pszCookie, TDNF_HASH_SHA256, ppszCookie);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+cleanup:
+    TDNF_SAFE_FREE_MEMORY(pszRepoMD);
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+static
+void
+_TDNFVerifyCacheFreeEntry(
+    PTDNF_VERIFY_CACHE_ENTRY pEntry
+    )
+{
+    TDNF_SAFE_FREE_MEMORY(pEntry->pszPath);
+    TDNF_SAFE_FREE_MEMORY(pEntry->pszDigest);
+    TDNF_SAFE_FREE_MEMORY(pEntry->pszKeyId);
+}
+
+static
+int
+_TDNFVerifyCacheMatchesStat(
+    PTDNF_VERIFY_CACHE_ENTRY pEntry,
+    const struct stat *pStat
+    )
+{
+    return pEntry->qwDev == (uint64_t)pStat->st_dev &&
+           pEntry->qwIno == (uint64_t)pStat->st_ino &&
+           pEntry->qwSize == (uint64_t)pStat->st_size &&
+           pEntry->llMTimeSec == (int64_t)pStat->st_mtim.tv_sec &&
+           pEntry->lMTimeNSec == pStat->st_mtim.tv_nsec &&
+           pEntry->llCTimeSec == (int64_t)pStat->st_ctim.tv_sec &&
+           pEntry->lCTimeNSec == pStat->st_ctim.tv_nsec;
+}
+
+static
+int
+_TDNFVerifyCacheIsSafeString(
+    const char *pszValue
+    )
+{
+    return !IsNullOrEmptyString(pszValue) &&
+           !strchr(pszValue, '\t') && !strchr(pszValue, '\n');
+}
+
+static
+uint32_t
+_TDNFVerifyCacheReadInt64(
+    char **ppszLine,
+    int64_t *pllValue
+    )
+{
+    uint32_t dwError = 0;
+    char *pszField = NULL;
+    char *pszEnd = NULL;
+
+    pszField = strsep(ppszLine, "\t");
+    if (IsNullOrEmptyString(pszField))
+    {
+        dwError = ERROR_TDNF_NO_DATA;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    *pllValue = strtoll(pszField, &pszEnd, 10);
+    if (*pszEnd)
+    {
+        dwError = ERROR_TDNF_NO_DATA;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+cleanup:
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+static
+uint32_t
+_TDNFVerifyCacheReadField(
+    char **ppszLine,
+    char **ppszValue
+    )
+{
+    uint32_t dwError = 0;
+    char *pszField = NULL;
+
+    pszField = strsep(ppszLine, "\t");
+    if (IsNullOrEmptyString(pszField))
+    {
+        dwError = ERROR_TDNF_NO_DATA;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    /* "-" is an empty value */
+    if (strcmp(pszField, "-"))
+    {
+        dwError = TDNFAllocateString(pszField, ppszValue);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+cleanup:
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+static
+uint32_t
+_TDNFVerifyCacheReadEntry(
+    char *pszLine,
+    PTDNF_VERIFY_CACHE_ENTRY pEntry
+    )
+{
+    uint32_t dwError = 0;
+    int64_t llValue = 0;
+
+    dwError = _TDNFVerifyCacheReadInt64(&pszLine, &llValue);
+    BAIL_ON_TDNF_ERROR(dwError);
+    pEntry->qwDev = llValue;
+    dwError = _TDNFVerifyCacheReadInt64(&pszLine, &llValue);
+    BAIL_ON_TDNF_ERROR(dwError);
+    pEntry->qwIno = llValue;
+    dwError = _TDNFVerifyCacheReadInt64(&pszLine, &llValue);
+    BAIL_ON_TDNF_ERROR(dwError);
+    pEntry->qwSize = llValue;
+    dwError = _TDNFVerifyCacheReadInt64(&pszLine, &pEntry->llMTimeSec);
+    BAIL_ON_TDNF_ERROR(dwError);
+    dwError = _TDNFVerifyCacheReadInt64(&pszLine, &llValue);
+    BAIL_ON_TDNF_ERROR(dwError);
+    pEntry->lMTimeNSec = llValue;
+    dwError = _TDNFVerifyCacheReadInt64(&pszLine, &pEntry->llCTimeSec);
+    BAIL_ON_TDNF_ERROR(dwError);
+    dwError = _TDNFVerifyCacheReadInt64(&pszLine, &llValue);
+    BAIL_ON_TDNF_ERROR(dwError);
+    pEntry->lCTimeNSec = llValue;
+    dwError = _TDNFVerifyCacheReadInt64(&pszLine, &llValue);
+    BAIL_ON_TDNF_ERROR(dwError);
+    if (llValue < 0 || llValue >= TDNF_HASH_SENTINEL)
+    {
+        dwError = ERROR_TDNF_NO_DATA;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+    pEntry->nHashType = llValue;
+
+    dwError = _TDNFVerifyCacheReadField(&pszLine, &pEntry->pszDigest);
+    BAIL_ON_TDNF_ERROR(dwError);
+    dwError = _TDNFVerifyCacheReadField(&pszLine, &pEntry->pszKeyId);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    /* the path is the rest of the line */
+    if (!pEntry->pszDigest || IsNullOrEmptyString(pszLine))
+    {
+        dwError = ERROR_TDNF_NO_DATA;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+    dwError = TDNFAllocateString(pszLine, &pEntry->pszPath);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+cleanup:
+    return dwError;
+
+error:
+    _TDNFVerifyCacheFreeEntry(pEntry);
+    goto cleanup;
+}
+
+static
+uint32_t
+_TDNFVerifyCacheGrow(
+    PTDNF_VERIFY_CACHE pCache
+    )
+{
+    uint32_t dwError = 0;
+    uint32_t dwCapacity = 0;
+
+    if (pCache->dwCount < pCache->dwCapacity)
+    {
+        goto cleanup;
+    }
+
+    dwCapacity = pCache->dwCapacity ? pCache->dwCapacity * 2 : 16;
+    dwError = TDNFReAllocateMemory(dwCapacity * sizeof(TDNF_VERIFY_CACHE_ENTRY),
+                                   (void **)&pCache->pEntries);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    memset(pCache->pEntries + pCache->dwCapacity, 0,
+           (dwCapacity - pCache->dwCapacity) * sizeof(TDNF_VERIFY_CACHE_ENTRY));
+    pCache->dwCapacity = dwCapacity;
+
+cleanup:
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+/*
+ * Read the entries of an existing cache file. Anything unexpected,
+ * including a file root does not own, leaves the cache empty.
+ */
+static
+void
+_TDNFVerifyCacheRead(
+    PTDNF_VERIFY_CACHE pCache
+    )
+{
+    FILE *fp = NULL;
+    char *pszLine = NULL;
+    size_t nLineSize = 0;
+    ssize_t nRead = 0;
+    char *pszExpected = NULL;
+    struct stat st = {0};
+    TDNF_VERIFY_CACHE_ENTRY entry = {0};
+    uint32_t i;
+
+    fp = fopen(pCache->pszPath, "r");
+    if (!fp)
+    {
+        goto cleanup;
+    }
+
+    if (fstat(fileno(fp), &st) ||
+        st.st_uid != 0 ||
+        (st.st_mode & (S_IWGRP | S_IWOTH)) ||
+        !S_ISREG(st.st_mode))
+    {
+        goto cleanup;
+    }
+
+    if (TDNFAllocateStringPrintf(&pszExpected, "%s %d %s\n",
+                                 TDNF_VERIFY_CACHE_MAGIC,
+                                 TDNF_VERIFY_CACHE_VERSION,
+                                 pCache->pszCookie))
+    {
+        goto cleanup;
+    }
+
+    if (getline(&pszLine, &nLineSize, fp) < 0 ||
+        strcmp(pszLine, pszExpected))
+    {
+        goto cleanup;
+    }
+
+    while ((nRead = getline(&pszLine, &nLineSize, fp)) > 0)
+    {
+        if (pszLine[nRead - 1] == '\n')
+        {
+            pszLine[nRead - 1] = '\0';
+        }
+        if (_TDNFVerifyCacheReadEntry(pszLine, &entry) ||
+            _TDNFVerifyCacheGrow(pCache))
+        {
+            _TDNFVerifyCacheFreeEntry(&entry);
+            break;
+        }
+        pCache->pEntries[pCache->dwCount++] = entry;
+        memset(&entry, 0, sizeof(entry));
+    }
+
+    /* a broken line means the file cannot be trusted at all */
+    if (nRead > 0)
+    {
+        for (i = 0; i < pCache->dwCount; i++)
+        {
+            _TDNFVerifyCacheFreeEntry(&pCache->pEntries[i]);
+        }
+        pCache->dwCount = 0;
+    }
+
+cleanup:
+    TDNF_SAFE_FREE_MEMORY(pszExpected);
+    if (pszLine)
+    {
+        free(pszLine);
+    }
+    if (fp)
+    {
+        fclose(fp);
+    }
+}
+
+/*
+ * Load the verify cache of pRepo. Returns ERROR_TDNF_NO_DATA for
+ * repos that cannot have one, like repos without metadata. A
+ * missing, stale or untrusted cache file gives an empty cache.
+ */
+uint32_t
+TDNFVerifyCacheLoad(
+    PTDNF pTdnf,
+    PTDNF_REPO_DATA pRepo,
+    PTDNF_VERIFY_CACHE *ppCache
+    )
+{
+    uint32_t dwError = 0;
+    PTDNF_VERIFY_CACHE pCache = NULL;
+    char *pszRepoCacheDir = NULL;
+
+    if (!pTdnf || !pTdnf->pConf || !pRepo || !ppCache)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    if (!pRepo->nHasMetaData || !strcmp(pRepo->pszId, CMDLINE_REPO_NAME))
+    {
+        dwError = ERROR_TDNF_NO_DATA;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    dwError = TDNFAllocateMemory(1, sizeof(TDNF_VERIFY_CACHE),
+                                 (void **)&pCache);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    pCache->pRepo = pRepo;
+
+    dwError = TDNFGetCachePath(pTdnf, pRepo, NULL, NULL, &pszRepoCacheDir);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = _TDNFVerifyCacheGetCookie(pszRepoCacheDir, &pCache->pszCookie);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFJoinPath(&pCache->pszPath,
+                           pszRepoCacheDir,
+                           TDNF_VERIFY_CACHE_FILE_NAME,
+                           NULL);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    _TDNFVerifyCacheRead(pCache);
+
+    *ppCache = pCache;
+
+cleanup:
+    TDNF_SAFE_FREE_MEMORY(pszRepoCacheDir);
+    return dwError;
+
+error:
+    TDNFFreeVerifyCache(pCache);
+    goto cleanup;
+}
+
+PTDNF_VERIFY_CACHE_ENTRY
+TDNFVerifyCacheLookup(
+    PTDNF_VERIFY_CACHE pCache,
+    const struct stat *pStat
+    )
+{
+    uint32_t i;
+
+    if (pCache && pStat)
+    {
+        for (i = 0; i < pCache->dwCount; i++)
+        {
+            if (_TDNFVerifyCacheMatchesStat(&pCache->pEntries[i], pStat))
+            {
+                return &pCache->pEntries[i];
+            }
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Remember that the file pszPath with pStat has the digest pszDigest
+ * and, if pszKeyId is set, a signature of that key.
+ */
+uint32_t
+TDNFVerifyCacheSet(
+    PTDNF_VERIFY_CACHE pCache,
+    const char *pszPath,
+    const struct stat *pStat,
+    int nHashType,
+    const char *pszDigest,
+    const char *pszKeyId
+    )
+{
+    uint32_t dwError = 0;
+    PTDNF_VERIFY_CACHE_ENTRY pEntry = NULL;
+    TDNF_VERIFY_CACHE_ENTRY entry = {0};
+
+    if (!pCache || !pStat || IsNullOrEmptyString(pszDigest) ||
+        nHashType < 0 || nHashType >= TDNF_HASH_SENTINEL)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    /* entries we could not read back are left out */
+    if (!_TDNFVerifyCacheIsSafeString(pszPath) ||
+        !_TDNFVerifyCacheIsSafeString(pszDigest) ||
+        (pszKeyId && !_TDNFVerifyCacheIsSafeString(pszKeyId)))
+    {
+        goto cleanup;
+    }
+
+    pEntry = TDNFVerifyCacheLookup(pCache, pStat);
+    if (pEntry &&
+        pEntry->nHashType == nHashType &&
+        !strcmp(pEntry->pszPath, pszPath) &&
+        !strcmp(pEntry->pszDigest, pszDigest) &&
+        ((!pszKeyId && !pEntry->pszKeyId) ||
+         (pszKeyId && pEntry->pszKeyId && !strcmp(pEntry->pszKeyId, pszKeyId))))
+    {
+        goto cleanup;
+    }
+
+    dwError = TDNFAllocateString(pszPath, &entry.pszPath);
+    BAIL_ON_TDNF_ERROR(dwError);
+    dwError = TDNFAllocateString(pszDigest, &entry.pszDigest);
+    BAIL_ON_TDNF_ERROR(dwError);
+    if (pszKeyId)
+    {
+        dwError = TDNFAllocateString(pszKeyId, &entry.pszKeyId);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+    entry.qwDev = pStat->st_dev;
+    entry.qwIno = pStat->st_ino;
+    entry.qwSize = pStat->st_size;
+    entry.llMTimeSec = pStat->st_mtim.tv_sec;
+    entry.lMTimeNSec = pStat->st_mtim.tv_nsec;
+    entry.llCTimeSec = pStat->st_ctim.tv_sec;
+    entry.lCTimeNSec = pStat->st_ctim.tv_nsec;
+    entry.nHashType = nHashType;
+
+    if (pEntry)
+    {
+        _TDNFVerifyCacheFreeEntry(pEntry);
+    }
+    else
+    {
+        dwError = _TDNFVerifyCacheGrow(pCache);
+        BAIL_ON_TDNF_ERROR(dwError);
+        pEntry = &pCache->pEntries[pCache->dwCount++];
+    }
+    *pEntry = entry;
+    pCache->nChanged = 1;
+
+cleanup:
+    return dwError;
+
+error:
+    _TDNFVerifyCacheFreeEntry(&entry);
+    goto cleanup;
+}
+
+/*
+ * Write pCache if it was changed. Entries of files that are gone
+ * or were changed are dropped. Only root writes the cache, since
+ * only a cache owned by root is used.
+ */
+uint32_t
+TDNFVerifyCacheSave(
+    PTDNF_VERIFY_CACHE pCache
+    )
+{
+    uint32_t dwError = 0;
+    char *pszTmpPath = NULL;
+    FILE *fp = NULL;
+    int fd = -1;
+    struct stat st = {0};
+    uint32_t i;
+
+    if (!pCache)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    if (!pCache->nChanged || geteuid() != 0)
+    {
+        goto cleanup;
+    }
+
+    dwError = TDNFAllocateStringPrintf(&pszTmpPath, "%s.XXXXXX",
+                                       pCache->pszPath);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    fd = mkstemp(pszTmpPath);
+    if (fd < 0)
+    {
+        dwError = ERROR_TDNF_SYSTEM_BASE + errno;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    fp = fdopen(fd, "w");
+    if (!fp)
+    {
+        dwError = ERROR_TDNF_SYSTEM_BASE + errno;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+    fd = -1;
+
+    if (fprintf(fp, "%s %d %s\n",
+                TDNF_VERIFY_CACHE_MAGIC,
+                TDNF_VERIFY_CACHE_VERSION,
+                pCache->pszCookie) < 0)
+    {
+        dwError = ERROR_TDNF_SYSTEM_BASE + errno;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    for (i = 0; i < pCache->dwCount; i++)
+    {
+        PTDNF_VERIFY_CACHE_ENTRY pEntry = &pCache->pEntries[i];
+
+        if (stat(pEntry->pszPath, &st) ||
+            !_TDNFVerifyCacheMatchesStat(pEntry, &st))
+        {
+            continue;
+        }
+        if (fprintf(fp, "%llu\t%llu\t%llu\t%lld\t%ld\t%lld\t%ld\t%d\t%s\t%s\t%s\n",
+                    (unsigned long long)pEntry->qwDev,
+                    (unsigned long long)pEntry->qwIno,
+                    (unsigned long long)pEntry->qwSize,
+                    (long long)pEntry->llMTimeSec,
+                    pEntry->lMTimeNSec,
+                    (long long)pEntry->llCTimeSec,
+                    pEntry->lCTimeNSec,
+                    pEntry->nHashType,
+                    pEntry->pszDigest,
+                    pEntry->pszKeyId ? pEntry->pszKeyId : "-",
+                    pEntry->pszPath) < 0)
+        {
+            dwError = ERROR_TDNF_SYSTEM_BASE + errno;
+            BAIL_ON_TDNF_ERROR(dwError);
+        }
+    }
+
+    if (fflush(fp) || ferror(fp))
+    {
+        dwError = ERROR_TDNF_SYSTEM_BASE + (errno ? errno : EIO);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+    fclose(fp);
+    fp = NULL;
+
+    if (chmod(pszTmpPath, 0644) || rename(pszTmpPath, pCache->pszPath))
+    {
+        dwError = ERROR_TDNF_SYSTEM_BASE + errno;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+    pCache->nChanged = 0;
+
+cleanup:
+    TDNF_SAFE_FREE_MEMORY(pszTmpPath);
+    return dwError;
+
+error:
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+    if (fp)
+    {
+        fclose(fp);
+    }
+    if (pszTmpPath)
+    {
+        unlink(pszTmpPath);
+    }
+    goto cleanup;
+}
+
+/*
+ * Get the id of the key that signed the package of rpmHeader, as
+ * printed by rpm. Returns ERROR_TDNF_NO_DATA for unsigned packages.
+ */
+uint32_t
+TDNFVerifyCacheGetKeyId(
+    Header rpmHeader,
+    char **ppszKeyId
+    )
+{
+    uint32_t dwError = 0;
+    char *pszSig = NULL;
+    const char *pszKeyId = NULL;
+    const char *pszErr = NULL;
+
+    if (!rpmHeader || !ppszKeyId)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    pszSig = headerFormat(rpmHeader,
+                          "%|DSAHEADER?{%{DSAHEADER:pgpsig}}:"
+                          "{%|RSAHEADER?{%{RSAHEADER:pgpsig}}:{(none)}|}|",
+                          &pszErr);
+    if (!pszSig || !(pszKeyId = strstr(pszSig, "Key ID ")))
+    {
+        dwError = ERROR_TDNF_NO_DATA;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+    pszKeyId += strlen("Key ID ");
+
+    dwError = TDNFAllocateString(pszKeyId, ppszKeyId);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+cleanup:
+    if (pszSig)
+    {
+        free(pszSig);
+    }
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+/* a long key id, hex digits of a fixed length */
+static
+int
+_TDNFVerifyCacheIsKeyId(
+    const char *pszKeyId,
+    size_t nLen
+    )
+{
+    size_t i;
+
+    for (i = 0; i < nLen; i++)
+    {
+        if (!isxdigit((unsigned char)pszKeyId[i]))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+ * Get the long key ids of the gpg-pubkey entries in the rpmdb of ts,
+ * from their gpg(<key id>) provides. The version is only the short
+ * key id. A cached key id is only trusted while its key is installed.
+ */
+uint32_t
+TDNFVerifyCacheGetTrustedKeys(
+    rpmts ts,
+    char ***pppszKeys
+    )
+{
+    uint32_t dwError = 0;
+    rpmdbMatchIterator pIterator = NULL;
+    Header rpmHeader = NULL;
+    rpmtd pTD = NULL;
+    char **ppszKeys = NULL;
+    const char *pszProvide = NULL;
+    int nCount = 0;
+    int i = 0;
+
+    if (!ts || !pppszKeys)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    pTD = rpmtdNew();
+    if (!pTD)
+    {
+        dwError = ERROR_TDNF_RPMTD_CREATE_FAILED;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    pIterator = rpmtsInitIterator(ts, RPMDBI_NAME, "gpg-pubkey", 0);
+    if (pIterator)
+    {
+        nCount = rpmdbGetIteratorCount(pIterator);
+    }
+
+    dwError = TDNFAllocateMemory(nCount + 1, sizeof(char *),
+                                 (void **)&ppszKeys);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    while (pIterator && i < nCount &&
+           (rpmHeader = rpmdbNextIterator(pIterator)) != NULL)
+    {
+        if (!headerGet(rpmHeader, RPMTAG_PROVIDENAME, pTD, HEADERGET_MINMEM))
+        {
+            continue;
+        }
+        while ((pszProvide = rpmtdNextString(pTD)) != NULL)
+        {
+            if (strlen(pszProvide) == TDNF_VERIFY_CACHE_KEY_ID_LEN + 5 &&
+                !strncmp(pszProvide, "gpg(", 4) &&
+                pszProvide[TDNF_VERIFY_CACHE_KEY_ID_LEN + 4] == ')' &&
+                _TDNFVerifyCacheIsKeyId(pszProvide + 4,
+                                        TDNF_VERIFY_CACHE_KEY_ID_LEN))
+            {
+                dwError = TDNFAllocateStringN(pszProvide + 4,
+                                              TDNF_VERIFY_CACHE_KEY_ID_LEN,
+                                              &ppszKeys[i++]);
+                BAIL_ON_TDNF_ERROR(dwError);
+                break;
+            }
+        }
+        rpmtdFreeData(pTD);
+    }
+
+    *pppszKeys = ppszKeys;
+
+cleanup:
+    if (pIterator)
+    {
+        rpmdbFreeIterator(pIterator);
+    }
+    if (pTD)
+    {
+        rpmtdFree(pTD);
+    }
+    return dwError;
+
+error:
+    TDNFFreeStringArray(ppszKeys);
+    goto cleanup;
+}
+
+/*
+ * Key ids are matched whole. rpm prints the long key id of a
+ * signature, a fingerprint or a short id never matches.
+ */
+int
+TDNFVerifyCacheIsKeyTrusted(
+    char **ppszKeys,
+    const char *pszKeyId
+    )
+{
+    int i;
+
+    if (!ppszKeys || IsNullOrEmptyString(pszKeyId) ||
+        strlen(pszKeyId) != TDNF_VERIFY_CACHE_KEY_ID_LEN ||
+        !_TDNFVerifyCacheIsKeyId(pszKeyId, TDNF_VERIFY_CACHE_KEY_ID_LEN))
+    {
+        return 0;
+    }
+
+    for (i = 0; ppszKeys[i]; i++)
+    {
+        if (!strcasecmp(ppszKeys[i], pszKeyId))
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void
+TDNFFreeVerifyCache(
+    PTDNF_VERIFY_CACHE pCache
+    )
+{
+    PTDNF_VERIFY_CACHE pNext = NULL;
+    uint32_t i;
+
+    for (; pCache; pCache = pNext)
+    {
+        pNext = pCache->pNext;
+        for (i = 0; i < pCache->dwCount; i++)
+        {
+            _TDNFVerifyCacheFreeEntry(&pCache->pEntries[i]);
+        }
+        TDNF_SAFE_FREE_MEMORY(pCache->pEntries);
+        TDNF_SAFE_FREE_MEMORY(pCache->pszPath);
+        TDNF_SAFE_FREE_MEMORY(pCache->pszCookie);
+        TDNFFreeMemory(pCache);
+    }
+}
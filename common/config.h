@@ -41,6 +41,16 @@
 #define TDNF_CONF_KEY_OPENMAX             "openmax"
 #define TDNF_CONF_KEY_CHECK_UPDATE_COMPAT "dnf_check_update_compat"
 #define TDNF_CONF_KEY_DISTROSYNC_REINSTALL_CHANGED "distrosync_reinstall_changed"
+#define TDNF_CONF_KEY_PACKAGE_STORE      "package_store"
+#define TDNF_CONF_KEY_LOCAL_HARDLINK     "local_hardlink"
+#define TDNF_CONF_KEY_SHARED_CACHEDIR    "shared_cachedir"
+#define TDNF_CONF_KEY_CACHE_BUDGET       "cache_budget"
+#define TDNF_CONF_KEY_SOLVCACHE_ZSTD_LEVEL "solvcache_zstd_level"
+#define TDNF_CONF_KEY_PREFETCH_THROTTLE  "prefetch_throttle"
+#define TDNF_CONF_KEY_STALE_WHILE_REVALIDATE "stale_while_revalidate"
+#define TDNF_CONF_KEY_MAX_CONCURRENT_STREAMS "max_concurrent_streams"
+#define TDNF_CONF_KEY_MAX_BANDWIDTH      "max_bandwidth"
+#define TDNF_CONF_KEY_BANDWIDTH_SHARES   "bandwidth_shares"
 
 //Repo file key names
 #define TDNF_REPO_KEY_BASEURL             "baseurl"
@@ -58,6 +68,7 @@
 #define TDNF_REPO_KEY_RETRIES             "retries"
 #define TDNF_REPO_KEY_MINRATE             "minrate"
 #define TDNF_REPO_KEY_THROTTLE            "throttle"
+#define TDNF_REPO_KEY_STALL_TIMEOUT       "stall_timeout"
 #define TDNF_REPO_KEY_SSL_VERIFY          "sslverify"
 #define TDNF_REPO_KEY_SSL_CA_CERT         "sslcacert"
 #define TDNF_REPO_KEY_SSL_CLI_CERT        "sslclientcert"
@@ -65,6 +76,7 @@
 #define TDNF_REPO_KEY_SKIP_MD_FILELISTS   "skip_md_filelists"
 #define TDNF_REPO_KEY_SKIP_MD_UPDATEINFO  "skip_md_updateinfo"
 #define TDNF_REPO_KEY_SKIP_MD_OTHER       "skip_md_other"
+#define TDNF_REPO_KEY_HTTP2_PRIOR_KNOWLEDGE "http2_prior_knowledge"
 
 //setopt keys
 #define TDNF_SETOPT_KEY_REPOSDIR          "reposdir"
@@ -97,6 +109,7 @@
 #define TDNF_REPO_DEFAULT_GPGCHECK           1
 #define TDNF_REPO_DEFAULT_MINRATE            0
 #define TDNF_REPO_DEFAULT_THROTTLE           0
+#define TDNF_REPO_DEFAULT_STALL_TIMEOUT      30
 #define TDNF_REPO_DEFAULT_TIMEOUT            0
 #define TDNF_REPO_DEFAULT_SSLVERIFY          1
 #define TDNF_REPO_DEFAULT_RETRIES            10
@@ -106,6 +119,7 @@
 #define TDNF_REPO_DEFAULT_SKIP_MD_FILELISTS  0
 #define TDNF_REPO_DEFAULT_SKIP_MD_UPDATEINFO 0
 #define TDNF_REPO_DEFAULT_SKIP_MD_OTHER      0
+#define TDNF_REPO_DEFAULT_HTTP2_PRIOR_KNOWLEDGE 0
 
 // var names
 #define TDNF_VAR_RELEASEVER               "$releasever"
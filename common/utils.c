@@ -414,6 +414,7 @@ TDNFFreeCmdArgs(
     TDNF_SAFE_FREE_MEMORY(pCmdArgs->ppszCmds);
     TDNF_SAFE_FREE_MEMORY(pCmdArgs->pszDownloadDir);
     TDNF_SAFE_FREE_MEMORY(pCmdArgs->pszInstallRoot);
+    TDNF_SAFE_FREE_STRINGARRAY(pCmdArgs->ppszInstallRoots);
     TDNF_SAFE_FREE_MEMORY(pCmdArgs->pszConfFile);
     TDNF_SAFE_FREE_MEMORY(pCmdArgs->pszReleaseVer);
 
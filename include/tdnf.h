@@ -32,6 +32,15 @@ TDNFOpenHandle(
     PTDNF* pTdnf
     );
 
+//Switch a handle to another installroot, for batch runs
+//over several roots. Repo metadata that is already loaded
+//is kept, only the installed packages are read again.
+uint32_t
+TDNFSetInstallRoot(
+    PTDNF pTdnf,
+    const char *pszInstallRoot
+    );
+
 uint32_t
 TDNFRefresh(
     PTDNF pTdnf
@@ -131,6 +140,27 @@ TDNFUpdateInfo(
     PTDNF_UPDATEINFO* ppUpdateInfo
     );
 
+//Precompute the update summary used by --cached
+uint32_t
+TDNFCacheUpdateSummary(
+    PTDNF pTdnf
+    );
+
+//Download the packages of the pending upgrade to the cache,
+//at low priority, see prefetch_throttle and cache_budget
+uint32_t
+TDNFPrefetchUpgrades(
+    PTDNF pTdnf
+    );
+
+//Downloads of this process so far, pStats is an array of
+//TDNF_XFER_CLASS_COUNT, indexed by TDNF_XFER_CLASS
+uint32_t
+TDNFGetTransferStats(
+    PTDNF pTdnf,
+    PTDNF_XFER_STAT pStats
+    );
+
 //Show update info summary
 uint32_t
 TDNFUpdateInfoSummary(
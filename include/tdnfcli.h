@@ -377,6 +377,28 @@ TDNFCliShowNoSuchCommand(
     const char* pszCmd
     );
 
+//automatic.c
+uint32_t
+TDNFCliAutomaticPrepare(
+    PTDNF_CMD_ARGS pCmdArgs
+    );
+
+uint32_t
+TDNFCliAutomaticCommand(
+    PTDNF_CLI_CONTEXT pContext,
+    PTDNF_CMD_ARGS pCmdArgs
+    );
+
+int
+TDNFCliAutomaticIsLegacy(
+    PTDNF_CMD_ARGS pCmdArgs
+    );
+
+uint32_t
+TDNFCliAutomaticLegacyError(
+    uint32_t dwErrorCode
+    );
+
 #ifdef __cplusplus
 }
 #endif
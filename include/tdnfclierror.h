@@ -28,5 +28,7 @@
 #define ERROR_TDNF_CLI_ALLDEPS_REQUIRES_DOWNLOADONLY     (ERROR_TDNF_CLI_BASE + 15)
 #define ERROR_TDNF_CLI_NODEPS_REQUIRES_DOWNLOADONLY      (ERROR_TDNF_CLI_BASE + 16)
 #define ERROR_TDNF_CLI_INVALID_MIXED_QUERY_QUERYFORMAT   (ERROR_TDNF_CLI_BASE + 17)
+#define ERROR_TDNF_CLI_AUTOMATIC_CONF                    (ERROR_TDNF_CLI_BASE + 18)
+#define ERROR_TDNF_CLI_AUTOMATIC_OFFLINE                 (ERROR_TDNF_CLI_BASE + 19)
 
 #endif /* __TDNF_CLI_ERR_H__ */
@@ -170,6 +170,10 @@ typedef uint32_t
     char **ppszPkgNameSpecs,
     uint32_t nValue);
 
+typedef uint32_t
+(*PFN_TDNF_PREFETCH)(
+    PTDNF_CLI_CONTEXT);
+
 typedef struct _TDNF_CLI_CONTEXT_
 {
     HTDNF hTdnf;
@@ -195,6 +199,7 @@ typedef struct _TDNF_CLI_CONTEXT_
     PFN_TDNF_HISTORY_RESOLVE_CMD  pFnHistoryResolve;
     PFN_TDNF_ALTER_HISTORY        pFnAlterHistory;
     PFN_TDNF_MARK_COMMAND         pFnMark;
+    PFN_TDNF_PREFETCH             pFnPrefetch;
 } TDNF_CLI_CONTEXT;
 
 #ifdef __cplusplus
@@ -30,6 +30,7 @@ typedef enum
     TDNF_PLUGIN_EVENT_TYPE_INIT     = 0x1, /* init is not maskable */
     TDNF_PLUGIN_EVENT_TYPE_REPO     = 0x2,
     TDNF_PLUGIN_EVENT_TYPE_REPO_MD  = 0x4,
+    TDNF_PLUGIN_EVENT_TYPE_PACKAGE  = 0x8,
     TDNF_PLUGIN_EVENT_TYPE_ALL      = 0xFF
 } TDNF_PLUGIN_EVENT_TYPE;
 
@@ -181,6 +182,18 @@ TDNFEventContextGetItemPtr(
     const void **pPtr
     );
 
+/*
+ * set or add a string item, used by plugins to hand data back
+ * to tdnf. pcszStr is not copied and must stay valid after the
+ * event handler returns, keep it with the plugin handle.
+ */
+uint32_t
+TDNFEventContextSetItemString(
+    PTDNF_EVENT_CONTEXT pContext,
+    const char *pcszName,
+    const char *pcszStr
+    );
+
 /* plugin error reporting */
 uint32_t
 TDNFGetPluginErrorString(
@@ -11,7 +11,7 @@
 
 #include "tdnfplugin.h"
 
-#define TDNF_PLUGIN_EVENT_MAP_VERSION "1.0.0"
+#define TDNF_PLUGIN_EVENT_MAP_VERSION "1.1.0"
 
 /*
  * get current plugin event map version. event maps
@@ -30,6 +30,13 @@ TDNFPluginGetEventMapVersion(
 #define TDNF_EVENT_ITEM_REPO_DATADIR "repo.datadir"
 #define TDNF_EVENT_ITEM_REPO_MD_URL  "repomd.url"
 #define TDNF_EVENT_ITEM_REPO_MD_FILE "repomd.file"
+#define TDNF_EVENT_ITEM_PKG_LOCATION "package.location"
+/* <hash type>:<hex digest>, only if the repo metadata has one */
+#define TDNF_EVENT_ITEM_PKG_CHECKSUM "package.checksum"
+/* where tdnf wants the package */
+#define TDNF_EVENT_ITEM_PKG_FILE     "package.file"
+/* set by a plugin at download start to fetch from this url */
+#define TDNF_EVENT_ITEM_PKG_URL      "package.url"
 
 typedef enum
 {
@@ -81,6 +88,37 @@ typedef struct _TDNF_PLUGIN_EVENT_MAP_
             {TDNF_EVENT_ITEM_TYPE_STRING,    TDNF_EVENT_ITEM_REPO_BASEURL},\
             {TDNF_EVENT_ITEM_TYPE_STRING,    TDNF_EVENT_ITEM_REPO_MD_FILE}\
         }\
+    },\
+    /*\
+     * a plugin can satisfy the download by putting the package at\
+     * TDNF_EVENT_ITEM_PKG_FILE, or redirect it by setting\
+     * TDNF_EVENT_ITEM_PKG_URL. Either way the file is checked\
+     * against size and checksum, tdnf falls back to the repo if\
+     * it does not match or there is no checksum to check.\
+     */\
+    {\
+        4,\
+        MAKE_PLUGIN_EVENT(TDNF_PLUGIN_EVENT_TYPE_PACKAGE,\
+                          TDNF_PLUGIN_EVENT_STATE_DOWNLOAD,\
+                          TDNF_PLUGIN_EVENT_PHASE_START),\
+        {\
+            {TDNF_EVENT_ITEM_TYPE_STRING,    TDNF_EVENT_ITEM_REPO_ID},\
+            {TDNF_EVENT_ITEM_TYPE_STRING,    TDNF_EVENT_ITEM_PKG_LOCATION},\
+            {TDNF_EVENT_ITEM_TYPE_STRING,    TDNF_EVENT_ITEM_PKG_CHECKSUM},\
+            {TDNF_EVENT_ITEM_TYPE_STRING,    TDNF_EVENT_ITEM_PKG_FILE}\
+        }\
+    },\
+    {\
+        4,\
+        MAKE_PLUGIN_EVENT(TDNF_PLUGIN_EVENT_TYPE_PACKAGE,\
+                          TDNF_PLUGIN_EVENT_STATE_DOWNLOAD,\
+                          TDNF_PLUGIN_EVENT_PHASE_END),\
+        {\
+            {TDNF_EVENT_ITEM_TYPE_STRING,    TDNF_EVENT_ITEM_REPO_ID},\
+            {TDNF_EVENT_ITEM_TYPE_STRING,    TDNF_EVENT_ITEM_PKG_LOCATION},\
+            {TDNF_EVENT_ITEM_TYPE_STRING,    TDNF_EVENT_ITEM_PKG_CHECKSUM},\
+            {TDNF_EVENT_ITEM_TYPE_STRING,    TDNF_EVENT_ITEM_PKG_FILE}\
+        }\
     }\
 };
 
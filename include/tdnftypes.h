@@ -110,6 +110,16 @@ typedef enum
     UPDATE_ENHANCEMENT
 }TDNF_UPDATEINFO_TYPE;
 
+//downloads by what they are for, see max_bandwidth
+typedef enum
+{
+    TDNF_XFER_REPOMD,
+    TDNF_XFER_METADATA,
+    TDNF_XFER_PACKAGE,
+    TDNF_XFER_PREFETCH,
+    TDNF_XFER_CLASS_COUNT
+}TDNF_XFER_CLASS;
+
 #define CLEANTYPE_NONE         0x00
 #define CLEANTYPE_PACKAGES     0x01
 #define CLEANTYPE_METADATA     0x02
@@ -118,6 +128,8 @@ typedef enum
 #define CLEANTYPE_EXPIRE_CACHE 0x10
 #define CLEANTYPE_KEYS         0x20
 #define CLEANTYPE_ALL          0xff
+//clean --stale, not part of 'all'
+#define CLEANTYPE_STALE        0x100
 
 
 //RepoList command filter
@@ -172,6 +184,7 @@ typedef struct _TDNF_PKG_INFO
     char *pszSourcePkg;
     unsigned char* pbChecksum;
     PTDNF_PKG_CHANGELOG_ENTRY pChangeLogEntries;
+    int nStale;            //from a repo with expired metadata
     struct _TDNF_PKG_INFO* pNext;
 }TDNF_PKG_INFO, *PTDNF_PKG_INFO;
 
@@ -245,6 +258,10 @@ typedef struct _TDNF_CMD_ARGS
 
     int nArgc;
     char **ppszArgv;
+
+    //all installroots of a batch run, NULL terminated.
+    //pszInstallRoot is the first one.
+    char **ppszInstallRoots;
 }TDNF_CMD_ARGS, *PTDNF_CMD_ARGS;
 
 typedef struct _TDNF_CONF
@@ -269,6 +286,16 @@ typedef struct _TDNF_CONF
     char** ppszMinVersions;
     char** ppszPkgLocks;
     char** ppszProtectedPkgs;
+    char* pszPackageStore;
+    int nLocalHardlink;    //link files from file:// repos instead of copying
+    char* pszSharedCacheDir; //repo metadata of all installroots, may be NULL
+    uint64_t qwCacheBudget; //bytes of cached packages to keep, 0 for no limit
+    int nSolvCacheZstdLevel; //zstd level of the solv cache, 0 for raw
+    uint64_t qwPrefetchThrottle; //bytes per second for prefetch, 0 for no limit
+    int nStaleWhileRevalidate; //read-only commands may use expired metadata
+    int nMaxConcurrentStreams; //parallel package downloads per mirror, 0 or 1 for serial
+    uint64_t qwMaxBandwidth; //bytes per second of all downloads, 0 for no limit
+    int nBandwidthShares[TDNF_XFER_CLASS_COUNT]; //weights of TDNF_XFER_CLASS
 }TDNF_CONF, *PTDNF_CONF;
 
 typedef struct _TDNF_REPO_DATA
@@ -293,11 +320,14 @@ typedef struct _TDNF_REPO_DATA
     int nTimeout;
     int nMinrate;
     int nThrottle;
+    int nStallTimeout;     //seconds below minrate before trying the next url
     int nRetries;
     int nSkipMDFileLists;
     int nSkipMDUpdateInfo;
     int nSkipMDOther;
     char *pszCacheName;
+    int nStale;            //loaded from expired metadata, see stale_while_revalidate
+    int nHttp2PriorKnowledge; //speak HTTP/2 to http:// urls without an upgrade
 
     struct _TDNF_REPO_DATA* pNext;
 }TDNF_REPO_DATA, *PTDNF_REPO_DATA;
@@ -359,6 +389,7 @@ typedef struct _TDNF_REPOSYNC_ARGS
     char *pszDownloadPath;
     char *pszMetaDataPath;
     char **ppszArchs;
+    int nWorkers;
 }TDNF_REPOSYNC_ARGS, *PTDNF_REPOSYNC_ARGS;
 
 typedef enum {
@@ -449,6 +480,14 @@ typedef struct _TDNF_HISTORY_INFO
     PTDNF_HISTORY_INFO_ITEM pItems;
 } TDNF_HISTORY_INFO, *PTDNF_HISTORY_INFO;
 
+//downloads of one TDNF_XFER_CLASS, see TDNFGetTransferStats()
+typedef struct _TDNF_XFER_STAT
+{
+    uint64_t qwBytes;
+    double dSeconds;        //time with downloads of the class running
+    double dWaitSeconds;    //of that, time held back by max_bandwidth
+} TDNF_XFER_STAT, *PTDNF_XFER_STAT;
+
 #ifdef __cplusplus
 }
 #endif
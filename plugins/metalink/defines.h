@@ -23,6 +23,16 @@
 #define ERROR_TDNF_METALINK_END                             ERROR_TDNF_METALINK_START + 10
 
 #define TDNF_REPO_CONFIG_METALINK_KEY "metalink"
+#define TDNF_REPO_CONFIG_METALINK_PROBE_KEY "metalink_probe"
+#define TDNF_REPO_CONFIG_METALINK_PROBE_EXPIRE_KEY "metalink_probe_expire"
+
+//mirror ranking, kept in the repo cache dir
+#define TDNF_METALINK_RANK_FILE_NAME      "metalink.rank"
+#define TDNF_METALINK_RANK_MAGIC          "tdnf-metalink-rank"
+#define TDNF_METALINK_RANK_VERSION        1
+#define TDNF_METALINK_PROBE_EXPIRE        86400
+#define TDNF_METALINK_PROBE_RANGE         "0-65535"
+#define TDNF_METALINK_PROBE_TIMEOUT_MS    5000L
 
 #define METALINK_PLUGIN_ERROR "metalink plugin error"
 #define METALINK_ERROR_TABLE \
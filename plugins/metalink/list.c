@@ -20,10 +20,21 @@
 
 #include "includes.h"
 
+/* order by preference, highest first */
+int
+TDNFCompareUrlPreference(
+    TDNF_ML_URL_INFO *urlA,
+    TDNF_ML_URL_INFO *urlB
+    )
+{
+    return urlB->preference - urlA->preference;
+}
+
 TDNF_ML_LIST*
 TDNFMergeList(
     TDNF_ML_LIST* listA,
-    TDNF_ML_LIST* listB
+    TDNF_ML_LIST* listB,
+    TDNF_ML_URL_CMP_FUNC cmp_func
     )
 {
     uint32_t dwError = 0;
@@ -47,7 +58,7 @@ TDNFMergeList(
         return (listA);
     }
 
-    //Compare the URL Preference to sort the URL List in descending order.
+    //Compare the URLs, equal ones keep their order.
     urlA = listA->data;
     urlB = listB->data;
 
@@ -57,15 +68,15 @@ TDNFMergeList(
         BAIL_ON_TDNF_ERROR(dwError);
     }
 
-    if (urlA->preference >= urlB->preference)
+    if (cmp_func(urlA, urlB) <= 0)
     {
         mergedList = listA;
-        mergedList->next = TDNFMergeList(listA->next, listB);
+        mergedList->next = TDNFMergeList(listA->next, listB, cmp_func);
     }
     else
     {
         mergedList = listB;
-        mergedList->next = TDNFMergeList(listA, listB->next);
+        mergedList->next = TDNFMergeList(listA, listB->next, cmp_func);
     }
 
     return mergedList;
@@ -113,16 +124,18 @@ TDNFFrontBackSplit(
     slowPtr->next = NULL;
 }
 
+/* stable merge sort of the url list with cmp_func */
 void
-TDNFSortListOnPreference(
-    TDNF_ML_LIST** headUrl
+TDNFSortList(
+    TDNF_ML_LIST** headUrl,
+    TDNF_ML_URL_CMP_FUNC cmp_func
     )
 {
     TDNF_ML_LIST* head = NULL;
     TDNF_ML_LIST* listA = NULL;
     TDNF_ML_LIST* listB = NULL;
 
-    if (!headUrl)
+    if (!headUrl || !cmp_func)
     {
         return;
     }
@@ -135,13 +148,21 @@ TDNFSortListOnPreference(
 
     TDNFFrontBackSplit(head, &listA, &listB);
 
-    TDNFSortListOnPreference(&listA);
-    TDNFSortListOnPreference(&listB);
+    TDNFSortList(&listA, cmp_func);
+    TDNFSortList(&listB, cmp_func);
 
-    *headUrl = TDNFMergeList(listA, listB);
+    *headUrl = TDNFMergeList(listA, listB, cmp_func);
 
 }
 
+void
+TDNFSortListOnPreference(
+    TDNF_ML_LIST** headUrl
+    )
+{
+    TDNFSortList(headUrl, TDNFCompareUrlPreference);
+}
+
 /* This function is used to append the list with
  * new node at last.
  */
@@ -51,6 +51,8 @@ TDNFMetalinkReadConfig(
 {
     uint32_t dwError = 0;
     char *pszMetalink = NULL;
+    int nProbe = 0;
+    long lProbeExpire = TDNF_METALINK_PROBE_EXPIRE;
     struct cnfnode *cn_section = NULL, *cn;
     PTDNF_METALINK_DATA pData = NULL;
 
@@ -77,6 +79,14 @@ TDNFMetalinkReadConfig(
             if (pszMetalink != NULL) free(pszMetalink);
             pszMetalink = strdup(cn->value);
         }
+        else if (strcmp(cn->name, TDNF_REPO_CONFIG_METALINK_PROBE_KEY) == 0)
+        {
+            nProbe = atoi(cn->value);
+        }
+        else if (strcmp(cn->name, TDNF_REPO_CONFIG_METALINK_PROBE_EXPIRE_KEY) == 0)
+        {
+            lProbeExpire = strtol(cn->value, NULL, 10);
+        }
     }
 
     /*
@@ -97,6 +107,9 @@ TDNFMetalinkReadConfig(
         dwError = TDNFConfigReplaceVars(pHandle->pTdnf, &pData->pszMetalink);
         BAIL_ON_TDNF_ERROR(dwError);
 
+        pData->nProbe = nProbe > 0 ? nProbe : 0;
+        pData->lProbeExpire = lProbeExpire;
+
         pData->pNext = pHandle->pData;
         pHandle->pData = pData;
     }
@@ -284,6 +297,16 @@ TDNFMetalinkGetBaseURLs(
                 pszMetaLinkFile, ml_ctx);
     BAIL_ON_TDNF_ERROR(dwError);
 
+    if (pData->nProbe > 0)
+    {
+        /* best effort, the preference order is still good */
+        if (TDNFMetalinkRankMirrors(pTdnf, pRepo, pData, ml_ctx))
+        {
+            pr_info("could not rank mirrors of %s, using preference\n",
+                    pcszRepoId);
+        }
+    }
+
     dwError = TDNFGetUrlsFromMLCtx(pTdnf, ml_ctx, &pRepo->ppszBaseUrls);
     BAIL_ON_TDNF_ERROR(dwError);
 
@@ -0,0 +1,490 @@
+/*
+ * Copyright (C) 2023 VMware, Inc. All Rights Reserved.
+ *
+ * Licensed under the GNU Lesser General Public License v2.1 (the "License");
+ * you may not use this file except in compliance with the License. The terms
+ * of the License are located in the COPYING file of this distribution.
+ */
+
+/*
+ * Rank metalink mirrors by how fast they are from this host. The top
+ * mirrors by preference get a small ranged request for repomd.xml, all
+ * at the same time. The score is the throughput of that request,
+ * time to first byte included, weighted by preference. The ranking is
+ * kept in the repo cache dir until it expires. The probes are repomd
+ * transfers for max_bandwidth, like the download they stand in for.
+ */
+
+#include "includes.h"
+
+static
+size_t
+_TDNFMetalinkProbeWrite(
+    char *ptr,
+    size_t size,
+    size_t nmemb,
+    void *pUserData
+    )
+{
+    TDNF_ML_PROBE *pProbe = pUserData;
+
+    UNUSED(ptr);
+
+    TDNFBandwidthConsume(TDNF_XFER_REPOMD, size * nmemb);
+    pProbe->nBytes += size * nmemb;
+    return size * nmemb;
+}
+
+/*
+ * Measured mirrors first, fastest first. Then mirrors that were not
+ * probed and last the ones that failed, both by preference.
+ */
+static
+int
+_TDNFCompareUrlRank(
+    TDNF_ML_URL_INFO *urlA,
+    TDNF_ML_URL_INFO *urlB
+    )
+{
+    int nClassA = urlA->score > 0 ? 0 : (urlA->score == 0 ? 1 : 2);
+    int nClassB = urlB->score > 0 ? 0 : (urlB->score == 0 ? 1 : 2);
+
+    if (nClassA != nClassB)
+    {
+        return nClassA - nClassB;
+    }
+    if (nClassA == 0 && urlA->score != urlB->score)
+    {
+        return urlA->score > urlB->score ? -1 : 1;
+    }
+    return TDNFCompareUrlPreference(urlA, urlB);
+}
+
+static
+uint32_t
+_TDNFMetalinkProbeInit(
+    PTDNF pTdnf,
+    PTDNF_REPO_DATA pRepo,
+    TDNF_ML_PROBE *pProbe
+    )
+{
+    uint32_t dwError = 0;
+    CURL *pCurl = NULL;
+
+    pCurl = curl_easy_init();
+    if (!pCurl)
+    {
+        dwError = ERROR_TDNF_CURL_INIT;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+    pProbe->pCurl = pCurl;
+
+    TDNFBandwidthStart(TDNF_XFER_REPOMD);
+    pProbe->nStarted = 1;
+
+    dwError = TDNFRepoApplyProxySettings(pTdnf->pConf, pCurl);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFRepoApplySSLSettings(pRepo, pCurl);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = curl_easy_setopt(pCurl, CURLOPT_URL, pProbe->urlInfo->url);
+    BAIL_ON_TDNF_CURL_ERROR(dwError);
+
+    dwError = curl_easy_setopt(pCurl, CURLOPT_RANGE, TDNF_METALINK_PROBE_RANGE);
+    BAIL_ON_TDNF_CURL_ERROR(dwError);
+
+    dwError = curl_easy_setopt(pCurl, CURLOPT_FOLLOWLOCATION, 1L);
+    BAIL_ON_TDNF_CURL_ERROR(dwError);
+
+    dwError = curl_easy_setopt(pCurl, CURLOPT_TIMEOUT_MS,
+                               TDNF_METALINK_PROBE_TIMEOUT_MS);
+    BAIL_ON_TDNF_CURL_ERROR(dwError);
+
+    dwError = curl_easy_setopt(pCurl, CURLOPT_NOSIGNAL, 1L);
+    BAIL_ON_TDNF_CURL_ERROR(dwError);
+
+    dwError = curl_easy_setopt(pCurl, CURLOPT_WRITEFUNCTION,
+                               _TDNFMetalinkProbeWrite);
+    BAIL_ON_TDNF_CURL_ERROR(dwError);
+
+    dwError = curl_easy_setopt(pCurl, CURLOPT_WRITEDATA, pProbe);
+    BAIL_ON_TDNF_CURL_ERROR(dwError);
+
+    dwError = curl_easy_setopt(pCurl, CURLOPT_PRIVATE, pProbe);
+    BAIL_ON_TDNF_CURL_ERROR(dwError);
+
+error:
+    return dwError;
+}
+
+static
+void
+_TDNFMetalinkProbeScore(
+    PTDNF pTdnf,
+    TDNF_ML_PROBE *pProbe,
+    CURLcode nResult
+    )
+{
+    TDNF_ML_URL_INFO *urlInfo = pProbe->urlInfo;
+    long lStatus = 0;
+    double dTotal = 0;
+    double dFirstByte = 0;
+    double dSpeed = 0;
+
+    curl_easy_getinfo(pProbe->pCurl, CURLINFO_RESPONSE_CODE, &lStatus);
+    curl_easy_getinfo(pProbe->pCurl, CURLINFO_TOTAL_TIME, &dTotal);
+    curl_easy_getinfo(pProbe->pCurl, CURLINFO_STARTTRANSFER_TIME, &dFirstByte);
+
+    if (nResult != CURLE_OK || lStatus >= 400 || pProbe->nBytes == 0)
+    {
+        urlInfo->score = -1;
+        pr_info("mirror %s: probe failed\n", urlInfo->url);
+        return;
+    }
+
+    /* small requests are dominated by the time to the first byte,
+       which is what we want to see */
+    dSpeed = pProbe->nBytes / (dTotal > 0.001 ? dTotal : 0.001);
+    urlInfo->score = dSpeed * (100 + urlInfo->preference) / 200;
+
+    if (pTdnf->pArgs->nVerbose)
+    {
+        pr_info("mirror %s: first byte %.0f ms, %.0f KiB/s\n",
+                urlInfo->url, dFirstByte * 1000, dSpeed / 1024);
+    }
+}
+
+/* probe all of ppUrls at the same time */
+static
+uint32_t
+_TDNFMetalinkProbeUrls(
+    PTDNF pTdnf,
+    PTDNF_REPO_DATA pRepo,
+    TDNF_ML_URL_INFO **ppUrls,
+    int nCount
+    )
+{
+    uint32_t dwError = 0;
+    CURLM *pMulti = NULL;
+    CURLMcode nMultiError = CURLM_OK;
+    CURLMsg *pMsg = NULL;
+    TDNF_ML_PROBE *pProbes = NULL;
+    TDNF_ML_PROBE *pProbe = NULL;
+    int nRunning = 0;
+    int nLeft = 0;
+    int i;
+
+    pMulti = curl_multi_init();
+    if (!pMulti)
+    {
+        dwError = ERROR_TDNF_CURL_INIT;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    dwError = TDNFAllocateMemory(nCount, sizeof(*pProbes), (void **)&pProbes);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    for (i = 0; i < nCount; i++)
+    {
+        pProbes[i].urlInfo = ppUrls[i];
+
+        dwError = _TDNFMetalinkProbeInit(pTdnf, pRepo, &pProbes[i]);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        if (curl_multi_add_handle(pMulti, pProbes[i].pCurl) != CURLM_OK)
+        {
+            dwError = ERROR_TDNF_CURL_INIT;
+            BAIL_ON_TDNF_ERROR(dwError);
+        }
+    }
+
+    do
+    {
+        nMultiError = curl_multi_perform(pMulti, &nRunning);
+        if (nMultiError == CURLM_OK && nRunning)
+        {
+            nMultiError = curl_multi_wait(pMulti, NULL, 0, 1000, NULL);
+        }
+    } while (nMultiError == CURLM_OK && nRunning);
+
+    if (nMultiError != CURLM_OK)
+    {
+        dwError = ERROR_TDNF_CURL_INIT;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    while ((pMsg = curl_multi_info_read(pMulti, &nLeft)))
+    {
+        if (pMsg->msg != CURLMSG_DONE)
+        {
+            continue;
+        }
+        pProbe = NULL;
+        curl_easy_getinfo(pMsg->easy_handle, CURLINFO_PRIVATE, (char **)&pProbe);
+        if (pProbe)
+        {
+            _TDNFMetalinkProbeScore(pTdnf, pProbe, pMsg->data.result);
+        }
+    }
+
+cleanup:
+    if (pProbes)
+    {
+        for (i = 0; i < nCount; i++)
+        {
+            if (pProbes[i].pCurl)
+            {
+                if (pMulti)
+                {
+                    curl_multi_remove_handle(pMulti, pProbes[i].pCurl);
+                }
+                curl_easy_cleanup(pProbes[i].pCurl);
+            }
+            if (pProbes[i].nStarted)
+            {
+                TDNFBandwidthStop(TDNF_XFER_REPOMD);
+            }
+        }
+        TDNFFreeMemory(pProbes);
+    }
+    if (pMulti)
+    {
+        curl_multi_cleanup(pMulti);
+    }
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+static
+TDNF_ML_URL_INFO *
+_TDNFMetalinkFindUrl(
+    TDNF_ML_CTX *ml_ctx,
+    const char *pszUrl
+    )
+{
+    TDNF_ML_URL_LIST *urlList = NULL;
+    TDNF_ML_URL_INFO *urlInfo = NULL;
+
+    for (urlList = ml_ctx->urls; urlList; urlList = urlList->next)
+    {
+        urlInfo = urlList->data;
+        if (urlInfo && strcmp(urlInfo->url, pszUrl) == 0)
+        {
+            return urlInfo;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Read the scores of a ranking that has not expired. Returns
+ * ERROR_TDNF_NO_DATA if there is none, or if one of the first nProbe
+ * mirrors by preference is not in it (the metalink changed).
+ */
+static
+uint32_t
+_TDNFMetalinkReadRank(
+    const char *pszRankFile,
+    long lExpire,
+    int nIgnoreExpire,
+    TDNF_ML_CTX *ml_ctx,
+    int nProbe
+    )
+{
+    uint32_t dwError = 0;
+    FILE *fp = NULL;
+    char szMagic[32] = {0};
+    char szUrl[BUFSIZ] = {0};
+    int nVersion = 0;
+    long lTime = 0;
+    double dScore = 0;
+    TDNF_ML_URL_LIST *urlList = NULL;
+    TDNF_ML_URL_INFO *urlInfo = NULL;
+    int i;
+
+    fp = fopen(pszRankFile, "r");
+    if (!fp ||
+        fscanf(fp, "%31s %d %ld", szMagic, &nVersion, &lTime) != 3 ||
+        strcmp(szMagic, TDNF_METALINK_RANK_MAGIC) ||
+        nVersion != TDNF_METALINK_RANK_VERSION ||
+        (!nIgnoreExpire && time(NULL) - lTime > lExpire))
+    {
+        dwError = ERROR_TDNF_NO_DATA;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    while (fscanf(fp, "%lf %8191s", &dScore, szUrl) == 2)
+    {
+        urlInfo = _TDNFMetalinkFindUrl(ml_ctx, szUrl);
+        if (urlInfo)
+        {
+            urlInfo->score = dScore;
+        }
+    }
+
+    /* mirrors that were not probed have 0 */
+    for (urlList = ml_ctx->urls, i = 0;
+         urlList && i < nProbe && !nIgnoreExpire;
+         urlList = urlList->next, i++)
+    {
+        urlInfo = urlList->data;
+        if (urlInfo && urlInfo->score == 0)
+        {
+            dwError = ERROR_TDNF_NO_DATA;
+            BAIL_ON_TDNF_ERROR(dwError);
+        }
+    }
+
+cleanup:
+    if (fp)
+    {
+        fclose(fp);
+    }
+    return dwError;
+
+error:
+    for (urlList = ml_ctx->urls; urlList; urlList = urlList->next)
+    {
+        urlInfo = urlList->data;
+        if (urlInfo)
+        {
+            urlInfo->score = 0;
+        }
+    }
+    goto cleanup;
+}
+
+static
+uint32_t
+_TDNFMetalinkWriteRank(
+    const char *pszRankFile,
+    TDNF_ML_CTX *ml_ctx
+    )
+{
+    uint32_t dwError = 0;
+    char *pszTmpFile = NULL;
+    FILE *fp = NULL;
+    TDNF_ML_URL_LIST *urlList = NULL;
+    TDNF_ML_URL_INFO *urlInfo = NULL;
+
+    dwError = TDNFAllocateStringPrintf(&pszTmpFile, "%s.tmp", pszRankFile);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    fp = fopen(pszTmpFile, "w");
+    if (!fp)
+    {
+        dwError = errno;
+        BAIL_ON_TDNF_SYSTEM_ERROR_UNCOND(dwError);
+    }
+
+    fprintf(fp, "%s %d %ld\n", TDNF_METALINK_RANK_MAGIC,
+            TDNF_METALINK_RANK_VERSION, (long)time(NULL));
+    for (urlList = ml_ctx->urls; urlList; urlList = urlList->next)
+    {
+        urlInfo = urlList->data;
+        if (urlInfo && urlInfo->score != 0 && !strchr(urlInfo->url, ' '))
+        {
+            fprintf(fp, "%.0f %s\n", urlInfo->score, urlInfo->url);
+        }
+    }
+
+    if (fclose(fp))
+    {
+        fp = NULL;
+        dwError = errno;
+        BAIL_ON_TDNF_SYSTEM_ERROR_UNCOND(dwError);
+    }
+    fp = NULL;
+
+    if (rename(pszTmpFile, pszRankFile))
+    {
+        dwError = errno;
+        BAIL_ON_TDNF_SYSTEM_ERROR_UNCOND(dwError);
+    }
+
+cleanup:
+    TDNF_SAFE_FREE_MEMORY(pszTmpFile);
+    return dwError;
+
+error:
+    if (fp)
+    {
+        fclose(fp);
+    }
+    if (pszTmpFile)
+    {
+        unlink(pszTmpFile);
+    }
+    goto cleanup;
+}
+
+/*
+ * Sort the urls of ml_ctx, already in preference order, by the
+ * ranking. Probes the first pData->nProbe mirrors if there is no
+ * current ranking, unless we are working from cache only.
+ */
+uint32_t
+TDNFMetalinkRankMirrors(
+    PTDNF pTdnf,
+    PTDNF_REPO_DATA pRepo,
+    PTDNF_METALINK_DATA pData,
+    TDNF_ML_CTX *ml_ctx
+    )
+{
+    uint32_t dwError = 0;
+    char *pszRankFile = NULL;
+    TDNF_ML_URL_INFO **ppUrls = NULL;
+    TDNF_ML_URL_LIST *urlList = NULL;
+    int nCount = 0;
+    int nCacheOnly = 0;
+
+    if (!pTdnf || !pTdnf->pArgs || !pRepo || !pData || !ml_ctx)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    nCacheOnly = pTdnf->pArgs->nCacheOnly;
+
+    dwError = TDNFGetCachePath(pTdnf, pRepo,
+                               TDNF_METALINK_RANK_FILE_NAME, NULL,
+                               &pszRankFile);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    if (_TDNFMetalinkReadRank(pszRankFile, pData->lProbeExpire, nCacheOnly,
+                              ml_ctx, pData->nProbe) && !nCacheOnly)
+    {
+        dwError = TDNFAllocateMemory(pData->nProbe, sizeof(*ppUrls),
+                                     (void **)&ppUrls);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        for (urlList = ml_ctx->urls;
+             urlList && nCount < pData->nProbe;
+             urlList = urlList->next)
+        {
+            if (urlList->data)
+            {
+                ppUrls[nCount++] = urlList->data;
+            }
+        }
+
+        dwError = _TDNFMetalinkProbeUrls(pTdnf, pRepo, ppUrls, nCount);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        /* not being able to keep it only costs another probe */
+        _TDNFMetalinkWriteRank(pszRankFile, ml_ctx);
+    }
+
+    TDNFSortList(&ml_ctx->urls, _TDNFCompareUrlRank);
+
+cleanup:
+    TDNF_SAFE_FREE_MEMORY(pszRankFile);
+    TDNF_SAFE_FREE_MEMORY(ppUrls);
+    return dwError;
+
+error:
+    goto cleanup;
+}
@@ -130,6 +130,18 @@ FreePluginHandle(
     );
 
 // list.c
+int
+TDNFCompareUrlPreference(
+    TDNF_ML_URL_INFO *urlA,
+    TDNF_ML_URL_INFO *urlB
+);
+
+void
+TDNFSortList(
+    TDNF_ML_LIST** headUrl,
+    TDNF_ML_URL_CMP_FUNC cmp_func
+);
+
 void
 TDNFSortListOnPreference(
     TDNF_ML_LIST** headUrl
@@ -166,4 +178,13 @@ TDNFMetalinkRepoMDDownloadEnd(
     PTDNF_EVENT_CONTEXT pContext
     );
 
+/* probe.c */
+uint32_t
+TDNFMetalinkRankMirrors(
+    PTDNF pTdnf,
+    PTDNF_REPO_DATA pRepo,
+    PTDNF_METALINK_DATA pData,
+    TDNF_ML_CTX *ml_ctx
+    );
+
 #endif /* __PLUGINS_Metalink_PROTOTYPES_H__ */
@@ -30,8 +30,20 @@ typedef struct _TDNF_ML_URL_INFO_
     char *location;
     char *url;
     int  preference;
+    double score; //measured, 0 if not probed, < 0 if the probe failed
 } TDNF_ML_URL_INFO;
 
+typedef int (*TDNF_ML_URL_CMP_FUNC)(TDNF_ML_URL_INFO *, TDNF_ML_URL_INFO *);
+
+//one mirror probe
+typedef struct _TDNF_ML_PROBE_
+{
+    CURL *pCurl;
+    TDNF_ML_URL_INFO *urlInfo;
+    size_t nBytes;
+    int nStarted;           //counted in the TDNF_XFER_REPOMD class
+} TDNF_ML_PROBE;
+
 //Metalink global parsed info.
 typedef struct _TDNF_ML_CTX_
 {
@@ -48,6 +60,8 @@ typedef struct _TDNF_METALINK_DATA_
     struct _TDNF_METALINK_DATA_ *pNext;
     char *pszRepoId;
     char *pszMetalink;
+    int nProbe; //mirrors to probe, 0 to only use preference
+    long lProbeExpire; //seconds the ranking is good for
     TDNF_ML_CTX *ml_ctx;
 } TDNF_METALINK_DATA, *PTDNF_METALINK_DATA;
 
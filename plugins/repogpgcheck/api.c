@@ -8,7 +8,6 @@
 
 #include "includes.h"
 #include "config.h"
-#include <gpgme.h>
 
 TDNF_PLUGIN_INTERFACE _interface = {0};
 
@@ -105,6 +104,10 @@ FreePluginHandle(
     if (pHandle)
     {
         TDNFFreeRepoGPGCheckData(pHandle->pData);
+        if (pHandle->pContext)
+        {
+            gpgme_release(pHandle->pContext);
+        }
         TDNFFreeMemory(pHandle);
     }
 }
@@ -20,6 +20,8 @@
 
 #define TDNF_REPO_CONFIG_REPO_GPGCHECK_KEY "repo_gpgcheck"
 #define TDNF_REPO_METADATA_SIG_EXT         ".asc"
+/* last good verification, in the repo cache dir */
+#define TDNF_REPO_GPGCHECK_RECORD_FILE     "repomd.verified"
 
 #define REPOGPGCHECK_PLUGIN_ERROR "repogpgcheck plugin error"
 #define REPOGPGCHECK_ERROR_TABLE \
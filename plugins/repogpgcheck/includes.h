@@ -25,6 +25,8 @@
 //libcurl
 #include <curl/curl.h>
 
+#include <gpgme.h>
+
 #include "../../common/defines.h"
 #include "../../common/structs.h"
 #include "../../common/prototypes.h"
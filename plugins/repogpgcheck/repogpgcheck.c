@@ -7,14 +7,18 @@
  */
 
 #include "includes.h"
-#include <gpgme.h>
 
 #include "../../llconf/nodes.h"
 
+/*
+ * Get the fingerprint of the key that made the signatures, all
+ * of them have to be good.
+ */
 static
 uint32_t
 _TDNFVerifyResult(
-    gpgme_ctx_t pContext
+    gpgme_ctx_t pContext,
+    char **ppszFingerprint
     )
 {
     uint32_t dwError = 0;
@@ -38,6 +42,17 @@ _TDNFVerifyResult(
             break;
         }
     }
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    if (IsNullOrEmptyString(pResult->signatures->fpr))
+    {
+        dwError = ERROR_TDNF_GPG_VERIFY_RESULT;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    dwError = TDNFAllocateString(pResult->signatures->fpr, ppszFingerprint);
+    BAIL_ON_TDNF_ERROR(dwError);
+
 cleanup:
     return dwError;
 
@@ -63,11 +78,45 @@ error:
     return dwError;
 }
 
+/* one gpgme context serves all repos of the handle */
+static
+uint32_t
+_TDNFRepoGPGCheckGetContext(
+    PTDNF_PLUGIN_HANDLE pHandle,
+    gpgme_ctx_t *ppContext
+    )
+{
+    uint32_t dwError = 0;
+    gpgme_error_t nGPGError = 0;
+    gpgme_ctx_t pContext = NULL;
+    gpgme_protocol_t protocol = GPGME_PROTOCOL_OpenPGP;
+
+    if (!pHandle->pContext)
+    {
+        nGPGError = gpgme_new(&pContext);
+        if (nGPGError)
+        {
+            pHandle->nGPGError = nGPGError;
+            dwError = ERROR_TDNF_GPG_ERROR;
+            BAIL_ON_TDNF_ERROR(dwError);
+        }
+
+        gpgme_set_protocol (pContext, protocol);
+        pHandle->pContext = pContext;
+    }
+
+    *ppContext = pHandle->pContext;
+
+error:
+    return dwError;
+}
+
 uint32_t
 TDNFVerifyRepoMDSignature(
     PTDNF_PLUGIN_HANDLE pHandle,
     const char *pszRepoMD,
-    const char *pszRepoMDSig
+    const char *pszRepoMDSig,
+    char **ppszFingerprint
     )
 {
     uint32_t dwError = 0;
@@ -75,26 +124,18 @@ TDNFVerifyRepoMDSignature(
     FILE *fpRepoMDSig = NULL;
     gpgme_error_t nGPGError = 0;
     gpgme_ctx_t pContext = NULL;
-    gpgme_protocol_t protocol = GPGME_PROTOCOL_OpenPGP;
     gpgme_data_t dataSig = NULL;
     gpgme_data_t dataText = NULL;
 
     if (!pHandle || IsNullOrEmptyString(pszRepoMD) ||
-        IsNullOrEmptyString(pszRepoMDSig))
+        IsNullOrEmptyString(pszRepoMDSig) || !ppszFingerprint)
     {
         dwError = ERROR_TDNF_INVALID_PARAMETER;
         BAIL_ON_TDNF_ERROR(dwError);
     }
 
-    nGPGError = gpgme_new(&pContext);
-    if (nGPGError)
-    {
-        pHandle->nGPGError = nGPGError;
-        dwError = ERROR_TDNF_GPG_ERROR;
-        BAIL_ON_TDNF_ERROR(dwError);
-    }
-
-    gpgme_set_protocol (pContext, protocol);
+    dwError = _TDNFRepoGPGCheckGetContext(pHandle, &pContext);
+    BAIL_ON_TDNF_ERROR(dwError);
 
     fpRepoMDSig = fopen(pszRepoMDSig, "rb");
     if (!fpRepoMDSig)
@@ -137,7 +178,7 @@ TDNFVerifyRepoMDSignature(
         BAIL_ON_TDNF_ERROR(dwError);
     }
 
-    dwError = _TDNFVerifyResult(pContext);
+    dwError = _TDNFVerifyResult(pContext, ppszFingerprint);
     BAIL_ON_TDNF_ERROR(dwError);
 
 cleanup:
@@ -157,13 +198,160 @@ cleanup:
     {
         fclose(fpRepoMDSig);
     }
-    if (pContext)
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+static
+uint32_t
+_TDNFRepoGPGCheckFileDigest(
+    const char *pszFile,
+    char **ppszDigest
+    )
+{
+    uint32_t dwError = 0;
+    uint8_t digest[EVP_MAX_MD_SIZE] = {0};
+
+    dwError = TDNFGetDigestForFile(pszFile, hash_ops + TDNF_HASH_SHA256, digest);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFDigestToHex(digest, TDNF_HASH_SHA256, ppszDigest);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+error:
+    return dwError;
+}
+
+/*
+ * The record of the last good verification of a repo is
+ *   <repomd sha256> <signature sha256> <key fingerprint>
+ * in the repo cache dir. It is only trusted if root owns it and
+ * nobody else can write it. Returns ERROR_TDNF_NO_DATA if the
+ * files were not verified before, or the key is gone.
+ */
+static
+uint32_t
+_TDNFRepoGPGCheckIsVerified(
+    PTDNF_PLUGIN_HANDLE pHandle,
+    const char *pszRecordFile,
+    const char *pszRepoMDDigest,
+    const char *pszSigDigest
+    )
+{
+    uint32_t dwError = 0;
+    FILE *fp = NULL;
+    struct stat st = {0};
+    char szRepoMDDigest[129] = {0};
+    char szSigDigest[129] = {0};
+    char szFingerprint[129] = {0};
+    gpgme_ctx_t pContext = NULL;
+    gpgme_key_t pKey = NULL;
+
+    fp = fopen(pszRecordFile, "r");
+    if (!fp ||
+        fstat(fileno(fp), &st) ||
+        st.st_uid != 0 ||
+        (st.st_mode & (S_IWGRP | S_IWOTH)) ||
+        fscanf(fp, "%128s %128s %128s",
+               szRepoMDDigest, szSigDigest, szFingerprint) != 3 ||
+        strcmp(szRepoMDDigest, pszRepoMDDigest) ||
+        strcmp(szSigDigest, pszSigDigest))
+    {
+        dwError = ERROR_TDNF_NO_DATA;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    /* listing a key is cheap compared to a verify */
+    dwError = _TDNFRepoGPGCheckGetContext(pHandle, &pContext);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    if (gpgme_get_key(pContext, szFingerprint, &pKey, 0) ||
+        !pKey || pKey->revoked || pKey->expired || pKey->disabled)
+    {
+        dwError = ERROR_TDNF_NO_DATA;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+cleanup:
+    if (pKey)
+    {
+        gpgme_key_unref(pKey);
+    }
+    if (fp)
+    {
+        fclose(fp);
+    }
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+static
+uint32_t
+_TDNFRepoGPGCheckSetVerified(
+    const char *pszRecordFile,
+    const char *pszRepoMDDigest,
+    const char *pszSigDigest,
+    const char *pszFingerprint
+    )
+{
+    uint32_t dwError = 0;
+    char *pszTmpFile = NULL;
+    FILE *fp = NULL;
+
+    /* only root's record is used */
+    if (geteuid() != 0)
+    {
+        goto cleanup;
+    }
+
+    dwError = TDNFAllocateStringPrintf(&pszTmpFile, "%s.tmp", pszRecordFile);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    fp = fopen(pszTmpFile, "w");
+    if (!fp)
+    {
+        dwError = errno;
+        BAIL_ON_TDNF_SYSTEM_ERROR(dwError);
+    }
+
+    if (fprintf(fp, "%s %s %s\n",
+                pszRepoMDDigest, pszSigDigest, pszFingerprint) < 0)
     {
-        gpgme_release(pContext);
+        dwError = errno;
+        BAIL_ON_TDNF_SYSTEM_ERROR(dwError);
+    }
+
+    if (fclose(fp))
+    {
+        fp = NULL;
+        dwError = errno;
+        BAIL_ON_TDNF_SYSTEM_ERROR(dwError);
+    }
+    fp = NULL;
+
+    if (chmod(pszTmpFile, 0644) || rename(pszTmpFile, pszRecordFile))
+    {
+        dwError = errno;
+        BAIL_ON_TDNF_SYSTEM_ERROR(dwError);
     }
+
+cleanup:
+    TDNF_SAFE_FREE_MEMORY(pszTmpFile);
     return dwError;
 
 error:
+    if (fp)
+    {
+        fclose(fp);
+    }
+    if (pszTmpFile)
+    {
+        unlink(pszTmpFile);
+    }
     goto cleanup;
 }
 
@@ -177,6 +365,10 @@ TDNFVerifySignature(
     uint32_t dwError = 0;
     char *pszRepoMDSigFile = NULL;
     char *pszRepoMDSigLocation = NULL;
+    char *pszRecordFile = NULL;
+    char *pszRepoMDDigest = NULL;
+    char *pszSigDigest = NULL;
+    char *pszFingerprint = NULL;
     PTDNF_REPO_DATA pRepo = NULL;
 
     if (!pHandle || !pHandle->pTdnf || IsNullOrEmptyString(pcszRepoId) ||
@@ -208,9 +400,39 @@ TDNFVerifySignature(
                                        pcszRepoId);
     BAIL_ON_TDNF_ERROR(dwError);
 
-    dwError = TDNFVerifyRepoMDSignature(pHandle, pcszRepoMDFile, pszRepoMDSigFile);
+    /* same repomd and signature as last time, no need to verify again */
+    if (TDNFGetCachePath(pHandle->pTdnf, pRepo,
+                         TDNF_REPO_GPGCHECK_RECORD_FILE, NULL,
+                         &pszRecordFile) == 0 &&
+        _TDNFRepoGPGCheckFileDigest(pcszRepoMDFile, &pszRepoMDDigest) == 0 &&
+        _TDNFRepoGPGCheckFileDigest(pszRepoMDSigFile, &pszSigDigest) == 0 &&
+        _TDNFRepoGPGCheckIsVerified(pHandle, pszRecordFile,
+                                    pszRepoMDDigest, pszSigDigest) == 0)
+    {
+        if (pHandle->pTdnf->pArgs->nVerbose)
+        {
+            pr_info("repogpgcheck: %s: repomd.xml signature verified before\n",
+                    pcszRepoId);
+        }
+        goto cleanup;
+    }
+
+    if (pHandle->pTdnf->pArgs->nVerbose)
+    {
+        pr_info("repogpgcheck: %s: verifying repomd.xml signature\n",
+                pcszRepoId);
+    }
+    dwError = TDNFVerifyRepoMDSignature(pHandle, pcszRepoMDFile,
+                                        pszRepoMDSigFile, &pszFingerprint);
     BAIL_ON_TDNF_ERROR(dwError);
 
+    /* a failed write just means verifying again next time */
+    if (pszRecordFile && pszRepoMDDigest && pszSigDigest)
+    {
+        _TDNFRepoGPGCheckSetVerified(pszRecordFile, pszRepoMDDigest,
+                                     pszSigDigest, pszFingerprint);
+    }
+
 cleanup:
     if (pszRepoMDSigFile)
     {
@@ -218,6 +440,10 @@ cleanup:
     }
     TDNF_SAFE_FREE_MEMORY(pszRepoMDSigLocation);
     TDNF_SAFE_FREE_MEMORY(pszRepoMDSigFile);
+    TDNF_SAFE_FREE_MEMORY(pszRecordFile);
+    TDNF_SAFE_FREE_MEMORY(pszRepoMDDigest);
+    TDNF_SAFE_FREE_MEMORY(pszSigDigest);
+    TDNF_SAFE_FREE_MEMORY(pszFingerprint);
     return dwError;
 
 error:
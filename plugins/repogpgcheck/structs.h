@@ -20,4 +20,5 @@ typedef struct _TDNF_PLUGIN_HANDLE_
     uint32_t nError; /* last error set by this plugin */
     uint32_t nGPGError; /* gpg specific error. gpgerror will provide details */
     PTDNF_REPO_GPG_CHECK_DATA pData;
+    gpgme_ctx_t pContext; /* shared by all repos, created on first use */
 }TDNF_PLUGIN_HANDLE;
@@ -0,0 +1,302 @@
+/*
+ * Copyright (C) 2023 VMware, Inc. All Rights Reserved.
+ *
+ * Licensed under the GNU Lesser General Public License v2.1 (the "License");
+ * you may not use this file except in compliance with the License. The terms
+ * of the License are located in the COPYING file of this distribution.
+ */
+
+/*
+ * Test plugin for the package download events. At the start event
+ * it copies $TDNF_TEST_DOWNLOAD_SOURCE/<name of the package> to the
+ * destination, if there is such a file, and appends the name to
+ * $TDNF_TEST_DOWNLOAD_LOG. Plugins get no config of their own, so
+ * the tests set these in the environment.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <tdnf.h>
+#include <tdnfplugin.h>
+#include <tdnfplugineventmap.h>
+#include <tdnf-common-defines.h>
+
+#define TEST_DOWNLOAD_ENV_SOURCE "TDNF_TEST_DOWNLOAD_SOURCE"
+#define TEST_DOWNLOAD_ENV_LOG    "TDNF_TEST_DOWNLOAD_LOG"
+
+typedef struct _TDNF_PLUGIN_HANDLE_
+{
+    char *pszSource;
+    char *pszLog;
+} TDNF_PLUGIN_HANDLE;
+
+const char *
+TDNFPluginGetVersion(
+    )
+{
+    return PLUGIN_VERSION;
+}
+
+const char *
+TDNFPluginGetName(
+    )
+{
+    return PLUGIN_NAME;
+}
+
+static
+void
+_FreeHandle(
+    PTDNF_PLUGIN_HANDLE pHandle
+    )
+{
+    if (pHandle)
+    {
+        free(pHandle->pszSource);
+        free(pHandle->pszLog);
+        free(pHandle);
+    }
+}
+
+static
+uint32_t
+TestDownloadInitialize(
+    const char *pszConfig,
+    PTDNF_PLUGIN_HANDLE *ppHandle
+    )
+{
+    uint32_t dwError = 0;
+    PTDNF_PLUGIN_HANDLE pHandle = NULL;
+    const char *pszEnv = NULL;
+
+    UNUSED(pszConfig);
+    if (!ppHandle)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    pHandle = calloc(1, sizeof(*pHandle));
+    if (!pHandle)
+    {
+        dwError = ERROR_TDNF_OUT_OF_MEMORY;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    pszEnv = getenv(TEST_DOWNLOAD_ENV_SOURCE);
+    if (!IsNullOrEmptyString(pszEnv))
+    {
+        pHandle->pszSource = strdup(pszEnv);
+    }
+    pszEnv = getenv(TEST_DOWNLOAD_ENV_LOG);
+    if (!IsNullOrEmptyString(pszEnv))
+    {
+        pHandle->pszLog = strdup(pszEnv);
+    }
+
+    *ppHandle = pHandle;
+
+cleanup:
+    return dwError;
+
+error:
+    _FreeHandle(pHandle);
+    goto cleanup;
+}
+
+static
+uint32_t
+TestDownloadEventsNeeded(
+    PTDNF_PLUGIN_HANDLE pHandle,
+    TDNF_PLUGIN_EVENT_TYPE *pnEvents
+    )
+{
+    if (!pHandle || !pnEvents)
+    {
+        return ERROR_TDNF_INVALID_PARAMETER;
+    }
+    *pnEvents = TDNF_PLUGIN_EVENT_TYPE_PACKAGE;
+    return 0;
+}
+
+static
+uint32_t
+_CopyFile(
+    const char *pszSrc,
+    const char *pszDst
+    )
+{
+    uint32_t dwError = 0;
+    FILE *fpSrc = NULL;
+    FILE *fpDst = NULL;
+    char buf[8192];
+    size_t nRead = 0;
+
+    fpSrc = fopen(pszSrc, "rb");
+    if (!fpSrc)
+    {
+        dwError = ERROR_TDNF_SYSTEM_BASE + errno;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+    fpDst = fopen(pszDst, "wb");
+    if (!fpDst)
+    {
+        dwError = ERROR_TDNF_SYSTEM_BASE + errno;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    while ((nRead = fread(buf, 1, sizeof(buf), fpSrc)) > 0)
+    {
+        if (fwrite(buf, 1, nRead, fpDst) != nRead)
+        {
+            dwError = ERROR_TDNF_SYSTEM_BASE + errno;
+            BAIL_ON_TDNF_ERROR(dwError);
+        }
+    }
+
+cleanup:
+    if (fpSrc)
+    {
+        fclose(fpSrc);
+    }
+    if (fpDst)
+    {
+        fclose(fpDst);
+    }
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+static
+uint32_t
+_DownloadStart(
+    PTDNF_PLUGIN_HANDLE pHandle,
+    PTDNF_EVENT_CONTEXT pContext
+    )
+{
+    uint32_t dwError = 0;
+    const char *pcszLocation = NULL;
+    const char *pcszFile = NULL;
+    const char *pcszName = NULL;
+    char szSource[4096];
+    FILE *fpLog = NULL;
+
+    if (!pHandle->pszSource)
+    {
+        goto cleanup;
+    }
+
+    dwError = TDNFEventContextGetItemString(pContext,
+                                            TDNF_EVENT_ITEM_PKG_LOCATION,
+                                            &pcszLocation);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFEventContextGetItemString(pContext,
+                                            TDNF_EVENT_ITEM_PKG_FILE,
+                                            &pcszFile);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    pcszName = strrchr(pcszLocation, '/');
+    pcszName = pcszName ? pcszName + 1 : pcszLocation;
+
+    snprintf(szSource, sizeof(szSource), "%s/%s", pHandle->pszSource, pcszName);
+    if (_CopyFile(szSource, pcszFile))
+    {
+        /* nothing to deliver, tdnf downloads it */
+        goto cleanup;
+    }
+
+    if (pHandle->pszLog)
+    {
+        fpLog = fopen(pHandle->pszLog, "a");
+        if (fpLog)
+        {
+            fprintf(fpLog, "%s\n", pcszName);
+            fclose(fpLog);
+        }
+    }
+
+cleanup:
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+static
+uint32_t
+TestDownloadEvent(
+    PTDNF_PLUGIN_HANDLE pHandle,
+    PTDNF_EVENT_CONTEXT pContext
+    )
+{
+    uint32_t dwError = 0;
+
+    if (!pHandle || !pContext)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    if (PLUGIN_EVENT_TYPE(pContext->nEvent) == TDNF_PLUGIN_EVENT_TYPE_PACKAGE &&
+        PLUGIN_EVENT_STATE(pContext->nEvent) == TDNF_PLUGIN_EVENT_STATE_DOWNLOAD &&
+        PLUGIN_EVENT_PHASE(pContext->nEvent) == TDNF_PLUGIN_EVENT_PHASE_START)
+    {
+        dwError = _DownloadStart(pHandle, pContext);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+cleanup:
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+static
+uint32_t
+TestDownloadGetErrorString(
+    PTDNF_PLUGIN_HANDLE pHandle,
+    uint32_t dwError,
+    char **ppszError
+    )
+{
+    UNUSED(pHandle);
+    UNUSED(dwError);
+    UNUSED(ppszError);
+    return ERROR_TDNF_INVALID_PARAMETER;
+}
+
+static
+uint32_t
+TestDownloadClose(
+    PTDNF_PLUGIN_HANDLE pHandle
+    )
+{
+    _FreeHandle(pHandle);
+    return 0;
+}
+
+uint32_t
+TDNFPluginLoadInterface(
+    PTDNF_PLUGIN_INTERFACE pInterface
+    )
+{
+    if (!pInterface)
+    {
+        return ERROR_TDNF_INVALID_PARAMETER;
+    }
+
+    pInterface->pFnInitialize = TestDownloadInitialize;
+    pInterface->pFnEventsNeeded = TestDownloadEventsNeeded;
+    pInterface->pFnGetErrorString = TestDownloadGetErrorString;
+    pInterface->pFnEvent = TestDownloadEvent;
+    pInterface->pFnCloseHandle = TestDownloadClose;
+    return 0;
+}
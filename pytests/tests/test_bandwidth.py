@@ -0,0 +1,83 @@
+#
+# Copyright (C) 2023 VMware, Inc. All Rights Reserved.
+#
+# Licensed under the GNU General Public License v2 (the "License");
+# you may not use this file except in compliance with the License. The terms
+# of the License are located in the COPYING file of this distribution.
+#
+
+import glob
+import os
+import shutil
+import time
+import pytest
+
+DOWNLOADDIR = '/tmp/tdnf/bandwidth'
+
+
+@pytest.fixture(scope='module', autouse=True)
+def setup_test(utils):
+    yield
+    teardown_test(utils)
+
+
+def teardown_test(utils):
+    utils.edit_config({'max_bandwidth': None, 'bandwidth_shares': None})
+    shutil.rmtree(DOWNLOADDIR, ignore_errors=True)
+
+
+def download(utils, pkgname, extra_args=[]):
+    shutil.rmtree(DOWNLOADDIR, ignore_errors=True)
+    os.makedirs(DOWNLOADDIR)
+    return utils.run(['tdnf', '-y', '--nogpgcheck'] + extra_args +
+                     ['--disablerepo=*', '--enablerepo=photon-test',
+                      '--downloadonly', '--downloaddir', DOWNLOADDIR,
+                      'install', pkgname])
+
+
+def stats_line(ret, name):
+    for line in ret['stdout']:
+        if line.split() and line.split()[0] == name:
+            return line
+    return None
+
+
+# 1M at 256k per second takes about 4 seconds
+def test_max_bandwidth(utils):
+    pkgname = utils.config['toolarge_pkgname']
+    utils.edit_config({'max_bandwidth': '256k'})
+
+    start = time.time()
+    ret = download(utils, pkgname)
+    elapsed = time.time() - start
+    assert ret['retval'] == 0
+    assert len(glob.glob('{}/{}*.rpm'.format(DOWNLOADDIR, pkgname))) == 1
+
+    assert elapsed > 3
+    assert stats_line(ret, 'packages') is not None
+    utils.edit_config({'max_bandwidth': None})
+
+
+# no summary without a limit, unless verbose
+def test_stats_verbose(utils):
+    pkgname = utils.config['sglversion_pkgname']
+
+    ret = download(utils, pkgname, ['--refresh'])
+    assert ret['retval'] == 0
+    assert stats_line(ret, 'packages') is None
+
+    ret = download(utils, pkgname, ['--refresh', '-v'])
+    assert ret['retval'] == 0
+    assert stats_line(ret, 'repomd') is not None
+    assert stats_line(ret, 'packages') is not None
+
+
+def test_bandwidth_shares_invalid(utils):
+    utils.edit_config({'bandwidth_shares': '8 4 2'})
+    ret = utils.run(['tdnf', 'repolist'])
+    assert ret['retval'] == 1010
+
+    utils.edit_config({'bandwidth_shares': '8 4 0 1'})
+    ret = utils.run(['tdnf', 'repolist'])
+    assert ret['retval'] == 1010
+    utils.edit_config({'bandwidth_shares': None})
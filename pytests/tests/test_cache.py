@@ -7,6 +7,8 @@
 #
 
 import os
+import glob
+import shutil
 import fnmatch
 import pytest
 
@@ -203,3 +205,279 @@ def test_cache_directory_out_of_disk_space(utils):
     clean_cache(utils)
     clean_small_cache(utils)
     assert ret['retval'] == 1036
+
+
+def read_verify_cache(utils, reponame):
+    path = os.path.join(find_cache_dir(utils, reponame), 'verified.cache')
+    if not os.path.isfile(path):
+        return path, []
+    with open(path) as f:
+        return path, f.read().splitlines()
+
+
+def test_verify_cache(utils):
+    clean_cache(utils)
+    enable_cache(utils)
+    pkgname = utils.config["sglversion_pkgname"]
+    utils.erase_package(pkgname)
+
+    ret = utils.run(['tdnf', 'install', '-y', '--nogpgcheck', pkgname])
+    assert ret['retval'] == 0
+
+    path, lines = read_verify_cache(utils, 'photon-test')
+    assert lines[0].startswith('tdnf-verify-cache 1 ')
+    assert any(pkgname in line for line in lines[1:])
+    st = os.stat(path)
+    assert st.st_uid == 0 and not st.st_mode & 0o022
+
+    # the unchanged file is taken from the cache
+    utils.erase_package(pkgname)
+    ret = utils.run(['tdnf', 'install', '-y', '--nogpgcheck', pkgname])
+    assert ret['retval'] == 0
+    assert utils.check_package(pkgname)
+    disable_cache(utils)
+
+
+def test_verify_cache_changed_file(utils):
+    clean_cache(utils)
+    enable_cache(utils)
+    pkgname = utils.config["sglversion_pkgname"]
+    utils.erase_package(pkgname)
+
+    ret = utils.run(['tdnf', 'install', '-y', '--nogpgcheck', pkgname])
+    assert ret['retval'] == 0
+    utils.erase_package(pkgname)
+
+    # damage the cached rpm in place, the entry must not match anymore
+    cache_dir = utils.tdnf_config.get('main', 'cachedir')
+    ret = utils.run(['find', cache_dir, '-name', pkgname + '*.rpm'])
+    rpm_path = ret['stdout'][0]
+    with open(rpm_path, 'r+b') as f:
+        f.seek(-1, os.SEEK_END)
+        last = f.read(1)
+        f.seek(-1, os.SEEK_END)
+        f.write(bytes([last[0] ^ 0xff]))
+
+    ret = utils.run(['tdnf', 'install', '-y', '--nogpgcheck', '--cacheonly', pkgname])
+    assert ret['retval'] != 0
+    assert not utils.check_package(pkgname)
+    clean_cache(utils)
+    disable_cache(utils)
+
+
+def test_verify_cache_not_root_owned(utils):
+    clean_cache(utils)
+    enable_cache(utils)
+    pkgname = utils.config["sglversion_pkgname"]
+    utils.erase_package(pkgname)
+
+    ret = utils.run(['tdnf', 'install', '-y', '--nogpgcheck', pkgname])
+    assert ret['retval'] == 0
+    utils.erase_package(pkgname)
+
+    # a cache others can write is ignored, and replaced
+    path, _ = read_verify_cache(utils, 'photon-test')
+    os.chmod(path, 0o666)
+    ret = utils.run(['tdnf', 'install', '-y', '--nogpgcheck', pkgname])
+    assert ret['retval'] == 0
+    assert not os.stat(path).st_mode & 0o022
+    disable_cache(utils)
+
+
+def find_cached_rpm(utils, pkgname):
+    cache_dir = utils.tdnf_config.get('main', 'cachedir')
+    ret = utils.run(['find', cache_dir, '-name', pkgname + '-*.rpm'])
+    return ret['stdout'][0] if ret['stdout'] else None
+
+
+# disk space used by cached packages, like du counting
+# hardlinks into the package store only once
+def cached_packages_usage(utils):
+    cache_dir = utils.tdnf_config.get('main', 'cachedir')
+    inodes = {}
+    for root, _, files in os.walk(cache_dir):
+        parts = os.path.relpath(root, cache_dir).split(os.sep)
+        if 'rpms' not in parts and parts[0] != 'store':
+            continue
+        for f in files:
+            st = os.stat(os.path.join(root, f))
+            inodes[(st.st_dev, st.st_ino)] = st.st_blocks * 512
+    return sum(inodes.values())
+
+
+def check_store_pruned(utils):
+    store = os.path.join(utils.tdnf_config.get('main', 'cachedir'), 'store')
+    for root, _, files in os.walk(store):
+        for f in files:
+            assert os.stat(os.path.join(root, f)).st_nlink > 1
+
+
+# packages over cache_budget are removed least recently used first
+def test_cache_budget(utils):
+    clean_cache(utils)
+    enable_cache(utils)
+    pkg_old = utils.config["sglversion_pkgname"]
+    pkg_kept = utils.config["sglversion2_pkgname"]
+    pkg_new = utils.config["mulversion_pkgname"]
+    for pkgname in [pkg_old, pkg_kept, pkg_new]:
+        utils.erase_package(pkgname)
+
+    for pkgname in [pkg_old, pkg_kept, pkg_new]:
+        ret = utils.run(['tdnf', 'install', '-y', '--nogpgcheck', pkgname])
+        assert ret['retval'] == 0
+    rpm_old = find_cached_rpm(utils, pkg_old)
+    rpm_kept = find_cached_rpm(utils, pkg_kept)
+    rpm_new = find_cached_rpm(utils, pkg_new)
+    os.utime(rpm_old, (0, 0))
+    os.utime(rpm_kept, (1000, 1000))
+
+    budget = os.path.getsize(rpm_kept) + os.path.getsize(rpm_new)
+    utils.edit_config({'cache_budget': str(budget)})
+    try:
+        # reinstalling from the cache is a use of rpm_new
+        utils.erase_package(pkg_new)
+        ret = utils.run(['tdnf', 'install', '-y', '--nogpgcheck', pkg_new])
+        assert ret['retval'] == 0
+        assert not os.path.exists(rpm_old)
+        assert os.path.exists(rpm_kept)
+        assert os.path.exists(rpm_new)
+        # the store copy of the evicted package is gone, too
+        check_store_pruned(utils)
+        assert cached_packages_usage(utils) <= \
+            sum(os.stat(rpm).st_blocks * 512 for rpm in [rpm_kept, rpm_new])
+    finally:
+        utils.edit_config({'cache_budget': None})
+        clean_cache(utils)
+        disable_cache(utils)
+
+
+def test_cache_budget_invalid(utils):
+    utils.edit_config({'cache_budget': '10X'})
+    try:
+        ret = utils.run(['tdnf', 'repolist'])
+        assert ret['retval'] == 1010
+    finally:
+        utils.edit_config({'cache_budget': None})
+
+
+# clean --stale removes packages not in the metadata and
+# cache dirs of repos that are not configured
+def test_clean_stale(utils):
+    clean_cache(utils)
+    enable_cache(utils)
+    pkgname = utils.config["sglversion_pkgname"]
+    utils.erase_package(pkgname)
+    ret = utils.run(['tdnf', 'install', '-y', '--nogpgcheck', pkgname])
+    assert ret['retval'] == 0
+    rpm_path = find_cached_rpm(utils, pkgname)
+
+    cache_dir = utils.tdnf_config.get('main', 'cachedir')
+    stale_rpm = os.path.join(os.path.dirname(rpm_path), 'gone-1.0-1.noarch.rpm')
+    with open(stale_rpm, 'w') as f:
+        f.write('stale')
+    store_dir = os.path.join(cache_dir, 'store', 'sha256', '00')
+    os.makedirs(store_dir, exist_ok=True)
+    os.link(stale_rpm, os.path.join(store_dir, '00' * 32))
+    gone_dir = os.path.join(cache_dir, 'gone-repo-0123456789abcdef')
+    os.makedirs(os.path.join(gone_dir, 'repodata'))
+
+    try:
+        ret = utils.run(['tdnf', 'clean', '--stale'])
+        assert ret['retval'] == 0
+        assert os.path.exists(rpm_path)
+        assert not os.path.exists(stale_rpm)
+        assert not os.path.exists(os.path.join(store_dir, '00' * 32))
+        check_store_pruned(utils)
+        assert not os.path.exists(gone_dir)
+        assert find_cache_dir(utils, 'photon-test') is not None
+    finally:
+        clean_cache(utils)
+        disable_cache(utils)
+
+
+def install_lower_mulversion(utils):
+    pkgname = utils.config["mulversion_pkgname"]
+    utils.erase_package(pkgname)
+    utils.install_package(pkgname, utils.config["mulversion_lower"])
+    return pkgname
+
+
+# makecache --prefetch downloads the pending upgrade, so the
+# upgrade itself works from the cache alone
+def test_makecache_prefetch(utils):
+    pkgname = install_lower_mulversion(utils)
+    clean_cache(utils)
+
+    ret = utils.run(['tdnf', 'makecache', '--prefetch'])
+    assert ret['retval'] == 0
+    version = utils.config["mulversion_higher"].split('-')[0]
+    assert find_cached_rpm(utils, pkgname + '-' + version)
+
+    ret = utils.run(['tdnf', '-C', 'upgrade', '-y', '--nogpgcheck', pkgname])
+    assert ret['retval'] == 0
+    assert utils.check_package(pkgname, utils.config["mulversion_higher"])
+    clean_cache(utils)
+
+
+# prefetch stops before the cache grows over cache_budget
+def test_makecache_prefetch_budget(utils):
+    pkgname = install_lower_mulversion(utils)
+    clean_cache(utils)
+
+    utils.edit_config({'cache_budget': '1', 'prefetch_throttle': '1M'})
+    try:
+        ret = utils.run(['tdnf', 'makecache', '--prefetch'])
+        assert ret['retval'] == 0
+        assert find_cached_rpm(utils, pkgname) is None
+    finally:
+        utils.edit_config({'cache_budget': None, 'prefetch_throttle': None})
+        clean_cache(utils)
+
+
+# a prefetched package that does not match the repo checksum
+# is not left in the cache, and the prefetch fails
+def test_makecache_prefetch_bad_checksum(utils):
+    pkgname = install_lower_mulversion(utils)
+    clean_cache(utils)
+
+    reponame = 'photon-test-prefetch'
+    repo_dir = os.path.join(utils.config['repo_path'], reponame)
+    shutil.rmtree(repo_dir, ignore_errors=True)
+    shutil.copytree(os.path.join(utils.config['repo_path'], 'photon-test'),
+                    repo_dir)
+    version = utils.config["mulversion_higher"].split('-')[0]
+    for rpm in glob.glob('{}/RPMS/*/{}-{}-*.rpm'.format(repo_dir, pkgname,
+                                                        version)):
+        # same size, different checksum
+        with open(rpm, 'r+b') as f:
+            f.seek(-1, os.SEEK_END)
+            last = f.read(1)
+            f.seek(-1, os.SEEK_END)
+            f.write(bytes([last[0] ^ 0xff]))
+
+    try:
+        ret = utils.run(['tdnf',
+                         '--repofrompath={},http://localhost:8080/{}'.format(
+                             reponame, reponame),
+                         '--repo={}'.format(reponame),
+                         'makecache', '--prefetch'])
+        assert ret['retval'] == 1528
+        assert find_cached_rpm(utils, pkgname + '-' + version) is None
+    finally:
+        shutil.rmtree(repo_dir, ignore_errors=True)
+        clean_cache(utils)
+
+
+# clean all does not touch the cache of repos that are not configured
+def test_clean_all_keeps_unknown_dirs(utils):
+    utils.run(['tdnf', 'makecache'])
+    cache_dir = utils.tdnf_config.get('main', 'cachedir')
+    gone_dir = os.path.join(cache_dir, 'gone-repo-0123456789abcdef')
+    os.makedirs(os.path.join(gone_dir, 'repodata'))
+
+    try:
+        ret = utils.run(['tdnf', 'clean', 'all'])
+        assert ret['retval'] == 0
+        assert os.path.exists(gone_dir)
+    finally:
+        clean_cache(utils)
@@ -8,6 +8,9 @@
 #   Author: Oliver Kurth <okurth@vmware.com>
 
 import os
+import glob
+import json
+import fcntl
 import pytest
 import time
 
@@ -23,6 +26,7 @@ def setup_test(utils):
 
 def teardown_test(utils):
     os.remove(os.path.join(utils.config['repo_path'], "yum.repos.d", REPOFILENAME))
+    utils.edit_config({'stale_while_revalidate': None, 'proxy': None})
 
 
 def generate_repofile_expire(utils, newconfig, repoid, value):
@@ -98,3 +102,111 @@ def test_cached_expired_no_reset(utils):
     time.sleep(expire / 2 + 2)
     ret = utils.run(['tdnf', '--repoid={}'.format(REPOID), 'list'])
     assert "Refreshing metadata" in "\n".join(ret['stdout'])
+
+
+# with stale_while_revalidate, read only commands use the expired
+# cache and it is refreshed in the background afterwards
+def test_cached_expired_stale(utils):
+    expire = 10
+    repoconf = os.path.join(utils.config['repo_path'], "yum.repos.d", REPOFILENAME)
+    generate_repofile_expire(utils, repoconf, REPOID, expire)
+    utils.edit_config({'stale_while_revalidate': '1'})
+
+    utils.run(['tdnf', '--repoid={}'.format(REPOID), 'makecache'])
+    time.sleep(expire + 2)
+    ret = utils.run(['tdnf', '--repoid={}'.format(REPOID), 'list'])
+    assert ret['retval'] == 0
+    assert "Refreshing metadata" not in "\n".join(ret['stdout'])
+    assert "is expired" in "\n".join(ret['stdout'])
+
+    time.sleep(5)
+    ret = utils.run(['tdnf', '--repoid={}'.format(REPOID), 'list'])
+    assert "is expired" not in "\n".join(ret['stdout'])
+
+
+def test_cached_expired_stale_json(utils):
+    expire = 10
+    repoconf = os.path.join(utils.config['repo_path'], "yum.repos.d", REPOFILENAME)
+    generate_repofile_expire(utils, repoconf, REPOID, expire)
+    utils.edit_config({'stale_while_revalidate': '1'})
+
+    utils.run(['tdnf', '--repoid={}'.format(REPOID), 'makecache'])
+    time.sleep(expire + 2)
+    ret = utils.run(['tdnf', '-j', '--repoid={}'.format(REPOID), 'list', 'available'])
+    assert ret['retval'] == 0
+    pkgs = json.loads("\n".join(ret['stdout']))
+    assert len(pkgs) > 0
+    for pkg in pkgs:
+        assert pkg['Stale']
+
+
+# commands that change the system do not use stale metadata
+def test_cached_expired_stale_strict(utils):
+    expire = 10
+    repoconf = os.path.join(utils.config['repo_path'], "yum.repos.d", REPOFILENAME)
+    generate_repofile_expire(utils, repoconf, REPOID, expire)
+    utils.edit_config({'stale_while_revalidate': '1'})
+    pkgname = utils.config["sglversion_pkgname"]
+
+    utils.run(['tdnf', '--repoid={}'.format(REPOID), 'makecache'])
+    time.sleep(expire + 2)
+    ret = utils.run(['tdnf', '--repoid={}'.format(REPOID), '--assumeno', 'install', pkgname])
+    assert "Refreshing metadata" in "\n".join(ret['stdout'])
+
+
+def test_cached_expired_stale_text(utils):
+    expire = 10
+    repoconf = os.path.join(utils.config['repo_path'], "yum.repos.d", REPOFILENAME)
+    generate_repofile_expire(utils, repoconf, REPOID, expire)
+    utils.edit_config({'stale_while_revalidate': '1'})
+
+    utils.run(['tdnf', '--repoid={}'.format(REPOID), 'makecache'])
+    time.sleep(expire + 2)
+    ret = utils.run(['tdnf', '--repoid={}'.format(REPOID), 'list', 'available'])
+    assert ret['retval'] == 0
+    assert "(stale)" in "\n".join(ret['stdout'])
+
+
+# a refresh in progress does not hold up commands that can use the
+# expired metadata
+def test_cached_expired_stale_no_wait(utils):
+    expire = 10
+    repoconf = os.path.join(utils.config['repo_path'], "yum.repos.d", REPOFILENAME)
+    generate_repofile_expire(utils, repoconf, REPOID, expire)
+    utils.edit_config({'stale_while_revalidate': '1'})
+
+    utils.run(['tdnf', '--repoid={}'.format(REPOID), 'makecache'])
+    time.sleep(expire + 2)
+
+    cache_dir = utils.tdnf_config.get('main', 'cachedir')
+    locks = glob.glob(os.path.join(cache_dir, REPOID + '*.lock'))
+    assert len(locks) == 1
+    with open(locks[0], 'r') as f:
+        fcntl.flock(f, fcntl.LOCK_EX)
+        ret = utils.run(['tdnf', '--repoid={}'.format(REPOID), 'list', 'available'])
+        fcntl.flock(f, fcntl.LOCK_UN)
+    assert ret['retval'] == 0
+    assert "waiting" not in "\n".join(ret['stdout'])
+    assert "is expired" in "\n".join(ret['stdout'])
+
+
+# a background refresh that fails leaves the expired metadata in place
+def test_cached_expired_stale_refresh_fails(utils):
+    expire = 10
+    repoconf = os.path.join(utils.config['repo_path'], "yum.repos.d", REPOFILENAME)
+    generate_repofile_expire(utils, repoconf, REPOID, expire)
+    utils.edit_config({'stale_while_revalidate': '1'})
+
+    utils.run(['tdnf', '--repoid={}'.format(REPOID), 'makecache'])
+    time.sleep(expire + 2)
+
+    # the cache name is from the baseurl, break the download instead
+    utils.edit_config({'proxy': 'http://localhost:1'})
+
+    ret = utils.run(['tdnf', '--repoid={}'.format(REPOID), 'list', 'available'])
+    assert ret['retval'] == 0
+    time.sleep(5)
+    ret = utils.run(['tdnf', '--repoid={}'.format(REPOID), 'list', 'available'])
+    assert ret['retval'] == 0
+    assert "is expired" in "\n".join(ret['stdout'])
+    assert "Refreshing metadata" not in "\n".join(ret['stdout'])
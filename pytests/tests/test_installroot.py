@@ -128,3 +128,144 @@ def test_setopt_reposdir_with_installroot(utils):
     assert REPONAME in "\n".join(ret['stdout'])
 
     shutil.rmtree(INSTALLROOT)
+
+
+# metadata and solv cache go to shared_cachedir, not into the installroot
+def test_shared_cachedir(utils):
+    shared_dir = os.path.join(utils.config['repo_path'], 'cache', 'shared')
+    installroot2 = INSTALLROOT + '2'
+    install_root(utils)
+    with open(os.path.join(INSTALLROOT, 'etc/tdnf', 'tdnf.conf'), 'a') as f:
+        f.write('shared_cachedir={}\n'.format(shared_dir))
+    shutil.copytree(INSTALLROOT, installroot2, symlinks=True)
+
+    try:
+        for root in [INSTALLROOT, installroot2]:
+            ret = utils.run(['tdnf', 'makecache',
+                             '--installroot', root,
+                             '--releasever=4.0'], noconfig=True)
+            assert ret['retval'] == 0
+            assert find_cache_dir('photon-test') is None
+
+        cache_dirs = fnmatch.filter(os.listdir(shared_dir), 'photon-test-*')
+        assert any(os.path.isdir(os.path.join(shared_dir, d, 'solvcache')) for d in cache_dirs)
+        assert any(d.endswith('.lock') for d in cache_dirs)
+    finally:
+        shutil.rmtree(installroot2)
+        shutil.rmtree(shared_dir)
+
+
+# one run with several installroots installs into each of them
+def test_batch_install(utils):
+    installroot2 = INSTALLROOT + '2'
+    pkgname = utils.config["mulversion_pkgname"]
+    install_root(utils)
+    shutil.copytree(INSTALLROOT, installroot2, symlinks=True)
+
+    try:
+        ret = utils.run(['tdnf', 'install',
+                         '-y', '--nogpgcheck',
+                         '--installroot', INSTALLROOT,
+                         '--installroot', installroot2,
+                         '--releasever=4.0', pkgname], noconfig=True)
+        assert ret['retval'] == 0
+        assert check_package(utils, pkgname)
+        assert check_package(utils, pkgname, installroot=installroot2)
+
+        # already installed in the first root, the second still gets it
+        utils.run(['tdnf',
+                   '--installroot', installroot2,
+                   '--releasever=4.0',
+                   'erase', '-y', pkgname])
+        assert not check_package(utils, pkgname, installroot=installroot2)
+        ret = utils.run(['tdnf', 'install',
+                         '-y', '--nogpgcheck',
+                         '--installroot', INSTALLROOT,
+                         '--installroot', installroot2,
+                         '--releasever=4.0', pkgname], noconfig=True)
+        assert ret['retval'] == 0
+        assert check_package(utils, pkgname, installroot=installroot2)
+    finally:
+        shutil.rmtree(installroot2)
+
+
+def test_batch_installroot_relative(utils):
+    install_root(utils)
+    ret = utils.run(['tdnf', 'list',
+                     '--installroot', INSTALLROOT,
+                     '--installroot', 'relative/root',
+                     '--releasever=4.0'], noconfig=True)
+    assert ret['retval'] == 1622
+
+
+def set_root_gpgcheck(utils, installroot, keyurl):
+    utils.edit_config({'gpgcheck': '1', 'gpgkey': keyurl},
+                      section='photon-test',
+                      filename=os.path.join(installroot, 'etc/yum.repos.d', REPOFILENAME))
+
+
+# no --nogpgcheck: each root has an rpm transaction of its own, the key
+# is imported into both
+def test_batch_install_gpgcheck(utils):
+    installroot2 = INSTALLROOT + '2'
+    pkgname = utils.config["mulversion_pkgname"]
+    keypath = os.path.join(utils.config['repo_path'], 'photon-test', 'keys', 'pubkey.asc')
+    install_root(utils)
+    set_root_gpgcheck(utils, INSTALLROOT, 'file://{}'.format(keypath))
+    shutil.copytree(INSTALLROOT, installroot2, symlinks=True)
+
+    try:
+        ret = utils.run(['tdnf', 'install', '-y',
+                         '--installroot', INSTALLROOT,
+                         '--installroot', installroot2,
+                         '--releasever=4.0', pkgname], noconfig=True)
+        assert ret['retval'] == 0
+        assert check_package(utils, pkgname)
+        assert check_package(utils, pkgname, installroot=installroot2)
+
+        # each root starts without the keys accepted for the other
+        output = '\n'.join(ret['stdout'] + ret['stderr'])
+        assert output.count('importing key from') == 2
+    finally:
+        shutil.rmtree(installroot2)
+
+
+# clean --stale keeps shared metadata while another root uses it
+def test_clean_stale_shared_cachedir(utils):
+    shared_dir = os.path.join(utils.config['repo_path'], 'cache', 'shared')
+    installroot2 = INSTALLROOT + '2'
+    install_root(utils)
+    with open(os.path.join(INSTALLROOT, 'etc/tdnf', 'tdnf.conf'), 'a') as f:
+        f.write('shared_cachedir={}\n'.format(shared_dir))
+    shutil.copytree(INSTALLROOT, installroot2, symlinks=True)
+
+    def shared_repo_dirs():
+        return [d for d in fnmatch.filter(os.listdir(shared_dir), 'photon-test-*')
+                if os.path.isdir(os.path.join(shared_dir, d))]
+
+    try:
+        for root in [INSTALLROOT, installroot2]:
+            ret = utils.run(['tdnf', 'makecache',
+                             '--installroot', root,
+                             '--releasever=4.0'], noconfig=True)
+            assert ret['retval'] == 0
+        assert len(shared_repo_dirs()) == 1
+
+        # the second root drops the repo, the first still has it
+        os.remove(os.path.join(installroot2, 'etc/yum.repos.d', REPOFILENAME))
+        ret = utils.run(['tdnf', 'clean', '--stale',
+                         '--installroot', installroot2,
+                         '--releasever=4.0'], noconfig=True)
+        assert ret['retval'] == 0
+        assert len(shared_repo_dirs()) == 1
+
+        # now no root uses it
+        os.remove(os.path.join(INSTALLROOT, 'etc/yum.repos.d', REPOFILENAME))
+        ret = utils.run(['tdnf', 'clean', '--stale',
+                         '--installroot', INSTALLROOT,
+                         '--releasever=4.0'], noconfig=True)
+        assert ret['retval'] == 0
+        assert len(shared_repo_dirs()) == 0
+    finally:
+        shutil.rmtree(installroot2)
+        shutil.rmtree(shared_dir)
@@ -7,6 +7,7 @@
 #
 
 import os
+import glob
 import pytest
 import configparser
 
@@ -14,6 +15,7 @@ REPO_ID = 'photon-test'
 REPO_FILENAME = 'photon-test.repo'
 BASEURL = 'http://localhost:8080/photon-test'
 METALINK = 'http://localhost:8080/photon-test/metalink'
+BAD_MIRROR = 'http://localhost:1/photon-test/repodata/repomd.xml'
 
 metalink_file_path = 'photon-test/metalink'
 repomd_file_path = 'photon-test/repodata/repomd.xml'
@@ -34,6 +36,8 @@ def teardown_test(utils):
     set_sha1(utils, False)
     set_sha256(utils, False)
     set_sha512(utils, False)
+    set_probe(utils, None)
+    set_bad_mirror(utils, False)
     pkgname = utils.config["mulversion_pkgname"]
     utils.run(['tdnf', 'erase', '-y', pkgname])
     disable_plugin(utils)
@@ -409,3 +413,58 @@ def test_invalid_sha1_valid_md5(utils):
 
     utils.run(['tdnf', 'install', '-y', '--nogpgcheck', pkgname])
     assert utils.check_package(pkgname)
+
+
+def set_probe(utils, count):
+    utils.edit_config({'metalink_probe': count}, repo=REPO_ID)
+
+
+# add a mirror nobody listens on, preferred over the good one
+def set_bad_mirror(utils, enabled):
+    photon_metalink = os.path.join(utils.config['repo_path'], metalink_file_path)
+    if enabled:
+        utils.run(['sed', '-i', '-e',
+                   r'/<resources/a \    <url protocol="http" type="file" location="IN" preference="100">' +
+                   BAD_MIRROR + '</url>', photon_metalink])
+        utils.run(['sed', '-i', '-e', 's|preference="100">http://localhost:8080|preference="50">http://localhost:8080|',
+                   photon_metalink])
+    else:
+        utils.run(['sed', '-i', '-e', r'\|localhost:1/|d', photon_metalink])
+        utils.run(['sed', '-i', '-e', 's/preference="50"/preference="100"/', photon_metalink])
+
+
+def read_rank(utils):
+    cache_dir = utils.tdnf_config.get('main', 'cachedir')
+    for rank_file in glob.glob(os.path.join(cache_dir, REPO_ID + '-*', 'metalink.rank')):
+        with open(rank_file) as f:
+            lines = f.read().splitlines()
+        return {url: float(score) for score, url in (line.split() for line in lines[1:])}
+    return None
+
+
+# probed mirrors are ranked by speed, failed ones go last
+def test_metalink_probe(utils):
+    set_metalink(utils, True)
+    set_baseurl(utils, False)
+    set_md5(utils, False)
+    set_sha1(utils, False)
+    set_sha256(utils, True)
+    set_sha512(utils, False)
+    set_bad_mirror(utils, True)
+    set_probe(utils, '2')
+
+    ret = utils.run(['tdnf', 'makecache', '--refresh'])
+    assert ret['retval'] == 0
+
+    rank = read_rank(utils)
+    assert rank is not None
+    assert rank[BAD_MIRROR] < 0
+    assert rank['http://localhost:8080/photon-test/repodata/repomd.xml'] > 0
+
+    # the ranking is reused while it has not expired
+    ret = utils.run(['tdnf', 'makecache', '--refresh'])
+    assert ret['retval'] == 0
+    assert read_rank(utils) == rank
+
+    set_bad_mirror(utils, False)
+    set_probe(utils, None)
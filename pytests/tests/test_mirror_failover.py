@@ -0,0 +1,188 @@
+#
+# Copyright (C) 2023 VMware, Inc. All Rights Reserved.
+#
+# Licensed under the GNU General Public License v2 (the "License");
+# you may not use this file except in compliance with the License. The terms
+# of the License are located in the COPYING file of this distribution.
+#
+
+import functools
+import glob
+import http.server
+import os
+import shutil
+import threading
+import time
+import pytest
+
+REPOFILENAME = 'failover.repo'
+REPONAME = 'failover-repo'
+STALL_PORT = 8083
+GOOD_PORT = 8084
+DOWNLOADDIR = '/tmp/tdnf/failover'
+
+
+class StallingHandler(http.server.SimpleHTTPRequestHandler):
+    '''
+    Serves metadata, but sends only the first half of rpms
+    and then goes quiet.
+    '''
+
+    def do_GET(self):
+        self.server.paths.append(self.path)
+        if not self.path.endswith('.rpm'):
+            return super().do_GET()
+        fn = self.translate_path(self.path)
+        with open(fn, 'rb') as f:
+            data = f.read()
+        self.send_response(200)
+        self.send_header('Content-Length', str(len(data)))
+        if self.server.etag:
+            self.send_header('ETag', self.server.etag)
+        self.end_headers()
+        self.wfile.write(data[:len(data) // 2])
+        self.wfile.flush()
+        time.sleep(10)
+
+    def log_message(self, format, *args):
+        pass
+
+
+class RangeHandler(http.server.SimpleHTTPRequestHandler):
+    '''
+    Serves files, with support for 'Range: bytes=N-' and If-Range.
+    '''
+
+    def do_GET(self):
+        self.server.paths.append(self.path)
+        byte_range = self.headers.get('Range')
+        if_range = self.headers.get('If-Range')
+        if if_range:
+            self.server.if_ranges.append(if_range)
+        if not byte_range or (if_range and if_range != self.server.etag):
+            return super().do_GET()
+        self.server.ranges.append(byte_range)
+        start = int(byte_range.split('=')[1].split('-')[0])
+        with open(self.translate_path(self.path), 'rb') as f:
+            data = f.read()
+        self.send_response(206)
+        self.send_header('Content-Range',
+                         'bytes {}-{}/{}'.format(start, len(data) - 1, len(data)))
+        self.send_header('Content-Length', str(len(data) - start))
+        self.end_headers()
+        self.wfile.write(data[start:])
+
+    def log_message(self, format, *args):
+        pass
+
+
+def start_server(handler, root, port):
+    server = http.server.ThreadingHTTPServer(
+        ('localhost', port), functools.partial(handler, directory=root))
+    server.daemon_threads = True
+    server.paths = []
+    server.ranges = []
+    server.if_ranges = []
+    server.etag = None
+    threading.Thread(target=server.serve_forever, daemon=True).start()
+    return server
+
+
+@pytest.fixture(scope='module', autouse=True)
+def setup_test(utils):
+    global stalling, good
+    root = utils.config['repo_path']
+    stalling = start_server(StallingHandler, root, STALL_PORT)
+    good = start_server(RangeHandler, root, GOOD_PORT)
+
+    filename = os.path.join(root, 'yum.repos.d', REPOFILENAME)
+    utils.create_repoconf(filename,
+                          'http://localhost:{}/photon-test '
+                          'http://localhost:{}/photon-test'.format(STALL_PORT, GOOD_PORT),
+                          REPONAME)
+    utils.edit_config({'stall_timeout': '2', 'minrate': '1'},
+                      repo='failover', section=REPONAME)
+    yield
+    teardown_test(utils)
+
+
+def teardown_test(utils):
+    for server in [stalling, good]:
+        server.shutdown()
+        server.server_close()
+    shutil.rmtree(DOWNLOADDIR, ignore_errors=True)
+    filename = os.path.join(utils.config['repo_path'], 'yum.repos.d', REPOFILENAME)
+    if os.path.isfile(filename):
+        os.remove(filename)
+
+
+def download(utils, pkgnames):
+    shutil.rmtree(DOWNLOADDIR, ignore_errors=True)
+    os.makedirs(DOWNLOADDIR)
+    return utils.run(['tdnf', '-y', '--nogpgcheck',
+                      '--disablerepo=*', '--enablerepo={}'.format(REPONAME),
+                      '--downloadonly', '--downloaddir', DOWNLOADDIR,
+                      'install'] + pkgnames)
+
+
+def repo_rpm(utils, pkgname):
+    pattern = os.path.join(utils.config['repo_path'], 'photon-test',
+                           '**', '{}-*.rpm'.format(pkgname))
+    return glob.glob(pattern, recursive=True)[0]
+
+
+# the stalled transfer is continued from the second url
+def test_stall_resume(utils):
+    pkgname = utils.config['toolarge_pkgname']
+    ret = utils.run(['tdnf', '--disablerepo=*', '--enablerepo={}'.format(REPONAME),
+                     'makecache'])
+    assert ret['retval'] == 0
+
+    ret = download(utils, [pkgname])
+    assert ret['retval'] == 0
+
+    rpms = glob.glob('{}/{}*.rpm'.format(DOWNLOADDIR, pkgname))
+    assert len(rpms) == 1
+    assert os.path.getsize(rpms[0]) == os.path.getsize(repo_rpm(utils, pkgname))
+
+    assert len(good.ranges) == 1
+    offset = int(good.ranges[0].split('=')[1].split('-')[0])
+    assert offset > 0
+
+
+# once it stalled, the first url is tried last for the other packages
+def test_sick_mirror_last(utils):
+    pkgnames = [utils.config['toolarge_pkgname'],
+                utils.config['sglversion_pkgname']]
+    del stalling.paths[:]
+    del good.paths[:]
+
+    ret = download(utils, pkgnames)
+    assert ret['retval'] == 0
+    for pkgname in pkgnames:
+        assert len(glob.glob('{}/{}*.rpm'.format(DOWNLOADDIR, pkgname))) == 1
+
+    assert len([p for p in stalling.paths if p.endswith('.rpm')]) == 1
+    assert len([p for p in good.paths if p.endswith('.rpm')]) == len(pkgnames)
+
+
+# a partial file from a mirror with another version of the
+# file is not continued, the second mirror sends all of it
+def test_stall_resume_if_range(utils):
+    pkgname = utils.config['toolarge_pkgname']
+    del good.ranges[:]
+    del good.if_ranges[:]
+    stalling.etag = '"stalled"'
+    good.etag = '"good"'
+    try:
+        ret = download(utils, [pkgname])
+        assert ret['retval'] == 0
+    finally:
+        stalling.etag = None
+        good.etag = None
+
+    rpms = glob.glob('{}/{}*.rpm'.format(DOWNLOADDIR, pkgname))
+    assert len(rpms) == 1
+    with open(rpms[0], 'rb') as f1, open(repo_rpm(utils, pkgname), 'rb') as f2:
+        assert f1.read() == f2.read()
+    assert good.if_ranges == ['"stalled"']
@@ -0,0 +1,207 @@
+#
+# Copyright (C) 2023 VMware, Inc. All Rights Reserved.
+#
+# Licensed under the GNU General Public License v2 (the "License");
+# you may not use this file except in compliance with the License. The terms
+# of the License are located in the COPYING file of this distribution.
+#
+
+import os
+import shutil
+import socket
+import threading
+import pytest
+
+h2 = pytest.importorskip('h2')
+import h2.config  # noqa: E402
+import h2.connection  # noqa: E402
+import h2.events  # noqa: E402
+
+REPOFILENAME = 'h2c.repo'
+REPONAME = 'h2c-repo'
+PORT = 8082
+
+
+class H2cServer:
+    '''
+    HTTP/2 without TLS and with prior knowledge, serving files of root.
+    Requests are answered once the client has been quiet for a moment,
+    so that streams sent together are seen together.
+    '''
+
+    def __init__(self, root, port):
+        self.root = root
+        self.connections = 0
+        self.requests = 0
+        self.max_pending = 0
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+        self.sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        self.sock.bind(('localhost', port))
+        self.sock.listen(8)
+        threading.Thread(target=self._serve, daemon=True).start()
+
+    def reset(self):
+        self.connections = 0
+        self.requests = 0
+        self.max_pending = 0
+
+    def stop(self):
+        self.sock.close()
+
+    def _serve(self):
+        while True:
+            try:
+                conn, _ = self.sock.accept()
+            except OSError:
+                return
+            self.connections += 1
+            threading.Thread(target=self._handle, args=(conn,),
+                             daemon=True).start()
+
+    def _respond(self, h2conn, stream_id, path, outgoing):
+        fn = os.path.join(self.root, path.split('?')[0].lstrip('/'))
+        if not os.path.isfile(fn):
+            h2conn.send_headers(stream_id, [(':status', '404')],
+                                end_stream=True)
+            return
+        with open(fn, 'rb') as f:
+            data = f.read()
+        h2conn.send_headers(stream_id, [(':status', '200'),
+                                        ('content-length', str(len(data)))])
+        outgoing[stream_id] = data
+
+    def _send_data(self, h2conn, outgoing):
+        for stream_id in list(outgoing):
+            data = outgoing[stream_id]
+            while data:
+                size = min(h2conn.local_flow_control_window(stream_id),
+                           h2conn.max_outbound_frame_size)
+                if size <= 0:
+                    break
+                h2conn.send_data(stream_id, data[:size],
+                                 end_stream=len(data) <= size)
+                data = data[size:]
+            if data:
+                outgoing[stream_id] = data
+            else:
+                del outgoing[stream_id]
+
+    def _handle(self, conn):
+        config = h2.config.H2Configuration(client_side=False,
+                                           header_encoding='utf-8')
+        h2conn = h2.connection.H2Connection(config=config)
+        h2conn.initiate_connection()
+        conn.sendall(h2conn.data_to_send())
+        conn.settimeout(0.2)
+        pending = {}
+        outgoing = {}
+        while True:
+            try:
+                data = conn.recv(65536)
+            except socket.timeout:
+                for stream_id, path in pending.items():
+                    self._respond(h2conn, stream_id, path, outgoing)
+                pending.clear()
+                self._send_data(h2conn, outgoing)
+                conn.sendall(h2conn.data_to_send())
+                continue
+            except OSError:
+                break
+            if not data:
+                break
+            for event in h2conn.receive_data(data):
+                if isinstance(event, h2.events.RequestReceived):
+                    pending[event.stream_id] = dict(event.headers)[':path']
+                    self.requests += 1
+                    self.max_pending = max(self.max_pending, len(pending))
+                elif isinstance(event, h2.events.ConnectionTerminated):
+                    conn.close()
+                    return
+            self._send_data(h2conn, outgoing)
+            conn.sendall(h2conn.data_to_send())
+        conn.close()
+
+
+@pytest.fixture(scope='module', autouse=True)
+def setup_test(utils):
+    global server
+    server = H2cServer(utils.config['repo_path'], PORT)
+
+    filename = os.path.join(utils.config['repo_path'], 'yum.repos.d', REPOFILENAME)
+    utils.create_repoconf(filename,
+                          'http://localhost:{}/photon-test'.format(PORT),
+                          REPONAME)
+    utils.edit_config({'http2_prior_knowledge': '1'}, repo='h2c',
+                      section=REPONAME)
+    yield
+    teardown_test(utils)
+
+
+def teardown_test(utils):
+    server.stop()
+    utils.edit_config({'max_concurrent_streams': None})
+    for pkgname in pkgnames(utils) + [utils.config['required_package']]:
+        utils.erase_package(pkgname)
+    filename = os.path.join(utils.config['repo_path'], 'yum.repos.d', REPOFILENAME)
+    if os.path.isfile(filename):
+        os.remove(filename)
+
+
+def pkgnames(utils):
+    return [utils.config['sglversion_pkgname'],
+            utils.config['sglversion2_pkgname'],
+            utils.config['requiring_package']]
+
+
+def clean_packages(utils):
+    for pkgname in pkgnames(utils) + [utils.config['required_package']]:
+        utils.erase_package(pkgname)
+    cachedir = utils.tdnf_config.get('main', 'cachedir')
+    shutil.rmtree(os.path.join(cachedir, REPONAME, 'rpms'), ignore_errors=True)
+
+
+def install(utils):
+    return utils.run(['tdnf', '-y', '--nogpgcheck',
+                      '--disablerepo=*', '--enablerepo={}'.format(REPONAME),
+                      'install'] + pkgnames(utils))
+
+
+def test_multiplexed_install(utils):
+    utils.edit_config({'max_concurrent_streams': '8'})
+    ret = utils.run(['tdnf', '--disablerepo=*', '--enablerepo={}'.format(REPONAME),
+                     'makecache'])
+    assert ret['retval'] == 0
+    clean_packages(utils)
+
+    server.reset()
+    ret = install(utils)
+    assert ret['retval'] == 0
+    for pkgname in pkgnames(utils):
+        assert utils.check_package(pkgname)
+
+    # all packages on one connection, several streams at a time
+    assert server.connections == 1
+    assert server.requests >= len(pkgnames(utils))
+    assert server.max_pending > 1
+
+
+def test_serial_install(utils):
+    utils.edit_config({'max_concurrent_streams': None})
+    clean_packages(utils)
+
+    server.reset()
+    ret = install(utils)
+    assert ret['retval'] == 0
+    for pkgname in pkgnames(utils):
+        assert utils.check_package(pkgname)
+
+    # a connection and a request per package
+    assert server.max_pending == 1
+    assert server.connections == server.requests
+
+
+def test_max_concurrent_streams_invalid(utils):
+    utils.edit_config({'max_concurrent_streams': '1000'})
+    ret = utils.run(['tdnf', 'repolist'])
+    assert ret['retval'] == 1010
+    utils.edit_config({'max_concurrent_streams': None})
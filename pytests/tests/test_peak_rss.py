@@ -0,0 +1,63 @@
+#
+# Copyright (C) 2023 VMware, Inc. All Rights Reserved.
+#
+# Licensed under the GNU General Public License v2 (the "License");
+# you may not use this file except in compliance with the License. The terms
+# of the License are located in the COPYING file of this distribution.
+#
+
+import os
+import subprocess
+import pytest
+
+# peak memory benchmark: the pool is freed before the rpm transaction
+# runs, so for transactions the peak is max(solve, rpm) instead of the sum
+
+
+@pytest.fixture(scope='module', autouse=True)
+def setup_test(utils):
+    utils.run(['tdnf', 'makecache'])
+    yield
+    teardown_test(utils)
+
+
+def teardown_test(utils):
+    utils.erase_package(utils.config['mulversion_pkgname'])
+    utils.erase_package(utils.config['sglversion_pkgname'])
+
+
+def run_peak_rss(utils, args):
+    cmd = ['tdnf'] + args
+    utils._decorate_tdnf_cmd_for_test(cmd, False)
+    process = subprocess.Popen(cmd,  # nosec
+                               stdout=subprocess.DEVNULL,
+                               stderr=subprocess.DEVNULL)
+    _, status, rusage = os.wait4(process.pid, 0)
+    process.returncode = os.waitstatus_to_exitcode(status)
+    assert process.returncode == 0
+    # ru_maxrss is in kilobytes on Linux
+    return rusage.ru_maxrss
+
+
+def test_peak_rss_benchmark(utils):
+    spkg = utils.config['sglversion_pkgname']
+    mpkg = utils.config['mulversion_pkgname']
+    mpkg_lower = mpkg + '-' + utils.config['mulversion_lower']
+
+    steps = [
+        ('list installed', ['list', 'installed']),
+        ('install', ['install', '-y', '--nogpgcheck', spkg, mpkg_lower]),
+        ('upgrade', ['upgrade', '-y', '--nogpgcheck', mpkg]),
+        ('erase', ['erase', '-y', spkg, mpkg]),
+    ]
+
+    results = []
+    for name, args in steps:
+        results.append((name, run_peak_rss(utils, args)))
+
+    print('\n{:<24} {:>14}'.format('command', 'peak rss(KiB)'))
+    for name, kib in results:
+        print('{:<24} {:>14}'.format(name, kib))
+
+    assert not utils.check_package(spkg)
+
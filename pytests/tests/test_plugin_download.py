@@ -0,0 +1,101 @@
+#
+# Copyright (C) 2023 VMware, Inc. All Rights Reserved.
+#
+# Licensed under the GNU General Public License v2 (the "License");
+# you may not use this file except in compliance with the License. The terms
+# of the License are located in the COPYING file of this distribution.
+#
+
+import glob
+import os
+import shutil
+import pytest
+
+PLUGIN_NAME = 'tdnftestdownload'
+SOURCEDIR = '/tmp/tdnf/plugin-source'
+LOGFILE = '/tmp/tdnf/plugin-download.log'
+
+
+@pytest.fixture(scope='function', autouse=True)
+def setup_test(utils):
+    enable_plugins(utils)
+    os.makedirs(SOURCEDIR, exist_ok=True)
+    os.environ['TDNF_TEST_DOWNLOAD_SOURCE'] = SOURCEDIR
+    os.environ['TDNF_TEST_DOWNLOAD_LOG'] = LOGFILE
+    utils.erase_package(utils.config['sglversion_pkgname'])
+    utils.run(['tdnf', 'clean', 'all'])
+    yield
+    teardown_test(utils)
+
+
+def teardown_test(utils):
+    del os.environ['TDNF_TEST_DOWNLOAD_SOURCE']
+    del os.environ['TDNF_TEST_DOWNLOAD_LOG']
+    shutil.rmtree(SOURCEDIR, ignore_errors=True)
+    if os.path.isfile(LOGFILE):
+        os.remove(LOGFILE)
+    utils.edit_config({'plugins': '0',
+                       'pluginconfpath': None,
+                       'pluginpath': None})
+    plugin_conf = os.path.join(utils.config['repo_path'], 'pluginconf.d', PLUGIN_NAME + '.conf')
+    if os.path.isfile(plugin_conf):
+        os.remove(plugin_conf)
+    utils.erase_package(utils.config['sglversion_pkgname'])
+
+
+def enable_plugins(utils):
+    plugin_conf_path = os.path.join(utils.config['repo_path'], 'pluginconf.d')
+    utils.makedirs(plugin_conf_path)
+
+    utils.edit_config({'plugins': '1',
+                       'pluginconfpath': plugin_conf_path,
+                       'pluginpath': utils.config['plugin_path']})
+
+    plugin_conf = os.path.join(plugin_conf_path, PLUGIN_NAME + '.conf')
+    with open(plugin_conf, 'w') as plugin_conf_file:
+        plugin_conf_file.write('[main]\nenabled=1\n')
+
+
+def repo_rpm(utils, pkgname):
+    pattern = os.path.join(utils.config['repo_path'], 'photon-test',
+                           'RPMS', '*', '{}-*.rpm'.format(pkgname))
+    return glob.glob(pattern)[0]
+
+
+def delivered():
+    if not os.path.isfile(LOGFILE):
+        return []
+    with open(LOGFILE) as f:
+        return f.read().split()
+
+
+def install(utils, pkgname):
+    return utils.run(['tdnf', 'install', '-y', '--nogpgcheck',
+                      '--disablerepo=*', '--enablerepo=photon-test', pkgname])
+
+
+# a package from the plugin that matches the repo checksum is used
+def test_plugin_package_accepted(utils):
+    pkgname = utils.config['sglversion_pkgname']
+    rpm = repo_rpm(utils, pkgname)
+    shutil.copy(rpm, SOURCEDIR)
+
+    ret = install(utils, pkgname)
+    assert ret['retval'] == 0
+    assert utils.check_package(pkgname)
+    assert os.path.basename(rpm) in delivered()
+    assert 'does not match repo metadata' not in '\n'.join(ret['stderr'])
+
+
+# a package from the plugin that does not match is replaced from the repo
+def test_plugin_package_fallback(utils):
+    pkgname = utils.config['sglversion_pkgname']
+    rpm = repo_rpm(utils, pkgname)
+    with open(os.path.join(SOURCEDIR, os.path.basename(rpm)), 'wb') as f:
+        f.write(b'not an rpm' * (os.path.getsize(rpm) // 10 + 1))
+
+    ret = install(utils, pkgname)
+    assert ret['retval'] == 0
+    assert utils.check_package(pkgname)
+    assert os.path.basename(rpm) in delivered()
+    assert 'does not match repo metadata' in '\n'.join(ret['stderr'])
@@ -132,3 +132,34 @@ def test_repofromdir_created_repo(utils):
                     cwd=workdir)
     assert ret['retval'] == 0
     assert utils.check_package(pkgname)
+
+
+# files from a file:// repo are copied locally, not through libcurl,
+# and hardlinked with local_hardlink
+def test_repofrompath_local_copy(utils):
+    workdir = WORKDIR
+    reponame = 'photon-test'
+    synced_dir = os.path.join(workdir, reponame)
+    copy_dir = os.path.join(workdir, 'copy')
+
+    create_repo(utils)
+
+    for hardlink in [False, True]:
+        utils.edit_config({'local_hardlink': '1' if hardlink else None})
+        ret = utils.run(['tdnf',
+                         '--repofrompath=synced-repo,{}'.format(synced_dir),
+                         '--repo=synced-repo',
+                         '--download-metadata',
+                         '--download-path={}'.format(copy_dir),
+                         'reposync'],
+                        cwd=workdir)
+        utils.edit_config({'local_hardlink': None})
+        assert ret['retval'] == 0
+
+        src = os.path.join(synced_dir, 'repodata', 'repomd.xml')
+        dst = os.path.join(copy_dir, 'synced-repo', 'repodata', 'repomd.xml')
+        with open(src, 'rb') as f1, open(dst, 'rb') as f2:
+            assert f1.read() == f2.read()
+        assert (os.stat(src).st_ino == os.stat(dst).st_ino) == hardlink
+
+        shutil.rmtree(copy_dir)
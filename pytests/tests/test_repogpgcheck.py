@@ -7,6 +7,7 @@
 #
 
 import os
+import fnmatch
 import pytest
 
 PLUGIN_NAME = 'tdnfrepogpgcheck'
@@ -73,3 +74,75 @@ def test_tdnfrepogpgcheck_plugin_validatesignature(utils):
     # we should load the plugin
     assert ret['stdout'][0].startswith('Loaded plugin: tdnfrepogpgcheck')  # nosec
     assert ret['retval'] == 0
+
+
+def find_cache_dir(utils, reponame):
+    cache_dir = utils.tdnf_config.get('main', 'cachedir')
+    for f in os.listdir(cache_dir):
+        if fnmatch.fnmatch(f, '{}-*'.format(reponame)):
+            return os.path.join(cache_dir, f)
+    return None
+
+
+# a good verification is recorded and reused for unchanged metadata
+def test_tdnfrepogpgcheck_plugin_verified_record(utils):
+    set_repo_flag_repo_gpgcheck(utils, "1")
+    ret = utils.run(['tdnf', 'repolist', '--refresh'])
+    assert ret['retval'] == 0
+    record = os.path.join(find_cache_dir(utils, 'photon-test'), 'repomd.verified')
+    assert os.path.isfile(record)
+
+    # unchanged files, the verify is skipped
+    ret = utils.run(['tdnf', '-v', 'repolist', '--refresh'])
+    assert ret['retval'] == 0
+    assert any('signature verified before' in line for line in ret['stdout'])
+    assert not any('verifying repomd.xml signature' in line
+                   for line in ret['stdout'])
+
+    # a record that is not for this repomd must not skip the check
+    with open(record, 'w') as f:
+        f.write('{} {} {}\n'.format('0' * 64, '0' * 64, '0' * 40))
+    ret = utils.run(['tdnf', 'repolist', '--refresh'])
+    assert ret['retval'] == 0
+    with open(record) as f:
+        assert not f.read().startswith('0' * 64)
+
+
+def served_repomd(utils):
+    return os.path.join(utils.config['repo_path'], 'photon-test',
+                        'repodata', 'repomd.xml')
+
+
+def verify_after_change(utils, filename):
+    set_repo_flag_repo_gpgcheck(utils, "1")
+    ret = utils.run(['tdnf', 'repolist', '--refresh'])
+    assert ret['retval'] == 0
+
+    with open(filename, 'rb') as f:
+        orig = f.read()
+    try:
+        with open(filename, 'ab') as f:
+            f.write(b'\n')
+        ret = utils.run(['tdnf', '-v', 'repolist', '--refresh'])
+    finally:
+        with open(filename, 'wb') as f:
+            f.write(orig)
+    assert not any('signature verified before' in line
+                   for line in ret['stdout'])
+    return ret
+
+
+# a changed repomd.xml is verified again, and does not match
+# the signature any more
+def test_tdnfrepogpgcheck_plugin_record_repomd_changed(utils):
+    ret = verify_after_change(utils, served_repomd(utils))
+    assert ret['retval'] != 0
+
+
+# a changed signature is verified again. Armor ignores the
+# trailing newline, so it is still good
+def test_tdnfrepogpgcheck_plugin_record_signature_changed(utils):
+    ret = verify_after_change(utils, served_repomd(utils) + '.asc')
+    assert ret['retval'] == 0
+    assert any('verifying repomd.xml signature' in line
+               for line in ret['stdout'])
@@ -7,9 +7,11 @@
 #
 
 import os
+import fcntl
 import shutil
 import pytest
 import platform
+import threading
 
 ARCH = platform.machine()
 DOWNLOADDIR = '/root/reposync/download'
@@ -154,6 +156,28 @@ def test_reposync_download_path_norepopath(utils):
     check_synced_repo(utils, reponame, downloaddir)
 
 
+# reposync excluding the repo name waits for another one into the same path
+def test_reposync_download_path_norepopath_locked(utils):
+    reponame = TESTREPO
+    downloaddir = DOWNLOADDIR
+    utils.makedirs(downloaddir)
+
+    with open(os.path.join(downloaddir, '.tdnf-reposync.lock'), 'w') as f:
+        fcntl.flock(f, fcntl.LOCK_EX)
+        timer = threading.Timer(5, fcntl.flock, [f, fcntl.LOCK_UN])
+        timer.start()
+        ret = utils.run(['tdnf',
+                         '--disablerepo=*', '--enablerepo={}'.format(reponame),
+                         '--download-path={}'.format(downloaddir),
+                         '--norepopath',
+                         'reposync'])
+        timer.join()
+    assert ret['retval'] == 0
+    assert any('waiting for another reposync' in line for line in ret['stdout'])
+
+    check_synced_repo(utils, reponame, downloaddir)
+
+
 # reposync excluding the repo name and delete option is incompatible
 def test_reposync_download_path_norepopath_delete(utils):
     reponame = TESTREPO
@@ -252,6 +276,38 @@ def test_reposync_delete(utils):
     shutil.rmtree(synced_dir)
 
 
+# --delete must only remove what was not synced, also in subdirectories,
+# and must not leave anything besides the packages behind
+def test_reposync_delete_nested(utils):
+    reponame = TESTREPO
+    workdir = WORKDIR
+    utils.makedirs(workdir)
+
+    synced_dir = os.path.join(workdir, reponame)
+    cmd = ['tdnf', '--disablerepo=*', '--enablerepo={}'.format(reponame),
+           '--delete', 'reposync']
+    ret = utils.run(cmd, cwd=workdir)
+    assert ret['retval'] == 0
+
+    faked_rpm = os.path.join(synced_dir, 'RPMS', ARCH, 'faked-0.1.2.rpm')
+    with open(faked_rpm, 'w') as f:
+        f.write('fake package')
+    other_file = os.path.join(synced_dir, 'RPMS', 'README')
+    with open(other_file, 'w') as f:
+        f.write('not a package')
+
+    ret = utils.run(cmd, cwd=workdir)
+    assert ret['retval'] == 0
+
+    check_synced_repo(utils, reponame, synced_dir)
+    assert not os.path.isfile(faked_rpm)
+    assert os.path.isfile(other_file)
+    for root, _, files in os.walk(synced_dir):
+        assert not [f for f in files if f.endswith('.reposync-keep')]
+
+    shutil.rmtree(synced_dir)
+
+
 # test no --delete option (we should not delete files if not asked to)
 def test_reposync_no_delete(utils):
     reponame = TESTREPO
@@ -432,3 +488,111 @@ def test_reposync_newest(utils):
     assert mulversion_pkgname_found
 
     shutil.rmtree(synced_dir)
+
+
+# reposync with a given number of download workers
+def test_reposync_workers(utils):
+    reponame = TESTREPO
+    workdir = WORKDIR
+    utils.makedirs(workdir)
+
+    ret = utils.run(['tdnf',
+                     '--disablerepo=*', '--enablerepo={}'.format(reponame),
+                     '--workers=8',
+                     'reposync'],
+                    cwd=workdir)
+    assert ret['retval'] == 0
+    synced_dir = os.path.join(workdir, reponame)
+    check_synced_repo(utils, reponame, synced_dir)
+
+    ret = utils.run(['tdnf',
+                     '--disablerepo=*', '--enablerepo={}'.format(reponame),
+                     '--workers=0',
+                     'reposync'],
+                    cwd=workdir)
+    assert ret['retval'] != 0
+
+    shutil.rmtree(synced_dir)
+
+
+# a truncated or damaged file must be downloaded again,
+# an intact one must be kept
+def test_reposync_verify_existing(utils):
+    reponame = TESTREPO
+    workdir = WORKDIR
+    utils.makedirs(workdir)
+
+    cmd = ['tdnf', '--disablerepo=*', '--enablerepo={}'.format(reponame), 'reposync']
+    ret = utils.run(cmd, cwd=workdir)
+    assert ret['retval'] == 0
+    synced_dir = os.path.join(workdir, reponame)
+    rpm_dir = os.path.join(synced_dir, 'RPMS', ARCH)
+    rpms = sorted(f for f in os.listdir(rpm_dir) if f.endswith('.rpm'))
+    assert len(rpms) >= 2
+
+    truncated = os.path.join(rpm_dir, rpms[0])
+    size = os.path.getsize(truncated)
+    with open(truncated, 'r+b') as f:
+        f.truncate(size // 2)
+
+    damaged = os.path.join(rpm_dir, rpms[1])
+    with open(damaged, 'r+b') as f:
+        f.seek(-1, os.SEEK_END)
+        last = f.read(1)
+        f.seek(-1, os.SEEK_END)
+        f.write(bytes([last[0] ^ 0xff]))
+
+    mtimes = {f: os.stat(os.path.join(rpm_dir, f)).st_mtime_ns for f in rpms[2:]}
+
+    ret = utils.run(cmd, cwd=workdir)
+    assert ret['retval'] == 0
+    assert os.path.getsize(truncated) == size
+    with open(damaged, 'rb') as f:
+        f.seek(-1, os.SEEK_END)
+        assert f.read(1) == last
+
+    for f, mtime in mtimes.items():
+        assert os.stat(os.path.join(rpm_dir, f)).st_mtime_ns == mtime
+
+    # digests of the synced files are cached for the next run
+    cache = os.path.join(utils.tdnf_config.get('main', 'cachedir'),
+                         'resultcache', 'file-digests.cache')
+    assert os.path.isfile(cache)
+
+    shutil.rmtree(synced_dir)
+
+
+# a second copy of a repo is linked from the package store,
+# not downloaded again
+def test_reposync_package_store(utils):
+    reponame = TESTREPO
+    workdir = WORKDIR
+    downloaddir = DOWNLOADDIR
+    utils.makedirs(workdir)
+    utils.makedirs(downloaddir)
+
+    cmd = ['tdnf', '--disablerepo=*', '--enablerepo={}'.format(reponame), 'reposync']
+    ret = utils.run(cmd, cwd=workdir)
+    assert ret['retval'] == 0
+    ret = utils.run(cmd + ['--download-path={}'.format(downloaddir)])
+    assert ret['retval'] == 0
+    assert 'deduplicated through the package store' in '\n'.join(ret['stdout'])
+
+    rpm_dir1 = os.path.join(workdir, reponame, 'RPMS', ARCH)
+    rpm_dir2 = os.path.join(downloaddir, reponame, 'RPMS', ARCH)
+    rpms = [f for f in os.listdir(rpm_dir1) if f.endswith('.rpm')]
+    assert len(rpms) > 0
+    for rpm in rpms:
+        st1 = os.stat(os.path.join(rpm_dir1, rpm))
+        st2 = os.stat(os.path.join(rpm_dir2, rpm))
+        assert st1.st_ino == st2.st_ino
+
+    # entries no longer used by any tree are pruned
+    shutil.rmtree(os.path.join(workdir, reponame))
+    shutil.rmtree(os.path.join(downloaddir, reponame))
+    ret = utils.run(['tdnf', 'clean', 'packages'])
+    assert ret['retval'] == 0
+    store = os.path.join(utils.tdnf_config.get('main', 'cachedir'), 'store')
+    for root, _, files in os.walk(store):
+        for f in files:
+            assert os.stat(os.path.join(root, f)).st_nlink > 1
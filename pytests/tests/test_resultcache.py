@@ -0,0 +1,90 @@
+#
+# Copyright (C) 2023 VMware, Inc. All Rights Reserved.
+#
+# Licensed under the GNU General Public License v2 (the "License");
+# you may not use this file except in compliance with the License. The terms
+# of the License are located in the COPYING file of this distribution.
+#
+
+import os
+import shutil
+import pytest
+
+WORKDIR = '/root/test_resultcache'
+TEST_CONF_FILE = 'tdnf.conf'
+TEST_CONF_PATH = os.path.join(WORKDIR, TEST_CONF_FILE)
+
+
+@pytest.fixture(scope='module', autouse=True)
+def setup_test(utils):
+    tdnf_conf = os.path.join(utils.config['repo_path'], 'tdnf.conf')
+    utils.makedirs(WORKDIR)
+    shutil.copy(tdnf_conf, TEST_CONF_PATH)
+    utils.run(['tdnf', 'makecache'])
+    yield
+    teardown_test(utils)
+
+
+def teardown_test(utils):
+    shutil.rmtree(WORKDIR)
+    pkgname = utils.config['mulversion_pkgname']
+    utils.erase_package(pkgname)
+
+
+def resultcache_dir(utils):
+    return os.path.join(utils.tdnf_config.get('main', 'cachedir'), 'resultcache')
+
+
+def test_check_update_cached(utils):
+    pkgname = utils.config['mulversion_pkgname']
+    pkg_lower = pkgname + '-' + utils.config['mulversion_lower']
+    utils.run(['tdnf', 'install', '-y', '--nogpgcheck', pkg_lower])
+
+    ret1 = utils.run(['tdnf', 'check-update'])
+    assert os.path.isdir(resultcache_dir(utils))
+    ret2 = utils.run(['tdnf', 'check-update'])
+    assert ret1['retval'] == ret2['retval']
+    assert ret1['stdout'] == ret2['stdout']
+    assert pkgname in '\n'.join(ret2['stdout'])
+
+
+def test_check_update_invalidated_by_rpmdb(utils):
+    pkgname = utils.config['mulversion_pkgname']
+    utils.run(['tdnf', 'check-update'])
+    utils.run(['tdnf', 'upgrade', '-y', '--nogpgcheck', pkgname])
+    ret = utils.run(['tdnf', 'check-update', pkgname])
+    assert pkgname not in '\n'.join(ret['stdout'])
+
+
+def test_check_update_invalidated_by_config(utils):
+    pkgname = utils.config['mulversion_pkgname']
+    pkg_lower = pkgname + '-' + utils.config['mulversion_lower']
+    utils.run(['tdnf', 'install', '-y', '--nogpgcheck', '--allowerasing', pkg_lower])
+    ret = utils.run(['tdnf', 'check-update', pkgname])
+    assert pkgname in '\n'.join(ret['stdout'])
+
+    utils.edit_config({'excludes': pkgname}, section='main', filename=TEST_CONF_PATH)
+    ret = utils.run(['tdnf', '--config', TEST_CONF_PATH, 'check-update', pkgname])
+    assert pkgname not in '\n'.join(ret['stdout'])
+
+
+def test_assumeno_cached(utils):
+    ret1 = utils.run(['tdnf', '--assumeno', 'upgrade'])
+    ret2 = utils.run(['tdnf', '--assumeno', 'upgrade'])
+    assert ret1['retval'] == ret2['retval']
+    assert [line for line in ret1['stdout'] if 'cached' not in line] == \
+        [line for line in ret2['stdout'] if 'cached' not in line]
+
+
+def test_refresh_bypasses_cache(utils):
+    utils.run(['tdnf', '--assumeno', 'upgrade'])
+    ret = utils.run(['tdnf', '--assumeno', '--refresh', 'upgrade'])
+    assert 'Using cached solver result' not in '\n'.join(ret['stdout'])
+
+
+def test_clean_dbcache_removes_results(utils):
+    utils.run(['tdnf', 'check-update'])
+    assert os.path.isdir(resultcache_dir(utils))
+    ret = utils.run(['tdnf', 'clean', 'dbcache'])
+    assert ret['retval'] == 0
+    assert not os.path.isdir(resultcache_dir(utils))
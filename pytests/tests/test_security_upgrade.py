@@ -0,0 +1,193 @@
+#
+# Copyright (C) 2023 VMware, Inc. All Rights Reserved.
+#
+# Licensed under the GNU General Public License v2 (the "License");
+# you may not use this file except in compliance with the License. The terms
+# of the License are located in the COPYING file of this distribution.
+#
+
+import glob
+import os
+import shutil
+import time
+import pytest
+
+# security upgrade benchmark: upgrade --security and friends against a
+# repo with 10k advisories. Most of them name packages that are not
+# installed, or versions older than the installed ones, only one of
+# them is an upgrade. Set TDNF_BASELINE to a tdnf binary built without
+# the one pass advisory resolve to compare against it.
+ADVISORIES = 10000
+RUNS = 5
+BASELINE = os.environ.get('TDNF_BASELINE')
+# the new path must not be slower than the baseline by more than this
+BASELINE_SLACK = 1.1
+REPONAME = 'photon-test-advisories'
+REPOFILENAME = 'advisories.repo'
+
+UPDATE_TEMPL = '''  <update from="tdnf@tdnf.test" status="stable" type="{type}" version="1">
+    <id>{id}</id>
+    <title>{name}</title>
+    <severity>{severity}</severity>
+    <issued date="2023-01-01 00:00:00"/>
+    <description>{id}</description>
+    <pkglist>
+      <collection short="bench">
+        <name>bench</name>
+        <package arch="{arch}" name="{name}" release="{release}" version="{version}">
+          <filename>{name}-{version}-{release}.{arch}.rpm</filename>
+        </package>
+      </collection>
+    </pkglist>
+  </update>
+'''
+
+
+def repo_dir(utils):
+    return os.path.join(utils.config['repo_path'], REPONAME)
+
+
+def mulversion_arch(utils):
+    pattern = os.path.join(utils.config['repo_path'], 'photon-test', 'RPMS',
+                           '*', '{}-{}.*.rpm'.format(
+                               utils.config['mulversion_pkgname'],
+                               utils.config['mulversion_higher']))
+    return glob.glob(pattern)[0].split('.')[-2]
+
+
+def write_updateinfo(utils, filename):
+    mpkg = utils.config['mulversion_pkgname']
+    spkg = utils.config['sglversion_pkgname']
+    arch = mulversion_arch(utils)
+    higher_version, higher_release = utils.config['mulversion_higher'].split('-')
+    with open(filename, 'w') as f:
+        f.write('<?xml version="1.0" encoding="UTF-8"?>\n<updates>\n')
+        for i in range(1, ADVISORIES):
+            if i % 3 == 0:
+                name, version, atype = 'tdnf-bench-{}'.format(i), '1.0', 'security'
+            elif i % 3 == 1:
+                name, version, atype = mpkg, '0.{}'.format(i), 'security'
+            else:
+                name, version, atype = spkg, '0.{}'.format(i), 'bugfix'
+            f.write(UPDATE_TEMPL.format(type=atype, id='BENCH-{}'.format(i),
+                                        name=name, severity='5.0',
+                                        arch=arch, version=version,
+                                        release='1'))
+        f.write(UPDATE_TEMPL.format(type='security', id='BENCH-0', name=mpkg,
+                                    severity='9.0', arch=arch,
+                                    version=higher_version,
+                                    release=higher_release))
+        f.write('</updates>\n')
+
+
+@pytest.fixture(scope='module', autouse=True)
+def setup_test(utils):
+    if not shutil.which('createrepo') or not shutil.which('modifyrepo'):
+        pytest.skip('createrepo and modifyrepo are needed')
+
+    path = repo_dir(utils)
+    shutil.rmtree(path, ignore_errors=True)
+    shutil.copytree(os.path.join(utils.config['repo_path'], 'photon-test', 'RPMS'),
+                    os.path.join(path, 'RPMS'))
+    ret = utils.run(['createrepo', path])
+    assert ret['retval'] == 0
+
+    updateinfo = os.path.join(utils.config['repo_path'], 'updateinfo.xml')
+    write_updateinfo(utils, updateinfo)
+    ret = utils.run(['modifyrepo', updateinfo, os.path.join(path, 'repodata')])
+    assert ret['retval'] == 0
+    os.remove(updateinfo)
+
+    filename = os.path.join(utils.config['repo_path'], 'yum.repos.d', REPOFILENAME)
+    utils.create_repoconf(filename,
+                          'http://localhost:8080/{}'.format(REPONAME),
+                          REPONAME)
+    yield
+    teardown_test(utils)
+
+
+def teardown_test(utils):
+    utils.erase_package(utils.config['mulversion_pkgname'])
+    filename = os.path.join(utils.config['repo_path'], 'yum.repos.d', REPOFILENAME)
+    if os.path.isfile(filename):
+        os.remove(filename)
+    shutil.rmtree(repo_dir(utils), ignore_errors=True)
+
+
+def install_lower(utils):
+    utils.install_package(utils.config['mulversion_pkgname'],
+                          utils.config['mulversion_lower'])
+
+
+def tdnf_args(opts):
+    return ['tdnf', '--disablerepo=*', '--enablerepo={}'.format(REPONAME)] + opts
+
+
+def test_security_upgrade(utils):
+    mpkg = utils.config['mulversion_pkgname']
+    install_lower(utils)
+
+    ret = utils.run(tdnf_args(['-y', '--nogpgcheck', '--security', 'upgrade']))
+    assert ret['retval'] == 0
+    assert utils.check_package(mpkg, utils.config['mulversion_higher'])
+
+
+def test_sec_severity_upgrade(utils):
+    mpkg = utils.config['mulversion_pkgname']
+
+    # no advisory is that severe
+    install_lower(utils)
+    ret = utils.run(tdnf_args(['-y', '--nogpgcheck', '--sec-severity', '9.5',
+                               'upgrade']))
+    assert ret['retval'] == 0
+    assert utils.check_package(mpkg, utils.config['mulversion_lower'])
+
+    ret = utils.run(tdnf_args(['-y', '--nogpgcheck', '--sec-severity', '9.0',
+                               'upgrade']))
+    assert ret['retval'] == 0
+    assert utils.check_package(mpkg, utils.config['mulversion_higher'])
+
+
+def time_command(utils, opts, binary=None):
+    times = []
+    for _ in range(RUNS):
+        cmd = tdnf_args(['-q'] + opts)
+        start = time.monotonic()
+        if binary:
+            utils._run([binary, '-c',
+                        os.path.join(utils.config['repo_path'], 'tdnf.conf')] +
+                       cmd[1:])
+        else:
+            utils.run(cmd)
+        times.append(time.monotonic() - start)
+    times.sort()
+    return times[len(times) // 2]
+
+
+def test_security_upgrade_benchmark(utils):
+    install_lower(utils)
+    utils.run(tdnf_args(['makecache']))
+
+    commands = [
+        ['--assumeno', 'upgrade'],
+        ['--assumeno', '--security', 'upgrade'],
+        ['--assumeno', '--sec-severity', '9.0', 'upgrade'],
+        ['--security', 'updateinfo', 'list'],
+    ]
+    results = {}
+    for opts in commands:
+        results[' '.join(opts)] = (
+            time_command(utils, opts),
+            time_command(utils, opts, BASELINE) if BASELINE else None)
+
+    print('\n{} advisories'.format(ADVISORIES))
+    print('{:<40} {:>10} {:>14}'.format('command', 'median(ms)',
+                                        'baseline(ms)'))
+    for cmd, (secs, base) in results.items():
+        print('{:<40} {:>10.1f} {:>14}'.format(
+            cmd, secs * 1000, '{:.1f}'.format(base * 1000) if base else '-'))
+
+    for cmd, (secs, base) in results.items():
+        # plain upgrade does not take the advisory path
+        if base and cmd.endswith('upgrade') and '--s' in cmd:
+            assert secs <= base * BASELINE_SLACK, cmd
@@ -128,3 +128,46 @@ def test_install_nokey1(utils):
     ret = utils.run(['tdnf', 'install', '-y', pkgname])
     assert ret['retval'] == 1514
     assert not utils.check_package(pkgname)
+
+
+# several packages are verified together, the key is imported only once
+def test_install_multiple_local_key(utils):
+    set_gpgcheck(utils, True)
+    keypath = os.path.join(utils.config['repo_path'], 'photon-test', 'keys', 'pubkey.asc')
+    set_repo_key(utils, 'file://{}'.format(keypath))
+    spkg = utils.config["sglversion_pkgname"]
+    mpkg = utils.config["mulversion_pkgname"]
+    utils.run(['tdnf', 'erase', '-y', mpkg])
+    ret = utils.run(['tdnf', 'install', '-y', spkg, mpkg])
+    assert ret['retval'] == 0
+    assert utils.check_package(spkg)
+    assert utils.check_package(mpkg)
+    output = '\n'.join(ret['stdout'] + ret['stderr'])
+    assert output.count('importing key from') == 1
+    utils.run(['tdnf', 'erase', '-y', mpkg])
+
+
+def find_cached_key(utils):
+    cache_dir = utils.tdnf_config.get('main', 'cachedir')
+    ret = utils.run(['find', cache_dir, '-path', '*/keys/*', '-name', 'pubkey.asc'])
+    return ret['stdout'][0] if ret['stdout'] else None
+
+
+# remote keys are kept in the cache and not fetched again while fresh
+def test_install_remote_key_cached(utils):
+    set_gpgcheck(utils, True)
+    set_repo_key(utils, 'http://localhost:8080/photon-test/keys/pubkey.asc')
+    pkgname = utils.config["sglversion_pkgname"]
+    ret = utils.run(['tdnf', 'install', '-y', pkgname])
+    assert ret['retval'] == 0
+
+    keypath = find_cached_key(utils)
+    assert keypath is not None
+    mtime = os.stat(keypath).st_mtime
+
+    utils.run(['rpm', '-e', '--allmatches', 'gpg-pubkey'])
+    utils.run(['tdnf', 'erase', '-y', pkgname])
+    ret = utils.run(['tdnf', 'install', '-y', pkgname])
+    assert ret['retval'] == 0
+    assert utils.check_package(pkgname)
+    assert os.stat(keypath).st_mtime == mtime
@@ -0,0 +1,116 @@
+#
+# Copyright (C) 2023 VMware, Inc. All Rights Reserved.
+#
+# Licensed under the GNU General Public License v2 (the "License");
+# you may not use this file except in compliance with the License. The terms
+# of the License are located in the COPYING file of this distribution.
+#
+
+import os
+import time
+import fnmatch
+import pytest
+
+# solv cache benchmark: load times with a cold (rebuilt from the repo
+# metadata) and a warm solv cache, and its size on disk, raw and with
+# zstd at a few levels
+RUNS = 5
+LEVELS = [0, 3, 19]
+ZSTD_MAGIC = b'\x28\xb5\x2f\xfd'
+
+
+@pytest.fixture(scope='module', autouse=True)
+def setup_test(utils):
+    yield
+    teardown_test(utils)
+
+
+def teardown_test(utils):
+    utils.edit_config({'solvcache_zstd_level': None})
+    utils.run(['tdnf', 'clean', 'dbcache'])
+
+
+def set_level(utils, level):
+    utils.edit_config({'solvcache_zstd_level': str(level) if level else None})
+
+
+def solvcache_files(utils, reponame='photon-test'):
+    cache_dir = utils.tdnf_config.get('main', 'cachedir')
+    files = []
+    for d in fnmatch.filter(os.listdir(cache_dir), '{}-*'.format(reponame)):
+        solvcache = os.path.join(cache_dir, d, 'solvcache')
+        if os.path.isdir(solvcache):
+            files += [os.path.join(solvcache, f) for f in os.listdir(solvcache)]
+    return files
+
+
+def time_list(utils):
+    start = time.monotonic()
+    ret = utils.run(['tdnf', '-q', 'list', 'available'])
+    assert ret['retval'] == 0
+    return time.monotonic() - start
+
+
+def median(times):
+    times.sort()
+    return times[len(times) // 2]
+
+
+def test_solvcache_zstd(utils):
+    set_level(utils, 3)
+    utils.run(['tdnf', 'clean', 'dbcache'])
+    ret = utils.run(['tdnf', 'makecache'])
+    assert ret['retval'] == 0
+
+    files = solvcache_files(utils)
+    assert any(f.endswith('.solv.zst') for f in files)
+    assert not any(f.endswith('.solv') for f in files)
+    for f in files:
+        with open(f, 'rb') as fp:
+            assert fp.read(4) == ZSTD_MAGIC
+
+    # loaded from the compressed cache
+    ret = utils.run(['tdnf', 'list', utils.config['sglversion_pkgname']])
+    assert ret['retval'] == 0
+    assert len(ret['stdout']) > 0
+
+    # back to raw replaces the compressed file
+    set_level(utils, 0)
+    ret = utils.run(['tdnf', 'list', utils.config['sglversion_pkgname']])
+    assert ret['retval'] == 0
+    files = solvcache_files(utils)
+    assert any(f.endswith('.solv') for f in files)
+    assert not any(f.endswith('.solv.zst') for f in files)
+
+
+def test_solvcache_zstd_invalid_level(utils):
+    utils.edit_config({'solvcache_zstd_level': '42'})
+    try:
+        ret = utils.run(['tdnf', 'repolist'])
+        assert ret['retval'] == 1010
+    finally:
+        set_level(utils, 0)
+
+
+def test_solvcache_benchmark(utils):
+    utils.run(['tdnf', 'makecache'])
+    results = []
+    for level in LEVELS:
+        set_level(utils, level)
+        cold = []
+        warm = []
+        for _ in range(RUNS):
+            utils.run(['tdnf', 'clean', 'dbcache'])
+            cold.append(time_list(utils))
+            warm.append(time_list(utils))
+        size = sum(os.path.getsize(f) for f in solvcache_files(utils))
+        results.append((level, median(cold), median(warm), size))
+    set_level(utils, 0)
+
+    print('\n{:<6} {:>14} {:>14} {:>12}'.format(
+          'level', 'cold(ms)', 'warm(ms)', 'bytes'))
+    for level, cold, warm, size in results:
+        print('{:<6} {:>14.1f} {:>14.1f} {:>12}'.format(
+              level, cold * 1000, warm * 1000, size))
+    # compression has to pay for itself on disk
+    assert results[1][3] < results[0][3]
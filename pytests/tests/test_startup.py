@@ -0,0 +1,114 @@
+#
+# Copyright (C) 2023 VMware, Inc. All Rights Reserved.
+#
+# Licensed under the GNU General Public License v2 (the "License");
+# you may not use this file except in compliance with the License. The terms
+# of the License are located in the COPYING file of this distribution.
+#
+
+import glob
+import os
+import time
+import pytest
+
+# commands that only need the config, the repo definitions or the
+# installed packages must not load repo metadata
+
+REPO_NAME = 'photon-test'
+
+# startup benchmark: commands that only need the config or the
+# repo definitions should not pay for loading the rpmdb and the pool
+RUNS = 5
+
+COMMANDS = [
+    ['help'],
+    ['history', 'list'],
+    ['repolist'],
+    ['clean', 'expire-cache'],
+    ['mark', 'install', '{pkgname}'],
+    ['list', 'installed'],
+    ['makecache'],
+]
+
+
+@pytest.fixture(scope='module', autouse=True)
+def setup_test(utils):
+    utils.run(['tdnf', 'makecache'])
+    utils.run(['tdnf', 'history', 'init'])
+    utils.install_package(utils.config['sglversion_pkgname'])
+    yield
+    teardown_test(utils)
+
+
+def teardown_test(utils):
+    utils.erase_package(utils.config['sglversion_pkgname'])
+    utils.run(['tdnf', 'makecache'])
+
+
+def repomd_exists(utils):
+    cache_dir = utils.tdnf_config.get('main', 'cachedir')
+    pattern = os.path.join(cache_dir, REPO_NAME + '-' + '[0-9a-f]' * 8,
+                           'repodata', 'repomd.xml')
+    return len(glob.glob(pattern)) > 0
+
+
+def clean_metadata(utils):
+    ret = utils.run(['tdnf', 'clean', 'all'])
+    assert ret['retval'] == 0
+    assert not repomd_exists(utils)
+
+
+def time_command(utils, args):
+    times = []
+    for _ in range(RUNS):
+        start = time.monotonic()
+        ret = utils.run(['tdnf', '-q'] + args)
+        times.append(time.monotonic() - start)
+        assert ret['retval'] == 0
+    times.sort()
+    return times[len(times) // 2]
+
+
+def test_startup_benchmark(utils):
+    pkgname = utils.config['sglversion_pkgname']
+    results = {}
+    for args in COMMANDS:
+        args = [arg.format(pkgname=pkgname) for arg in args]
+        results[' '.join(args)] = time_command(utils, args)
+
+    print('\n{:<24} {:>10}'.format('command', 'median(ms)'))
+    for cmd, secs in results.items():
+        print('{:<24} {:>10.1f}'.format(cmd, secs * 1000))
+
+
+def test_history_list_no_repos(utils):
+    # history list needs neither repos nor the pool,
+    # a broken repo config must not get in the way
+    ret = utils.run(['tdnf', 'history', 'list',
+                     '--setopt=reposdir=/nonexistent'])
+    assert ret['retval'] == 0
+
+
+def test_repolist_no_repodata(utils):
+    clean_metadata(utils)
+    ret = utils.run(['tdnf', 'repolist'])
+    assert ret['retval'] == 0
+    assert any(REPO_NAME in line for line in ret['stdout'])
+    assert not repomd_exists(utils)
+
+
+def test_mark_no_repodata(utils):
+    clean_metadata(utils)
+    ret = utils.run(['tdnf', 'mark', 'install',
+                     utils.config['sglversion_pkgname']])
+    assert ret['retval'] == 0
+    assert not repomd_exists(utils)
+
+
+def test_list_loads_repodata(utils):
+    clean_metadata(utils)
+    ret = utils.run(['tdnf', 'repolist'])
+    assert ret['retval'] == 0
+    ret = utils.run(['tdnf', 'list', 'installed'])
+    assert ret['retval'] == 0
+    assert repomd_exists(utils)
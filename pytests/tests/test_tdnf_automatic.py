@@ -8,6 +8,7 @@
 
 import os
 import glob
+import json
 import pytest
 import shutil
 import socket
@@ -171,7 +172,7 @@ def test_tdnf_automatic_rand_sleep(utils):
 def test_tdnf_automatic_refresh_cache(utils):
     ini_load(automatic_conf)
     set_base_conf_and_store(tmp_auto_conf)
-    prepare_and_run_test_cmd(utils, [], 0, 'RefreshCache success')
+    prepare_and_run_test_cmd(utils, [], 0, 'Refreshing metadata')
 
 
 def test_tdnf_automatic_disable_repos_retry(utils):
@@ -220,6 +221,26 @@ def test_emit_to_file(utils):
     glob.glob(emit_file + '*.bak')
 
 
+# a severity no advisory reaches leaves nothing to upgrade
+def test_tdnf_automatic_no_matching_advisory(utils):
+    cleanup_env(utils)
+    pkgname = utils.config["mulversion_pkgname"]
+    pkgversion = utils.config["mulversion_lower"]
+    utils.run(['tdnf', 'install', '-y', pkgname + '-' + pkgversion])
+
+    ini_load(automatic_conf)
+    ini_set('emitter', 'emit_to_stdio', 'yes')
+    ini_set('emitter', 'emit_to_file', emit_file)
+    ini_set('commands', 'upgrade_type', 'security')
+    ini_set('commands', 'sec_severity', '11')
+    ini_set('commands', 'show_updates', 'yes')
+    ini_set('commands', 'apply_updates', 'no')
+    set_base_conf_and_store(tmp_auto_conf)
+    prepare_and_run_test_cmd(utils, [], 0, 'System upto date')
+    with open(emit_file) as f:
+        assert 'System upto date' in f.read()
+
+
 def test_tdnf_automatic_show_updates(utils):
     cleanup_env(utils)
     pkgname = utils.config["mulversion_pkgname"]
@@ -289,3 +310,37 @@ def test_tdnf_automatic_hostname(utils):
         prepare_and_run_test_cmd(utils, [], 0, 'The following updates are available on - ' + i)
         with open(emit_file) as f:
             assert i in f.read()
+
+
+# the native command, with the json result on stdout and in the file
+def test_tdnf_automatic_json(utils):
+    cleanup_env(utils)
+    pkgname = utils.config["mulversion_pkgname"]
+    pkgversion = utils.config["mulversion_lower"]
+    utils.run(['tdnf', 'install', '-y', pkgname + '-' + pkgversion])
+
+    ini_load(automatic_conf)
+    ini_set('emitter', 'emit_to_file', emit_file)
+    ini_set('commands', 'show_updates', 'yes')
+    ini_set('commands', 'apply_updates', 'no')
+    set_base_conf_and_store(tmp_auto_conf)
+    ret = utils.run(['tdnf', '-j', 'automatic', '--autoconf=' + tmp_auto_conf])
+    assert ret['retval'] == 0
+    result = json.loads("\n".join(ret['stdout']))
+    assert result['Status'] == 'available'
+    assert pkgname in [pkg['Name'] for pkg in result['Updates']]
+    with open(emit_file) as f:
+        assert json.load(f)['Status'] == 'available'
+    assert utils.check_package(pkgname, pkgversion)
+
+
+# the native command keeps the tdnf error codes, the script
+# gets the codes of the former script from it
+def test_tdnf_automatic_legacy_exit_codes(utils):
+    ret = utils.run(['tdnf', 'automatic', '--autoconf=/badpath/badfile.conf'])
+    assert ret['retval'] == 1602
+
+    ret = run_test_cmd(utils, ['tdnf', 'automatic', '--legacy-exit-codes',
+                               '--autoconf=/badpath/badfile.conf'])
+    assert ret['retval'] == 2
+    assert not any(line.startswith('Error(') for line in ret['stderr'])
@@ -0,0 +1,88 @@
+#
+# Copyright (C) 2023 VMware, Inc. All Rights Reserved.
+#
+# Licensed under the GNU General Public License v2 (the "License");
+# you may not use this file except in compliance with the License. The terms
+# of the License are located in the COPYING file of this distribution.
+#
+
+import os
+import pytest
+
+
+@pytest.fixture(scope='module', autouse=True)
+def setup_test(utils):
+    yield
+    teardown_test(utils)
+
+
+def teardown_test(utils):
+    mpkg = utils.config['mulversion_pkgname']
+    utils.run(['tdnf', 'erase', '-y', mpkg])
+
+
+def summary_path(utils):
+    return os.path.join(utils.tdnf_config.get('main', 'cachedir'),
+                        'resultcache', 'update-summary.cache')
+
+
+def install_lower(utils):
+    mpkg = utils.config['mulversion_pkgname']
+    pkg = mpkg + '-' + utils.config['mulversion_lower']
+    ret = utils.run(['tdnf', 'install', '-y', '--nogpgcheck', pkg])
+    assert ret['retval'] == 0
+
+
+def test_makecache_writes_summary(utils):
+    install_lower(utils)
+    ret = utils.run(['tdnf', 'makecache'])
+    assert ret['retval'] == 0
+    path = summary_path(utils)
+    assert os.path.isfile(path)
+    with open(path) as f:
+        lines = f.read().splitlines()
+    assert lines[0].startswith('tdnf-result-cache ')
+    assert lines[1].startswith('generated\t')
+    assert lines[2].startswith('count\t')
+
+
+def test_check_update_cached(utils):
+    mpkg = utils.config['mulversion_pkgname']
+    install_lower(utils)
+    utils.run(['tdnf', 'makecache'])
+
+    ret = utils.run(['tdnf', 'check-update'])
+    ret_cached = utils.run(['tdnf', '--cached', 'check-update'])
+    assert ret_cached['retval'] == ret['retval']
+    assert ret_cached['stdout'] == ret['stdout']
+    assert mpkg in '\n'.join(ret_cached['stdout'])
+
+
+def test_updateinfo_cached(utils):
+    install_lower(utils)
+    utils.run(['tdnf', 'makecache'])
+
+    for opts in [[], ['--security'], ['--sec-severity', '5.0']]:
+        ret = utils.run(['tdnf'] + opts + ['updateinfo'])
+        ret_cached = utils.run(['tdnf', '--cached'] + opts + ['updateinfo'])
+        assert ret_cached['retval'] == ret['retval']
+        assert ret_cached['stdout'] == ret['stdout']
+
+
+def test_cached_follows_rpmdb(utils):
+    mpkg = utils.config['mulversion_pkgname']
+    install_lower(utils)
+    utils.run(['tdnf', 'makecache'])
+
+    # summary is stale after the upgrade, and recomputed
+    utils.run(['tdnf', 'upgrade', '-y', '--nogpgcheck', mpkg])
+    ret = utils.run(['tdnf', '--cached', 'check-update'])
+    assert mpkg not in '\n'.join(ret['stdout'])
+
+
+def test_cached_without_summary(utils):
+    utils.run(['tdnf', 'clean', 'dbcache'])
+    assert not os.path.exists(summary_path(utils))
+    ret = utils.run(['tdnf', '--cached', 'check-update'])
+    assert ret['retval'] == 0
+    assert os.path.isfile(summary_path(utils))
@@ -5,6 +5,7 @@
 #define CMDLINE_REPO_NAME "@cmdline"
 #define SOLV_COOKIE_IDENT "tdnf"
 #define TDNF_SOLVCACHE_DIR_NAME "solvcache"
+#define TDNF_SOLVCACHE_ZSTD_EXT ".zst"
 #define SOLV_COOKIE_LEN   32
 
 #define SOLV_NEVRA_UNINSTALLED 0
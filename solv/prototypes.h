@@ -47,6 +47,7 @@ typedef struct _SOLV_REPO_INFO_INTERNAL_
     unsigned char cookie[SOLV_COOKIE_LEN];
     int           nCookieSet;
     char          *pszRepoCacheDir;
+    int           nZstdLevel;    //compress the solv cache, 0 for raw
 }SOLV_REPO_INFO_INTERNAL, *PSOLV_REPO_INFO_INTERNAL;
 
 extern Id allDepKeyIds[];
@@ -261,6 +262,20 @@ SolvFindHighestAvailable(
     Id* pdwId
     );
 
+uint32_t
+SolvFindBestAvailableId(
+    PSolvSack pSack,
+    Id idName,
+    Id* pdwId
+    );
+
+uint32_t
+SolvFindHighestInstalledId(
+    PSolvSack pSack,
+    Id idName,
+    Id* pdwId
+    );
+
 uint32_t
 SolvFindLowestInstalled(
     PSolvSack pSack,
@@ -357,6 +372,12 @@ SolvInitSack(
     const char* pszRootDir
 );
 
+uint32_t
+SolvSetRootDir(
+    PSolvSack pSack,
+    const char* pszRootDir
+    );
+
 // tdnfquery.c
 uint32_t
 SolvCreateQuery(
@@ -643,6 +664,27 @@ SolvRequiresFromQueue(
     Queue *pq_deps   /* string ids */
 );
 
+// tdnfzstd.c
+uint32_t
+SolvZstdOpenWrite(
+    FILE *fp,
+    int nLevel,
+    FILE **ppZFile
+    );
+
+uint32_t
+SolvZstdOpenRead(
+    FILE *fp,
+    FILE **ppZFile
+    );
+
+uint32_t
+SolvZstdWriteSkippable(
+    FILE *fp,
+    const void *pData,
+    uint32_t dwSize
+    );
+
 #ifdef __cplusplus
 }
 #endif
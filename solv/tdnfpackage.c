@@ -1385,19 +1385,45 @@ SolvFindBestAvailable(
     )
 {
     uint32_t dwError = 0;
+
+    if(!pSack || IsNullOrEmptyString(pszPkgName) || !pdwId)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    dwError = SolvFindBestAvailableId(
+                  pSack,
+                  pool_str2id(pSack->pPool, pszPkgName, 1),
+                  pdwId);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+cleanup:
+    return dwError;
+error:
+    goto cleanup;
+}
+
+//SolvFindBestAvailable() for a name that is an id of the pool already
+uint32_t
+SolvFindBestAvailableId(
+    PSolvSack pSack,
+    Id idName,
+    Id* pdwId
+    )
+{
+    uint32_t dwError = 0;
     Pool *pool; /* FOR_PROVIDES needs this name */
-    Id idName;
     Id p, pp;
     Queue q = {0};
 
-    if(!pSack || IsNullOrEmptyString(pszPkgName) || !pdwId)
+    if(!pSack || !idName || !pdwId)
     {
         dwError = ERROR_TDNF_INVALID_PARAMETER;
         BAIL_ON_TDNF_ERROR(dwError);
     }
 
     pool = pSack->pPool;
-    idName = pool_str2id(pool, pszPkgName, 1);
 
     queue_init(&q);
 
@@ -1488,6 +1514,57 @@ error:
     goto cleanup;
 }
 
+//highest installed version of idName, without a query
+uint32_t
+SolvFindHighestInstalledId(
+    PSolvSack pSack,
+    Id idName,
+    Id* pdwId
+    )
+{
+    uint32_t dwError = 0;
+    Pool *pool; /* FOR_PROVIDES needs this name */
+    Id p, pp;
+    Id dwHighest = 0;
+
+    if(!pSack || !idName || !pdwId)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    pool = pSack->pPool;
+
+    FOR_PROVIDES(p, pp, idName)
+    {
+        Solvable *pSolv = pool_id2solvable(pool, p);
+
+        if (pSolv->name != idName || pSolv->repo != pool->installed)
+        {
+            continue;
+        }
+        if (!dwHighest ||
+            pool_evrcmp(pool, pSolv->evr,
+                        pool_id2solvable(pool, dwHighest)->evr,
+                        EVRCMP_COMPARE) > 0)
+        {
+            dwHighest = p;
+        }
+    }
+    if (!dwHighest)
+    {
+        dwError = ERROR_TDNF_NO_MATCH;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    *pdwId = dwHighest;
+
+cleanup:
+    return dwError;
+error:
+    goto cleanup;
+}
+
 uint32_t
 SolvFindLowestInstalled(
     PSolvSack pSack,
@@ -180,3 +180,62 @@ error:
     }
     goto cleanup;
 }
+
+/*
+ * Point the sack to another root. The installed repo is replaced by
+ * an empty one, the caller reads the rpmdb of the new root into it.
+ * The available repos stay loaded. The whatprovides index has to be
+ * built again, and the considered map is dropped since it does not
+ * cover the new solvables, goals apply the excludes again.
+ */
+uint32_t
+SolvSetRootDir(
+    PSolvSack pSack,
+    const char* pszRootDir
+    )
+{
+    uint32_t dwError = 0;
+    Pool* pPool = NULL;
+    Repo *pRepo = NULL;
+    char *pszRootDirNew = NULL;
+
+    if(!pSack || !pSack->pPool || IsNullOrEmptyString(pszRootDir))
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+    pPool = pSack->pPool;
+
+    dwError = TDNFAllocateString(pszRootDir, &pszRootDirNew);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    if (pPool->installed)
+    {
+        repo_free(pPool->installed, 1);
+    }
+    if (pPool->considered)
+    {
+        map_free(pPool->considered);
+        TDNF_SAFE_FREE_MEMORY(pPool->considered);
+    }
+
+    pool_set_rootdir(pPool, pszRootDir);
+    TDNF_SAFE_FREE_MEMORY(pSack->pszRootDir);
+    pSack->pszRootDir = pszRootDirNew;
+    pszRootDirNew = NULL;
+
+    pRepo = repo_create(pPool, SYSTEM_REPO_NAME);
+    if(pRepo == NULL)
+    {
+       dwError = ERROR_TDNF_INVALID_PARAMETER;
+       BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+    }
+    pool_set_installed(pPool, pRepo);
+
+cleanup:
+    TDNF_SAFE_FREE_MEMORY(pszRootDirNew);
+    return dwError;
+
+error:
+    goto cleanup;
+}
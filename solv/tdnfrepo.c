@@ -516,10 +516,12 @@ SolvGetMetaDataCachePath(
     {
         dwError = TDNFAllocateStringPrintf(
                       &pszCachePath,
-                      "%s/%s/%s.solv",
+                      "%s/%s/%s.solv%s",
                       pSolvRepoInfo->pszRepoCacheDir,
                       TDNF_SOLVCACHE_DIR_NAME,
-                      pRepo->name);
+                      pRepo->name,
+                      pSolvRepoInfo->nZstdLevel > 0 ?
+                          TDNF_SOLVCACHE_ZSTD_EXT : "");
         BAIL_ON_TDNF_ERROR(dwError);
     }
     *ppszCachePath = pszCachePath;
@@ -539,6 +541,7 @@ SolvAddSolvMetaData(
     uint32_t dwError = 0;
     Repo *pRepo = NULL;
     FILE *fp = NULL;
+    FILE *pZFile = NULL;
     int i = 0;
 
     if (!pSolvRepoInfo || !pSolvRepoInfo->pRepo || !pszTempSolvFile)
@@ -571,14 +574,23 @@ SolvAddSolvMetaData(
         dwError = errno;
         BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
     }
+    if (pSolvRepoInfo->nZstdLevel > 0)
+    {
+        dwError = SolvZstdOpenRead(fp, &pZFile);
+        BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+    }
     repo_empty(pRepo, 1);
-    if (repo_add_solv(pRepo, fp, SOLV_ADD_NO_STUBS))
+    if (repo_add_solv(pRepo, pZFile ? pZFile : fp, SOLV_ADD_NO_STUBS))
     {
         dwError = ERROR_TDNF_ADD_SOLV;
         BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
     }
 
 cleanup:
+    if (pZFile != NULL)
+    {
+        fclose(pZFile);
+    }
     if (fp != NULL)
     {
         fclose(fp);
@@ -597,6 +609,7 @@ SolvUseMetaDataCache(
 {
     uint32_t dwError = 0;
     FILE *fp = NULL;
+    FILE *pZFile = NULL;
     Repo *pRepo = NULL;
     unsigned char *pszCookie = NULL;
     unsigned char pszTempCookie[32];
@@ -637,7 +650,13 @@ SolvUseMetaDataCache(
         BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
     }
     rewind(fp);
-    if (repo_add_solv(pRepo, fp, 0))
+    /* the cookie is outside of the zstd frame, see SolvCreateMetaDataCache */
+    if (pSolvRepoInfo->nZstdLevel > 0)
+    {
+        dwError = SolvZstdOpenRead(fp, &pZFile);
+        BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+    }
+    if (repo_add_solv(pRepo, pZFile ? pZFile : fp, 0))
     {
         dwError = ERROR_TDNF_ADD_SOLV;
         BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
@@ -645,6 +664,10 @@ SolvUseMetaDataCache(
     *nUseMetaDataCache = 1;
 
 cleanup:
+    if (pZFile != NULL)
+    {
+       fclose(pZFile);
+    }
     if (fp != NULL)
     {
        fclose(fp);
@@ -668,10 +691,12 @@ SolvCreateMetaDataCache(
     uint32_t dwError = 0;
     Repo *pRepo = NULL;
     FILE *fp = NULL;
+    FILE *pZFile = NULL;
     int fd = 0;
     char *pszSolvCacheDir = NULL;
     char *pszTempSolvFile = NULL;
     char *pszCacheFilePath = NULL;
+    char *pszOtherFilePath = NULL;
     mode_t mask = 0;
 
     if (!pSack || !pSolvRepoInfo)
@@ -720,15 +745,41 @@ SolvCreateMetaDataCache(
         dwError = ERROR_TDNF_SOLV_IO;
         BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
     }
-    if (repo_write(pRepo, fp))
+    if (pSolvRepoInfo->nZstdLevel > 0)
+    {
+        dwError = SolvZstdOpenWrite(fp, pSolvRepoInfo->nZstdLevel, &pZFile);
+        BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+    }
+    if (repo_write(pRepo, pZFile ? pZFile : fp))
     {
         dwError = ERROR_TDNF_REPO_WRITE;
         BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
     }
 
+    if (pZFile)
+    {
+        /* ends the zstd frame */
+        if (fclose(pZFile))
+        {
+            pZFile = NULL;
+            dwError = ERROR_TDNF_SOLV_IO;
+            BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+        }
+        pZFile = NULL;
+    }
+
+    /* the cookie stays the last bytes of the file, for compressed
+       caches in a skippable frame, so SolvUseMetaDataCache() can
+       check it without decompressing */
     if (pSolvRepoInfo->nCookieSet)
     {
-        if (fwrite(pSolvRepoInfo->cookie, SOLV_COOKIE_LEN, 1, fp) != 1)
+        if (pSolvRepoInfo->nZstdLevel > 0)
+        {
+            dwError = SolvZstdWriteSkippable(fp, pSolvRepoInfo->cookie,
+                                             SOLV_COOKIE_LEN);
+            BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+        }
+        else if (fwrite(pSolvRepoInfo->cookie, SOLV_COOKIE_LEN, 1, fp) != 1)
         {
             dwError = ERROR_TDNF_SOLV_IO;
             BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
@@ -760,12 +811,35 @@ SolvCreateMetaDataCache(
         BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
     }
     unlink(pszTempSolvFile);
+
+    /* drop a cache in the other format, compression may have been
+       switched on or off */
+    if (pSolvRepoInfo->nZstdLevel > 0)
+    {
+        dwError = TDNFAllocateString(pszCacheFilePath, &pszOtherFilePath);
+        BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+        pszOtherFilePath[strlen(pszOtherFilePath) -
+                         strlen(TDNF_SOLVCACHE_ZSTD_EXT)] = '\0';
+    }
+    else
+    {
+        dwError = TDNFAllocateStringPrintf(&pszOtherFilePath, "%s%s",
+                                           pszCacheFilePath,
+                                           TDNF_SOLVCACHE_ZSTD_EXT);
+        BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+    }
+    unlink(pszOtherFilePath);
 cleanup:
     TDNF_SAFE_FREE_MEMORY(pszTempSolvFile);
     TDNF_SAFE_FREE_MEMORY(pszSolvCacheDir);
     TDNF_SAFE_FREE_MEMORY(pszCacheFilePath);
+    TDNF_SAFE_FREE_MEMORY(pszOtherFilePath);
     return dwError;
 error:
+    if (pZFile != NULL)
+    {
+        fclose(pZFile);
+    }
     if (fp != NULL)
     {
         fclose(fp);
@@ -0,0 +1,311 @@
+/*
+ * Copyright (C) 2023 VMware, Inc. All Rights Reserved.
+ *
+ * Licensed under the GNU Lesser General Public License v2.1 (the "License");
+ * you may not use this file except in compliance with the License. The terms
+ * of the License are located in the COPYING file of this distribution.
+ */
+
+/*
+ * zstd streams for the solv cache. repo_write() and repo_add_solv()
+ * work on a FILE, so the (de)compression is a stdio cookie on top of
+ * the FILE of the cache file. The wrapped FILE is not closed with the
+ * stream, the solv cache appends its cookie to it after the zstd frame
+ * as a skippable frame. solv_xfopen() can read these files as well,
+ * but cannot set the compression level when writing.
+ */
+
+#define _GNU_SOURCE 1
+#include "includes.h"
+#include <string.h>
+#include <zstd.h>
+
+typedef struct _SOLV_ZSTD_FILE
+{
+    FILE *fp;               //the file, not owned
+    ZSTD_CCtx *pCCtx;       //when writing
+    ZSTD_DCtx *pDCtx;       //when reading
+    void *pBuf;
+    size_t nBufSize;
+    ZSTD_inBuffer stIn;     //when reading, what is left of pBuf
+    int nError;
+} SOLV_ZSTD_FILE, *PSOLV_ZSTD_FILE;
+
+static
+void
+_SolvZstdFree(
+    PSOLV_ZSTD_FILE pZFile
+    )
+{
+    if (pZFile)
+    {
+        ZSTD_freeCCtx(pZFile->pCCtx);
+        ZSTD_freeDCtx(pZFile->pDCtx);
+        free(pZFile->pBuf);
+        free(pZFile);
+    }
+}
+
+static
+ssize_t
+_SolvZstdWrite(
+    void *pCookie,
+    const char *pBuf,
+    size_t nSize
+    )
+{
+    PSOLV_ZSTD_FILE pZFile = pCookie;
+    ZSTD_inBuffer stIn = {pBuf, nSize, 0};
+    ZSTD_outBuffer stOut;
+    size_t nRet;
+
+    while (stIn.pos < stIn.size)
+    {
+        stOut.dst = pZFile->pBuf;
+        stOut.size = pZFile->nBufSize;
+        stOut.pos = 0;
+        nRet = ZSTD_compressStream2(pZFile->pCCtx, &stOut, &stIn,
+                                    ZSTD_e_continue);
+        if (ZSTD_isError(nRet) ||
+            fwrite(pZFile->pBuf, 1, stOut.pos, pZFile->fp) != stOut.pos)
+        {
+            pZFile->nError = 1;
+            return -1;
+        }
+    }
+    return nSize;
+}
+
+static
+ssize_t
+_SolvZstdRead(
+    void *pCookie,
+    char *pBuf,
+    size_t nSize
+    )
+{
+    PSOLV_ZSTD_FILE pZFile = pCookie;
+    ZSTD_outBuffer stOut = {pBuf, nSize, 0};
+    size_t nRet;
+    size_t nRead;
+
+    while (stOut.pos == 0)
+    {
+        if (pZFile->stIn.pos == pZFile->stIn.size)
+        {
+            nRead = fread(pZFile->pBuf, 1, pZFile->nBufSize, pZFile->fp);
+            if (nRead == 0)
+            {
+                break;
+            }
+            pZFile->stIn.src = pZFile->pBuf;
+            pZFile->stIn.size = nRead;
+            pZFile->stIn.pos = 0;
+        }
+        nRet = ZSTD_decompressStream(pZFile->pDCtx, &stOut, &pZFile->stIn);
+        if (ZSTD_isError(nRet))
+        {
+            return -1;
+        }
+    }
+    return stOut.pos;
+}
+
+/* end the frame when writing, the wrapped FILE stays open */
+static
+int
+_SolvZstdClose(
+    void *pCookie
+    )
+{
+    PSOLV_ZSTD_FILE pZFile = pCookie;
+    ZSTD_inBuffer stIn = {NULL, 0, 0};
+    ZSTD_outBuffer stOut;
+    size_t nRet = 1;
+    int nError = 0;
+
+    if (pZFile->pCCtx)
+    {
+        nError = pZFile->nError;
+        while (!nError && nRet != 0)
+        {
+            stOut.dst = pZFile->pBuf;
+            stOut.size = pZFile->nBufSize;
+            stOut.pos = 0;
+            nRet = ZSTD_compressStream2(pZFile->pCCtx, &stOut, &stIn,
+                                        ZSTD_e_end);
+            if (ZSTD_isError(nRet) ||
+                fwrite(pZFile->pBuf, 1, stOut.pos, pZFile->fp) != stOut.pos)
+            {
+                nError = 1;
+            }
+        }
+    }
+    _SolvZstdFree(pZFile);
+    return nError ? EOF : 0;
+}
+
+/*
+ * Open a stream that writes zstd with level nLevel to fp.
+ * Closing the stream ends the frame, fp has to be closed after.
+ */
+uint32_t
+SolvZstdOpenWrite(
+    FILE *fp,
+    int nLevel,
+    FILE **ppZFile
+    )
+{
+    uint32_t dwError = 0;
+    PSOLV_ZSTD_FILE pZFile = NULL;
+    cookie_io_functions_t stFuncs = {
+        .write = _SolvZstdWrite,
+        .close = _SolvZstdClose,
+    };
+    FILE *pZFp = NULL;
+
+    if (!fp || !ppZFile)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    pZFile = calloc(1, sizeof(*pZFile));
+    if (!pZFile)
+    {
+        dwError = ERROR_TDNF_OUT_OF_MEMORY;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+    pZFile->fp = fp;
+    pZFile->nBufSize = ZSTD_CStreamOutSize();
+    pZFile->pBuf = malloc(pZFile->nBufSize);
+    pZFile->pCCtx = ZSTD_createCCtx();
+    if (!pZFile->pBuf || !pZFile->pCCtx)
+    {
+        dwError = ERROR_TDNF_OUT_OF_MEMORY;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+    if (ZSTD_isError(ZSTD_CCtx_setParameter(pZFile->pCCtx,
+                                            ZSTD_c_compressionLevel,
+                                            nLevel)))
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    pZFp = fopencookie(pZFile, "w", stFuncs);
+    if (!pZFp)
+    {
+        dwError = ERROR_TDNF_SOLV_IO;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+    *ppZFile = pZFp;
+
+cleanup:
+    return dwError;
+
+error:
+    _SolvZstdFree(pZFile);
+    goto cleanup;
+}
+
+/*
+ * Open a stream that reads the zstd frames of fp from its current
+ * position. Skippable frames are skipped. fp has to be closed after
+ * the stream.
+ */
+uint32_t
+SolvZstdOpenRead(
+    FILE *fp,
+    FILE **ppZFile
+    )
+{
+    uint32_t dwError = 0;
+    PSOLV_ZSTD_FILE pZFile = NULL;
+    cookie_io_functions_t stFuncs = {
+        .read = _SolvZstdRead,
+        .close = _SolvZstdClose,
+    };
+    FILE *pZFp = NULL;
+
+    if (!fp || !ppZFile)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    pZFile = calloc(1, sizeof(*pZFile));
+    if (!pZFile)
+    {
+        dwError = ERROR_TDNF_OUT_OF_MEMORY;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+    pZFile->fp = fp;
+    pZFile->nBufSize = ZSTD_DStreamInSize();
+    pZFile->pBuf = malloc(pZFile->nBufSize);
+    pZFile->pDCtx = ZSTD_createDCtx();
+    if (!pZFile->pBuf || !pZFile->pDCtx)
+    {
+        dwError = ERROR_TDNF_OUT_OF_MEMORY;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    pZFp = fopencookie(pZFile, "r", stFuncs);
+    if (!pZFp)
+    {
+        dwError = ERROR_TDNF_SOLV_IO;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+    *ppZFile = pZFp;
+
+cleanup:
+    return dwError;
+
+error:
+    _SolvZstdFree(pZFile);
+    goto cleanup;
+}
+
+/*
+ * Append data to fp as a zstd skippable frame, decoders pass over it.
+ * The solv cache keeps its cookie there, so the last bytes of the
+ * file are the cookie as with an uncompressed cache.
+ */
+uint32_t
+SolvZstdWriteSkippable(
+    FILE *fp,
+    const void *pData,
+    uint32_t dwSize
+    )
+{
+    uint32_t dwError = 0;
+    unsigned char szHeader[8];
+    uint32_t dwMagic = ZSTD_MAGIC_SKIPPABLE_START;
+    int i;
+
+    if (!fp || !pData)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    /* both little endian */
+    for (i = 0; i < 4; i++)
+    {
+        szHeader[i] = (dwMagic >> (8 * i)) & 0xff;
+        szHeader[4 + i] = (dwSize >> (8 * i)) & 0xff;
+    }
+
+    if (fwrite(szHeader, sizeof(szHeader), 1, fp) != 1 ||
+        fwrite(pData, dwSize, 1, fp) != 1)
+    {
+        dwError = ERROR_TDNF_SOLV_IO;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+cleanup:
+    return dwError;
+
+error:
+    goto cleanup;
+}
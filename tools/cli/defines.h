@@ -32,6 +32,12 @@
         }                                                          \
     } while(0)
 
+#define CMDLINE_REPO_NAME "@cmdline"
+
+#define TDNF_AUTOMATIC_CONF_FILE    "/etc/tdnf/automatic.conf"
+//seconds between tries to reach the repos
+#define TDNF_AUTOMATIC_RETRY_SECS   3
+
 #define TDNF_CLI_ERROR_TABLE \
 { \
     {ERROR_TDNF_CLI_BASE,                    "ERROR_TDNF_CLI_BASE",                   "Generic base error."}, \
@@ -52,4 +58,6 @@
     {ERROR_TDNF_CLI_ALLDEPS_REQUIRES_DOWNLOADONLY, "ERROR_TDNF_CLI_ALLDEPS_REQUIRES_DOWNLOADONLY", "--alldeps requires --downloadonly"}, \
     {ERROR_TDNF_CLI_NODEPS_REQUIRES_DOWNLOADONLY, "ERROR_TDNF_CLI_NODEPS_REQUIRES_DOWNLOADONLY", "--nodeps requires --downloadonly"}, \
     {ERROR_TDNF_CLI_INVALID_MIXED_QUERY_QUERYFORMAT, "ERROR_TDNF_CLI_INVALID_MIXED_QUERY_QUERYFORMAT", "--qf requires only querytags. Invalid Mixed Query"}, \
+    {ERROR_TDNF_CLI_AUTOMATIC_CONF,          "ERROR_TDNF_CLI_AUTOMATIC_CONF",         "Invalid entry in the tdnf automatic configuration."}, \
+    {ERROR_TDNF_CLI_AUTOMATIC_OFFLINE,       "ERROR_TDNF_CLI_AUTOMATIC_OFFLINE",      "System is off-line, no repository could be reached."}, \
 };
@@ -142,6 +142,7 @@ TDNFCliListPackagesPrint(
     #define MAX_COL_LEN 256
     char szNameAndArch[MAX_COL_LEN] = {0};
     char szVersionAndRelease[MAX_COL_LEN] = {0};
+    char szRepo[MAX_COL_LEN] = {0};
 
     #define LIST_COL_COUNT 3
     //Name.Arch | Version-Release | Repo
@@ -167,6 +168,10 @@ TDNFCliListPackagesPrint(
             CHECK_JD_RC(jd_map_add_string(jd_pkg, "Arch", pPkg->pszArch));
             CHECK_JD_RC(jd_map_add_fmt(jd_pkg, "Evr", "%s-%s", pPkg->pszVersion, pPkg->pszRelease));
             CHECK_JD_RC(jd_map_add_string(jd_pkg, "Repo", pPkg->pszRepoName));
+            if (pPkg->nStale)
+            {
+                CHECK_JD_RC(jd_map_add_bool(jd_pkg, "Stale", 1));
+            }
 
             CHECK_JD_RC(jd_list_add_child(jd, jd_pkg));
             JD_SAFE_DESTROY(jd_pkg);
@@ -207,6 +212,18 @@ TDNFCliListPackagesPrint(
                 BAIL_ON_CLI_ERROR(dwError);
             }
 
+            memset(szRepo, 0, MAX_COL_LEN);
+            if(snprintf(
+                szRepo,
+                MAX_COL_LEN,
+                "%s%s",
+                pPkg->pszRepoName,
+                pPkg->nStale ? " (stale)" : "") < 0)
+            {
+                dwError = errno;
+                BAIL_ON_CLI_ERROR(dwError);
+            }
+
             pr_crit(
                 "%-*s %-*s %*s\n",
                 nColWidths[0],
@@ -214,7 +231,7 @@ TDNFCliListPackagesPrint(
                 nColWidths[1],
                 szVersionAndRelease,
                 nColWidths[2],
-                pPkg->pszRepoName);
+                szRepo);
         }
     }
 
@@ -328,6 +345,10 @@ TDNFCliInfoCommand(
             CHECK_JD_RC(jd_map_add_string(jd_pkg, "Arch", pPkg->pszArch));
             CHECK_JD_RC(jd_map_add_fmt(jd_pkg, "Evr", "%s-%s", pPkg->pszVersion, pPkg->pszRelease));
             CHECK_JD_RC(jd_map_add_string(jd_pkg, "Repo", pPkg->pszRepoName));
+            if (pPkg->nStale)
+            {
+                CHECK_JD_RC(jd_map_add_bool(jd_pkg, "Stale", 1));
+            }
             CHECK_JD_RC(jd_map_add_string(jd_pkg, "Url", pPkg->pszURL));
             CHECK_JD_RC(jd_map_add_int(jd_pkg, "InstallSize", pPkg->dwInstallSizeBytes));
             if (pPkg->dwDownloadSizeBytes)
@@ -360,7 +381,8 @@ TDNFCliInfoCommand(
             {
                 pr_crit("Download Size  : %s (%u)\n", pPkg->pszFormattedDownloadSize, pPkg->dwDownloadSizeBytes);
             }
-            pr_crit("Repo          : %s\n", pPkg->pszRepoName);
+            pr_crit("Repo          : %s%s\n", pPkg->pszRepoName,
+                    pPkg->nStale ? " (stale)" : "");
             pr_crit("Summary       : %s\n", pPkg->pszSummary);
             pr_crit("URL           : %s\n", pPkg->pszURL);
             pr_crit("License       : %s\n", pPkg->pszLicense);
@@ -985,6 +1007,10 @@ TDNFCliRepoQueryCommand(
             CHECK_JD_RC(jd_map_add_string(jd_pkg, "Arch", pPkgInfo->pszArch));
             CHECK_JD_RC(jd_map_add_fmt(jd_pkg, "Evr", "%s-%s", pPkgInfo->pszVersion, pPkgInfo->pszRelease));
             CHECK_JD_RC(jd_map_add_string(jd_pkg, "Repo", pPkgInfo->pszRepoName));
+            if (pPkgInfo->nStale)
+            {
+                CHECK_JD_RC(jd_map_add_bool(jd_pkg, "Stale", 1));
+            }
 
             if (pPkgInfo->ppszFileList)
             {
@@ -1225,7 +1251,8 @@ TDNFCliCheckUpdateCommand(
         for(dwIndex = 0; dwIndex < dwCount; ++dwIndex)
         {
             pPkg = &pPkgInfo[dwIndex];
-            pr_crit("%*s\r", 80, pPkg->pszRepoName);
+            pr_crit("%*s%s\r", pPkg->nStale ? 72 : 80, pPkg->pszRepoName,
+                    pPkg->nStale ? " (stale)" : "");
             pr_crit("%*s-%s\r", 50, pPkg->pszVersion, pPkg->pszRelease);
             pr_crit("%s.%s", pPkg->pszName, pPkg->pszArch);
             pr_crit("\n");
@@ -1261,6 +1288,8 @@ TDNFCliMakeCacheCommand(
     )
 {
     uint32_t dwError = 0;
+    PTDNF_CMD_OPT pSetOpt = NULL;
+    int nPrefetch = 0;
 
     if(!pContext || !pContext->hTdnf || !pCmdArgs)
     {
@@ -1268,11 +1297,32 @@ TDNFCliMakeCacheCommand(
         BAIL_ON_CLI_ERROR(dwError);
     }
 
+    for (pSetOpt = pCmdArgs->pSetOpt; pSetOpt; pSetOpt = pSetOpt->pNext)
+    {
+        if (strcasecmp(pSetOpt->pszOptName, "prefetch") == 0)
+        {
+            nPrefetch = 1;
+        }
+    }
+
     dwError = TDNFCliRefresh(pContext);
     BAIL_ON_CLI_ERROR(dwError);
 
+    /* used by check-update and updateinfo with --cached. They
+       compute it themselves if missing, so this is not fatal */
+    if (TDNFCacheUpdateSummary(pContext->hTdnf))
+    {
+        pr_info("Update summary not cached.\n");
+    }
+
     pr_crit("Metadata cache created.\n");
 
+    if (nPrefetch)
+    {
+        dwError = pContext->pFnPrefetch(pContext);
+        BAIL_ON_CLI_ERROR(dwError);
+    }
+
 cleanup:
     return dwError;
 
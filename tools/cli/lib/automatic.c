@@ -0,0 +1,934 @@
+/*
+ * Copyright (C) 2023 VMware, Inc. All Rights Reserved.
+ *
+ * Licensed under the GNU General Public License v2 (the "License");
+ * you may not use this file except in compliance with the License. The terms
+ * of the License are located in the COPYING file of this distribution.
+ */
+
+/*
+ * tdnf automatic: refresh the metadata, find the upgrades allowed
+ * by automatic.conf, optionally download or apply them and report
+ * the result, all with one handle and one metadata load.
+ */
+
+#include "includes.h"
+#include <time.h>
+#include <sys/stat.h>
+
+#include "../../../llconf/nodes.h"
+#include "../../../llconf/modules.h"
+#include "../../../llconf/entry.h"
+#include "../../../llconf/ini.h"
+
+typedef struct _TDNF_AUTOMATIC_CONF
+{
+    int nUpgradeSecurity;
+    char *pszSeverity;
+    int nRebootRequired;
+    int nRandomSleep;
+    int nNetworkTimeout;
+    int nShowUpdates;
+    int nApplyUpdates;
+    int nDownloadUpdates;
+    int nEmitToStdio;
+    char *pszEmitFile;
+    char *pszSystemName;
+    char *pszTdnfConf;
+} TDNF_AUTOMATIC_CONF, *PTDNF_AUTOMATIC_CONF;
+
+static
+void
+_AutomaticFreeConf(
+    PTDNF_AUTOMATIC_CONF pConf
+    )
+{
+    if (pConf)
+    {
+        TDNF_CLI_SAFE_FREE_MEMORY(pConf->pszSeverity);
+        TDNF_CLI_SAFE_FREE_MEMORY(pConf->pszEmitFile);
+        TDNF_CLI_SAFE_FREE_MEMORY(pConf->pszSystemName);
+        TDNF_CLI_SAFE_FREE_MEMORY(pConf->pszTdnfConf);
+        TDNFFreeMemory(pConf);
+    }
+}
+
+/* same spellings the tdnf-automatic script accepted */
+static
+uint32_t
+_AutomaticParseBool(
+    const char *pszKey,
+    const char *pszValue,
+    int *pnValue
+    )
+{
+    uint32_t dwError = 0;
+    const char *ppszTrue[] = {"yes", "y", "true", "t", "on", "1", NULL};
+    const char *ppszFalse[] = {"no", "n", "false", "f", "off", "0", NULL};
+    int i;
+
+    for (i = 0; ppszTrue[i]; i++)
+    {
+        if (!strcasecmp(pszValue, ppszTrue[i]))
+        {
+            *pnValue = 1;
+            goto cleanup;
+        }
+    }
+    for (i = 0; ppszFalse[i]; i++)
+    {
+        if (!strcasecmp(pszValue, ppszFalse[i]))
+        {
+            *pnValue = 0;
+            goto cleanup;
+        }
+    }
+
+    pr_err("Invalid input(%s) for '%s'\n", pszValue, pszKey);
+    dwError = ERROR_TDNF_CLI_AUTOMATIC_CONF;
+    BAIL_ON_CLI_ERROR(dwError);
+
+cleanup:
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+static
+uint32_t
+_AutomaticParseSeconds(
+    const char *pszKey,
+    const char *pszValue,
+    int *pnValue
+    )
+{
+    uint32_t dwError = 0;
+    char *pszEnd = NULL;
+    long lValue;
+
+    errno = 0;
+    lValue = strtol(pszValue, &pszEnd, 10);
+    if (errno || pszEnd == pszValue || *pszEnd || lValue < 0 ||
+        lValue > INT32_MAX)
+    {
+        pr_err("Invalid input(%s) for '%s'\n", pszValue, pszKey);
+        dwError = ERROR_TDNF_CLI_AUTOMATIC_CONF;
+        BAIL_ON_CLI_ERROR(dwError);
+    }
+    *pnValue = (int)lValue;
+
+cleanup:
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+static
+uint32_t
+_AutomaticReadCommands(
+    struct cnfnode *cn_section,
+    PTDNF_AUTOMATIC_CONF pConf
+    )
+{
+    uint32_t dwError = 0;
+    struct cnfnode *cn;
+
+    for (cn = cn_section->first_child; cn; cn = cn->next)
+    {
+        if ((cn->name[0] == '.') || (cn->value == NULL))
+            continue;
+
+        if (!strcmp(cn->name, "upgrade_type"))
+        {
+            if (strcmp(cn->value, "all") && strcmp(cn->value, "security"))
+            {
+                pr_err("Invalid entry 'commands'|'upgrade_type'='%s'\n",
+                       cn->value);
+                dwError = ERROR_TDNF_CLI_AUTOMATIC_CONF;
+                BAIL_ON_CLI_ERROR(dwError);
+            }
+            pConf->nUpgradeSecurity = !strcmp(cn->value, "security");
+        }
+        else if (!strcmp(cn->name, "sec_severity"))
+        {
+            TDNF_CLI_SAFE_FREE_MEMORY(pConf->pszSeverity);
+            dwError = TDNFAllocateString(cn->value, &pConf->pszSeverity);
+        }
+        else if (!strcmp(cn->name, "reboot_required"))
+        {
+            dwError = _AutomaticParseBool(cn->name, cn->value,
+                                          &pConf->nRebootRequired);
+        }
+        else if (!strcmp(cn->name, "random_sleep"))
+        {
+            dwError = _AutomaticParseSeconds(cn->name, cn->value,
+                                             &pConf->nRandomSleep);
+        }
+        else if (!strcmp(cn->name, "network_online_timeout"))
+        {
+            dwError = _AutomaticParseSeconds(cn->name, cn->value,
+                                             &pConf->nNetworkTimeout);
+        }
+        else if (!strcmp(cn->name, "show_updates"))
+        {
+            dwError = _AutomaticParseBool(cn->name, cn->value,
+                                          &pConf->nShowUpdates);
+        }
+        else if (!strcmp(cn->name, "apply_updates"))
+        {
+            dwError = _AutomaticParseBool(cn->name, cn->value,
+                                          &pConf->nApplyUpdates);
+        }
+        else if (!strcmp(cn->name, "download_updates"))
+        {
+            dwError = _AutomaticParseBool(cn->name, cn->value,
+                                          &pConf->nDownloadUpdates);
+        }
+        else
+        {
+            pr_err("Invalid entry 'commands'|'%s'='%s'\n",
+                   cn->name, cn->value);
+            dwError = ERROR_TDNF_CLI_AUTOMATIC_CONF;
+        }
+        BAIL_ON_CLI_ERROR(dwError);
+    }
+
+cleanup:
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+static
+uint32_t
+_AutomaticReadEmitter(
+    struct cnfnode *cn_section,
+    PTDNF_AUTOMATIC_CONF pConf
+    )
+{
+    uint32_t dwError = 0;
+    struct cnfnode *cn;
+
+    for (cn = cn_section->first_child; cn; cn = cn->next)
+    {
+        if ((cn->name[0] == '.') || (cn->value == NULL))
+            continue;
+
+        if (!strcmp(cn->name, "emit_to_stdio"))
+        {
+            dwError = _AutomaticParseBool(cn->name, cn->value,
+                                          &pConf->nEmitToStdio);
+        }
+        else if (!strcmp(cn->name, "emit_to_file") && cn->value[0])
+        {
+            TDNF_CLI_SAFE_FREE_MEMORY(pConf->pszEmitFile);
+            dwError = TDNFAllocateString(cn->value, &pConf->pszEmitFile);
+        }
+        else if (!strcmp(cn->name, "system_name") && cn->value[0])
+        {
+            TDNF_CLI_SAFE_FREE_MEMORY(pConf->pszSystemName);
+            dwError = TDNFAllocateString(cn->value, &pConf->pszSystemName);
+        }
+        else
+        {
+            pr_err("Invalid entry 'emitter'|'%s'='%s'\n",
+                   cn->name, cn->value);
+            dwError = ERROR_TDNF_CLI_AUTOMATIC_CONF;
+        }
+        BAIL_ON_CLI_ERROR(dwError);
+    }
+
+cleanup:
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+static
+uint32_t
+_AutomaticReadConf(
+    PTDNF_CMD_ARGS pCmdArgs,
+    PTDNF_AUTOMATIC_CONF *ppConf
+    )
+{
+    uint32_t dwError = 0;
+    PTDNF_AUTOMATIC_CONF pConf = NULL;
+    const char *pszConfFile = TDNF_AUTOMATIC_CONF_FILE;
+    PTDNF_CMD_OPT pSetOpt = NULL;
+    struct cnfnode *cn_conf = NULL, *cn_section, *cn;
+    struct cnfmodule *mod_ini;
+
+    for (pSetOpt = pCmdArgs->pSetOpt; pSetOpt; pSetOpt = pSetOpt->pNext)
+    {
+        if (!strcasecmp(pSetOpt->pszOptName, "autoconf"))
+        {
+            pszConfFile = pSetOpt->pszOptValue;
+        }
+    }
+
+    if (access(pszConfFile, F_OK))
+    {
+        pr_err("Configuration file: '%s' does not exist\n", pszConfFile);
+        dwError = ERROR_TDNF_FILE_NOT_FOUND;
+        BAIL_ON_CLI_ERROR(dwError);
+    }
+
+    dwError = TDNFAllocateMemory(1, sizeof(TDNF_AUTOMATIC_CONF),
+                                 (void **)&pConf);
+    BAIL_ON_CLI_ERROR(dwError);
+
+    /* defaults of automatic.conf */
+    pConf->nRandomSleep = 120;
+    pConf->nNetworkTimeout = 300;
+    pConf->nShowUpdates = 1;
+    pConf->nEmitToStdio = 1;
+
+    register_ini(NULL);
+    mod_ini = find_cnfmodule("ini");
+    if (mod_ini == NULL)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_CLI_ERROR(dwError);
+    }
+
+    cn_conf = cnfmodule_parse_file(mod_ini, pszConfFile);
+    if (cn_conf == NULL)
+    {
+        dwError = errno ? ERROR_TDNF_SYSTEM_BASE + errno :
+                          ERROR_TDNF_CONF_FILE_LOAD;
+        BAIL_ON_CLI_ERROR(dwError);
+    }
+
+    for (cn_section = cn_conf->first_child; cn_section;
+         cn_section = cn_section->next)
+    {
+        if (cn_section->name[0] == '.')
+            continue;
+
+        if (!strcmp(cn_section->name, "commands"))
+        {
+            dwError = _AutomaticReadCommands(cn_section, pConf);
+        }
+        else if (!strcmp(cn_section->name, "emitter"))
+        {
+            dwError = _AutomaticReadEmitter(cn_section, pConf);
+        }
+        else if (!strcmp(cn_section->name, "base"))
+        {
+            for (cn = cn_section->first_child; cn; cn = cn->next)
+            {
+                if ((cn->name[0] == '.') || (cn->value == NULL))
+                    continue;
+
+                if (strcmp(cn->name, "tdnf_conf") || !cn->value[0])
+                {
+                    pr_err("Invalid entry 'base'|'%s'='%s'\n",
+                           cn->name, cn->value);
+                    dwError = ERROR_TDNF_CLI_AUTOMATIC_CONF;
+                    BAIL_ON_CLI_ERROR(dwError);
+                }
+                TDNF_CLI_SAFE_FREE_MEMORY(pConf->pszTdnfConf);
+                dwError = TDNFAllocateString(cn->value, &pConf->pszTdnfConf);
+                BAIL_ON_CLI_ERROR(dwError);
+            }
+        }
+        else
+        {
+            pr_err("Invalid entry '%s'\n", cn_section->name);
+            dwError = ERROR_TDNF_CLI_AUTOMATIC_CONF;
+        }
+        BAIL_ON_CLI_ERROR(dwError);
+    }
+
+    *ppConf = pConf;
+
+cleanup:
+    destroy_cnftree(cn_conf);
+    return dwError;
+
+error:
+    _AutomaticFreeConf(pConf);
+    goto cleanup;
+}
+
+/*
+ * Called before the handle is opened, for the settings of
+ * automatic.conf that decide how it is opened: the tdnf config
+ * file, the advisory filters and the random sleep of the timer.
+ */
+uint32_t
+TDNFCliAutomaticPrepare(
+    PTDNF_CMD_ARGS pCmdArgs
+    )
+{
+    uint32_t dwError = 0;
+    PTDNF_AUTOMATIC_CONF pConf = NULL;
+    PTDNF_CMD_OPT pSetOpt = NULL;
+    int nTimer = 0;
+    int nSleep = 0;
+
+    if (!pCmdArgs)
+    {
+        dwError = ERROR_TDNF_CLI_INVALID_ARGUMENT;
+        BAIL_ON_CLI_ERROR(dwError);
+    }
+
+    dwError = _AutomaticReadConf(pCmdArgs, &pConf);
+    BAIL_ON_CLI_ERROR(dwError);
+
+    /* -c on the command line wins over base.tdnf_conf */
+    if (!pCmdArgs->pszConfFile && pConf->pszTdnfConf)
+    {
+        if (access(pConf->pszTdnfConf, F_OK))
+        {
+            pr_err("tdnf conf '%s' does not exist\n", pConf->pszTdnfConf);
+            dwError = ERROR_TDNF_FILE_NOT_FOUND;
+            BAIL_ON_CLI_ERROR(dwError);
+        }
+        dwError = TDNFAllocateString(pConf->pszTdnfConf,
+                                     &pCmdArgs->pszConfFile);
+        BAIL_ON_CLI_ERROR(dwError);
+    }
+
+    if (pConf->nUpgradeSecurity)
+    {
+        dwError = AddSetOptWithValues(pCmdArgs, "security", "1");
+        BAIL_ON_CLI_ERROR(dwError);
+    }
+    if (pConf->pszSeverity)
+    {
+        dwError = AddSetOptWithValues(pCmdArgs, "sec-severity",
+                                      pConf->pszSeverity);
+        BAIL_ON_CLI_ERROR(dwError);
+    }
+    if (pConf->nRebootRequired)
+    {
+        dwError = AddSetOptWithValues(pCmdArgs, "reboot-required", "1");
+        BAIL_ON_CLI_ERROR(dwError);
+    }
+
+    pCmdArgs->nRefresh = 1;
+    pCmdArgs->nAssumeYes = 1;
+
+    for (pSetOpt = pCmdArgs->pSetOpt; pSetOpt; pSetOpt = pSetOpt->pNext)
+    {
+        if (!strcasecmp(pSetOpt->pszOptName, "timer"))
+        {
+            nTimer = 1;
+        }
+    }
+
+    /* no lock is taken yet, other tdnf runs can go on meanwhile */
+    if (nTimer && pConf->nRandomSleep > 0)
+    {
+        srand(time(NULL) ^ getpid());
+        nSleep = rand() % pConf->nRandomSleep;
+        pr_info("Sleep for %d second(s)...\n", nSleep);
+        sleep(nSleep);
+    }
+
+cleanup:
+    _AutomaticFreeConf(pConf);
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+static
+uint32_t
+_AutomaticCountEnabledRepos(
+    PTDNF_CLI_CONTEXT pContext,
+    int *pnCount
+    )
+{
+    uint32_t dwError = 0;
+    PTDNF_REPO_DATA pRepos = NULL;
+    PTDNF_REPO_DATA pRepo = NULL;
+    int nCount = 0;
+
+    dwError = pContext->pFnRepoList(pContext, REPOLISTFILTER_ENABLED,
+                                    &pRepos);
+    BAIL_ON_CLI_ERROR(dwError);
+
+    for (pRepo = pRepos; pRepo; pRepo = pRepo->pNext)
+    {
+        if (strcmp(pRepo->pszId, CMDLINE_REPO_NAME))
+        {
+            nCount++;
+        }
+    }
+    *pnCount = nCount;
+
+cleanup:
+    TDNFFreeRepos(pRepos);
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+/*
+ * Load the metadata, retrying for up to network_online_timeout
+ * seconds while no repo can be reached. A failed try leaves no
+ * half loaded pool, see TDNFRefresh().
+ */
+static
+uint32_t
+_AutomaticRefresh(
+    PTDNF_CLI_CONTEXT pContext,
+    PTDNF_AUTOMATIC_CONF pConf
+    )
+{
+    uint32_t dwError = 0;
+    time_t tEnd = time(NULL) + pConf->nNetworkTimeout;
+    int nRepos = 0;
+
+    while (1)
+    {
+        dwError = TDNFCliRefresh(pContext);
+        if (!dwError)
+        {
+            dwError = _AutomaticCountEnabledRepos(pContext, &nRepos);
+            BAIL_ON_CLI_ERROR(dwError);
+            if (nRepos > 0)
+            {
+                break;
+            }
+            pr_err("No tdnf repo is enabled, retrying...\n");
+        }
+        else
+        {
+            pr_err("Failed to refresh repo cache (%u), retrying...\n",
+                   dwError);
+        }
+
+        if (time(NULL) + TDNF_AUTOMATIC_RETRY_SECS > tEnd)
+        {
+            pr_err("System is off-line...\n");
+            dwError = ERROR_TDNF_CLI_AUTOMATIC_OFFLINE;
+            BAIL_ON_CLI_ERROR(dwError);
+        }
+        sleep(TDNF_AUTOMATIC_RETRY_SECS);
+    }
+
+cleanup:
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+static
+uint32_t
+_AutomaticAddPkgs(
+    struct json_dump *jd_list,
+    PTDNF_PKG_INFO pPkgInfos,
+    int nText
+    )
+{
+    uint32_t dwError = 0;
+    PTDNF_PKG_INFO pPkgInfo;
+    struct json_dump *jd_pkg = NULL;
+
+    for (pPkgInfo = pPkgInfos; pPkgInfo; pPkgInfo = pPkgInfo->pNext)
+    {
+        jd_pkg = jd_create(0);
+        CHECK_JD_NULL(jd_pkg);
+
+        CHECK_JD_RC(jd_map_start(jd_pkg));
+        CHECK_JD_RC(jd_map_add_string(jd_pkg, "Name", pPkgInfo->pszName));
+        CHECK_JD_RC(jd_map_add_string(jd_pkg, "Arch", pPkgInfo->pszArch));
+        CHECK_JD_RC(jd_map_add_fmt(jd_pkg, "Evr", "%s-%s",
+                                   pPkgInfo->pszVersion,
+                                   pPkgInfo->pszRelease));
+        CHECK_JD_RC(jd_map_add_string(jd_pkg, "Repo", pPkgInfo->pszRepoName));
+
+        CHECK_JD_RC(jd_list_add_child(jd_list, jd_pkg));
+        JD_SAFE_DESTROY(jd_pkg);
+
+        if (nText)
+        {
+            pr_crit("%s-%s-%s.%s\n", pPkgInfo->pszName, pPkgInfo->pszVersion,
+                    pPkgInfo->pszRelease, pPkgInfo->pszArch);
+        }
+    }
+
+cleanup:
+    return dwError;
+
+error:
+    JD_SAFE_DESTROY(jd_pkg);
+    goto cleanup;
+}
+
+static
+uint32_t
+_AutomaticWriteFile(
+    const char *pszFile,
+    const char *pszContent
+    )
+{
+    uint32_t dwError = 0;
+    char *pszBackup = NULL;
+    char szTime[32] = {0};
+    time_t tNow = time(NULL);
+    struct stat st = {0};
+    FILE *fp = NULL;
+
+    /* keep the previous result, like the script did */
+    if (stat(pszFile, &st) == 0 && st.st_size > 0)
+    {
+        strftime(szTime, sizeof(szTime), "%F-%H.%M.%S", localtime(&tNow));
+        dwError = TDNFAllocateStringPrintf(&pszBackup,
+                                           "%s.tdnf-automatic-%s.bak",
+                                           pszFile, szTime);
+        BAIL_ON_CLI_ERROR(dwError);
+
+        if (rename(pszFile, pszBackup))
+        {
+            dwError = ERROR_TDNF_SYSTEM_BASE + errno;
+            BAIL_ON_CLI_ERROR(dwError);
+        }
+    }
+
+    fp = fopen(pszFile, "w");
+    if (!fp)
+    {
+        dwError = ERROR_TDNF_SYSTEM_BASE + errno;
+        BAIL_ON_CLI_ERROR(dwError);
+    }
+    if (fputs(pszContent, fp) == EOF || fputc('\n', fp) == EOF)
+    {
+        dwError = ERROR_TDNF_SYSTEM_BASE + errno;
+        BAIL_ON_CLI_ERROR(dwError);
+    }
+
+cleanup:
+    if (fp)
+    {
+        fclose(fp);
+    }
+    TDNF_CLI_SAFE_FREE_MEMORY(pszBackup);
+    return dwError;
+
+error:
+    pr_err("Could not write result to '%s'\n", pszFile);
+    goto cleanup;
+}
+
+/*
+ * Report the result as text on stdout (emit_to_stdio) and as json
+ * in emit_to_file, or as json on stdout with -j. The json result
+ * has the same text in "Message" so readers of the old text file
+ * still find it.
+ */
+static
+uint32_t
+_AutomaticEmit(
+    PTDNF_CMD_ARGS pCmdArgs,
+    PTDNF_AUTOMATIC_CONF pConf,
+    const char *pszStatus,
+    const char *pszSystemName,
+    PTDNF_SOLVED_PKG_INFO pSolvedInfo,
+    PTDNF_UPDATEINFO pUpdateInfo
+    )
+{
+    uint32_t dwError = 0;
+    struct json_dump *jd = NULL;
+    struct json_dump *jd_list = NULL;
+    PTDNF_UPDATEINFO pInfo = NULL;
+    char *pszMessage = NULL;
+    char szTime[64] = {0};
+    time_t tNow = time(NULL);
+    int nText = pConf->nEmitToStdio && !pCmdArgs->nJsonOutput;
+
+    strftime(szTime, sizeof(szTime), "%c", localtime(&tNow));
+
+    if (!strcmp(pszStatus, "uptodate"))
+    {
+        dwError = TDNFAllocateStringPrintf(&pszMessage,
+                      "No updates available on %s. System upto date...",
+                      pszSystemName);
+    }
+    else
+    {
+        dwError = TDNFAllocateStringPrintf(&pszMessage,
+                      "The following updates are %s on - %s:",
+                      strcmp(pszStatus, "applied") ? "available" : "applied",
+                      pszSystemName);
+    }
+    BAIL_ON_CLI_ERROR(dwError);
+
+    if (nText)
+    {
+        pr_crit("\n%s\n", pszMessage);
+    }
+
+    jd = jd_create(0);
+    CHECK_JD_NULL(jd);
+
+    CHECK_JD_RC(jd_map_start(jd));
+    CHECK_JD_RC(jd_map_add_string(jd, "SystemName", pszSystemName));
+    CHECK_JD_RC(jd_map_add_string(jd, "Time", szTime));
+    CHECK_JD_RC(jd_map_add_string(jd, "UpgradeType",
+                                  pConf->nUpgradeSecurity ? "security" : "all"));
+    CHECK_JD_RC(jd_map_add_string(jd, "Status", pszStatus));
+    CHECK_JD_RC(jd_map_add_string(jd, "Message", pszMessage));
+
+    jd_list = jd_create(0);
+    CHECK_JD_NULL(jd_list);
+    CHECK_JD_RC(jd_list_start(jd_list));
+    if (pSolvedInfo)
+    {
+        dwError = _AutomaticAddPkgs(jd_list, pSolvedInfo->pPkgsToUpgrade, nText);
+        BAIL_ON_CLI_ERROR(dwError);
+        dwError = _AutomaticAddPkgs(jd_list, pSolvedInfo->pPkgsToInstall, nText);
+        BAIL_ON_CLI_ERROR(dwError);
+    }
+    CHECK_JD_RC(jd_map_add_child(jd, "Updates", jd_list));
+    JD_SAFE_DESTROY(jd_list);
+
+    if (pUpdateInfo)
+    {
+        jd_list = jd_create(0);
+        CHECK_JD_NULL(jd_list);
+        CHECK_JD_RC(jd_list_start(jd_list));
+        if (nText)
+        {
+            pr_crit("\nAdvisories:\n");
+        }
+        for (pInfo = pUpdateInfo; pInfo; pInfo = pInfo->pNext)
+        {
+            CHECK_JD_RC(jd_list_add_string(jd_list, pInfo->pszID));
+            if (nText)
+            {
+                pr_crit("%s %s\n", pInfo->pszID,
+                        TDNFGetUpdateInfoType(pInfo->nType));
+            }
+        }
+        CHECK_JD_RC(jd_map_add_child(jd, "Advisories", jd_list));
+        JD_SAFE_DESTROY(jd_list);
+    }
+
+    if (nText && !strcmp(pszStatus, "applied"))
+    {
+        pr_crit("\n--- Updates completed at %s ---\n", szTime);
+    }
+
+    if (pCmdArgs->nJsonOutput)
+    {
+        pr_json(jd->buf);
+    }
+
+    if (pConf->pszEmitFile)
+    {
+        dwError = _AutomaticWriteFile(pConf->pszEmitFile, jd->buf);
+        BAIL_ON_CLI_ERROR(dwError);
+    }
+
+cleanup:
+    JD_SAFE_DESTROY(jd_list);
+    JD_SAFE_DESTROY(jd);
+    TDNF_CLI_SAFE_FREE_MEMORY(pszMessage);
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+uint32_t
+TDNFCliAutomaticCommand(
+    PTDNF_CLI_CONTEXT pContext,
+    PTDNF_CMD_ARGS pCmdArgs
+    )
+{
+    uint32_t dwError = 0;
+    PTDNF_AUTOMATIC_CONF pConf = NULL;
+    PTDNF_SOLVED_PKG_INFO pSolvedInfo = NULL;
+    PTDNF_UPDATEINFO pUpdateInfo = NULL;
+    TDNF_UPDATEINFO_ARGS stInfoArgs = {0};
+    PTDNF_CMD_OPT pSetOpt = NULL;
+    const char *pszStatus = "available";
+    const char *pszSystemName = NULL;
+    char szHostName[256] = {0};
+    int nNotify = 0;
+    int nInstall = 0;
+
+    if (!pContext || !pContext->hTdnf || !pCmdArgs)
+    {
+        dwError = ERROR_TDNF_CLI_INVALID_ARGUMENT;
+        BAIL_ON_CLI_ERROR(dwError);
+    }
+
+    dwError = _AutomaticReadConf(pCmdArgs, &pConf);
+    BAIL_ON_CLI_ERROR(dwError);
+
+    for (pSetOpt = pCmdArgs->pSetOpt; pSetOpt; pSetOpt = pSetOpt->pNext)
+    {
+        if (!strcasecmp(pSetOpt->pszOptName, "notify"))
+        {
+            nNotify = 1;
+        }
+        else if (!strcasecmp(pSetOpt->pszOptName, "install"))
+        {
+            nInstall = 1;
+        }
+    }
+
+    /* --notify wins over --install, without either the config decides */
+    if (nNotify)
+    {
+        nInstall = 0;
+    }
+    else if (!nInstall)
+    {
+        nInstall = !pConf->nShowUpdates && pConf->nApplyUpdates;
+    }
+
+    pszSystemName = pConf->pszSystemName;
+    if (!pszSystemName)
+    {
+        gethostname(szHostName, sizeof(szHostName) - 1);
+        pszSystemName = szHostName;
+    }
+
+    dwError = _AutomaticRefresh(pContext, pConf);
+    BAIL_ON_CLI_ERROR(dwError);
+
+    dwError = pContext->pFnResolve(pContext, ALTER_UPGRADEALL, &pSolvedInfo);
+    /* a security or severity filter that matches no advisory means
+       there is nothing to upgrade */
+    if (dwError == ERROR_TDNF_NO_DATA)
+    {
+        dwError = 0;
+    }
+    BAIL_ON_CLI_ERROR(dwError);
+
+    if (!pSolvedInfo || !pSolvedInfo->nNeedAction)
+    {
+        dwError = _AutomaticEmit(pCmdArgs, pConf, "uptodate", pszSystemName,
+                                 NULL, NULL);
+        BAIL_ON_CLI_ERROR(dwError);
+        goto cleanup;
+    }
+
+    /* the advisories behind a filtered upgrade, before a transaction
+       releases the pool */
+    if (pConf->nUpgradeSecurity || pConf->pszSeverity ||
+        pConf->nRebootRequired)
+    {
+        dwError = pContext->pFnUpdateInfo(pContext, &stInfoArgs,
+                                          &pUpdateInfo);
+        if (dwError == ERROR_TDNF_NO_DATA)
+        {
+            dwError = 0;
+        }
+        BAIL_ON_CLI_ERROR(dwError);
+    }
+
+    if (nInstall)
+    {
+        dwError = pContext->pFnAlter(pContext, pSolvedInfo);
+        BAIL_ON_CLI_ERROR(dwError);
+        pszStatus = "applied";
+    }
+    else if (pConf->nDownloadUpdates)
+    {
+        dwError = pContext->pFnPrefetch(pContext);
+        BAIL_ON_CLI_ERROR(dwError);
+        pszStatus = "downloaded";
+    }
+
+    dwError = _AutomaticEmit(pCmdArgs, pConf, pszStatus, pszSystemName,
+                             pSolvedInfo, pUpdateInfo);
+    BAIL_ON_CLI_ERROR(dwError);
+
+cleanup:
+    if (pUpdateInfo)
+    {
+        TDNFFreeUpdateInfo(pUpdateInfo);
+    }
+    TDNFCliFreeSolvedPackageInfo(pSolvedInfo);
+    _AutomaticFreeConf(pConf);
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+/*
+ * bin/tdnf-automatic keeps the exit codes of the former script, it
+ * asks for them with --legacy-exit-codes.
+ */
+int
+TDNFCliAutomaticIsLegacy(
+    PTDNF_CMD_ARGS pCmdArgs
+    )
+{
+    PTDNF_CMD_OPT pSetOpt = NULL;
+
+    if (!pCmdArgs || pCmdArgs->nCmdCount < 1 ||
+        strcmp(pCmdArgs->ppszCmds[0], "automatic"))
+    {
+        return 0;
+    }
+    for (pSetOpt = pCmdArgs->pSetOpt; pSetOpt; pSetOpt = pSetOpt->pNext)
+    {
+        if (!strcasecmp(pSetOpt->pszOptName, "legacy-exit-codes"))
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Print dwErrorCode like the former script, without the error
+ * number, and return the exit status it used for it.
+ */
+uint32_t
+TDNFCliAutomaticLegacyError(
+    uint32_t dwErrorCode
+    )
+{
+    char *pszError = NULL;
+    uint32_t dwStatus = 121;
+
+    switch (dwErrorCode)
+    {
+        case 0:
+        case ERROR_TDNF_CLI_NOTHING_TO_DO:
+        case ERROR_TDNF_NO_DATA:
+            dwStatus = 0;
+            break;
+        case ERROR_TDNF_CLI_AUTOMATIC_CONF:
+            dwStatus = 22;
+            break;
+        case ERROR_TDNF_FILE_NOT_FOUND:
+            dwStatus = 2;
+            break;
+        case ERROR_TDNF_CLI_AUTOMATIC_OFFLINE:
+            dwStatus = 64;
+            break;
+        case ERROR_TDNF_PERM:
+            dwStatus = 13;
+            break;
+    }
+
+    if (dwErrorCode &&
+        (dwErrorCode < ERROR_TDNF_BASE ?
+         TDNFCliGetErrorString(dwErrorCode, &pszError) :
+         TDNFGetErrorString(dwErrorCode, &pszError)) == 0 &&
+        pszError)
+    {
+        pr_err("%s\n", pszError);
+    }
+    TDNF_CLI_SAFE_FREE_MEMORY(pszError);
+
+    return dwStatus;
+}
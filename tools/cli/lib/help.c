@@ -13,6 +13,7 @@ static const char *help_msg =
  "common options:\n"
  "           [--assumeno]\n"
  "           [-y, --assumeyes]\n"
+ "           [--cached]\n"
  "           [-C, --cacheonly]\n"
  "           [-c [config file]]\n"
  "           [--debugsolver]\n"
@@ -24,7 +25,7 @@ static const char *help_msg =
  "           [--enablerepo=<repoid>]\n"
  "           [--enableplugin=<plugin_name>]\n"
  "           [--exclude [file1,file2,...]]\n"
- "           [--installroot [path]]\n"
+ "           [--installroot [path]]... (once per root for a batch run)\n"
  "           [--noautoremove]\n"
  "           [--nogpgcheck]\n"
  "           [--noplugins]\n"
@@ -83,9 +84,21 @@ static const char *help_msg =
  "           [--newest-only]\n"
  "           [--norepopath]\n"
  "           [--source]\n"
- "           [--urls]\n\n"
+ "           [--urls]\n"
+ "           [--workers=<count>]\n\n"
+ "clean options:\n"
+ "           [--stale]\n\n"
+ "makecache options:\n"
+ "           [--prefetch]\n\n"
+ "automatic options:\n"
+ "           [--autoconf=<automatic.conf>]\n"
+ "           [--install]\n"
+ "           [--legacy-exit-codes]\n"
+ "           [--notify]\n"
+ "           [--timer]\n\n"
  "List of Main Commands\n\n"
  "autoerase          same as 'autoremove'\n"
+ "automatic          Check for, download or apply updates as set in automatic.conf\n"
  "autoremove         Remove a package and its automatic dependencies or all auto installed packages\n"
  "check              Checks repositories for problems\n"
  "check-local        Checks local rpm folder for problems\n"
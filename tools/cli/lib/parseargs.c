@@ -20,6 +20,7 @@ static struct option pstOptions[] =
     {"assumeyes",     no_argument, 0, 'y'},                //--assumeyes
     {"best",          no_argument, &_opt.nBest, 1},        //--best
     {"builddeps",     no_argument, &_opt.nBuildDeps, 1},
+    {"cached",        no_argument, 0, 0},                  //--cached, check-update and updateinfo from the makecache summary
     {"cacheonly",     no_argument, &_opt.nCacheOnly, 1}, //-C, --cacheonly
     {"config",        required_argument, 0, 'c'},          //-c, --config
     {"debuglevel",    required_argument, 0, 'd'},          //-d, --debuglevel
@@ -70,6 +71,17 @@ static struct option pstOptions[] =
     {"newest-only",   no_argument, 0, 0},
     {"norepopath",    no_argument, 0, 0},
     {"urls",          no_argument, 0, 0},
+    {"workers",       required_argument, 0, 0},
+    // clean options
+    {"stale",         no_argument, 0, 0},
+    // makecache options
+    {"prefetch",      no_argument, 0, 0},
+    // automatic options
+    {"autoconf",      required_argument, 0, 0},
+    {"install",       no_argument, 0, 0},
+    {"legacy-exit-codes", no_argument, 0, 0},
+    {"notify",        no_argument, 0, 0},
+    {"timer",         no_argument, 0, 0},
     // repoquery option
     // repoquery select options
     {"available",     no_argument, 0, 0},
@@ -248,6 +260,18 @@ TDNFCliParseArgs(
         BAIL_ON_CLI_ERROR(dwError);
     }
 
+    for (int i = 0;
+         pCmdArgs->ppszInstallRoots && pCmdArgs->ppszInstallRoots[i];
+         i++)
+    {
+        if (pCmdArgs->ppszInstallRoots[i][0] != '/')
+        {
+            pr_crit("Install root must be an absolute path.\n");
+            dwError = ERROR_TDNF_INVALID_PARAMETER;
+            BAIL_ON_CLI_ERROR(dwError);
+        }
+    }
+
     dwError = TDNFCopyOptions(&_opt, pCmdArgs);
     BAIL_ON_CLI_ERROR(dwError);
 
@@ -350,6 +374,61 @@ error:
     goto cleanup;
 }
 
+/*
+ * --installroot can be given more than once to run the command
+ * for each root in turn. The first one is pszInstallRoot, all of
+ * them are listed in ppszInstallRoots once there is a second.
+ */
+static
+uint32_t
+_AddInstallRoot(
+    PTDNF_CMD_ARGS pCmdArgs,
+    const char *pszInstallRoot
+    )
+{
+    uint32_t dwError = 0;
+    int nCount = 0;
+
+    if (!pCmdArgs->pszInstallRoot)
+    {
+        dwError = TDNFAllocateString(pszInstallRoot,
+                                     &pCmdArgs->pszInstallRoot);
+        BAIL_ON_CLI_ERROR(dwError);
+        goto cleanup;
+    }
+
+    if (!pCmdArgs->ppszInstallRoots)
+    {
+        dwError = TDNFAllocateMemory(2, sizeof(char *),
+                                     (void **)&pCmdArgs->ppszInstallRoots);
+        BAIL_ON_CLI_ERROR(dwError);
+
+        dwError = TDNFAllocateString(pCmdArgs->pszInstallRoot,
+                                     &pCmdArgs->ppszInstallRoots[0]);
+        BAIL_ON_CLI_ERROR(dwError);
+    }
+
+    while (pCmdArgs->ppszInstallRoots[nCount])
+    {
+        nCount++;
+    }
+
+    dwError = TDNFReAllocateMemory((nCount + 2) * sizeof(char *),
+                                   (void **)&pCmdArgs->ppszInstallRoots);
+    BAIL_ON_CLI_ERROR(dwError);
+    pCmdArgs->ppszInstallRoots[nCount + 1] = NULL;
+
+    dwError = TDNFAllocateString(pszInstallRoot,
+                                 &pCmdArgs->ppszInstallRoots[nCount]);
+    BAIL_ON_CLI_ERROR(dwError);
+
+cleanup:
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
 uint32_t
 ParseOption(
     const char *pszName,
@@ -379,7 +458,7 @@ ParseOption(
     }
     else if (!strcasecmp(pszName, "installroot"))
     {
-        dwError = TDNFAllocateString(optarg, &pCmdArgs->pszInstallRoot);
+        dwError = _AddInstallRoot(pCmdArgs, optarg);
     }
     else if (!strcasecmp(pszName, "downloaddir"))
     {
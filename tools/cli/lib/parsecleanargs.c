@@ -16,13 +16,25 @@ TDNFCliParseCleanArgs(
 {
     uint32_t dwError = 0;
     uint32_t nCleanType = CLEANTYPE_NONE;
+    uint32_t nStale = CLEANTYPE_NONE;
+    PTDNF_CMD_OPT pSetOpt = NULL;
 
     if(!pCmdArgs)
     {
         dwError = ERROR_TDNF_INVALID_PARAMETER;
         BAIL_ON_CLI_ERROR(dwError);
     }
-    if(pCmdArgs->nCmdCount == 1)
+
+    for (pSetOpt = pCmdArgs->pSetOpt; pSetOpt; pSetOpt = pSetOpt->pNext)
+    {
+        if (strcasecmp(pSetOpt->pszOptName, "stale") == 0)
+        {
+            nStale = CLEANTYPE_STALE;
+        }
+    }
+
+    //tdnf clean --stale needs no type
+    if(pCmdArgs->nCmdCount == 1 && !nStale)
     {
         dwError = ERROR_TDNF_CLI_CLEAN_REQUIRES_OPTION;
         BAIL_ON_CLI_ERROR(dwError);
@@ -35,7 +47,7 @@ TDNFCliParseCleanArgs(
         BAIL_ON_CLI_ERROR(dwError);
     }
 
-    *pnCleanType = nCleanType;
+    *pnCleanType = nCleanType | nStale;
 
 cleanup:
     return dwError;
@@ -90,6 +90,16 @@ TDNFCliParseRepoSyncArgs(
         {
             pReposyncArgs->nPrintUrlsOnly = 1;
         }
+        else if (strcasecmp(pSetOpt->pszOptName, "workers") == 0)
+        {
+            pReposyncArgs->nWorkers = strtoi(pSetOpt->pszOptValue);
+            if (pReposyncArgs->nWorkers <= 0)
+            {
+                pr_crit("workers must be a positive number\n");
+                dwError = ERROR_TDNF_CLI_INVALID_ARGUMENT;
+                BAIL_ON_CLI_ERROR(dwError);
+            }
+        }
         else if (strcasecmp(pSetOpt->pszOptName, "download-path") == 0)
         {
             dwError = TDNFAllocateString(
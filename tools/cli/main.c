@@ -11,6 +11,7 @@
 static TDNF_CLI_CMD_MAP arCmdMap[] =
 {
     {"autoerase",          TDNFCliAutoEraseCommand, true},
+    {"automatic",          TDNFCliAutomaticCommand, true},
     {"autoremove",         TDNFCliAutoEraseCommand, true},
     {"check",              TDNFCliCheckCommand, false},
     {"check-local",        TDNFCliCheckLocalCommand, false},
@@ -42,6 +43,54 @@ static TDNF_CLI_CMD_MAP arCmdMap[] =
     {"updateinfo",         TDNFCliUpdateInfoCommand, false},
 };
 
+/*
+ * Run the command for each installroot of a batch run. The handle
+ * keeps the repo metadata loaded for the first root, the next root
+ * only replaces the installed packages. A root with nothing to do
+ * does not stop the others.
+ */
+static
+uint32_t
+_RunForInstallRoots(
+    PTDNF_CLI_CONTEXT pContext,
+    TDNF_CLI_CMD_MAP *pCmd,
+    PTDNF_CMD_ARGS pCmdArgs
+    )
+{
+    uint32_t dwError = 0;
+
+    for (int i = 0; pCmdArgs->ppszInstallRoots[i]; i++)
+    {
+        const char *pszInstallRoot = pCmdArgs->ppszInstallRoots[i];
+
+        if (i > 0)
+        {
+            dwError = TDNFSetInstallRoot(pContext->hTdnf, pszInstallRoot);
+            BAIL_ON_CLI_ERROR(dwError);
+        }
+
+        if (!pCmdArgs->nJsonOutput)
+        {
+            pr_info("Installroot: %s\n", pszInstallRoot);
+        }
+
+        dwError = pCmd->pFnCmd(pContext, pCmdArgs);
+        if (dwError == ERROR_TDNF_CLI_NOTHING_TO_DO ||
+            dwError == ERROR_TDNF_NO_DATA)
+        {
+            TDNFCliPrintError(dwError, pCmdArgs->nJsonOutput);
+            dwError = 0;
+        }
+        BAIL_ON_CLI_ERROR(dwError);
+    }
+
+cleanup:
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
 int main(int argc, char **argv)
 {
     uint32_t dwError = 0;
@@ -92,6 +141,7 @@ int main(int argc, char **argv)
         _context.pFnHistoryResolve = TDNFCliInvokeHistoryResolve;
         _context.pFnAlterHistory = TDNFCliInvokeAlterHistory;
         _context.pFnMark = TDNFCliInvokeMark;
+        _context.pFnPrefetch = TDNFCliInvokePrefetch;
 
         pszCmd = pCmdArgs->ppszCmds[0];
 
@@ -116,6 +166,11 @@ int main(int argc, char **argv)
             {
                 pCmdArgs->nRefresh = 1;
             }
+            else if (!strcmp(pszCmd, "automatic"))
+            {
+                dwError = TDNFCliAutomaticPrepare(pCmdArgs);
+                BAIL_ON_CLI_ERROR(dwError);
+            }
 
             dwError = TDNFInit();
             BAIL_ON_CLI_ERROR(dwError);
@@ -131,7 +186,17 @@ int main(int argc, char **argv)
                 BAIL_ON_CLI_ERROR(dwError);
             }
 
-            dwError = pCmd->pFnCmd(&_context, pCmdArgs);
+            if (pCmdArgs->ppszInstallRoots)
+            {
+                dwError = _RunForInstallRoots(&_context, pCmd, pCmdArgs);
+            }
+            else
+            {
+                dwError = pCmd->pFnCmd(&_context, pCmdArgs);
+            }
+            BAIL_ON_CLI_ERROR(dwError);
+
+            dwError = TDNFCliShowTransferStats(pTdnf, pCmdArgs);
             BAIL_ON_CLI_ERROR(dwError);
         }
         else
@@ -167,6 +232,11 @@ cleanup:
     return dwError;
 
 error:
+    if (TDNFCliAutomaticIsLegacy(pCmdArgs))
+    {
+        dwError = TDNFCliAutomaticLegacyError(dwError);
+        goto cleanup;
+    }
     TDNFCliPrintError(dwError, pCmdArgs ? pCmdArgs->nJsonOutput : 0);
     if (dwError == ERROR_TDNF_CLI_NOTHING_TO_DO ||
         dwError == ERROR_TDNF_NO_DATA)
@@ -310,6 +380,87 @@ error:
     goto cleanup;
 }
 
+/*
+ * Downloads of the run by class, when verbose or when max_bandwidth
+ * held them back.
+ */
+uint32_t
+TDNFCliShowTransferStats(
+    PTDNF pTdnf,
+    PTDNF_CMD_ARGS pCmdArgs
+    )
+{
+    uint32_t dwError = 0;
+    TDNF_XFER_STAT stats[TDNF_XFER_CLASS_COUNT] = {0};
+    const char *ppszClasses[TDNF_XFER_CLASS_COUNT] = {
+        "repomd", "metadata", "packages", "prefetch"
+    };
+    char *pszSize = NULL;
+    char *pszRate = NULL;
+    int nShow = 0;
+    int i;
+
+    if(!pTdnf || !pCmdArgs)
+    {
+        dwError = ERROR_TDNF_CLI_INVALID_ARGUMENT;
+        BAIL_ON_CLI_ERROR(dwError);
+    }
+
+    if (pCmdArgs->nJsonOutput)
+    {
+        goto cleanup;
+    }
+
+    dwError = TDNFGetTransferStats(pTdnf, stats);
+    BAIL_ON_CLI_ERROR(dwError);
+
+    for (i = 0; i < TDNF_XFER_CLASS_COUNT; i++)
+    {
+        if (stats[i].qwBytes &&
+            (pCmdArgs->nVerbose || stats[i].dWaitSeconds > 0))
+        {
+            nShow = 1;
+        }
+    }
+    if (!nShow)
+    {
+        goto cleanup;
+    }
+
+    pr_info("Downloads:\n");
+    for (i = 0; i < TDNF_XFER_CLASS_COUNT; i++)
+    {
+        if (!stats[i].qwBytes)
+        {
+            continue;
+        }
+
+        dwError = TDNFUtilsFormatSize(stats[i].qwBytes, &pszSize);
+        BAIL_ON_CLI_ERROR(dwError);
+
+        dwError = TDNFUtilsFormatSize(
+                      stats[i].dSeconds > 0 ?
+                      (uint64_t)(stats[i].qwBytes / stats[i].dSeconds) : 0,
+                      &pszRate);
+        BAIL_ON_CLI_ERROR(dwError);
+
+        pr_info("  %-10s %8s in %.1fs, %s/s, %.1fs held back\n",
+                ppszClasses[i], pszSize, stats[i].dSeconds, pszRate,
+                stats[i].dWaitSeconds);
+
+        TDNF_CLI_SAFE_FREE_MEMORY(pszSize);
+        TDNF_CLI_SAFE_FREE_MEMORY(pszRate);
+    }
+
+cleanup:
+    TDNF_CLI_SAFE_FREE_MEMORY(pszSize);
+    TDNF_CLI_SAFE_FREE_MEMORY(pszRate);
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
 uint32_t
 TDNFCliInvokeCheck(
     PTDNF_CLI_CONTEXT pContext
@@ -533,3 +684,11 @@ TDNFCliInvokeMark(
 {
     return TDNFMark(pContext->hTdnf, ppszPkgNameSpecs, nValue);
 }
+
+uint32_t
+TDNFCliInvokePrefetch(
+    PTDNF_CLI_CONTEXT pContext
+    )
+{
+    return TDNFPrefetchUpgrades(pContext->hTdnf);
+}
@@ -195,6 +195,12 @@ TDNFCliVerboseShowEnv(
     PTDNF_CMD_ARGS pCmdArgs
     );
 
+uint32_t
+TDNFCliShowTransferStats(
+    PTDNF pTdnf,
+    PTDNF_CMD_ARGS pCmdArgs
+    );
+
 //options.c
 uint32_t
 _TDNFCliGetOptionByName(
@@ -368,3 +374,8 @@ TDNFCliInvokeMark(
     char **ppszPkgNameSpecs,
     uint32_t nValue
     );
+
+uint32_t
+TDNFCliInvokePrefetch(
+    PTDNF_CLI_CONTEXT pContext
+    );